@@ -0,0 +1,223 @@
+// Functional style code: small closures created in loops, passed to higher
+// order functions and called through them, curried and composed, over
+// immutable cons lists. Almost every call is to a closure, and most
+// closures capture variables of the function that made them.
+
+let ITERATIONS = 200;
+let LENGTH = 500;
+
+function cons(head, tail)
+{
+    return { head : head, tail : tail };
+}
+
+function range(from, to)
+{
+    let list = null;
+    for (let i = to - 1; i >= from; --i)
+    {
+        list = cons(i, list);
+    }
+    return list;
+}
+
+function reverse(list)
+{
+    let result = null;
+    while (list != null)
+    {
+        result = cons(list.head, result);
+        list = list.tail;
+    }
+    return result;
+}
+
+function map(list, f)
+{
+    let result = null;
+    while (list != null)
+    {
+        result = cons(f(list.head), result);
+        list = list.tail;
+    }
+    return reverse(result);
+}
+
+function filter(list, predicate)
+{
+    let result = null;
+    while (list != null)
+    {
+        if (predicate(list.head))
+        {
+            result = cons(list.head, result);
+        }
+        list = list.tail;
+    }
+    return reverse(result);
+}
+
+function foldLeft(list, initial, f)
+{
+    let acc = initial;
+    while (list != null)
+    {
+        acc = f(acc, list.head);
+        list = list.tail;
+    }
+    return acc;
+}
+
+// recursive, one frame per element
+function foldRight(list, initial, f)
+{
+    if (list == null)
+    {
+        return initial;
+    }
+    return f(list.head, foldRight(list.tail, initial, f));
+}
+
+function zipWith(a, b, f)
+{
+    let result = null;
+    while (a != null && b != null)
+    {
+        result = cons(f(a.head, b.head), result);
+        a = a.tail;
+        b = b.tail;
+    }
+    return reverse(result);
+}
+
+function compose(f, g)
+{
+    return (x) => f(g(x));
+}
+
+function curry2(f)
+{
+    return (a) => (b) => f(a, b);
+}
+
+function add(a, b)
+{
+    return a + b;
+}
+
+function multiply(a, b)
+{
+    return a * b;
+}
+
+// a counter object made only of closures over one variable
+function makeCounter(start)
+{
+    let count = start;
+    return {
+        increment : () => ++count,
+        add : (n) => { count += n; return count; },
+        get : () => count
+    };
+}
+
+// memoizes a function of small integers
+function memoize(f)
+{
+    let cache = [];
+    return (n) =>
+    {
+        let cached = cache[n];
+        if (cached != undefined)
+        {
+            return cached;
+        }
+        let value = f(n);
+        cache[n] = value;
+        return value;
+    };
+}
+
+// continuation passing sum, every step makes a new closure
+function sumCps(list, k)
+{
+    while (list != null)
+    {
+        let head = list.head;
+        let next = k;
+        k = (x) => next(x + head);
+        list = list.tail;
+    }
+    return k(0);
+}
+
+function run()
+{
+    let numbers = range(0, LENGTH);
+
+    // a pipeline of closures built from curried functions
+    let addOne = curry2(add)(1);
+    let triple = curry2(multiply)(3);
+    let addOneThenTriple = compose(triple, addOne);
+
+    let transformed = map(numbers, addOneThenTriple);
+    let odd = filter(transformed, (x) => x % 2 == 1);
+    let sum = foldLeft(odd, 0, add);
+
+    // 3 * (i + 1) is odd for even i
+    let expected = 0;
+    for (let i = 0; i < LENGTH; i += 2)
+    {
+        expected += 3 * (i + 1);
+    }
+    if (sum != expected)
+    {
+        __write("Pipeline sum is wrong");
+    }
+
+    // every element gets a closure over its own index
+    let adders = map(numbers, (i) => (x) => x + i);
+    let applied = zipWith(adders, numbers, (f, x) => f(x));
+    if (foldRight(applied, 0, add) != LENGTH * (LENGTH - 1))
+    {
+        __write("Applied adders are wrong");
+    }
+
+    let counter = makeCounter(0);
+    foldLeft(numbers, null, (acc, x) =>
+    {
+        if (x % 3 == 0)
+        {
+            counter.increment();
+        }
+        else
+        {
+            counter.add(2);
+        }
+        return acc;
+    });
+    let thirds = ((LENGTH + 2) / 3) | 0;
+    if (counter.get() != thirds + 2 * (LENGTH - thirds))
+    {
+        __write("Counter is wrong");
+    }
+
+    let fib = null;
+    fib = memoize((n) => n < 2 ? n : fib(n - 1) + fib(n - 2));
+    if (fib(70) != 190392490709135)
+    {
+        __write("Memoized fibonacci is wrong");
+    }
+
+    if (sumCps(numbers, (x) => x) != LENGTH * (LENGTH - 1) / 2)
+    {
+        __write("Continuation passing sum is wrong");
+    }
+}
+
+for (let i = 0; i < ITERATIONS; ++i)
+{
+    run();
+}
+
+__write("Closures done");
@@ -0,0 +1,614 @@
+// A DeltaBlue style benchmark: an incremental solver for hierarchies of
+// weighted constraints, after "The DeltaBlue Algorithm: An Incremental
+// Constraint Hierarchy Solver" by Freeman-Benson and Maloney, CACM 1990,
+// shaped like the classic Smalltalk and JavaScript benchmark.
+//
+// Every kind of constraint has its own prototype chain, and the planner
+// reaches all of them through the same call sites, so most property
+// accesses here see several shapes.
+//
+// HydraCompiler has no switch and no Function.prototype.call, so the
+// subclasses set up their fields and repeat their base methods themselves.
+
+let ITERATIONS = 100;
+
+function inherits(child, parent) {
+  let Inheriter = function () { };
+  Inheriter.prototype = parent.prototype;
+  child.prototype = new Inheriter();
+}
+
+// an array that shrinks, there is no splice
+function OrderedCollection() {
+  this.elms = [];
+  this.length = 0;
+}
+
+OrderedCollection.prototype.add = function (elm) {
+  this.elms[this.length++] = elm;
+};
+
+OrderedCollection.prototype.at = function (index) {
+  return this.elms[index];
+};
+
+OrderedCollection.prototype.size = function () {
+  return this.length;
+};
+
+OrderedCollection.prototype.removeFirst = function () {
+  let first = this.elms[0];
+  for (let i = 1; i < this.length; ++i)
+    this.elms[i - 1] = this.elms[i];
+  this.length--;
+  this.elms[this.length] = null;
+  return first;
+};
+
+OrderedCollection.prototype.remove = function (elm) {
+  let index = 0;
+  for (let i = 0; i < this.length; ++i) {
+    let value = this.elms[i];
+    if (value != elm) {
+      this.elms[index] = value;
+      index++;
+    }
+  }
+  for (let i = index; i < this.length; ++i)
+    this.elms[i] = null;
+  this.length = index;
+};
+
+// smaller values are stronger, every strength is a single object so they
+// are compared by identity
+function Strength(strengthValue, name) {
+  this.strengthValue = strengthValue;
+  this.name = name;
+}
+
+function stronger(s1, s2) {
+  return s1.strengthValue < s2.strengthValue;
+}
+
+function weaker(s1, s2) {
+  return s1.strengthValue > s2.strengthValue;
+}
+
+function weakestOf(s1, s2) {
+  return weaker(s1, s2) ? s1 : s2;
+}
+
+let REQUIRED        = new Strength(0, "required");
+let STRONG_PREFERRED = new Strength(1, "strongPreferred");
+let PREFERRED       = new Strength(2, "preferred");
+let STRONG_DEFAULT  = new Strength(3, "strongDefault");
+let NORMAL          = new Strength(4, "normal");
+let WEAK_DEFAULT    = new Strength(5, "weakDefault");
+let WEAKEST         = new Strength(6, "weakest");
+
+// the order the classic benchmark walks the strengths in: from required
+// straight down to weakest, so only required constraints are re-added
+let NEXT_WEAKER = [
+  WEAKEST, WEAK_DEFAULT, NORMAL, STRONG_DEFAULT, PREFERRED, REQUIRED, WEAKEST
+];
+
+Strength.prototype.nextWeaker = function () {
+  return NEXT_WEAKER[this.strengthValue];
+};
+
+// the planner of the current test
+let planner = null;
+
+// a relation between variables the planner keeps satisfied, if strong enough
+function Constraint(strength) {
+  this.strength = strength;
+}
+
+Constraint.prototype.addConstraint = function () {
+  this.addToGraph();
+  planner.incrementalAdd(this);
+};
+
+// picks a direction and propagates, returns the constraint it overrode
+Constraint.prototype.satisfy = function (mark) {
+  this.chooseMethod(mark);
+  if (!this.isSatisfied()) {
+    if (this.strength == REQUIRED)
+      __write("Could not satisfy a required constraint!");
+    return null;
+  }
+  this.markInputs(mark);
+  let out = this.output();
+  let overridden = out.determinedBy;
+  if (overridden != null) overridden.markUnsatisfied();
+  out.determinedBy = this;
+  if (!planner.addPropagate(this, mark))
+    __write("Cycle encountered");
+  out.mark = mark;
+  return overridden;
+};
+
+Constraint.prototype.destroyConstraint = function () {
+  if (this.isSatisfied()) planner.incrementalRemove(this);
+  else this.removeFromGraph();
+};
+
+// input constraints take their value from outside, like an edit
+Constraint.prototype.isInput = function () {
+  return false;
+};
+
+// a constraint with a single output variable
+function UnaryConstraint(v, strength) {
+  this.strength = strength;
+  this.myOutput = v;
+  this.satisfied = false;
+  this.addConstraint();
+}
+
+inherits(UnaryConstraint, Constraint);
+
+UnaryConstraint.prototype.addToGraph = function () {
+  this.myOutput.addConstraint(this);
+  this.satisfied = false;
+};
+
+UnaryConstraint.prototype.chooseMethod = function (mark) {
+  this.satisfied = (this.myOutput.mark != mark)
+    && stronger(this.strength, this.myOutput.walkStrength);
+};
+
+UnaryConstraint.prototype.isSatisfied = function () {
+  return this.satisfied;
+};
+
+UnaryConstraint.prototype.markInputs = function (mark) {
+  // has no inputs
+};
+
+UnaryConstraint.prototype.output = function () {
+  return this.myOutput;
+};
+
+UnaryConstraint.prototype.recalculate = function () {
+  this.myOutput.walkStrength = this.strength;
+  this.myOutput.stay = !this.isInput();
+  if (this.myOutput.stay) this.execute();
+};
+
+UnaryConstraint.prototype.markUnsatisfied = function () {
+  this.satisfied = false;
+};
+
+UnaryConstraint.prototype.inputsKnown = function () {
+  return true;
+};
+
+UnaryConstraint.prototype.removeFromGraph = function () {
+  if (this.myOutput != null) this.myOutput.removeConstraint(this);
+  this.satisfied = false;
+};
+
+// keeps a variable at its value, if nothing stronger says otherwise
+function StayConstraint(v, str) {
+  this.strength = str;
+  this.myOutput = v;
+  this.satisfied = false;
+  this.addConstraint();
+}
+
+inherits(StayConstraint, UnaryConstraint);
+
+StayConstraint.prototype.execute = function () {
+  // Stay constraints do nothing
+};
+
+// marks a variable the program is about to change
+function EditConstraint(v, str) {
+  this.strength = str;
+  this.myOutput = v;
+  this.satisfied = false;
+  this.addConstraint();
+}
+
+inherits(EditConstraint, UnaryConstraint);
+
+EditConstraint.prototype.isInput = function () {
+  return true;
+};
+
+EditConstraint.prototype.execute = function () {
+  // Edit constraints do nothing
+};
+
+let DIRECTION_NONE     = 0;
+let DIRECTION_FORWARD  = 1;
+let DIRECTION_BACKWARD = -1;
+
+// a constraint between two variables that can flow either way
+function BinaryConstraint(var1, var2, strength) {
+  this.strength = strength;
+  this.v1 = var1;
+  this.v2 = var2;
+  this.direction = DIRECTION_NONE;
+  this.addConstraint();
+}
+
+inherits(BinaryConstraint, Constraint);
+
+BinaryConstraint.prototype.chooseMethod = function (mark) {
+  if (this.v1.mark == mark) {
+    this.direction = (this.v2.mark != mark && stronger(this.strength, this.v2.walkStrength))
+      ? DIRECTION_FORWARD
+      : DIRECTION_NONE;
+  }
+  if (this.v2.mark == mark) {
+    this.direction = (this.v1.mark != mark && stronger(this.strength, this.v1.walkStrength))
+      ? DIRECTION_BACKWARD
+      : DIRECTION_NONE;
+  }
+  if (weaker(this.v1.walkStrength, this.v2.walkStrength)) {
+    this.direction = stronger(this.strength, this.v1.walkStrength)
+      ? DIRECTION_BACKWARD
+      : DIRECTION_NONE;
+  } else {
+    this.direction = stronger(this.strength, this.v2.walkStrength)
+      ? DIRECTION_FORWARD
+      : DIRECTION_BACKWARD;
+  }
+};
+
+BinaryConstraint.prototype.addToGraph = function () {
+  this.v1.addConstraint(this);
+  this.v2.addConstraint(this);
+  this.direction = DIRECTION_NONE;
+};
+
+BinaryConstraint.prototype.isSatisfied = function () {
+  return this.direction != DIRECTION_NONE;
+};
+
+BinaryConstraint.prototype.markInputs = function (mark) {
+  this.input().mark = mark;
+};
+
+BinaryConstraint.prototype.input = function () {
+  return (this.direction == DIRECTION_FORWARD) ? this.v1 : this.v2;
+};
+
+BinaryConstraint.prototype.output = function () {
+  return (this.direction == DIRECTION_FORWARD) ? this.v2 : this.v1;
+};
+
+BinaryConstraint.prototype.recalculate = function () {
+  let ihn = this.input(), out = this.output();
+  out.walkStrength = weakestOf(this.strength, ihn.walkStrength);
+  out.stay = ihn.stay;
+  if (out.stay) this.execute();
+};
+
+BinaryConstraint.prototype.markUnsatisfied = function () {
+  this.direction = DIRECTION_NONE;
+};
+
+BinaryConstraint.prototype.inputsKnown = function (mark) {
+  let i = this.input();
+  return i.mark == mark || i.stay || i.determinedBy == null;
+};
+
+BinaryConstraint.prototype.removeFromGraph = function () {
+  if (this.v1 != null) this.v1.removeConstraint(this);
+  if (this.v2 != null) this.v2.removeConstraint(this);
+  this.direction = DIRECTION_NONE;
+};
+
+// v2 = v1 * scale + offset, scale and offset are inputs only
+function ScaleConstraint(src, scale, offset, dest, strength) {
+  this.direction = DIRECTION_NONE;
+  this.scale = scale;
+  this.offset = offset;
+  this.strength = strength;
+  this.v1 = src;
+  this.v2 = dest;
+  this.addConstraint();
+}
+
+inherits(ScaleConstraint, BinaryConstraint);
+
+ScaleConstraint.prototype.addToGraph = function () {
+  this.v1.addConstraint(this);
+  this.v2.addConstraint(this);
+  this.direction = DIRECTION_NONE;
+  this.scale.addConstraint(this);
+  this.offset.addConstraint(this);
+};
+
+ScaleConstraint.prototype.removeFromGraph = function () {
+  if (this.v1 != null) this.v1.removeConstraint(this);
+  if (this.v2 != null) this.v2.removeConstraint(this);
+  this.direction = DIRECTION_NONE;
+  if (this.scale != null) this.scale.removeConstraint(this);
+  if (this.offset != null) this.offset.removeConstraint(this);
+};
+
+ScaleConstraint.prototype.markInputs = function (mark) {
+  this.input().mark = mark;
+  this.scale.mark = this.offset.mark = mark;
+};
+
+ScaleConstraint.prototype.execute = function () {
+  if (this.direction == DIRECTION_FORWARD) {
+    this.v2.value = this.v1.value * this.scale.value + this.offset.value;
+  } else {
+    this.v1.value = (this.v2.value - this.offset.value) / this.scale.value;
+  }
+};
+
+ScaleConstraint.prototype.recalculate = function () {
+  let ihn = this.input(), out = this.output();
+  out.walkStrength = weakestOf(this.strength, ihn.walkStrength);
+  out.stay = ihn.stay && this.scale.stay && this.offset.stay;
+  if (out.stay) this.execute();
+};
+
+// v1 == v2
+function EqualityConstraint(var1, var2, strength) {
+  this.strength = strength;
+  this.v1 = var1;
+  this.v2 = var2;
+  this.direction = DIRECTION_NONE;
+  this.addConstraint();
+}
+
+inherits(EqualityConstraint, BinaryConstraint);
+
+EqualityConstraint.prototype.execute = function () {
+  this.output().value = this.input().value;
+};
+
+// a value with the constraints on it and the planner's bookkeeping
+function Variable(name, initialValue) {
+  this.value = initialValue;
+  this.constraints = new OrderedCollection();
+  this.determinedBy = null;
+  this.mark = 0;
+  this.walkStrength = WEAKEST;
+  this.stay = true;
+  this.name = name;
+}
+
+Variable.prototype.addConstraint = function (c) {
+  this.constraints.add(c);
+};
+
+Variable.prototype.removeConstraint = function (c) {
+  this.constraints.remove(c);
+  if (this.determinedBy == c) this.determinedBy = null;
+};
+
+function Planner() {
+  this.currentMark = 0;
+}
+
+// satisfies c, then tries to re-satisfy whatever it overrode in turn
+Planner.prototype.incrementalAdd = function (c) {
+  let mark = this.newMark();
+  let overridden = c.satisfy(mark);
+  while (overridden != null)
+    overridden = overridden.satisfy(mark);
+};
+
+// removes c and re-adds the downstream constraints it kept unsatisfied,
+// strongest first
+Planner.prototype.incrementalRemove = function (c) {
+  let out = c.output();
+  c.markUnsatisfied();
+  c.removeFromGraph();
+  let unsatisfied = this.removePropagateFrom(out);
+  let strength = REQUIRED;
+  do {
+    for (let i = 0; i < unsatisfied.size(); i++) {
+      let u = unsatisfied.at(i);
+      if (u.strength == strength)
+        this.incrementalAdd(u);
+    }
+    strength = strength.nextWeaker();
+  } while (strength != WEAKEST);
+};
+
+Planner.prototype.newMark = function () {
+  return ++this.currentMark;
+};
+
+// orders the constraints downstream of sources so each runs after its
+// inputs, skipping outputs that are stay
+Planner.prototype.makePlan = function (sources) {
+  let mark = this.newMark();
+  let plan = new Plan();
+  let todo = sources;
+  while (todo.size() > 0) {
+    let c = todo.removeFirst();
+    if (c.output().mark != mark && c.inputsKnown(mark)) {
+      plan.addConstraint(c);
+      c.output().mark = mark;
+      this.addConstraintsConsumingTo(c.output(), todo);
+    }
+  }
+  return plan;
+};
+
+Planner.prototype.extractPlanFromConstraints = function (constraints) {
+  let sources = new OrderedCollection();
+  for (let i = 0; i < constraints.size(); i++) {
+    let c = constraints.at(i);
+    if (c.isInput() && c.isSatisfied())
+      sources.add(c);
+  }
+  return this.makePlan(sources);
+};
+
+// recomputes walk strengths and stay values downstream of c, false if
+// that runs into a cycle
+Planner.prototype.addPropagate = function (c, mark) {
+  let todo = new OrderedCollection();
+  todo.add(c);
+  while (todo.size() > 0) {
+    let d = todo.removeFirst();
+    if (d.output().mark == mark) {
+      this.incrementalRemove(c);
+      return false;
+    }
+    d.recalculate();
+    this.addConstraintsConsumingTo(d.output(), todo);
+  }
+  return true;
+};
+
+// resets everything downstream of out, returns the unsatisfied
+// constraints met on the way
+Planner.prototype.removePropagateFrom = function (out) {
+  out.determinedBy = null;
+  out.walkStrength = WEAKEST;
+  out.stay = true;
+  let unsatisfied = new OrderedCollection();
+  let todo = new OrderedCollection();
+  todo.add(out);
+  while (todo.size() > 0) {
+    let v = todo.removeFirst();
+    for (let i = 0; i < v.constraints.size(); i++) {
+      let c = v.constraints.at(i);
+      if (!c.isSatisfied())
+        unsatisfied.add(c);
+    }
+    let determining = v.determinedBy;
+    for (let i = 0; i < v.constraints.size(); i++) {
+      let next = v.constraints.at(i);
+      if (next != determining && next.isSatisfied()) {
+        next.recalculate();
+        todo.add(next.output());
+      }
+    }
+  }
+  return unsatisfied;
+};
+
+Planner.prototype.addConstraintsConsumingTo = function (v, coll) {
+  let determining = v.determinedBy;
+  let cc = v.constraints;
+  for (let i = 0; i < cc.size(); i++) {
+    let c = cc.at(i);
+    if (c != determining && c.isSatisfied())
+      coll.add(c);
+  }
+};
+
+// constraints to execute in order to bring every output up to date
+function Plan() {
+  this.v = new OrderedCollection();
+}
+
+Plan.prototype.addConstraint = function (c) {
+  this.v.add(c);
+};
+
+Plan.prototype.size = function () {
+  return this.v.size();
+};
+
+Plan.prototype.constraintAt = function (index) {
+  return this.v.at(index);
+};
+
+Plan.prototype.execute = function () {
+  for (let i = 0; i < this.size(); i++) {
+    let c = this.constraintAt(i);
+    c.execute();
+  }
+};
+
+// a chain of n equalities with a stay at one end and an edit at the other,
+// every change goes down the whole chain
+function chainTest(n) {
+  planner = new Planner();
+  let prev = null, first = null, last = null;
+
+  // Build chain of n equality constraints
+  for (let i = 0; i <= n; i++) {
+    let name = "v" + i;
+    let v = new Variable(name, 0);
+    if (prev != null)
+      new EqualityConstraint(prev, v, REQUIRED);
+    if (i == 0) first = v;
+    if (i == n) last = v;
+    prev = v;
+  }
+
+  new StayConstraint(last, STRONG_DEFAULT);
+  let edit = new EditConstraint(first, PREFERRED);
+  let edits = new OrderedCollection();
+  edits.add(edit);
+  let plan = planner.extractPlanFromConstraints(edits);
+  for (let i = 0; i < 100; i++) {
+    first.value = i;
+    plan.execute();
+    if (last.value != i)
+      __write("Chain test failed.");
+  }
+}
+
+// n pairs related by a shared scale and offset, changed from either side
+function projectionTest(n) {
+  planner = new Planner();
+  let scale = new Variable("scale", 10);
+  let offset = new Variable("offset", 1000);
+  let src = null, dst = null;
+
+  let dests = new OrderedCollection();
+  for (let i = 0; i < n; i++) {
+    src = new Variable("src" + i, i);
+    dst = new Variable("dst" + i, i);
+    dests.add(dst);
+    new StayConstraint(src, NORMAL);
+    new ScaleConstraint(src, scale, offset, dst, REQUIRED);
+  }
+
+  change(src, 17);
+  if (dst.value != 1170) __write("Projection 1 failed");
+  change(dst, 1050);
+  if (src.value != 5) __write("Projection 2 failed");
+  change(scale, 5);
+  for (let i = 0; i < n - 1; i++) {
+    if (dests.at(i).value != i * 5 + 1000)
+      __write("Projection 3 failed");
+  }
+  change(offset, 2000);
+  for (let i = 0; i < n - 1; i++) {
+    if (dests.at(i).value != i * 5 + 2000)
+      __write("Projection 4 failed");
+  }
+}
+
+function change(v, newValue) {
+  let edit = new EditConstraint(v, PREFERRED);
+  let edits = new OrderedCollection();
+  edits.add(edit);
+  let plan = planner.extractPlanFromConstraints(edits);
+  for (let i = 0; i < 10; i++) {
+    v.value = newValue;
+    plan.execute();
+  }
+  edit.destroyConstraint();
+}
+
+
+function deltaBlue() {
+  chainTest(100);
+  projectionTest(100);
+}
+
+for (let i = 0; i < ITERATIONS; ++i)
+{
+    deltaBlue();
+}
+
+__write("DeltaBlue done");
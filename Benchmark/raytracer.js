@@ -0,0 +1,371 @@
+// A small raytracer in the manner of the classic RayTrace benchmark: a
+// checkered plane and three spheres under four lights, with shadows and
+// reflections. Vectors and colors are immutable objects, so every bit of
+// double arithmetic allocates, and the scene objects are reached through
+// the same call sites with different shapes.
+
+let WIDTH = 64;
+let HEIGHT = 64;
+let MAX_DEPTH = 3;
+let ITERATIONS = 4;
+let EXPECTED_CHECKSUM = 704090;
+
+let EPSILON = 0.0001;
+let INFINITY = 1e30;
+
+// there is no Math in the runtime, Newton's iteration from above converges
+// monotonously
+function sqrt(x)
+{
+    if (x <= 0)
+    {
+        return 0;
+    }
+
+    let guess = x > 1 ? x : 1;
+    while (true)
+    {
+        let next = 0.5 * (guess + x / guess);
+        if (next >= guess)
+        {
+            return guess;
+        }
+        guess = next;
+    }
+}
+
+function floor(x)
+{
+    let truncated = x | 0;
+    return truncated > x ? truncated - 1 : truncated;
+}
+
+function Vector(x, y, z)
+{
+    this.x = x;
+    this.y = y;
+    this.z = z;
+}
+
+Vector.prototype.add = function (v)
+{
+    return new Vector(this.x + v.x, this.y + v.y, this.z + v.z);
+};
+
+Vector.prototype.sub = function (v)
+{
+    return new Vector(this.x - v.x, this.y - v.y, this.z - v.z);
+};
+
+Vector.prototype.scale = function (k)
+{
+    return new Vector(this.x * k, this.y * k, this.z * k);
+};
+
+Vector.prototype.dot = function (v)
+{
+    return this.x * v.x + this.y * v.y + this.z * v.z;
+};
+
+Vector.prototype.cross = function (v)
+{
+    return new Vector(
+        this.y * v.z - this.z * v.y,
+        this.z * v.x - this.x * v.z,
+        this.x * v.y - this.y * v.x);
+};
+
+Vector.prototype.magnitude = function ()
+{
+    return sqrt(this.dot(this));
+};
+
+Vector.prototype.normalize = function ()
+{
+    return this.scale(1 / this.magnitude());
+};
+
+function Color(r, g, b)
+{
+    this.r = r;
+    this.g = g;
+    this.b = b;
+}
+
+Color.prototype.add = function (c)
+{
+    return new Color(this.r + c.r, this.g + c.g, this.b + c.b);
+};
+
+Color.prototype.scale = function (k)
+{
+    return new Color(this.r * k, this.g * k, this.b * k);
+};
+
+Color.prototype.multiply = function (c)
+{
+    return new Color(this.r * c.r, this.g * c.g, this.b * c.b);
+};
+
+// a channel as 0 to 255
+function toByte(value)
+{
+    if (value <= 0)
+    {
+        return 0;
+    }
+    if (value >= 1)
+    {
+        return 255;
+    }
+    return (value * 255) | 0;
+}
+
+let BLACK = new Color(0, 0, 0);
+let WHITE = new Color(1, 1, 1);
+let BACKGROUND = new Color(0.1, 0.1, 0.2);
+
+function Ray(start, direction)
+{
+    this.start = start;
+    this.direction = direction;
+}
+
+function Intersection(shape, ray, distance)
+{
+    this.shape = shape;
+    this.ray = ray;
+    this.distance = distance;
+}
+
+// surfaces answer a color for a point, the shapes refer to them
+function SolidSurface(color, reflect)
+{
+    this.color = color;
+    this.reflect = reflect;
+    this.specular = WHITE;
+    this.roughness = 50;
+}
+
+SolidSurface.prototype.diffuse = function (position)
+{
+    return this.color;
+};
+
+function CheckerSurface(reflect)
+{
+    this.reflect = reflect;
+    this.specular = WHITE;
+    this.roughness = 150;
+}
+
+CheckerSurface.prototype.diffuse = function (position)
+{
+    return (floor(position.z) + floor(position.x)) % 2 != 0 ? WHITE : BLACK;
+};
+
+function Sphere(center, radius, surface)
+{
+    this.center = center;
+    this.radius2 = radius * radius;
+    this.surface = surface;
+}
+
+Sphere.prototype.normal = function (position)
+{
+    return position.sub(this.center).normalize();
+};
+
+Sphere.prototype.intersect = function (ray)
+{
+    let eo = this.center.sub(ray.start);
+    let v = eo.dot(ray.direction);
+    if (v < 0)
+    {
+        return null;
+    }
+
+    let disc = this.radius2 - (eo.dot(eo) - v * v);
+    if (disc <= 0)
+    {
+        return null;
+    }
+
+    return new Intersection(this, ray, v - sqrt(disc));
+};
+
+function Plane(normal, offset, surface)
+{
+    this.norm = normal;
+    this.offset = offset;
+    this.surface = surface;
+}
+
+Plane.prototype.normal = function (position)
+{
+    return this.norm;
+};
+
+Plane.prototype.intersect = function (ray)
+{
+    let denom = this.norm.dot(ray.direction);
+    if (denom >= 0)
+    {
+        return null;
+    }
+
+    let distance = (this.norm.dot(ray.start) + this.offset) / -denom;
+    return new Intersection(this, ray, distance);
+};
+
+function Light(position, color)
+{
+    this.position = position;
+    this.color = color;
+}
+
+function Camera(position, lookAt)
+{
+    let down = new Vector(0, -1, 0);
+
+    this.position = position;
+    this.forward = lookAt.sub(position).normalize();
+    this.right = this.forward.cross(down).normalize().scale(1.5);
+    this.up = this.forward.cross(this.right).normalize().scale(1.5);
+}
+
+// the ray through pixel x, y
+Camera.prototype.ray = function (x, y)
+{
+    let recenterX = (x - WIDTH / 2) / 2 / WIDTH;
+    let recenterY = -(y - HEIGHT / 2) / 2 / HEIGHT;
+    let direction = this.forward
+        .add(this.right.scale(recenterX))
+        .add(this.up.scale(recenterY))
+        .normalize();
+    return new Ray(this.position, direction);
+};
+
+function Scene()
+{
+    this.shapes = [
+        new Plane(new Vector(0, 1, 0), 0, new CheckerSurface(0.7)),
+        new Sphere(new Vector(0, 1, -0.25), 1, new SolidSurface(new Color(0.9, 0.9, 0.9), 0.7)),
+        new Sphere(new Vector(-1, 0.5, 1.5), 0.5, new SolidSurface(new Color(0.8, 0.2, 0.2), 0.3)),
+        new Sphere(new Vector(1.5, 0.4, 1), 0.4, new SolidSurface(new Color(0.2, 0.6, 0.9), 0.5))
+    ];
+    this.lights = [
+        new Light(new Vector(-2, 2.5, 0), new Color(0.49, 0.07, 0.07)),
+        new Light(new Vector(1.5, 2.5, 1.5), new Color(0.07, 0.07, 0.49)),
+        new Light(new Vector(1.5, 2.5, -1.5), new Color(0.07, 0.49, 0.071)),
+        new Light(new Vector(0, 3.5, 0), new Color(0.21, 0.21, 0.35))
+    ];
+    this.camera = new Camera(new Vector(3, 2, 4), new Vector(-1, 0.5, 0));
+}
+
+// the closest intersection along ray, null if there is none
+Scene.prototype.intersect = function (ray)
+{
+    let closest = null;
+    let closestDistance = INFINITY;
+    for (let i = 0; i < this.shapes.length; ++i)
+    {
+        let intersection = this.shapes[i].intersect(ray);
+        if (intersection != null && intersection.distance < closestDistance)
+        {
+            closest = intersection;
+            closestDistance = intersection.distance;
+        }
+    }
+    return closest;
+};
+
+Scene.prototype.trace = function (ray, depth)
+{
+    let intersection = this.intersect(ray);
+    if (intersection == null)
+    {
+        return BACKGROUND;
+    }
+    return this.shade(intersection, depth);
+};
+
+Scene.prototype.shade = function (intersection, depth)
+{
+    let direction = intersection.ray.direction;
+    let position = direction.scale(intersection.distance).add(intersection.ray.start);
+    let normal = intersection.shape.normal(position);
+    let reflectDirection = direction.sub(normal.scale(2 * normal.dot(direction)));
+
+    let color = this.light(intersection.shape.surface, position, normal, reflectDirection);
+
+    if (depth < MAX_DEPTH)
+    {
+        let reflected = this.trace(new Ray(position.add(reflectDirection.scale(EPSILON)), reflectDirection), depth + 1);
+        color = color.add(reflected.scale(intersection.shape.surface.reflect));
+    }
+
+    return color;
+};
+
+// diffuse and specular light of every light that is not in shadow
+Scene.prototype.light = function (surface, position, normal, reflectDirection)
+{
+    let color = BLACK;
+    for (let i = 0; i < this.lights.length; ++i)
+    {
+        let light = this.lights[i];
+        let toLight = light.position.sub(position);
+        let lightDistance = toLight.magnitude();
+        let lightDirection = toLight.normalize();
+
+        let blocker = this.intersect(new Ray(position.add(lightDirection.scale(EPSILON)), lightDirection));
+        if (blocker != null && blocker.distance < lightDistance)
+        {
+            continue;
+        }
+
+        let illumination = lightDirection.dot(normal);
+        if (illumination > 0)
+        {
+            color = color.add(surface.diffuse(position).multiply(light.color.scale(illumination)));
+        }
+
+        let specular = lightDirection.dot(reflectDirection.normalize());
+        if (specular > 0)
+        {
+            let power = specular;
+            for (let k = 1; k < surface.roughness; k *= 2)
+            {
+                power = power * power;
+            }
+            color = color.add(surface.specular.multiply(light.color.scale(power)));
+        }
+    }
+    return color;
+};
+
+Scene.prototype.render = function ()
+{
+    let checksum = 0;
+    for (let y = 0; y < HEIGHT; ++y)
+    {
+        for (let x = 0; x < WIDTH; ++x)
+        {
+            let color = this.trace(this.camera.ray(x, y), 0);
+            checksum += toByte(color.r) + toByte(color.g) + toByte(color.b);
+        }
+    }
+    return checksum;
+};
+
+for (let i = 0; i < ITERATIONS; ++i)
+{
+    let checksum = new Scene().render();
+    if (checksum != EXPECTED_CHECKSUM)
+    {
+        __write("Raytracer checksum ", checksum, " expected ", EXPECTED_CHECKSUM);
+    }
+}
+
+__write("Raytracer done");
@@ -0,0 +1,310 @@
+// A splay tree benchmark in the manner of the classic Splay: a large tree
+// of long lived nodes, each holding a payload of small objects, of which a
+// few are replaced on every step. Most of the heap survives collections and
+// is old, while the replaced nodes keep dying there: old generation churn
+// with pointers from old nodes to young ones.
+
+let TREE_SIZE = 8000;
+let MODIFICATIONS = 80;
+let PAYLOAD_DEPTH = 5;
+let ITERATIONS = 50;
+
+// a Park-Miller generator, keys repeat from run to run
+let seed = 49734321;
+
+function nextKey()
+{
+    seed = (seed * 16807) % 2147483647;
+    return seed;
+}
+
+function SplayNode(key, value)
+{
+    this.key = key;
+    this.value = value;
+    this.left = null;
+    this.right = null;
+}
+
+function SplayTree()
+{
+    this.root = null;
+    this.size = 0;
+}
+
+// top down splay: brings the node with key, or the last node on its path,
+// to the root
+SplayTree.prototype.splay = function (key)
+{
+    if (this.root == null)
+    {
+        return;
+    }
+
+    let dummy = new SplayNode(0, null);
+    let left = dummy;
+    let right = dummy;
+    let current = this.root;
+
+    while (true)
+    {
+        if (key < current.key)
+        {
+            if (current.left == null)
+            {
+                break;
+            }
+            if (key < current.left.key)
+            {
+                // rotate right
+                let tmp = current.left;
+                current.left = tmp.right;
+                tmp.right = current;
+                current = tmp;
+                if (current.left == null)
+                {
+                    break;
+                }
+            }
+            // link right
+            right.left = current;
+            right = current;
+            current = current.left;
+        }
+        else if (key > current.key)
+        {
+            if (current.right == null)
+            {
+                break;
+            }
+            if (key > current.right.key)
+            {
+                // rotate left
+                let tmp = current.right;
+                current.right = tmp.left;
+                tmp.left = current;
+                current = tmp;
+                if (current.right == null)
+                {
+                    break;
+                }
+            }
+            // link left
+            left.right = current;
+            left = current;
+            current = current.right;
+        }
+        else
+        {
+            break;
+        }
+    }
+
+    // assemble
+    left.right = current.left;
+    right.left = current.right;
+    current.left = dummy.right;
+    current.right = dummy.left;
+    this.root = current;
+};
+
+// false if the key is already there
+SplayTree.prototype.insert = function (key, value)
+{
+    if (this.root == null)
+    {
+        this.root = new SplayNode(key, value);
+        this.size++;
+        return true;
+    }
+
+    this.splay(key);
+    if (this.root.key == key)
+    {
+        return false;
+    }
+
+    let node = new SplayNode(key, value);
+    if (key > this.root.key)
+    {
+        node.left = this.root;
+        node.right = this.root.right;
+        this.root.right = null;
+    }
+    else
+    {
+        node.right = this.root;
+        node.left = this.root.left;
+        this.root.left = null;
+    }
+    this.root = node;
+    this.size++;
+    return true;
+};
+
+// the removed node, null if the key is not there
+SplayTree.prototype.remove = function (key)
+{
+    if (this.root == null)
+    {
+        return null;
+    }
+
+    this.splay(key);
+    if (this.root.key != key)
+    {
+        return null;
+    }
+
+    let removed = this.root;
+    if (this.root.left == null)
+    {
+        this.root = this.root.right;
+    }
+    else
+    {
+        let right = this.root.right;
+        this.root = this.root.left;
+        // key is larger than everything on the left, the maximum comes up
+        this.splay(key);
+        this.root.right = right;
+    }
+    this.size--;
+    return removed;
+};
+
+// the largest node with a key below key
+SplayTree.prototype.findGreatestLessThan = function (key)
+{
+    if (this.root == null)
+    {
+        return null;
+    }
+
+    this.splay(key);
+    if (this.root.key < key)
+    {
+        return this.root;
+    }
+    if (this.root.left == null)
+    {
+        return null;
+    }
+
+    let current = this.root.left;
+    while (current.right != null)
+    {
+        current = current.right;
+    }
+    return current;
+};
+
+// in order, visits every node
+SplayTree.prototype.forEach = function (visit)
+{
+    let stack = [];
+    let depth = 0;
+    let current = this.root;
+
+    while (current != null || depth > 0)
+    {
+        while (current != null)
+        {
+            stack[depth++] = current;
+            current = current.left;
+        }
+
+        current = stack[--depth];
+        visit(current);
+        current = current.right;
+    }
+};
+
+// a binary tree of depth objects with an array and a string at the leaves
+function generatePayloadTree(depth, tag)
+{
+    if (depth == 0)
+    {
+        return {
+            array : [0, 1, 2, 3, 4, 5, 6, 7, 8, 9],
+            string : "String for key " + tag + " in leaf node"
+        };
+    }
+
+    return {
+        left : generatePayloadTree(depth - 1, tag),
+        right : generatePayloadTree(depth - 1, tag)
+    };
+}
+
+function insertNewNode(tree)
+{
+    while (true)
+    {
+        let key = nextKey();
+        if (tree.insert(key, generatePayloadTree(PAYLOAD_DEPTH, key)))
+        {
+            return key;
+        }
+    }
+}
+
+function setup()
+{
+    let tree = new SplayTree();
+    for (let i = 0; i < TREE_SIZE; ++i)
+    {
+        insertNewNode(tree);
+    }
+    return tree;
+}
+
+// replaces MODIFICATIONS nodes: inserts a new one and removes the next
+// smaller, or the new one itself if nothing is smaller
+function step(tree)
+{
+    for (let i = 0; i < MODIFICATIONS; ++i)
+    {
+        let key = insertNewNode(tree);
+        let greatest = tree.findGreatestLessThan(key);
+        if (greatest == null)
+        {
+            tree.remove(key);
+        }
+        else
+        {
+            tree.remove(greatest.key);
+        }
+    }
+}
+
+function verify(tree)
+{
+    let count = 0;
+    let last = -1;
+    let ordered = true;
+
+    tree.forEach((node) =>
+    {
+        if (node.key <= last)
+        {
+            ordered = false;
+        }
+        last = node.key;
+        count++;
+    });
+
+    if (!ordered || count != tree.size || count != TREE_SIZE)
+    {
+        __write("Splay tree is broken");
+    }
+}
+
+let tree = setup();
+for (let i = 0; i < ITERATIONS; ++i)
+{
+    step(tree);
+}
+verify(tree);
+
+__write("Splay done");
@@ -0,0 +1,187 @@
+// String building: every + of two strings makes a ConcatedString rope, the
+// rope is flattened the first time its characters are needed. This builds
+// ropes of different shapes and then reads them back by comparing, by
+// ordering and by using them as property keys.
+
+let ITERATIONS = 40;
+let ROWS = 200;
+let PIECES = 500;
+let KEYS = 64;
+
+// left deep, as by a loop of +=
+function buildLeft(count)
+{
+    let str = "";
+    for (let i = 0; i < count; ++i)
+    {
+        str += "piece" + i + ";";
+    }
+    return str;
+}
+
+// right deep, the same text prepended from the end
+function buildRight(count)
+{
+    let str = "";
+    for (let i = count - 1; i >= 0; --i)
+    {
+        str = "piece" + i + ";" + str;
+    }
+    return str;
+}
+
+// balanced, halves joined recursively
+function buildBalanced(from, to)
+{
+    if (to - from == 1)
+    {
+        return "piece" + from + ";";
+    }
+
+    let middle = (from + to) >> 1;
+    return buildBalanced(from, middle) + buildBalanced(middle, to);
+}
+
+function Row(id, name, price)
+{
+    this.id = id;
+    this.name = name;
+    this.price = price;
+}
+
+// a table as html, many short pieces joined into one long rope
+function renderTable(rows)
+{
+    let html = "<table>\n";
+    for (let i = 0; i < rows.length; ++i)
+    {
+        let row = rows[i];
+        html += "  <tr class=\"" + (i % 2 == 0 ? "even" : "odd") + "\">" +
+            "<td>" + row.id + "</td>" +
+            "<td>" + row.name + "</td>" +
+            "<td>" + row.price + "</td>" +
+            "</tr>\n";
+    }
+    return html + "</table>\n";
+}
+
+// the same table, each line built on its own first
+function renderTableByLines(rows)
+{
+    let lines = [];
+    for (let i = 0; i < rows.length; ++i)
+    {
+        let row = rows[i];
+        let cells = "<td>" + row.id + "</td><td>" + row.name + "</td><td>" + row.price + "</td>";
+        lines.push("  <tr class=\"" + (i % 2 == 0 ? "even" : "odd") + "\">" + cells + "</tr>\n");
+    }
+
+    let html = "<table>\n";
+    for (let i = 0; i < lines.length; ++i)
+    {
+        html = html + lines[i];
+    }
+    return html + "</table>\n";
+}
+
+// concatenated keys, each is hashed when it is looked up
+function countKeys(count)
+{
+    let counts = {};
+    for (let i = 0; i < count; ++i)
+    {
+        let key = "key_" + (i % KEYS) + "_" + ((i * 7) % 3);
+        let current = counts[key];
+        counts[key] = current == undefined ? 1 : current + 1;
+    }
+
+    let total = 0;
+    for (let i = 0; i < KEYS; ++i)
+    {
+        for (let j = 0; j < 3; ++j)
+        {
+            let current = counts["key_" + i + "_" + j];
+            if (current != undefined)
+            {
+                total += current;
+            }
+        }
+    }
+    return total;
+}
+
+// insertion sort by <, ropes compare character by character
+function sortNames(rows)
+{
+    let names = [];
+    for (let i = 0; i < rows.length; ++i)
+    {
+        names.push(rows[i].name);
+    }
+
+    for (let i = 1; i < names.length; ++i)
+    {
+        let name = names[i];
+        let j = i - 1;
+        while (j >= 0 && name < names[j])
+        {
+            names[j + 1] = names[j];
+            --j;
+        }
+        names[j + 1] = name;
+    }
+
+    for (let i = 1; i < names.length; ++i)
+    {
+        if (names[i] < names[i - 1])
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+function makeRows(count)
+{
+    let rows = [];
+    for (let i = 0; i < count; ++i)
+    {
+        let id = (i * 7919) % count;
+        rows.push(new Row(id, "name" + ((id * 31) % 97) + "_" + id, id * 3 + 0.5));
+    }
+    return rows;
+}
+
+function run()
+{
+    let left = buildLeft(PIECES);
+    let right = buildRight(PIECES);
+    let balanced = buildBalanced(0, PIECES);
+    if (left != right || left != balanced)
+    {
+        __write("Ropes of different shapes differ");
+    }
+
+    let rows = makeRows(ROWS);
+    if (renderTable(rows) != renderTableByLines(rows))
+    {
+        __write("Rendered tables differ");
+    }
+
+    if (countKeys(PIECES * 4) != PIECES * 4)
+    {
+        __write("Key count is wrong");
+    }
+
+    if (!sortNames(rows))
+    {
+        __write("Names are not sorted");
+    }
+}
+
+for (let i = 0; i < ITERATIONS; ++i)
+{
+    run();
+}
+
+__write("Strings done");
@@ -0,0 +1,237 @@
+#include "Bench.h"
+
+#include "HydraCore/Core.hpp"
+#include "HydraCore/Common/ThreadPool.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <thread>
+
+namespace hydra
+{
+namespace bench
+{
+
+#ifdef _MSC_VER
+const volatile void *Sink = nullptr;
+#endif
+
+struct Benchmark
+{
+    std::string Name;
+    Function Run;
+    i64 Arg;
+    size_t MaxIterations;
+};
+
+struct Result
+{
+    std::string Name;
+    size_t Iterations;
+    double Median;
+    double Min;
+    double ItemsPerSecond;
+};
+
+static std::vector<Benchmark> &GetBenchmarks()
+{
+    static std::vector<Benchmark> benchmarks;
+    return benchmarks;
+}
+
+Registrar::Registrar(const char *name, Function function, Options options)
+{
+    if (options.ArgList.empty())
+    {
+        GetBenchmarks().push_back(Benchmark { name, function, 0, options.MaxIterations });
+        return;
+    }
+
+    for (auto arg : options.ArgList)
+    {
+        GetBenchmarks().push_back(Benchmark {
+            std::string(name) + "/" + std::to_string(arg), function, arg, options.MaxIterations });
+    }
+}
+
+static double Seconds(State::Clock::duration duration)
+{
+    return std::chrono::duration<double>(duration).count();
+}
+
+static Result Run(const Benchmark &benchmark, double minTime, size_t repetitions)
+{
+    // grow the iteration count until a run takes minTime
+    size_t iterations = 1;
+    while (true)
+    {
+        State state(iterations, benchmark.Arg);
+        benchmark.Run(state);
+
+        double elapsed = Seconds(state.GetElapsed());
+        if (elapsed >= minTime || iterations >= benchmark.MaxIterations)
+        {
+            break;
+        }
+
+        double multiplier = elapsed > 0 ? minTime * 1.4 / elapsed : 100;
+        multiplier = std::min(std::max(multiplier, 2.0), 100.0);
+        iterations = std::min(benchmark.MaxIterations, static_cast<size_t>(iterations * multiplier));
+    }
+
+    std::vector<double> perIteration;
+    double items = 0;
+    double total = 0;
+    for (size_t i = 0; i < repetitions; ++i)
+    {
+        State state(iterations, benchmark.Arg);
+        benchmark.Run(state);
+
+        double elapsed = Seconds(state.GetElapsed());
+        perIteration.push_back(elapsed * 1e9 / iterations);
+        items += state.GetItemsProcessed();
+        total += elapsed;
+    }
+
+    std::sort(perIteration.begin(), perIteration.end());
+
+    return Result {
+        benchmark.Name,
+        iterations,
+        perIteration[perIteration.size() / 2],
+        perIteration.front(),
+        total > 0 ? items / total : 0
+    };
+}
+
+static void WriteJson(std::ostream &out, const std::vector<Result> &results)
+{
+    char date[64];
+    std::time_t now = std::time(nullptr);
+    std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", std::localtime(&now));
+
+    out << "{" << std::endl;
+    out << "  \"context\": {" << std::endl;
+    out << "    \"date\": \"" << date << "\"," << std::endl;
+    out << "    \"num_cpus\": " << std::thread::hardware_concurrency() << "," << std::endl;
+#ifdef NDEBUG
+    out << "    \"library_build_type\": \"release\"" << std::endl;
+#else
+    out << "    \"library_build_type\": \"debug\"" << std::endl;
+#endif
+    out << "  }," << std::endl;
+    out << "  \"benchmarks\": [";
+
+    const char *separator = "";
+    for (auto &result : results)
+    {
+        out << separator << std::endl
+            << "    { \"name\": \"" << result.Name << "\""
+            << ", \"iterations\": " << result.Iterations
+            << ", \"real_time\": " << result.Median
+            << ", \"min_time\": " << result.Min
+            << ", \"time_unit\": \"ns\"";
+        if (result.ItemsPerSecond > 0)
+        {
+            out << ", \"items_per_second\": " << result.ItemsPerSecond;
+        }
+        out << " }";
+        separator = ",";
+    }
+
+    out << std::endl << "  ]" << std::endl << "}" << std::endl;
+}
+
+static bool StartsWith(const std::string &str, const char *prefix)
+{
+    return str.compare(0, strlen(prefix), prefix) == 0;
+}
+
+static int Main(int argc, const char **argv)
+{
+    std::string filter;
+    std::string jsonPath;
+    double minTime = 0.1;
+    size_t repetitions = 5;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (StartsWith(arg, "--filter="))
+        {
+            filter = arg.substr(9);
+        }
+        else if (StartsWith(arg, "--json="))
+        {
+            jsonPath = arg.substr(7);
+        }
+        else if (StartsWith(arg, "--min-time="))
+        {
+            minTime = std::strtod(arg.c_str() + 11, nullptr);
+        }
+        else if (StartsWith(arg, "--repetitions="))
+        {
+            repetitions = std::max<size_t>(1, std::strtoul(arg.c_str() + 14, nullptr, 10));
+        }
+        else
+        {
+            std::cerr << "usage: HydraBench [--filter=<substring>] [--json=<file>]"
+                << " [--min-time=<seconds>] [--repetitions=<n>]" << std::endl;
+            return 1;
+        }
+    }
+
+    printf("%-40s %14s %14s %12s %16s\n", "benchmark", "median ns", "min ns", "iterations", "items/s");
+
+    std::vector<Result> results;
+    for (auto &benchmark : GetBenchmarks())
+    {
+        if (benchmark.Name.find(filter) == std::string::npos)
+        {
+            continue;
+        }
+
+        auto result = Run(benchmark, minTime, repetitions);
+        printf("%-40s %14.1f %14.1f %12zu %16.0f\n", result.Name.c_str(),
+            result.Median, result.Min, result.Iterations, result.ItemsPerSecond);
+        fflush(stdout);
+
+        results.push_back(result);
+    }
+
+    if (!jsonPath.empty())
+    {
+        std::ofstream out(jsonPath);
+        if (!out)
+        {
+            std::cerr << "can not write " << jsonPath << std::endl;
+            return 1;
+        }
+        WriteJson(out, results);
+    }
+
+    return 0;
+}
+
+} // namespace bench
+} // namespace hydra
+
+int main(int argc, const char **argv)
+{
+    using namespace hydra;
+
+    // ensure initialization order
+    {
+        Logger::GetInstance();
+        Metrics::GetInstance();
+        gc::Heap::GetInstance();
+        ThreadPool::GetInstance();
+    }
+
+    return bench::Main(argc, argv);
+}
@@ -0,0 +1,150 @@
+#ifndef _BENCH_H_
+#define _BENCH_H_
+
+#include "HydraCore/Common/HydraCore.h"
+
+#include <chrono>
+#include <functional>
+#include <string>
+#include <vector>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace hydra
+{
+namespace bench
+{
+
+// a run of one benchmark with a fixed iteration count. The clock runs from
+// the first KeepRunning to the last, or between ResumeTiming and PauseTiming
+// for benchmarks that time themselves, e.g. to spread work over threads
+class State
+{
+public:
+    using Clock = std::chrono::high_resolution_clock;
+
+    State(size_t iterations, i64 arg)
+        : Iterations(iterations), Remaining(iterations), Argument(arg),
+        Started(false), Elapsed(0), ItemsProcessed(0)
+    { }
+
+    inline bool KeepRunning()
+    {
+        if (!Started)
+        {
+            Started = true;
+            ResumeTiming();
+        }
+
+        if (Remaining > 0)
+        {
+            --Remaining;
+            return true;
+        }
+
+        PauseTiming();
+        return false;
+    }
+
+    inline void ResumeTiming()
+    {
+        Last = Clock::now();
+    }
+
+    inline void PauseTiming()
+    {
+        Elapsed += Clock::now() - Last;
+    }
+
+    inline size_t GetIterations() const
+    {
+        return Iterations;
+    }
+
+    inline i64 Arg() const
+    {
+        return Argument;
+    }
+
+    inline void SetItemsProcessed(size_t items)
+    {
+        ItemsProcessed = items;
+    }
+
+    inline size_t GetItemsProcessed() const
+    {
+        return ItemsProcessed;
+    }
+
+    inline Clock::duration GetElapsed() const
+    {
+        return Elapsed;
+    }
+
+private:
+    size_t Iterations;
+    size_t Remaining;
+    i64 Argument;
+    bool Started;
+    Clock::time_point Last;
+    Clock::duration Elapsed;
+    size_t ItemsProcessed;
+};
+
+struct Options
+{
+    // registers one run per argument, named "name/arg"
+    std::vector<i64> ArgList;
+
+    // for benchmarks that keep what they allocate, the gc does not run here
+    size_t MaxIterations = static_cast<size_t>(1) << 30;
+
+    inline Options &Args(std::vector<i64> args)
+    {
+        ArgList = std::move(args);
+        return *this;
+    }
+
+    inline Options &IterationLimit(size_t limit)
+    {
+        MaxIterations = limit;
+        return *this;
+    }
+};
+
+using Function = std::function<void(State &)>;
+
+struct Registrar
+{
+    Registrar(const char *name, Function function, Options options = Options());
+};
+
+#ifdef _MSC_VER
+extern const volatile void *Sink;
+#endif
+
+// keeps the compiler from dropping a result nobody reads
+template <typename T>
+inline void DoNotOptimize(const T &value)
+{
+#ifdef _MSC_VER
+    Sink = &value;
+    _ReadWriteBarrier();
+#else
+    asm volatile("" : : "r,m"(value) : "memory");
+#endif
+}
+
+} // namespace bench
+} // namespace hydra
+
+#define hydra_benchmark_with(__name, __options)                                             \
+    static void __name(::hydra::bench::State &state);                                       \
+    static ::hydra::bench::Registrar __name##Registrar(#__name, __name, __options);        \
+    static void __name(::hydra::bench::State &state)
+
+#define hydra_benchmark(__name)     hydra_benchmark_with(__name, ::hydra::bench::Options())
+
+#endif // _BENCH_H_
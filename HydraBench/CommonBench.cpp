@@ -0,0 +1,90 @@
+#include "Bench.h"
+
+#include "HydraCore/Common/ConcurrentQueue.h"
+#include "HydraCore/Common/ThreadPool.h"
+
+#include <future>
+#include <memory>
+#include <thread>
+
+namespace hydra
+{
+namespace bench
+{
+
+// arg producers and as many consumers share one queue, each item passes once
+hydra_benchmark_with(ConcurrentQueue, Options().Args({ 1, 2, 4 }))
+{
+    size_t threads = static_cast<size_t>(state.Arg());
+    size_t iterations = state.GetIterations();
+
+    // too large for the stack
+    auto queue = std::make_unique<concurrent::Queue<size_t>>();
+    std::vector<std::thread> workers;
+
+    state.ResumeTiming();
+    for (size_t i = 0; i < threads; ++i)
+    {
+        workers.emplace_back([&]()
+        {
+            for (size_t j = 0; j < iterations; ++j)
+            {
+                queue->Enqueue(j);
+            }
+        });
+        workers.emplace_back([&]()
+        {
+            size_t value;
+            for (size_t j = 0; j < iterations; ++j)
+            {
+                queue->Dequeue(value);
+                DoNotOptimize(value);
+            }
+        });
+    }
+    for (auto &worker : workers)
+    {
+        worker.join();
+    }
+    state.PauseTiming();
+
+    state.SetItemsProcessed(iterations * threads);
+}
+
+// one task at a time, the latency of a round trip through the pool
+hydra_benchmark(ThreadPoolDispatch)
+{
+    auto pool = ThreadPool::GetInstance();
+
+    while (state.KeepRunning())
+    {
+        DoNotOptimize(pool->Dispatch<int>([]() { return 1; }).get());
+    }
+
+    state.SetItemsProcessed(state.GetIterations());
+}
+
+// arg tasks in flight before waiting, the throughput of the pool
+hydra_benchmark_with(ThreadPoolDispatchBatch, Options().Args({ 16, 256 }))
+{
+    auto pool = ThreadPool::GetInstance();
+    size_t batch = static_cast<size_t>(state.Arg());
+
+    std::vector<std::future<int>> futures;
+    futures.reserve(batch);
+
+    while (state.KeepRunning())
+    {
+        for (size_t i = 0; i < batch; ++i)
+        {
+            futures.push_back(pool->Dispatch<int>([]() { return 1; }));
+        }
+        ThreadPool::WaitAll(futures.begin(), futures.end());
+        futures.clear();
+    }
+
+    state.SetItemsProcessed(state.GetIterations() * batch);
+}
+
+} // namespace bench
+} // namespace hydra
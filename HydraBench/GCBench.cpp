@@ -0,0 +1,52 @@
+#include "Bench.h"
+
+#include "HydraCore/GarbageCollection/GC.h"
+
+namespace hydra
+{
+namespace bench
+{
+
+namespace
+{
+
+struct BenchObject : gc::HeapObject
+{
+    BenchObject(u8 property)
+        : HeapObject(property)
+    { }
+
+    virtual void Scan(std::function<void(gc::HeapObject *)>) override
+    { }
+};
+
+}
+
+// a cell of each tested level; nothing is collected, so runs are capped
+hydra_benchmark_with(ThreadAllocatorAllocate, Options().Args({ 0, 2, 4 }).IterationLimit(1 << 14))
+{
+    gc::ThreadAllocator allocator(gc::Heap::GetInstance());
+    size_t size = gc::Region::CellSizeFromLevel(static_cast<size_t>(state.Arg()));
+
+    while (state.KeepRunning())
+    {
+        DoNotOptimize(allocator.AllocateWithSizeAuto<BenchObject>(size));
+    }
+
+    state.SetItemsProcessed(state.GetIterations());
+}
+
+hydra_benchmark_with(ThreadAllocatorAllocateLarge, Options().IterationLimit(1 << 6))
+{
+    gc::ThreadAllocator allocator(gc::Heap::GetInstance());
+
+    while (state.KeepRunning())
+    {
+        DoNotOptimize(allocator.AllocateWithSizeAuto<BenchObject>(gc::MAXIMAL_ALLOCATE_SIZE + 1));
+    }
+
+    state.SetItemsProcessed(state.GetIterations());
+}
+
+} // namespace bench
+} // namespace hydra
@@ -0,0 +1,525 @@
+#include "HydraCore/Core.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <regex>
+#include <sstream>
+#include <streambuf>
+#include <thread>
+
+namespace hydra
+{
+namespace bench
+{
+
+using Clock = std::chrono::high_resolution_clock;
+
+static constexpr auto PEAK_HEAP_SAMPLE_INTERVAL = 2ms;
+
+// one measured run of a script
+struct Sample
+{
+    double Wall;
+    double GC;
+    double Jit;
+    double Allocated;
+
+    // the most the heap in use grew over its size when the run started
+    double HeapGrowth;
+};
+
+struct Field
+{
+    const char *Name;
+    double Sample::*Value;
+};
+
+static const Field FIELDS[] = {
+    { "wall_ms", &Sample::Wall },
+    { "gc_ms", &Sample::GC },
+    { "jit_compile_ms", &Sample::Jit },
+    { "allocated_bytes", &Sample::Allocated },
+    { "heap_growth_bytes", &Sample::HeapGrowth },
+};
+
+// medians over the measured runs by field name, plus wall_min_ms
+using Summary = std::map<std::string, double>;
+
+struct Result
+{
+    std::string Name;
+    size_t Runs;
+    Summary Values;
+};
+
+// the totals a run is measured by, as differences of two of these
+struct Totals
+{
+    double GCUs = 0;
+    double JitUs = 0;
+    double Allocated = 0;
+};
+
+static Totals ReadTotals(const Metrics::Report &report)
+{
+    Totals ret;
+
+    auto pause = report.Histograms.find("gc.pause_us");
+    if (pause != report.Histograms.end())
+    {
+        ret.GCUs = static_cast<double>(pause->second.Sum);
+    }
+
+    auto compile = report.Histograms.find("jit.compile_us");
+    if (compile != report.Histograms.end())
+    {
+        ret.JitUs = static_cast<double>(compile->second.Sum);
+    }
+
+    for (auto &pair : report.Counters)
+    {
+        if (pair.first.compare(0, 19, "gc.allocated_bytes.") == 0)
+        {
+            ret.Allocated += static_cast<double>(pair.second);
+        }
+    }
+
+    return ret;
+}
+
+// regions taken out of the free lists, large objects are not counted
+static u64 HeapInUse()
+{
+    auto gauges = Metrics::GetInstance()->Collect().Gauges;
+    u64 total = gauges["gc.regions.total"];
+    u64 free = gauges["gc.regions.free"];
+    return (total > free ? total - free : 0) * gc::REGION_SIZE;
+}
+
+// swallows what the script writes while it is measured
+class NullBuffer : public std::streambuf
+{
+protected:
+    virtual int overflow(int ch) override
+    {
+        return ch == EOF ? 0 : ch;
+    }
+};
+
+static bool RunOnce(gc::ThreadAllocator &allocator, runtime::JSFunction *func, bool showOutput, Sample &sample)
+{
+    auto metrics = Metrics::GetInstance();
+    auto before = ReadTotals(metrics->Collect());
+
+    // gauges only tell the current state, so the peak is polled
+    std::atomic<bool> done(false);
+    u64 start = HeapInUse();
+    u64 peak = start;
+    std::thread sampler([&]()
+    {
+        while (!done.load())
+        {
+            std::this_thread::sleep_for(PEAK_HEAP_SAMPLE_INTERVAL);
+            peak = std::max(peak, HeapInUse());
+        }
+    });
+
+    NullBuffer null;
+    auto output = showOutput ? std::cout.rdbuf() : std::cout.rdbuf(&null);
+
+    auto begin = Clock::now();
+
+    auto arguments = runtime::semantic::NewArrayInternal(allocator);
+    runtime::JSValue retVal;
+    runtime::JSValue error;
+    bool result = func->Call(allocator,
+        runtime::JSValue::FromObject(runtime::semantic::GetGlobalObject()), arguments, retVal, error);
+
+    auto end = Clock::now();
+
+    std::cout.rdbuf(output);
+
+    done = true;
+    sampler.join();
+    peak = std::max(peak, HeapInUse());
+
+    auto after = ReadTotals(metrics->Collect());
+
+    sample.Wall = std::chrono::duration<double, std::milli>(end - begin).count();
+    sample.GC = (after.GCUs - before.GCUs) / 1000;
+    sample.Jit = (after.JitUs - before.JitUs) / 1000;
+    sample.Allocated = after.Allocated - before.Allocated;
+    sample.HeapGrowth = static_cast<double>(peak - start);
+
+    return result;
+}
+
+static double Median(std::vector<double> values)
+{
+    std::sort(values.begin(), values.end());
+    return values[values.size() / 2];
+}
+
+static bool Run(gc::ThreadAllocator &allocator, const std::string &path,
+    size_t warmup, size_t runs, bool showOutput, Result &result)
+{
+    // loaded once, every run calls the same root function
+    auto func = vm::VM::GetInstance()->Compile(allocator, path);
+
+    std::vector<Sample> samples;
+    for (size_t i = 0; i < warmup + runs; ++i)
+    {
+        Sample sample;
+        if (!RunOnce(allocator, func, showOutput, sample))
+        {
+            return false;
+        }
+
+        if (i >= warmup)
+        {
+            samples.push_back(sample);
+        }
+    }
+
+    result.Name = path;
+    result.Runs = runs;
+
+    for (auto &field : FIELDS)
+    {
+        std::vector<double> values;
+        for (auto &sample : samples)
+        {
+            values.push_back(sample.*field.Value);
+        }
+        result.Values[field.Name] = Median(values);
+    }
+
+    auto fastest = std::min_element(samples.begin(), samples.end(), [](auto &a, auto &b)
+    {
+        return a.Wall < b.Wall;
+    });
+    result.Values["wall_min_ms"] = fastest->Wall;
+
+    return true;
+}
+
+static void WriteString(std::ostream &out, const std::string &str)
+{
+    out << '"';
+    for (char ch : str)
+    {
+        if (ch == '"' || ch == '\\')
+        {
+            out << '\\';
+        }
+        out << ch;
+    }
+    out << '"';
+}
+
+static void WriteJson(std::ostream &out, const std::vector<Result> &results, size_t warmup)
+{
+    char date[64];
+    std::time_t now = std::time(nullptr);
+    std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", std::localtime(&now));
+
+    // byte counts must survive the round trip through a baseline
+    out.precision(15);
+
+    out << "{" << std::endl;
+    out << "  \"context\": { \"date\": \"" << date << "\", \"warmup\": " << warmup << " }," << std::endl;
+    out << "  \"benchmarks\": [";
+
+    const char *separator = "";
+    for (auto &result : results)
+    {
+        out << separator << std::endl << "    { \"name\": ";
+        WriteString(out, result.Name);
+        out << ", \"runs\": " << result.Runs;
+        for (auto &pair : result.Values)
+        {
+            out << ", \"" << pair.first << "\": " << pair.second;
+        }
+        out << " }";
+        separator = ",";
+    }
+
+    out << std::endl << "  ]" << std::endl << "}" << std::endl;
+}
+
+// reads back the benchmarks of a report written by WriteJson, it is no
+// general json parser: every benchmark is a flat object of strings and numbers
+static bool ReadBaseline(const std::string &path, std::map<std::string, Summary> &baseline)
+{
+    std::ifstream file(path);
+    if (!file)
+    {
+        return false;
+    }
+
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    std::string text = buffer.str();
+
+    auto begin = text.find("\"benchmarks\"");
+    if (begin == std::string::npos)
+    {
+        return false;
+    }
+
+    static const std::regex pair(R"re("((?:[^"\\]|\\.)*)"\s*:\s*(?:"((?:[^"\\]|\\.)*)"|([-+0-9.eE]+)))re");
+    static const std::regex escape(R"re(\\(.))re");
+
+    while ((begin = text.find('{', begin)) != std::string::npos)
+    {
+        auto end = text.find('}', begin);
+        if (end == std::string::npos)
+        {
+            return false;
+        }
+
+        std::string name;
+        Summary values;
+
+        auto object = text.substr(begin, end - begin);
+        for (std::sregex_iterator iter(object.begin(), object.end(), pair), last; iter != last; ++iter)
+        {
+            if ((*iter)[2].matched)
+            {
+                if ((*iter)[1] == "name")
+                {
+                    name = std::regex_replace((*iter)[2].str(), escape, "$1");
+                }
+            }
+            else
+            {
+                values[(*iter)[1]] = std::strtod((*iter)[3].str().c_str(), nullptr);
+            }
+        }
+
+        if (!name.empty())
+        {
+            baseline[name] = values;
+        }
+        begin = end;
+    }
+
+    return true;
+}
+
+// prints every field against the baseline, true if any got worse by more than threshold
+static bool Compare(const std::vector<Result> &results,
+    const std::map<std::string, Summary> &baseline, double threshold)
+{
+    bool regressed = false;
+
+    printf("\n%-32s %-16s %14s %14s %9s\n", "benchmark", "field", "baseline", "current", "change");
+    for (auto &result : results)
+    {
+        auto entry = baseline.find(result.Name);
+        if (entry == baseline.end())
+        {
+            printf("%-32s not in baseline\n", result.Name.c_str());
+            continue;
+        }
+
+        for (auto &field : FIELDS)
+        {
+            auto base = entry->second.find(field.Name);
+            if (base == entry->second.end() || base->second <= 0)
+            {
+                continue;
+            }
+
+            double current = result.Values.at(field.Name);
+            double change = current / base->second - 1;
+            bool regression = change > threshold;
+            regressed |= regression;
+
+            printf("%-32s %-16s %14.2f %14.2f %+8.1f%%%s\n", result.Name.c_str(), field.Name,
+                base->second, current, change * 100, regression ? "  REGRESSION" : "");
+        }
+    }
+
+    return regressed;
+}
+
+static bool StartsWith(const std::string &str, const char *prefix)
+{
+    return str.compare(0, strlen(prefix), prefix) == 0;
+}
+
+// benchmarks are compiled ahead by HydraCompiler, the ir sits next to the js
+static std::string ScriptPath(const std::string &path)
+{
+    if (path.size() > 3 && path.compare(path.size() - 3, 3, ".js") == 0)
+    {
+        return path.substr(0, path.size() - 3) + ".ir";
+    }
+    return path;
+}
+
+static void Usage()
+{
+    std::cerr << "usage: HydraMacroBench [--runs=<n>] [--warmup=<n>] [--json=<file>]"
+        << " [--baseline=<file>] [--threshold=<fraction>] [--show-output] <script>..." << std::endl;
+}
+
+static int Main(int argc, const char **argv)
+{
+    size_t runs = 5;
+    size_t warmup = 2;
+    std::string jsonPath;
+    std::string baselinePath;
+    double threshold = 0.05;
+    bool showOutput = false;
+    std::vector<std::string> scripts;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (StartsWith(arg, "--runs="))
+        {
+            runs = std::max<size_t>(1, std::strtoul(arg.c_str() + 7, nullptr, 10));
+        }
+        else if (StartsWith(arg, "--warmup="))
+        {
+            warmup = std::strtoul(arg.c_str() + 9, nullptr, 10);
+        }
+        else if (StartsWith(arg, "--json="))
+        {
+            jsonPath = arg.substr(7);
+        }
+        else if (StartsWith(arg, "--baseline="))
+        {
+            baselinePath = arg.substr(11);
+        }
+        else if (StartsWith(arg, "--threshold="))
+        {
+            threshold = std::strtod(arg.c_str() + 12, nullptr);
+        }
+        else if (arg == "--show-output")
+        {
+            showOutput = true;
+        }
+        else if (StartsWith(arg, "--"))
+        {
+            Usage();
+            return 1;
+        }
+        else
+        {
+            scripts.push_back(ScriptPath(arg));
+        }
+    }
+
+    if (scripts.empty())
+    {
+        Usage();
+        return 1;
+    }
+
+    std::map<std::string, Summary> baseline;
+    if (!baselinePath.empty() && !ReadBaseline(baselinePath, baseline))
+    {
+        std::cerr << "can not read baseline " << baselinePath << std::endl;
+        return 1;
+    }
+
+    for (auto &script : scripts)
+    {
+        if (!std::ifstream(script))
+        {
+            std::cerr << "can not find " << script << ", compile it with HydraCompiler first" << std::endl;
+            return 1;
+        }
+    }
+
+    // a cache left by an earlier run would skip the loading being measured
+    vm::CodeCache::SetEnabled(false);
+
+    auto VM = vm::VM::GetInstance();
+    gc::ThreadAllocator allocator(gc::Heap::GetInstance());
+
+    VM->LoadJsLib(allocator);
+
+    int ret = 0;
+
+    printf("%-32s %10s %10s %10s %10s %14s %14s\n", "benchmark",
+        "wall ms", "min ms", "gc ms", "jit ms", "allocated", "heap growth");
+
+    std::vector<Result> results;
+    for (auto &script : scripts)
+    {
+        Result result;
+        if (!Run(allocator, script, warmup, runs, showOutput, result))
+        {
+            std::cerr << script << ": error thrown" << std::endl;
+            ret = 1;
+            continue;
+        }
+
+        auto &values = result.Values;
+        printf("%-32s %10.2f %10.2f %10.2f %10.2f %14.0f %14.0f\n", script.c_str(),
+            values["wall_ms"], values["wall_min_ms"], values["gc_ms"], values["jit_compile_ms"],
+            values["allocated_bytes"], values["heap_growth_bytes"]);
+        fflush(stdout);
+
+        results.push_back(result);
+    }
+
+    if (!jsonPath.empty())
+    {
+        std::ofstream out(jsonPath);
+        if (!out)
+        {
+            std::cerr << "can not write " << jsonPath << std::endl;
+            ret = 1;
+        }
+        else
+        {
+            WriteJson(out, results, warmup);
+        }
+    }
+
+    if (!baselinePath.empty() && Compare(results, baseline, threshold))
+    {
+        ret = 1;
+    }
+
+    allocator.SetInactive([](){});
+    VM->Stop();
+
+    return ret;
+}
+
+} // namespace bench
+} // namespace hydra
+
+int main(int argc, const char **argv)
+{
+    using namespace hydra;
+
+    // ensure initialization order
+    {
+        Logger::GetInstance();
+        Metrics::GetInstance();
+        Tracer::GetInstance();
+        gc::Heap::GetInstance();
+        vm::IRModuleGCHelper::GetInstance();
+        runtime::semantic::Initialize();
+        vm::CodeHeap::GetInstance();
+        vm::VM::GetInstance();
+    }
+
+    Tracer::SetThreadName("Main");
+
+    return bench::Main(argc, argv);
+}
@@ -0,0 +1,270 @@
+#include "Bench.h"
+
+#include "HydraCore/Runtime/JSArray.h"
+#include "HydraCore/Runtime/Klass.h"
+#include "HydraCore/Runtime/ManagedHashMap.h"
+#include "HydraCore/Runtime/String.h"
+
+#include <thread>
+
+namespace hydra
+{
+namespace bench
+{
+
+using runtime::HashMap;
+using runtime::JSArray;
+using runtime::JSObjectPropertyAttribute;
+using runtime::JSValue;
+using runtime::Klass;
+using runtime::String;
+
+namespace
+{
+
+constexpr size_t MAP_KEYS = 1024;
+constexpr size_t STRING_LENGTH = 64;
+
+String *NewKey(gc::ThreadAllocator &allocator, size_t index)
+{
+    auto number = std::to_string(index);
+    auto text = u"property" + std::u16string(number.begin(), number.end());
+    return String::New(allocator, text.begin(), text.end());
+}
+
+std::vector<String *> NewKeys(gc::ThreadAllocator &allocator, size_t count)
+{
+    std::vector<String *> keys;
+    for (size_t i = 0; i < count; ++i)
+    {
+        keys.push_back(NewKey(allocator, i));
+    }
+    return keys;
+}
+
+std::u16string Text(char_t ch)
+{
+    return std::u16string(STRING_LENGTH, ch);
+}
+
+// runs body(thread) on each of threads threads and times them together
+template <typename T_Body>
+void RunThreads(State &state, size_t threads, T_Body body)
+{
+    std::vector<std::thread> workers;
+
+    state.ResumeTiming();
+    for (size_t i = 0; i < threads; ++i)
+    {
+        workers.emplace_back(body, i);
+    }
+    for (auto &worker : workers)
+    {
+        worker.join();
+    }
+    state.PauseTiming();
+
+    state.SetItemsProcessed(state.GetIterations() * threads);
+}
+
+}
+
+// the transitions exist after the first run, this walks the cached chain
+hydra_benchmark_with(KlassTransition, Options().Args({ 4, 32 }))
+{
+    gc::ThreadAllocator allocator(gc::Heap::GetInstance());
+    auto keys = NewKeys(allocator, static_cast<size_t>(state.Arg()));
+    auto empty = Klass::EmptyKlass(allocator);
+
+    while (state.KeepRunning())
+    {
+        Klass *klass = empty;
+        for (auto key : keys)
+        {
+            klass = klass->AddTransaction(allocator, key);
+        }
+        DoNotOptimize(klass);
+    }
+
+    state.SetItemsProcessed(state.GetIterations() * keys.size());
+}
+
+// below MINIMAL_KEY_COUNT_TO_ENABLE_HASH_IN_KLASS keys Find scans the table
+hydra_benchmark_with(KlassFind, Options().Args({ 4, 8, 32 }))
+{
+    gc::ThreadAllocator allocator(gc::Heap::GetInstance());
+    auto keys = NewKeys(allocator, static_cast<size_t>(state.Arg()));
+
+    Klass *klass = Klass::EmptyKlass(allocator);
+    for (auto key : keys)
+    {
+        klass = klass->AddTransaction(allocator, key);
+    }
+
+    // equal to the last key but not the same object
+    auto probe = NewKey(allocator, keys.size() - 1);
+
+    while (state.KeepRunning())
+    {
+        size_t index;
+        DoNotOptimize(klass->Find(probe, index));
+    }
+
+    state.SetItemsProcessed(state.GetIterations());
+}
+
+hydra_benchmark_with(HashMapFind, Options().Args({ 1, 2, 4, 8 }))
+{
+    gc::ThreadAllocator allocator(gc::Heap::GetInstance());
+    auto keys = NewKeys(allocator, MAP_KEYS);
+
+    auto map = HashMap<size_t>::New(allocator, MAP_KEYS * 2);
+    for (size_t i = 0; i < keys.size(); ++i)
+    {
+        map->TrySet(keys[i], i);
+    }
+
+    RunThreads(state, static_cast<size_t>(state.Arg()), [&](size_t thread)
+    {
+        for (size_t i = 0; i < state.GetIterations(); ++i)
+        {
+            size_t value;
+            DoNotOptimize(map->Find(keys[(i + thread) % keys.size()], value));
+        }
+    });
+}
+
+// every thread inserts the same keys, the first insert wins and the rest find
+hydra_benchmark_with(HashMapFindOrSet, Options().Args({ 1, 2, 4, 8 }))
+{
+    gc::ThreadAllocator allocator(gc::Heap::GetInstance());
+    auto keys = NewKeys(allocator, MAP_KEYS);
+    auto map = HashMap<size_t>::New(allocator, MAP_KEYS * 2);
+
+    RunThreads(state, static_cast<size_t>(state.Arg()), [&](size_t thread)
+    {
+        for (size_t i = 0; i < state.GetIterations(); ++i)
+        {
+            size_t value = i;
+            bool found, set;
+            DoNotOptimize(map->FindOrSet(keys[(i + thread) % keys.size()], value, found, set));
+        }
+    });
+}
+
+hydra_benchmark_with(StringConcat, Options().IterationLimit(1 << 16))
+{
+    gc::ThreadAllocator allocator(gc::Heap::GetInstance());
+    auto text = Text(u'a');
+    auto left = String::New(allocator, text.begin(), text.end());
+    auto right = String::New(allocator, text.begin(), text.end());
+
+    while (state.KeepRunning())
+    {
+        DoNotOptimize(String::Concat(allocator, left, right));
+    }
+
+    state.SetItemsProcessed(state.GetIterations());
+}
+
+// a rope of arg pieces, built left deep as by repeated +=
+hydra_benchmark_with(StringFlatten, Options().Args({ 2, 16, 128 }).IterationLimit(1 << 10))
+{
+    gc::ThreadAllocator allocator(gc::Heap::GetInstance());
+    auto text = Text(u'a');
+    auto piece = String::New(allocator, text.begin(), text.end());
+
+    // Flatten caches its result, so every iteration gets its own rope
+    std::vector<String *> ropes;
+    for (size_t i = 0; i < state.GetIterations(); ++i)
+    {
+        String *rope = piece;
+        for (i64 j = 1; j < state.Arg(); ++j)
+        {
+            rope = String::Concat(allocator, rope, piece);
+        }
+        ropes.push_back(rope);
+    }
+
+    size_t i = 0;
+    while (state.KeepRunning())
+    {
+        DoNotOptimize(ropes[i++]->Flatten(allocator));
+    }
+
+    state.SetItemsProcessed(state.GetIterations() * STRING_LENGTH * state.Arg());
+}
+
+hydra_benchmark(StringEqualsTo)
+{
+    gc::ThreadAllocator allocator(gc::Heap::GetInstance());
+    auto text = Text(u'a');
+    auto left = String::New(allocator, text.begin(), text.end());
+    auto right = String::New(allocator, text.begin(), text.end());
+
+    while (state.KeepRunning())
+    {
+        DoNotOptimize(left->EqualsTo(right));
+    }
+
+    state.SetItemsProcessed(state.GetIterations());
+}
+
+// the hash is cached, so every iteration hashes a string of its own
+hydra_benchmark_with(StringGetHash, Options().IterationLimit(1 << 16))
+{
+    gc::ThreadAllocator allocator(gc::Heap::GetInstance());
+    auto text = Text(u'a');
+
+    std::vector<String *> strings;
+    for (size_t i = 0; i < state.GetIterations(); ++i)
+    {
+        strings.push_back(String::New(allocator, text.begin(), text.end()));
+    }
+
+    size_t i = 0;
+    while (state.KeepRunning())
+    {
+        DoNotOptimize(strings[i++]->GetHash());
+    }
+
+    state.SetItemsProcessed(state.GetIterations() * STRING_LENGTH);
+}
+
+// indices below the split point live in the table part, the rest in the hash part
+hydra_benchmark_with(JSArrayGet, Options().Args({ 0, 7, 8, 64 }))
+{
+    gc::ThreadAllocator allocator(gc::Heap::GetInstance());
+    auto array = JSArray::New(allocator);
+    size_t key = static_cast<size_t>(state.Arg());
+
+    array->Set(allocator, key, JSValue::FromNumber(1));
+
+    while (state.KeepRunning())
+    {
+        JSValue value;
+        JSObjectPropertyAttribute attribute;
+        DoNotOptimize(array->Get(key, value, attribute));
+    }
+
+    state.SetItemsProcessed(state.GetIterations());
+}
+
+hydra_benchmark_with(JSArraySet, Options().Args({ 0, 7, 8, 64 }))
+{
+    gc::ThreadAllocator allocator(gc::Heap::GetInstance());
+    auto array = JSArray::New(allocator);
+    size_t key = static_cast<size_t>(state.Arg());
+    auto value = JSValue::FromNumber(1);
+
+    while (state.KeepRunning())
+    {
+        array->Set(allocator, key, value);
+    }
+
+    DoNotOptimize(array);
+    state.SetItemsProcessed(state.GetIterations());
+}
+
+} // namespace bench
+} // namespace hydra
@@ -67,6 +67,13 @@ public:
         return RootLevel.Has(ptr, hash);
     }
 
+    // not a snapshot: elements added or removed meanwhile may or may not be visited
+    template <typename T_Callback>
+    void Foreach(T_Callback callback)
+    {
+        RootLevel.Foreach(callback);
+    }
+
 private:
     static_assert((LevelSize & (LevelSize - 1)) == 0,
         "LevelSize must be power of 2");
@@ -182,6 +189,23 @@ private:
 
             return CastToT(slotValue) == ptr;
         }
+
+        template <typename T_Callback>
+        void Foreach(T_Callback &callback)
+        {
+            for (auto &slot : Table)
+            {
+                auto slotValue = slot.load(std::memory_order_consume);
+                if (IsNextLevel(slotValue))
+                {
+                    CastToLevel<Level + 1>(slotValue)->Foreach(callback);
+                }
+                else if (slotValue)
+                {
+                    callback(CastToT(slotValue));
+                }
+            }
+        }
     };
 
     template <size_t Level>
@@ -228,6 +252,19 @@ private:
             auto levelHash = GetLevelHash(hash);
             return Table[levelHash].load(std::memory_order_consume) == ptr;
         }
+
+        template <typename T_Callback>
+        void Foreach(T_Callback &callback)
+        {
+            for (auto &slot : Table)
+            {
+                T *ptr = slot.load(std::memory_order_consume);
+                if (ptr)
+                {
+                    callback(ptr);
+                }
+            }
+        }
     };
 
     static constexpr bool IsNextLevel(uintptr_t value)
@@ -17,6 +17,13 @@ namespace hydra
 #define HYDRA_ENABLE_LOG
 #define HYDRA_LOG_TO_FILE
 
+// log events below this level compile to nothing: 0 debug, 1 info, 2 warn
+#define HYDRA_LOG_LEVEL 0
+
+// symbols of generated code for linux perf, see vm::JitSymbols
+// #define HYDRA_ENABLE_PERF_MAP
+// #define HYDRA_ENABLE_JITDUMP
+
 using namespace std::chrono_literals;
 
 using std::size_t;
@@ -1,17 +1,31 @@
 #include "Logger.h"
+#include <algorithm>
+#include <cstdio>
 #include <iostream>
 #include <fstream>
 
-#if defined(HYDRA_LOG_TO_FILE) && defined(HYDRA_ENABLE_LOG)
-std::ofstream fout("./log.txt");
-#endif
-
 namespace hydra
 {
 
+thread_local Logger::Ring *Logger::LocalRing = nullptr;
+
+static constexpr auto LOG_FLUSH_INTERVAL = 10ms;
+
 Logger::Logger()
     : ShouldExit(false),
-    Queue(),
+    StartTime(Clock::now()),
+    Out(nullptr),
+#ifdef HYDRA_ENABLE_LOG
+    WriteThread(&Logger::Write, this)
+#else
+    WriteThread()
+#endif
+{ }
+
+Logger::Logger(std::ostream &out)
+    : ShouldExit(false),
+    StartTime(Clock::now()),
+    Out(&out),
 #ifdef HYDRA_ENABLE_LOG
     WriteThread(&Logger::Write, this)
 #else
@@ -31,73 +45,199 @@ Logger::~Logger()
 
 void Logger::Shutdown()
 {
+    hydra_log_info("Logger shutdown requested");
+
     if (!ShouldExit.exchange(true))
     {
-        Log() << "Logger shutdown requested";
 #ifdef HYDRA_ENABLE_LOG
         WriteThread.join();
 #endif
     }
 }
 
-void Logger::Write()
+Logger::Ring *Logger::NewRing()
 {
-#ifdef HYDRA_ENABLE_LOG
-    auto StartTime = std::chrono::high_resolution_clock::now();
-
-    auto writeTime = [&](decltype(StartTime) time)
+    // destroyed when the thread exits, Drain frees the ring after emptying it
+    struct RetireOnExit
     {
-        auto us = std::chrono::duration_cast<std::chrono::microseconds>(time - StartTime).count();
-        auto hour = us / 1000 / 1000 / 60 / 60;
-        auto min = us / 1000 / 1000 / 60 % 60;
-        auto sec = us / 1000 / 1000 % 60;
-        auto ms = us / 1000 % 1000;
-        us = us % 1000;
+        Ring *Owned = nullptr;
 
-#ifdef HYDRA_LOG_TO_FILE
-        fout
-#else
-        std::cout
-#endif
-            << (hour < 10 ? "0" : "") << hour << ":"
-            << (min < 10 ? "0" : "") << min << ":"
-            << (sec < 10 ? "0" : "") << sec << "."
-            << (ms < 10 ? "00" : ms < 100 ? "0" : "") << ms << "."
-            << (us < 10 ? "00" : us < 100 ? "0" : "") << us;
+        ~RetireOnExit()
+        {
+            if (Owned)
+            {
+                LocalRing = nullptr;
+                Owned->Retired.store(true, std::memory_order_release);
+            }
+        }
     };
+    static thread_local RetireOnExit retire;
 
-    while (!ShouldExit.load())
+    std::lock_guard<std::mutex> lock(RingsMutex);
+
+    Rings.emplace_back(new Ring());
+    LocalRing = Rings.back().get();
+    LocalRing->ThreadId = std::this_thread::get_id();
+    retire.Owned = LocalRing;
+    return LocalRing;
+}
+
+std::string Logger::Format(const Record &record)
+{
+    std::string ret;
+    char buffer[32];
+    size_t index = 0;
+
+    for (const char *ch = record.Format; *ch; ++ch)
     {
-        Entry *entry;
-        Queue.Dequeue(entry);
+        if (ch[0] != '{' || ch[1] != '}' || index >= record.Count)
+        {
+            ret += *ch;
+            continue;
+        }
 
-        writeTime(entry->TimePoint);
-#ifdef HYDRA_LOG_TO_FILE
-        fout
-#else
-        std::cout
-#endif
-            << "\t" << entry->ThreadId << "\t" << entry->Message << "\t{" << Queue.Count() << "}" << std::endl;;
-        fout.flush();
+        u64 value = record.Args[index];
+        switch (record.Types[index++])
+        {
+        case ArgType::SIGNED:
+            snprintf(buffer, sizeof(buffer), "%lld", static_cast<long long>(static_cast<i64>(value)));
+            ret += buffer;
+            break;
+        case ArgType::UNSIGNED:
+            snprintf(buffer, sizeof(buffer), "%llu", static_cast<unsigned long long>(value));
+            ret += buffer;
+            break;
+        case ArgType::DOUBLE:
+        {
+            double number;
+            std::memcpy(&number, &value, sizeof(number));
+            snprintf(buffer, sizeof(buffer), "%.3f", number);
+            ret += buffer;
+            break;
+        }
+        case ArgType::POINTER:
+            snprintf(buffer, sizeof(buffer), "%p", reinterpret_cast<void *>(value));
+            ret += buffer;
+            break;
+        case ArgType::STRING:
+            ret += value ? reinterpret_cast<const char *>(value) : "(null)";
+            break;
+        }
+        ++ch;
+    }
+
+    return ret;
+}
 
-        delete entry;
+static void WriteTime(std::ostream &out, Logger::Clock::duration time)
+{
+    auto us = std::chrono::duration_cast<std::chrono::microseconds>(time).count();
+
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "%02lld:%02lld:%02lld.%03lld.%03lld",
+        static_cast<long long>(us / 1000 / 1000 / 60 / 60),
+        static_cast<long long>(us / 1000 / 1000 / 60 % 60),
+        static_cast<long long>(us / 1000 / 1000 % 60),
+        static_cast<long long>(us / 1000 % 1000),
+        static_cast<long long>(us % 1000));
+    out << buffer;
+}
+
+bool Logger::Drain(std::ostream &out)
+{
+    std::vector<Ring *> rings;
+    {
+        std::lock_guard<std::mutex> lock(RingsMutex);
+        for (auto &ring : Rings)
+        {
+            rings.push_back(ring.get());
+        }
+    }
+
+    // records stay in place until Tail passes them. A ring retired before
+    // its head is read gets nothing after it
+    std::vector<std::pair<const Record *, const Ring *>> pending;
+    std::vector<size_t> heads;
+    std::vector<Ring *> retired;
+    for (auto ring : rings)
+    {
+        if (ring->Retired.load(std::memory_order_acquire))
+        {
+            retired.push_back(ring);
+        }
+
+        size_t head = ring->Head.load(std::memory_order_acquire);
+        for (size_t i = ring->Tail.load(std::memory_order_relaxed); i < head; ++i)
+        {
+            pending.emplace_back(&ring->Records[i % RING_SIZE], ring);
+        }
+        heads.push_back(head);
+    }
+
+    std::stable_sort(pending.begin(), pending.end(), [](auto &a, auto &b)
+    {
+        return a.first->Time < b.first->Time;
+    });
+
+    for (auto &entry : pending)
+    {
+        WriteTime(out, entry.first->Time - StartTime);
+        out << "\t" << entry.second->ThreadId
+            << "\t" << "DIW"[static_cast<size_t>(entry.first->Severity)]
+            << "\t" << Format(*entry.first) << "\n";
     }
 
-    Entry *entry;
-    while (Queue.TryDequeue(entry))
+    for (size_t i = 0; i < rings.size(); ++i)
     {
-        writeTime(entry->TimePoint);
+        rings[i]->Tail.store(heads[i], std::memory_order_release);
+
+        auto dropped = rings[i]->Dropped.exchange(0, std::memory_order_relaxed);
+        if (dropped)
+        {
+            WriteTime(out, Clock::now() - StartTime);
+            out << "\t" << rings[i]->ThreadId << "\tW\tdropped " << dropped << " events\n";
+        }
+    }
+
+    if (!retired.empty())
+    {
+        std::lock_guard<std::mutex> lock(RingsMutex);
+        Rings.erase(std::remove_if(Rings.begin(), Rings.end(), [&](auto &ring)
+        {
+            return std::find(retired.begin(), retired.end(), ring.get()) != retired.end();
+        }), Rings.end());
+    }
+
+    out.flush();
+    return !pending.empty();
+}
+
+void Logger::Write()
+{
+#ifdef HYDRA_ENABLE_LOG
 #ifdef HYDRA_LOG_TO_FILE
-        fout
+    std::ofstream file;
+    if (!Out)
+    {
+        file.open("./log.txt");
+    }
+    std::ostream &out = Out ? *Out : file;
 #else
-        std::cout
+    std::ostream &out = Out ? *Out : std::cout;
 #endif
-            << "\t" << entry->ThreadId << "\t" << entry->Message << std::endl;;
-        delete entry;
+
+    while (!ShouldExit.load())
+    {
+        if (!Drain(out))
+        {
+            std::this_thread::sleep_for(LOG_FLUSH_INTERVAL);
+        }
     }
 
+    Drain(out);
+
     std::cout << "Logger shutdown" << std::endl;
 #endif
 }
 
-} // namespace hydra
\ No newline at end of file
+} // namespace hydra
@@ -2,68 +2,82 @@
 #define _LOGGER_H_
 
 #include "Singleton.h"
-#include "ConcurrentQueue.h"
+#include "Tracer.h"
 #include "Common/HydraCore.h"
 
 #include <thread>
 #include <atomic>
 #include <string>
-#include <sstream>
-#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <vector>
 #include <chrono>
-#include <iomanip>
+#include <type_traits>
+
+#if defined(HYDRA_ENABLE_LOG) && HYDRA_LOG_LEVEL <= 0
+#define hydra_log_debug(...)    ::hydra::Logger::GetInstance()->Event(::hydra::Logger::Level::DEBUG, __VA_ARGS__)
+#else
+#define hydra_log_debug(...)    ((void)0)
+#endif
+
+#if defined(HYDRA_ENABLE_LOG) && HYDRA_LOG_LEVEL <= 1
+#define hydra_log_info(...)     ::hydra::Logger::GetInstance()->Event(::hydra::Logger::Level::INFO, __VA_ARGS__)
+#else
+#define hydra_log_info(...)     ((void)0)
+#endif
+
+#if defined(HYDRA_ENABLE_LOG) && HYDRA_LOG_LEVEL <= 2
+#define hydra_log_warn(...)     ::hydra::Logger::GetInstance()->Event(::hydra::Logger::Level::WARN, __VA_ARGS__)
+#else
+#define hydra_log_warn(...)     ((void)0)
+#endif
 
 namespace hydra
 {
 
+// events are fixed size binary records: a format literal, whose address is
+// its id, and up to MAX_ARGS raw arguments. Each thread appends to its own
+// ring without lock or allocation and drops events when the ring is full;
+// the write thread drains the rings, orders events by time and formats
+// them there. The ring of an exited thread is freed once drained. Use the
+// hydra_log_* macros, levels below HYDRA_LOG_LEVEL compile to nothing
 class Logger : public Singleton<Logger>
 {
 public:
-#ifdef HYDRA_ENABLE_LOG
-    class LoggerProxy : public std::stringstream
-#else
-    class LoggerProxy
-#endif
-    {
-    public:
-        ~LoggerProxy()
-        {
-#ifdef HYDRA_ENABLE_LOG
-            if (Owner)
-            {
-                Owner->InsertEntry(TimePoint, str(), std::this_thread::get_id());
-            }
-#endif
-        }
-
-#ifndef HYDRA_ENABLE_LOG
-        template <typename T>
-        LoggerProxy &operator << (const T &)
-        {
-            return *this;
-        }
-#endif
+    using Clock = std::chrono::high_resolution_clock;
 
-    private:
-        explicit LoggerProxy(Logger *owner)
-            : Owner(owner), TimePoint(std::chrono::high_resolution_clock::now())
-        { }
+    enum class Level : u8
+    {
+        DEBUG,
+        INFO,
+        WARN
+    };
 
-        LoggerProxy(const LoggerProxy &) = delete;
-        LoggerProxy(LoggerProxy &&other)
-            : Owner(other.Owner), TimePoint(other.TimePoint)
-        {
-            other.Owner = nullptr;
-        }
-        LoggerProxy & operator =(const LoggerProxy &) = delete;
-        LoggerProxy & operator =(LoggerProxy &&) = default;
+    static constexpr size_t MAX_ARGS = 6;
+    static constexpr size_t RING_SIZE = 2048;
 
-        Logger *Owner;
-        std::chrono::time_point<std::chrono::high_resolution_clock> TimePoint;
+    enum class ArgType : u8
+    {
+        SIGNED,
+        UNSIGNED,
+        DOUBLE,
+        POINTER,
+        STRING
+    };
 
-        friend class Logger;
+    struct Record
+    {
+        Clock::time_point Time;
+        const char *Format;
+        Level Severity;
+        u8 Count;
+        ArgType Types[MAX_ARGS];
+        u64 Args[MAX_ARGS];
     };
 
+    // also shows up in the trace as a span, with a slice per phase
     class PerfSession
     {
     public:
@@ -77,78 +91,163 @@ public:
         {
             if (Logger)
             {
-                WriteLogAndUpdateLast("END", std::chrono::high_resolution_clock::now());
+                WriteLogAndUpdateLast("END", Clock::now());
+                if (Tracer::IsEnabled())
+                {
+                    Tracer::GetInstance()->End("perf", Name);
+                }
             }
         }
 
-        inline void Phase(std::string phaseName)
+        inline void Phase(const char *phaseName)
         {
             hydra_assert(Logger,
                 "Valid PerfSession should refer to a valid Logger");
 
-            WriteLogAndUpdateLast(phaseName, std::chrono::high_resolution_clock::now());
+            auto now = Clock::now();
+            if (Tracer::IsEnabled())
+            {
+                Tracer::GetInstance()->Complete("perf", phaseName, Last, now);
+            }
+
+            WriteLogAndUpdateLast(phaseName, now);
         }
 
     private:
-        PerfSession(Logger *logger, std::string name)
-            : Logger(logger), Name(name), Start(std::chrono::high_resolution_clock::now()), Last(Start)
+        PerfSession(Logger *logger, const char *name)
+            : Logger(logger), Name(name), Start(Clock::now()), Last(Start)
         {
+            if (Tracer::IsEnabled())
+            {
+                Tracer::GetInstance()->Begin("perf", Name);
+            }
+
             WriteLogAndUpdateLast("START", Start);
         }
 
-        inline void WriteLogAndUpdateLast(std::string phaseName, std::chrono::time_point<std::chrono::high_resolution_clock> now)
+        inline void WriteLogAndUpdateLast(const char *phaseName, Clock::time_point now)
         {
-            double fromStart = std::chrono::duration_cast<std::chrono::microseconds>(now - Start).count() / 1000.0f;
-            double fromLast = std::chrono::duration_cast<std::chrono::microseconds>(now - Last).count() / 1000.0f;
-            Logger->Log() << "Perf " << std::fixed << std::setprecision(3) << fromStart <<
-                "(+" << fromLast << ") " << Name << "::" << phaseName;
+            hydra_log_debug("Perf {}(+{}) {}::{}",
+                std::chrono::duration<double, std::milli>(now - Start).count(),
+                std::chrono::duration<double, std::milli>(now - Last).count(),
+                Name, phaseName);
 
             Last = now;
         }
 
         Logger *Logger;
-        std::string Name;
-        std::chrono::time_point<std::chrono::high_resolution_clock> Start;
-        std::chrono::time_point<std::chrono::high_resolution_clock> Last;
+        const char *Name;
+        Clock::time_point Start;
+        Clock::time_point Last;
 
         friend class Logger;
     };
 
     Logger();
+
+    // writes to out instead of the log file; a thread logs to one Logger only
+    explicit Logger(std::ostream &out);
+
     ~Logger();
 
-    inline LoggerProxy Log()
+    // string arguments are kept as pointers, they must be literals too
+    template <size_t N, typename ...T_Args>
+    inline void Event(Level severity, const char (&format)[N], T_Args ...args)
     {
-        return LoggerProxy(this);
+        static_assert(sizeof...(T_Args) <= MAX_ARGS, "too many log arguments");
+
+        auto ring = LocalRing ? LocalRing : NewRing();
+
+        size_t head = ring->Head.load(std::memory_order_relaxed);
+        if (head - ring->Tail.load(std::memory_order_acquire) >= RING_SIZE)
+        {
+            ring->Dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        auto &record = ring->Records[head % RING_SIZE];
+        record.Time = Clock::now();
+        record.Format = format;
+        record.Severity = severity;
+        record.Count = static_cast<u8>(sizeof...(T_Args));
+        Pack(record, 0, args...);
+
+        ring->Head.store(head + 1, std::memory_order_release);
     }
 
-    inline PerfSession Perf(std::string name)
+    // name must be a string literal
+    inline PerfSession Perf(const char *name)
     {
         return PerfSession(this, name);
     }
 
+    // replaces each {} in the format with the next argument
+    static std::string Format(const Record &record);
+
     void Shutdown();
 
 private:
-    struct Entry
+    struct Ring
     {
-        std::chrono::time_point<std::chrono::high_resolution_clock> TimePoint;
-        std::string Message;
+        std::atomic<size_t> Head { 0 };
+        std::atomic<size_t> Tail { 0 };
+        std::atomic<size_t> Dropped { 0 };
+        std::atomic<bool> Retired { false };
         std::thread::id ThreadId;
+        Record Records[RING_SIZE];
     };
 
-    inline void InsertEntry(
-        std::chrono::time_point<std::chrono::high_resolution_clock>timePoint,
-        std::string message,
-        std::thread::id threadId)
+    inline static void Pack(Record &, size_t)
+    { }
+
+    template <typename T, typename ...T_Args>
+    inline static void Pack(Record &record, size_t index, T value, T_Args ...args)
     {
-        Queue.Enqueue(new Entry{ timePoint, message, threadId });
+        static_assert(std::is_arithmetic<T>::value || std::is_pointer<T>::value,
+            "log arguments must be numbers or pointers");
+
+        if constexpr (std::is_same<T, const char *>::value || std::is_same<T, char *>::value)
+        {
+            record.Types[index] = ArgType::STRING;
+            record.Args[index] = reinterpret_cast<u64>(value);
+        }
+        else if constexpr (std::is_pointer<T>::value)
+        {
+            record.Types[index] = ArgType::POINTER;
+            record.Args[index] = reinterpret_cast<u64>(value);
+        }
+        else if constexpr (std::is_floating_point<T>::value)
+        {
+            double converted = value;
+            record.Types[index] = ArgType::DOUBLE;
+            std::memcpy(&record.Args[index], &converted, sizeof(converted));
+        }
+        else if constexpr (std::is_signed<T>::value)
+        {
+            record.Types[index] = ArgType::SIGNED;
+            record.Args[index] = static_cast<u64>(static_cast<i64>(value));
+        }
+        else
+        {
+            record.Types[index] = ArgType::UNSIGNED;
+            record.Args[index] = static_cast<u64>(value);
+        }
+
+        Pack(record, index + 1, args...);
     }
 
+    Ring *NewRing();
+
     std::atomic<bool> ShouldExit;
-    concurrent::Queue<Entry *, 8192> Queue;
+    Clock::time_point StartTime;
+    std::ostream *Out;
+    std::mutex RingsMutex;
+    std::vector<std::unique_ptr<Ring>> Rings;
     std::thread WriteThread;
     void Write();
+    bool Drain(std::ostream &out);
+
+    static thread_local Ring *LocalRing;
 };
 
 }
@@ -0,0 +1,219 @@
+#include "Metrics.h"
+#include "Platform.h"
+
+#include <cstdio>
+#include <fstream>
+
+namespace hydra
+{
+
+thread_local Metrics::Shard *Metrics::LocalShard = nullptr;
+
+u64 Metrics::Histogram::Percentile(double percentile) const
+{
+    if (Count == 0)
+    {
+        return 0;
+    }
+
+    u64 target = static_cast<u64>(Count * percentile);
+    u64 seen = 0;
+    for (size_t i = 0; i < HISTOGRAM_BUCKETS; ++i)
+    {
+        seen += Buckets[i];
+        if (seen > target)
+        {
+            return i == 0 ? 0 : (1ull << i) - 1;
+        }
+    }
+
+    return ~0ull;
+}
+
+static void WriteName(std::ostream &out, const std::string &name)
+{
+    out << '"';
+    for (char ch : name)
+    {
+        if (ch == '"' || ch == '\\')
+        {
+            out << '\\';
+        }
+        out << ch;
+    }
+    out << '"';
+}
+
+void Metrics::Report::WriteJson(std::ostream &out) const
+{
+    const char *separator = "";
+
+    out << "{" << std::endl << "  \"counters\": {";
+    for (auto &pair : Counters)
+    {
+        out << separator << std::endl << "    ";
+        WriteName(out, pair.first);
+        out << ": " << pair.second;
+        separator = ",";
+    }
+
+    separator = "";
+    out << std::endl << "  }," << std::endl << "  \"gauges\": {";
+    for (auto &pair : Gauges)
+    {
+        out << separator << std::endl << "    ";
+        WriteName(out, pair.first);
+        out << ": " << pair.second;
+        separator = ",";
+    }
+
+    separator = "";
+    out << std::endl << "  }," << std::endl << "  \"histograms\": {";
+    for (auto &pair : Histograms)
+    {
+        auto &histogram = pair.second;
+
+        out << separator << std::endl << "    ";
+        WriteName(out, pair.first);
+        out << ": { \"count\": " << histogram.Count
+            << ", \"sum\": " << histogram.Sum
+            << ", \"p50\": " << histogram.Percentile(0.5)
+            << ", \"p99\": " << histogram.Percentile(0.99)
+            << ", \"buckets\": [";
+
+        for (size_t i = 0; i < HISTOGRAM_BUCKETS; ++i)
+        {
+            out << (i ? ", " : "") << histogram.Buckets[i];
+        }
+        out << "] }";
+        separator = ",";
+    }
+
+    out << std::endl << "  }" << std::endl << "}" << std::endl;
+}
+
+Metrics::Metrics()
+    : Used(1)
+{ }
+
+Metrics::Id Metrics::Reserve(size_t count)
+{
+    hydra_assert(Used + count <= MAX_COUNTERS,
+        "too many counters, raise Metrics::MAX_COUNTERS");
+
+    Id first = static_cast<Id>(Used);
+    Used += count;
+    return first;
+}
+
+Metrics::Id Metrics::RegisterCounter(const std::string &name)
+{
+    std::lock_guard<std::mutex> lock(Mutex);
+
+    Id id = Reserve(1);
+    Entries.push_back(Entry { name, Kind::COUNTER, id });
+    return id;
+}
+
+Metrics::Id Metrics::RegisterCounters(const std::string &name, size_t count)
+{
+    std::lock_guard<std::mutex> lock(Mutex);
+
+    Id first = Reserve(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        char suffix[32];
+        snprintf(suffix, sizeof(suffix), ".%02zu", i);
+        Entries.push_back(Entry { name + suffix, Kind::COUNTER, static_cast<Id>(first + i) });
+    }
+    return first;
+}
+
+Metrics::Id Metrics::RegisterHistogram(const std::string &name)
+{
+    std::lock_guard<std::mutex> lock(Mutex);
+
+    Id id = Reserve(2 + HISTOGRAM_BUCKETS);
+    Entries.push_back(Entry { name, Kind::HISTOGRAM, id });
+    return id;
+}
+
+void Metrics::RegisterGauge(const std::string &name, std::function<u64()> read)
+{
+    std::lock_guard<std::mutex> lock(Mutex);
+    Gauges[name] = read;
+}
+
+size_t Metrics::BucketOf(u64 value)
+{
+    if (value == 0)
+    {
+        return 0;
+    }
+
+    return std::min<size_t>(platform::GetMSB(value) + 1, HISTOGRAM_BUCKETS - 1);
+}
+
+Metrics::Shard *Metrics::NewLocalShard()
+{
+    auto metrics = GetInstance();
+    std::lock_guard<std::mutex> lock(metrics->Mutex);
+
+    metrics->Shards.emplace_back(new Shard());
+    LocalShard = metrics->Shards.back().get();
+    return LocalShard;
+}
+
+Metrics::Report Metrics::Collect()
+{
+    Report report;
+    std::lock_guard<std::mutex> lock(Mutex);
+
+    std::vector<u64> totals(Used, 0);
+    for (auto &shard : Shards)
+    {
+        for (size_t i = 0; i < Used; ++i)
+        {
+            totals[i] += shard->Values[i].load(std::memory_order_relaxed);
+        }
+    }
+
+    for (auto &entry : Entries)
+    {
+        if (entry.Type == Kind::COUNTER)
+        {
+            report.Counters[entry.Name] = totals[entry.First];
+        }
+        else
+        {
+            auto &histogram = report.Histograms[entry.Name];
+            histogram.Count = totals[entry.First];
+            histogram.Sum = totals[entry.First + 1];
+            for (size_t i = 0; i < HISTOGRAM_BUCKETS; ++i)
+            {
+                histogram.Buckets[i] = totals[entry.First + 2 + i];
+            }
+        }
+    }
+
+    for (auto &pair : Gauges)
+    {
+        report.Gauges[pair.first] = pair.second();
+    }
+
+    return report;
+}
+
+bool Metrics::WriteJson(const std::string &path)
+{
+    std::ofstream out(path);
+    if (!out)
+    {
+        return false;
+    }
+
+    Collect().WriteJson(out);
+    return static_cast<bool>(out);
+}
+
+}
@@ -0,0 +1,138 @@
+#ifndef _METRICS_H_
+#define _METRICS_H_
+
+#include "Singleton.h"
+#include "Common/HydraCore.h"
+
+#include <array>
+#include <atomic>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace hydra
+{
+
+// counters live in per thread shards that only their own thread writes, so
+// bumping one is a plain add without lock or contention; Collect sums the
+// shards. A histogram is a run of counters: count, sum and power of two
+// buckets. Gauges are read through a callback when collected.
+// Ids may be registered during static initialization, id 0 takes whatever
+// is counted before its real id is assigned
+class Metrics : public Singleton<Metrics>
+{
+public:
+    using Id = u32;
+
+    static constexpr size_t MAX_COUNTERS = 1024;
+    static constexpr size_t HISTOGRAM_BUCKETS = 32;
+
+    struct Shard
+    {
+        std::atomic<u64> Values[MAX_COUNTERS];
+
+        Shard()
+        {
+            for (auto &value : Values)
+            {
+                value.store(0, std::memory_order_relaxed);
+            }
+        }
+    };
+
+    struct Histogram
+    {
+        u64 Count = 0;
+        u64 Sum = 0;
+
+        // bucket 0 holds 0, bucket i holds [2^(i-1), 2^i)
+        std::array<u64, HISTOGRAM_BUCKETS> Buckets {};
+
+        // upper bound of the bucket the percentile falls into
+        u64 Percentile(double percentile) const;
+    };
+
+    struct Report
+    {
+        std::map<std::string, u64> Counters;
+        std::map<std::string, u64> Gauges;
+        std::map<std::string, Histogram> Histograms;
+
+        void WriteJson(std::ostream &out) const;
+    };
+
+    Metrics();
+
+    Id RegisterCounter(const std::string &name);
+
+    // count consecutive counters named name.00, name.01 ...
+    Id RegisterCounters(const std::string &name, size_t count);
+
+    Id RegisterHistogram(const std::string &name);
+    void RegisterGauge(const std::string &name, std::function<u64()> read);
+
+    inline static void Add(Id id, u64 value = 1)
+    {
+        Add(GetLocalShard(), id, value);
+    }
+
+    inline static void Add(Shard *shard, Id id, u64 value = 1)
+    {
+        auto &slot = shard->Values[id];
+        slot.store(slot.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    }
+
+    inline static void Record(Id histogram, u64 value)
+    {
+        auto shard = GetLocalShard();
+        Add(shard, histogram, 1);
+        Add(shard, histogram + 1, value);
+        Add(shard, histogram + 2 + BucketOf(value), 1);
+    }
+
+    // the calling thread's shard, generated code bumps counters in it directly
+    inline static Shard *GetLocalShard()
+    {
+        return LocalShard ? LocalShard : NewLocalShard();
+    }
+
+    Report Collect();
+
+    // false if the file can not be written
+    bool WriteJson(const std::string &path);
+
+private:
+    enum class Kind
+    {
+        COUNTER,
+        HISTOGRAM
+    };
+
+    struct Entry
+    {
+        std::string Name;
+        Kind Type;
+        Id First;
+    };
+
+    static size_t BucketOf(u64 value);
+    static Shard *NewLocalShard();
+
+    Id Reserve(size_t count);
+
+    std::mutex Mutex;
+    size_t Used;
+    std::vector<Entry> Entries;
+    std::map<std::string, std::function<u64()>> Gauges;
+    std::vector<std::unique_ptr<Shard>> Shards;
+
+    static thread_local Shard *LocalShard;
+};
+
+}
+
+#endif // _METRICS_H_
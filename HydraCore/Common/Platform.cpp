@@ -1,5 +1,17 @@
 #include "Platform.h"
 
+#ifndef _MSC_VER
+
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+
+#endif
+
 namespace hydra
 {
 namespace platform
@@ -62,11 +74,173 @@ MappedFile::~MappedFile()
     CloseHandle(File);
 }
 
+bool MapDual(size_t size, bool largePages, DualMapping &out)
+{
+    DWORD protect = PAGE_EXECUTE_READWRITE;
+    if (largePages)
+    {
+        protect |= SEC_COMMIT | SEC_LARGE_PAGES;
+    }
+
+    HANDLE mapping = CreateFileMappingA(
+        INVALID_HANDLE_VALUE,
+        NULL,
+        protect,
+        static_cast<DWORD>(static_cast<u64>(size) >> 32),
+        static_cast<DWORD>(size),
+        NULL
+    );
+
+    // large pages need SeLockMemoryPrivilege, fall back to normal ones
+    if (mapping == NULL && largePages)
+    {
+        return MapDual(size, false, out);
+    }
+
+    if (mapping == NULL)
+    {
+        return false;
+    }
+
+    out.Writable = MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, size);
+    out.Executable = MapViewOfFile(mapping, FILE_MAP_READ | FILE_MAP_EXECUTE, 0, 0, size);
+    out.Size = size;
+
+    // the views keep the section alive
+    CloseHandle(mapping);
+
+    if (out.Writable == NULL || out.Executable == NULL)
+    {
+        UnmapDual(out);
+        return false;
+    }
+
+    return true;
+}
+
+void UnmapDual(DualMapping &mapping)
+{
+    if (mapping.Writable)
+    {
+        UnmapViewOfFile(mapping.Writable);
+    }
+    if (mapping.Executable)
+    {
+        UnmapViewOfFile(mapping.Executable);
+    }
+    mapping.Writable = mapping.Executable = nullptr;
+}
+
 void Break()
 {
     DebugBreak();
 }
 
+#else
+
+MappedFile::MappedFile(const std::string &filename)
+{
+    File = open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+    if (File < 0)
+    {
+        hydra_trap("Open file failed: " + std::to_string(errno));
+    }
+
+    struct stat info;
+    if (fstat(File, &info) != 0)
+    {
+        hydra_trap("Stat file failed: " + std::to_string(errno));
+    }
+    Size = static_cast<size_t>(info.st_size);
+
+    // like CreateFileMapping, an empty file can not be mapped
+    if (Size == 0)
+    {
+        hydra_trap("Mapping file failed: empty file");
+    }
+
+    View = mmap(nullptr, Size, PROT_READ, MAP_PRIVATE, File, 0);
+    if (View == MAP_FAILED)
+    {
+        hydra_trap("Mapping file failed: " + std::to_string(errno));
+    }
+}
+
+MappedFile::~MappedFile()
+{
+    munmap(View, Size);
+    close(File);
+}
+
+bool MapDual(size_t size, bool largePages, DualMapping &out)
+{
+    unsigned int flags = MFD_CLOEXEC;
+    if (largePages)
+    {
+        flags |= MFD_HUGETLB;
+    }
+
+    int fd = memfd_create("hydra-code", flags);
+
+    // no huge pages reserved, fall back to normal ones
+    if (fd < 0 && largePages)
+    {
+        return MapDual(size, false, out);
+    }
+
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    if (ftruncate(fd, static_cast<off_t>(size)) != 0)
+    {
+        close(fd);
+        return false;
+    }
+
+    out.Writable = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    out.Executable = mmap(nullptr, size, PROT_READ | PROT_EXEC, MAP_SHARED, fd, 0);
+    out.Size = size;
+
+    // the mappings keep the file alive
+    close(fd);
+
+    if (out.Writable == MAP_FAILED || out.Executable == MAP_FAILED)
+    {
+        if (out.Writable == MAP_FAILED)
+        {
+            out.Writable = nullptr;
+        }
+        if (out.Executable == MAP_FAILED)
+        {
+            out.Executable = nullptr;
+        }
+        UnmapDual(out);
+        return false;
+    }
+
+    return true;
+}
+
+void UnmapDual(DualMapping &mapping)
+{
+    if (mapping.Writable)
+    {
+        munmap(mapping.Writable, mapping.Size);
+    }
+    if (mapping.Executable)
+    {
+        munmap(mapping.Executable, mapping.Size);
+    }
+    mapping.Writable = mapping.Executable = nullptr;
+}
+
+void Break()
+{
+    raise(SIGTRAP);
+}
+
 #endif
 
 } // namespace platform
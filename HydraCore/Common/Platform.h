@@ -10,12 +10,20 @@
 #ifdef _MSC_VER
 
 #include <intrin.h>
+#include <malloc.h>
 #include <windows.h>
 #include "Shlwapi.h"
 
+#define hydra_alloca(size)  _alloca(size)
+
 #else
 
 #include <stdlib.h>
+#include <alloca.h>
+#include <malloc.h>
+#include <unistd.h>
+
+#define hydra_alloca(size)  alloca(size)
 
 #endif
 
@@ -26,8 +34,10 @@ namespace platform
 
 inline void *AlignedAlloc(size_t size, size_t alignment);
 inline void AlignedFree(void *ptr);
+inline size_t AllocationSize(void *ptr);
 inline size_t GetMSB(uint64_t);
 inline size_t GetLSB(uint64_t);
+inline u32 CurrentProcessId();
 inline u64 powi(u64 base, u64 exp)
 {
     u64 res = 1;
@@ -58,6 +68,19 @@ inline std::string GetDirectoryOfPath(std::string fullPath);
 
 class MappedFile;
 
+// one piece of memory seen through a writable and an executable view, so no
+// address is ever writable and executable at once
+struct DualMapping
+{
+    void *Writable;
+    void *Executable;
+    size_t Size;
+};
+
+// size must be a multiple of the page size, of the large page size if asked for
+bool MapDual(size_t size, bool largePages, DualMapping &out);
+void UnmapDual(DualMapping &mapping);
+
 void Break();
 
 #ifdef _MSC_VER
@@ -72,6 +95,11 @@ inline void AlignedFree(void *ptr)
     _aligned_free(ptr);
 }
 
+inline size_t AllocationSize(void *ptr)
+{
+    return _msize(ptr);
+}
+
 inline size_t GetMSB(uint64_t value)
 {
     unsigned long ret;
@@ -94,6 +122,11 @@ inline size_t GetLSB(uint64_t value)
     return static_cast<size_t>(-1);
 }
 
+inline u32 CurrentProcessId()
+{
+    return static_cast<u32>(GetCurrentProcessId());
+}
+
 template <typename T_callback>
 void ForeachWordOnStack(T_callback callback)
 {
@@ -226,10 +259,15 @@ inline void AlignedFree(void *ptr)
     free(ptr);
 }
 
+inline size_t AllocationSize(void *ptr)
+{
+    return malloc_usable_size(ptr);
+}
+
 inline size_t GetMSB(uint64_t value)
 {
     if (value) {
-        return 63 - __builtin_clz(value);
+        return 63 - __builtin_clzll(value);
     }
     return static_cast<size_t>(-1);
 }
@@ -237,11 +275,38 @@ inline size_t GetMSB(uint64_t value)
 inline size_t GetLSB(uint64_t value)
 {
     if (value) {
-        return  __builtin_ctz(value);
+        return  __builtin_ctzll(value);
     }
     return static_cast<size_t>(-1);
 }
 
+inline u32 CurrentProcessId()
+{
+    return static_cast<u32>(getpid());
+}
+
+class MappedFile
+{
+public:
+    MappedFile(const std::string &filename);
+    MappedFile(const MappedFile &) = delete;
+    MappedFile(MappedFile &&) = delete;
+    MappedFile &operator = (const MappedFile &) = delete;
+    MappedFile &operator = (MappedFile &&) = delete;
+
+    ~MappedFile();
+
+    operator void *()
+    {
+        return View;
+    }
+
+private:
+    int File;
+    size_t Size;
+    void *View;
+};
+
 template <typename T_callback>
 void ForeachWordOnStack(T_callback callback)
 {
@@ -1,6 +1,8 @@
 #include "ThreadPool.h"
 
 #include "AutoCounter.h"
+#include "Metrics.h"
+#include "Tracer.h"
 
 namespace hydra
 {
@@ -12,6 +14,16 @@ ThreadPool::ThreadPool(size_t threadCount)
     {
         return std::thread(&ThreadPool::ThreadPoolWorker, this);
     });
+
+    auto metrics = Metrics::GetInstance();
+    metrics->RegisterGauge("threadpool.queue_depth", [this]() -> u64
+    {
+        return TaskQueue.Count();
+    });
+    metrics->RegisterGauge("threadpool.active_threads", [this]() -> u64
+    {
+        return ActiveThreadCount.load();
+    });
 }
 
 ThreadPool::~ThreadPool()
@@ -32,6 +44,7 @@ ThreadPool::~ThreadPool()
 void ThreadPool::ThreadPoolWorker()
 {
     AutoCounter<size_t> autoLivingThreadCounter(LivingThreadCount);
+    Tracer::SetThreadName("ThreadPool");
 
     while (true)
     {
@@ -0,0 +1,224 @@
+#include "Tracer.h"
+
+#include <cstdio>
+#include <fstream>
+
+namespace hydra
+{
+
+std::atomic<bool> Tracer::Enabled { false };
+thread_local Tracer::ThreadBuffer *Tracer::LocalBuffer = nullptr;
+thread_local const char *Tracer::LocalName = nullptr;
+
+Tracer::Tracer()
+{ }
+
+Tracer::~Tracer()
+{
+    Stop();
+}
+
+bool Tracer::Start(const std::string &path)
+{
+    std::lock_guard<std::mutex> lock(BuffersMutex);
+    if (!Path.empty())
+    {
+        return false;
+    }
+
+    Path = path;
+    StartTime = Clock::now();
+    Enabled.store(true);
+    return true;
+}
+
+void Tracer::Stop()
+{
+    if (Enabled.exchange(false))
+    {
+        Write();
+    }
+}
+
+void Tracer::Begin(const char *category, const char *name, std::string detail)
+{
+    auto now = Clock::now();
+    Record('B', category, name, now, now, std::move(detail));
+}
+
+void Tracer::End(const char *category, const char *name)
+{
+    auto now = Clock::now();
+    Record('E', category, name, now, now, std::string());
+}
+
+void Tracer::Complete(const char *category, const char *name, Clock::time_point start, Clock::time_point end)
+{
+    Record('X', category, name, start, end, std::string());
+}
+
+void Tracer::SetThreadName(const char *name)
+{
+    LocalName = name;
+    if (LocalBuffer)
+    {
+        LocalBuffer->Name.store(name);
+    }
+}
+
+void Tracer::Record(char phase, const char *category, const char *name,
+    Clock::time_point start, Clock::time_point end, std::string detail)
+{
+    if (!IsEnabled())
+    {
+        return;
+    }
+
+    auto buffer = GetThreadBuffer();
+    size_t count = buffer->Count.load(std::memory_order_relaxed);
+
+    if (count > 0 && count % CHUNK_SIZE == 0)
+    {
+        if (buffer->Chunks == MAX_CHUNKS)
+        {
+            buffer->Dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        // once Stop began writing no chunk is linked, an event recorded
+        // into the current chunk meanwhile lies past the count Write read
+        std::lock_guard<std::mutex> lock(BuffersMutex);
+        if (!IsEnabled())
+        {
+            return;
+        }
+
+        auto chunk = new Chunk();
+        buffer->Tail->Next.store(chunk, std::memory_order_release);
+        buffer->Tail = chunk;
+        ++buffer->Chunks;
+    }
+
+    auto &event = buffer->Tail->Events[count % CHUNK_SIZE];
+    event.Category = category;
+    event.Name = name;
+    event.Phase = phase;
+    event.Start = start;
+    event.End = end;
+    event.Detail = std::move(detail);
+
+    buffer->Count.store(count + 1, std::memory_order_release);
+}
+
+Tracer::ThreadBuffer *Tracer::GetThreadBuffer()
+{
+    if (!LocalBuffer)
+    {
+        std::lock_guard<std::mutex> lock(BuffersMutex);
+        Buffers.emplace_back(new ThreadBuffer());
+        LocalBuffer = Buffers.back().get();
+        LocalBuffer->ThreadId = Buffers.size();
+        LocalBuffer->Name.store(LocalName);
+    }
+
+    return LocalBuffer;
+}
+
+static void WriteEscaped(std::ostream &out, const char *str)
+{
+    out << '"';
+    for (; *str; ++str)
+    {
+        char ch = *str;
+        if (ch == '"' || ch == '\\')
+        {
+            out << '\\' << ch;
+        }
+        else if (static_cast<unsigned char>(ch) < 0x20)
+        {
+            char buffer[8];
+            snprintf(buffer, sizeof(buffer), "\\u%04x", ch);
+            out << buffer;
+        }
+        else
+        {
+            out << ch;
+        }
+    }
+    out << '"';
+}
+
+void Tracer::Write()
+{
+    std::ofstream out(Path);
+    if (!out)
+    {
+        return;
+    }
+
+    auto microseconds = [this](Clock::time_point time)
+    {
+        return std::chrono::duration<double, std::micro>(time - StartTime).count();
+    };
+
+    std::lock_guard<std::mutex> lock(BuffersMutex);
+
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[" << std::endl;
+    out << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"hydra\"}}";
+
+    for (auto &buffer : Buffers)
+    {
+        auto threadName = buffer->Name.load();
+        if (threadName)
+        {
+            out << "," << std::endl << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":"
+                << buffer->ThreadId << ",\"args\":{\"name\":";
+            WriteEscaped(out, threadName);
+            out << "}}";
+        }
+
+        size_t count = buffer->Count.load(std::memory_order_acquire);
+        Chunk *chunk = &buffer->Head;
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            if (i > 0 && i % CHUNK_SIZE == 0)
+            {
+                chunk = chunk->Next.load(std::memory_order_acquire);
+            }
+
+            auto &event = chunk->Events[i % CHUNK_SIZE];
+
+            out << "," << std::endl << "{\"name\":";
+            WriteEscaped(out, event.Name);
+            out << ",\"cat\":";
+            WriteEscaped(out, event.Category);
+            out << ",\"ph\":\"" << event.Phase << "\",\"pid\":1,\"tid\":" << buffer->ThreadId
+                << ",\"ts\":" << std::fixed << microseconds(event.Start);
+
+            if (event.Phase == 'X')
+            {
+                out << ",\"dur\":" << std::chrono::duration<double, std::micro>(event.End - event.Start).count();
+            }
+
+            if (!event.Detail.empty())
+            {
+                out << ",\"args\":{\"detail\":";
+                WriteEscaped(out, event.Detail.c_str());
+                out << "}";
+            }
+
+            out << "}";
+        }
+    }
+
+    size_t dropped = 0;
+    for (auto &buffer : Buffers)
+    {
+        dropped += buffer->Dropped.load(std::memory_order_relaxed);
+    }
+
+    out << std::endl << "],\"otherData\":{\"droppedEvents\":" << dropped << "}}" << std::endl;
+}
+
+}
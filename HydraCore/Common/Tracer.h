@@ -0,0 +1,138 @@
+#ifndef _TRACER_H_
+#define _TRACER_H_
+
+#include "Singleton.h"
+#include "Common/HydraCore.h"
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace hydra
+{
+
+// records begin/end events into per thread buffers and writes them as chrome
+// trace event json, for chrome://tracing or ui.perfetto.dev. Only the owning
+// thread appends to a buffer and publishes the count with a release store,
+// so recording takes no lock except to link a new chunk, under the lock Write
+// holds. Past MAX_THREAD_EVENTS a thread's events are dropped and counted.
+// Names and categories must be string literals
+class Tracer : public Singleton<Tracer>
+{
+public:
+    using Clock = std::chrono::high_resolution_clock;
+
+    static constexpr size_t CHUNK_SIZE = 1024;
+    static constexpr size_t MAX_CHUNKS = 128;
+    static constexpr size_t MAX_THREAD_EVENTS = CHUNK_SIZE * MAX_CHUNKS;
+
+    class Span
+    {
+    public:
+        Span(const char *category, const char *name, std::string detail = std::string())
+            : Category(category), Name(name), Active(Tracer::IsEnabled())
+        {
+            if (Active)
+            {
+                Tracer::GetInstance()->Begin(Category, Name, std::move(detail));
+            }
+        }
+
+        ~Span()
+        {
+            if (Active)
+            {
+                Tracer::GetInstance()->End(Category, Name);
+            }
+        }
+
+        Span(const Span &) = delete;
+        Span &operator = (const Span &) = delete;
+
+    private:
+        const char *Category;
+        const char *Name;
+        bool Active;
+    };
+
+    Tracer();
+    ~Tracer();
+
+    // tracing runs at most once per process, false if it was started before
+    bool Start(const std::string &path);
+
+    // stops recording and writes the file
+    void Stop();
+
+    inline static bool IsEnabled()
+    {
+        return Enabled.load(std::memory_order_relaxed);
+    }
+
+    void Begin(const char *category, const char *name, std::string detail = std::string());
+    void End(const char *category, const char *name);
+    void Complete(const char *category, const char *name, Clock::time_point start, Clock::time_point end);
+
+    // shown instead of the thread number, may be called before tracing starts
+    static void SetThreadName(const char *name);
+
+private:
+    struct Event
+    {
+        const char *Category;
+        const char *Name;
+        char Phase;
+        Clock::time_point Start;
+        Clock::time_point End;
+        std::string Detail;
+    };
+
+    struct Chunk
+    {
+        Event Events[CHUNK_SIZE];
+        std::atomic<Chunk *> Next { nullptr };
+    };
+
+    struct ThreadBuffer
+    {
+        size_t ThreadId;
+        std::atomic<const char *> Name { nullptr };
+        Chunk Head;
+        Chunk *Tail = &Head;
+        size_t Chunks = 1;
+        std::atomic<size_t> Count { 0 };
+        std::atomic<size_t> Dropped { 0 };
+
+        ~ThreadBuffer()
+        {
+            Chunk *chunk = Head.Next.load();
+            while (chunk)
+            {
+                Chunk *next = chunk->Next.load();
+                delete chunk;
+                chunk = next;
+            }
+        }
+    };
+
+    void Record(char phase, const char *category, const char *name,
+        Clock::time_point start, Clock::time_point end, std::string detail);
+    ThreadBuffer *GetThreadBuffer();
+    void Write();
+
+    static std::atomic<bool> Enabled;
+    static thread_local ThreadBuffer *LocalBuffer;
+    static thread_local const char *LocalName;
+
+    std::string Path;
+    Clock::time_point StartTime;
+    std::mutex BuffersMutex;
+    std::vector<std::unique_ptr<ThreadBuffer>> Buffers;
+};
+
+}
+
+#endif // _TRACER_H_
@@ -2,8 +2,14 @@
 #define _CORE_H_
 
 #include "Common/HydraCore.h"
+#include "Common/Metrics.h"
+#include "Common/Tracer.h"
 #include "GarbageCollection/GC.h"
 #include "Runtime/Semantic.h"
+#include "VirtualMachine/AllocationProfiler.h"
+#include "VirtualMachine/CodeCache.h"
+#include "VirtualMachine/HeapSnapshot.h"
+#include "VirtualMachine/Profiler.h"
 #include "VirtualMachine/VM.h"
 
 #endif // _CORE_H_
\ No newline at end of file
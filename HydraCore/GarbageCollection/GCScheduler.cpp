@@ -140,9 +140,8 @@ bool GCScheduler::ShouldFullGC()
     if (ret)
     {
     */
-        Logger::GetInstance()->Log() << "Predict full gc: "
-            << "[NextFullGCTime: " << (SecondsForFullGC * 1000) << "ms] "
-            << "[AllocateToIncrement: " << (SecondsForAllocationByIncrement * 1000) << "ms]";
+        hydra_log_debug("Predict full gc: [NextFullGCTime: {}ms] [AllocateToIncrement: {}ms]",
+            SecondsForFullGC * 1000, SecondsForAllocationByIncrement * 1000);
     //}
 
     return ret;
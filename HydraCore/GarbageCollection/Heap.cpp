@@ -1,6 +1,7 @@
 #include "Heap.h"
 
 #include "Common/Logger.h"
+#include "Common/Platform.h"
 #include "Common/ThreadPool.h"
 
 #include <queue>
@@ -39,7 +40,7 @@ Region *Heap::GetFreeRegion(size_t level)
 
 void Heap::CommitFullRegion(Region *&region)
 {
-    Logger::GetInstance()->Log() << "Commit Region " << region;
+    hydra_log_debug("Commit Region {}", region);
 
     auto level = region->Level;
 
@@ -92,7 +93,7 @@ void Heap::StopTheWorld()
 
         WaitingMutex.unlock();
         RunningMutex.lock();
-        Logger::GetInstance()->Log() << "Stop the world";
+        hydra_log_info("Stop the world");
 
         WorldStopped = std::chrono::high_resolution_clock::now();
 
@@ -111,8 +112,16 @@ void Heap::ResumeTheWorld()
         auto perfSession = Logger::GetInstance()->Perf("ResumingTheWorld");
 
         auto now = std::chrono::high_resolution_clock::now();
-        Logger::GetInstance()->Log() << "Resume the world " <<
-            std::chrono::duration_cast<std::chrono::microseconds>(now - WorldStopped).count() / 1000. << "ms";
+        Metrics::Record(PauseHistogram,
+            std::chrono::duration_cast<std::chrono::microseconds>(now - WorldStopped).count());
+
+        if (Tracer::IsEnabled())
+        {
+            Tracer::GetInstance()->Complete("gc", "WorldStopped", WorldStopped, now);
+        }
+
+        hydra_log_info("Resume the world {}ms",
+            std::chrono::duration<double, std::milli>(now - WorldStopped).count());
         RunningMutex.unlock();
         WakeupCV.notify_all();
 
@@ -123,20 +132,125 @@ void Heap::ResumeTheWorld()
     }
 }
 
+void Heap::RunWithWorldStopped(std::function<void()> func)
+{
+    std::unique_lock<std::mutex> lck(CollectionMutex);
+
+    StopTheWorld();
+    func();
+    ResumeTheWorld();
+}
+
 void Heap::Shutdown()
 {
-    Logger::GetInstance()->Log() << "Heap shutdown requested";
+    hydra_log_info("Heap shutdown requested");
 
     if (!ShouldExit.exchange(true))
     {
         GCManagementThread.join();
     }
 
-    Logger::GetInstance()->Log() << "Heap shutdown";
+    hydra_log_info("Heap shutdown");
+}
+
+void Heap::RegisterMetrics()
+{
+    auto metrics = Metrics::GetInstance();
+
+    PauseHistogram = metrics->RegisterHistogram("gc.pause_us");
+    YoungGCCount = metrics->RegisterCounter("gc.young_collections");
+    FullGCCount = metrics->RegisterCounter("gc.full_collections");
+
+    metrics->RegisterGauge("gc.regions.total", []() -> u64
+    {
+        return Region::GetTotalRegionCount();
+    });
+    metrics->RegisterGauge("gc.regions.free", [this]() -> u64
+    {
+        size_t count = 0;
+        for (auto &list : FreeLists)
+        {
+            count += list.GetCount();
+        }
+        return count;
+    });
+    metrics->RegisterGauge("gc.regions.remarking", [this]() -> u64
+    {
+        size_t count = 0;
+        for (auto &list : RemarkingLists)
+        {
+            count += list.GetCount();
+        }
+        return count;
+    });
+    metrics->RegisterGauge("gc.regions.full", [this]() -> u64
+    {
+        return FullList.GetCount();
+    });
+    metrics->RegisterGauge("gc.regions.cleaning", [this]() -> u64
+    {
+        return CleaningList.GetCount();
+    });
+    metrics->RegisterGauge("gc.regions.full_cleaning", [this]() -> u64
+    {
+        return FullCleaningList.GetCount();
+    });
+    metrics->RegisterGauge("gc.large_objects", [this]() -> u64
+    {
+        std::shared_lock<std::shared_mutex> lck(LargeSetMutex);
+        return LargeSet.size();
+    });
+    metrics->RegisterGauge("gc.working_queue", [this]() -> u64
+    {
+        return WorkingQueue.Count();
+    });
+}
+
+void Heap::ForeachObject(std::function<void(HeapObject *, size_t)> callback)
+{
+    Region::ForeachRegion([&](Region *region)
+    {
+        auto cellSize = Region::CellSizeFromLevel(region->Level);
+
+        // cells past the bump pointer are zeroed, so IsInUse is enough
+        for (auto cell : *region)
+        {
+            if (cell->IsInUse())
+            {
+                callback(static_cast<HeapObject *>(cell), cellSize);
+            }
+        }
+    });
+
+    std::shared_lock<std::shared_mutex> lck(LargeSetMutex);
+    for (auto obj : LargeSet)
+    {
+        callback(obj, platform::AllocationSize(obj));
+    }
+}
+
+void Heap::ScanRoots(std::function<void(HeapObject *)> scan)
+{
+    std::unique_lock<std::mutex> lck(RootScanFuncMutex);
+    for (auto &func : RootScanFunc)
+    {
+        func(scan);
+    }
+}
+
+void Heap::RunMarkedFunc(std::function<bool(HeapObject *)> survives)
+{
+    std::unique_lock<std::mutex> lck(MarkedFuncMutex);
+    for (auto &func : MarkedFunc)
+    {
+        func(survives);
+    }
 }
 
 void Heap::GCManagement()
 {
+    Tracer::SetThreadName("GCManagement");
+
     bool youngGCRequested = false;
     bool fullGCRequested = false;
 
@@ -161,16 +275,17 @@ void Heap::GCManagement()
 
         while (!ShouldExit.load() && (youngGCRequested || fullGCRequested))
         {
-            Logger::GetInstance()->Log() << "WorkingQueue: " << WorkingQueue.Count();
+            std::unique_lock<std::mutex> collectionLock(CollectionMutex);
+
+            hydra_log_debug("WorkingQueue: {}", WorkingQueue.Count());
 
             if (fullGCRequested)
             {
                 auto perfSession = Logger::GetInstance()->Perf("FullGC");
+                Metrics::Add(FullGCCount);
 
-                Logger::GetInstance()->Log() << "Before Full GC: "
-                    << "[Total: " << Region::GetTotalRegionCount() << "] "
-                    << "[YoungFull: " << GetFullListRegionCount() << "] "
-                    << "[OldFull: " << GetFullCleaningRegionCount() << "]";
+                hydra_log_info("Before Full GC: [Total: {}] [YoungFull: {}] [OldFull: {}]",
+                    Region::GetTotalRegionCount(), GetFullListRegionCount(), GetFullCleaningRegionCount());
 
                 Scheduler.OnFullGCStart();
 
@@ -208,6 +323,12 @@ void Heap::GCManagement()
                     "WorkingQueue should be empty now");
                 perfSession.Phase("FinishMark");
 
+                // the sweep frees white and dark cells
+                RunMarkedFunc([](HeapObject *obj)
+                {
+                    return obj->GetGCState() == GCState::GC_BLACK;
+                });
+
                 FullCleaningList.Steal(FullList);
                 for (size_t i = 0; i < LEVEL_NR; ++i)
                 {
@@ -254,19 +375,16 @@ void Heap::GCManagement()
 
                 Scheduler.OnFullGCEnd();
 
-                Logger::GetInstance()->Log() << "After Full GC: "
-                    << "[Total: " << Region::GetTotalRegionCount() << "] "
-                    << "[YoungFull: " << GetFullListRegionCount() << "] "
-                    << "[OldFull: " << GetFullCleaningRegionCount() << "]";
+                hydra_log_info("After Full GC: [Total: {}] [YoungFull: {}] [OldFull: {}]",
+                    Region::GetTotalRegionCount(), GetFullListRegionCount(), GetFullCleaningRegionCount());
             }
             else if (youngGCRequested)
             {
                 auto perfSession = Logger::GetInstance()->Perf("YoungGC");
+                Metrics::Add(YoungGCCount);
 
-                Logger::GetInstance()->Log() << "Before Young GC: "
-                    << "[Total: " << Region::GetTotalRegionCount() << "] "
-                    << "[YoungFull: " << GetFullListRegionCount() << "] "
-                    << "[OldFull: " << GetFullCleaningRegionCount() << "]";
+                hydra_log_info("Before Young GC: [Total: {}] [YoungFull: {}] [OldFull: {}]",
+                    Region::GetTotalRegionCount(), GetFullListRegionCount(), GetFullCleaningRegionCount());
 
                 Scheduler.OnYoungGCStart();
 
@@ -308,6 +426,11 @@ void Heap::GCManagement()
                     "WorkingQueue should be empty now");
                 perfSession.Phase("FinishMark");
 
+                RunMarkedFunc([](HeapObject *obj)
+                {
+                    return obj->GetGCState() != GCState::GC_WHITE;
+                });
+
                 CleaningList.Steal(FullList);
                 perfSession.Phase("BeforeResumeTheWorld");
 
@@ -336,10 +459,8 @@ void Heap::GCManagement()
 
                 Scheduler.OnYoungGCEnd();
 
-                Logger::GetInstance()->Log() << "After Young GC: "
-                    << "[Total: " << Region::GetTotalRegionCount() << "] "
-                    << "[YoungFull: " << GetFullListRegionCount() << "] "
-                    << "[OldFull: " << GetFullCleaningRegionCount() << "]";
+                hydra_log_info("After Young GC: [Total: {}] [YoungFull: {}] [OldFull: {}]",
+                    Region::GetTotalRegionCount(), GetFullListRegionCount(), GetFullCleaningRegionCount());
             }
 
             GCCurrentPhase.store(GCPhase::GC_IDLE);
@@ -358,7 +479,7 @@ void Heap::GCManagement()
 
     GCCurrentPhase.store(GCPhase::GC_EXIT);
 
-    Logger::GetInstance()->Log() << "GC Management shutdown";
+    hydra_log_info("GC Management shutdown");
 }
 
 void Heap::Fire(Heap::GCPhase phase, std::vector<std::future<void>> &futures)
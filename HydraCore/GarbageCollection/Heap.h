@@ -11,6 +11,7 @@
 #include "Common/ConcurrentQueue.h"
 #include "Common/Singleton.h"
 #include "Common/Logger.h"
+#include "Common/Metrics.h"
 
 #include <array>
 #include <vector>
@@ -58,6 +59,8 @@ public:
         GCCurrentPhase(GCPhase::GC_IDLE),
         Scheduler(this)
     {
+        RegisterMetrics();
+
         WaitingMutex.lock();
         GCManagementThread = std::thread(&Heap::GCManagement, this);
     }
@@ -102,7 +105,7 @@ public:
             return;
         }
 
-        Logger::GetInstance()->Log() << "Young GC requested";
+        hydra_log_debug("Young GC requested");
 
         YoungGCRequested.store(true, std::memory_order_relaxed);
         ShouldGCCV.notify_one();
@@ -115,7 +118,7 @@ public:
             return;
         }
 
-        Logger::GetInstance()->Log() << "Full GC requested";
+        hydra_log_debug("Full GC requested");
 
         FullGCRequested.store(true, std::memory_order_relaxed);
         ShouldGCCV.notify_one();
@@ -207,6 +210,10 @@ public:
     void StopTheWorld();
     void ResumeTheWorld();
 
+    // runs func with every thread parked at a checkpoint or inactive, never
+    // during a collection; the calling thread must be inactive itself
+    void RunWithWorldStopped(std::function<void()> func);
+
     void Shutdown();
 
     inline bool IsLargeObject(void *ptr)
@@ -228,6 +235,22 @@ public:
         RootScanFunc.push_back(scanFunc);
     }
 
+    // run with the world stopped once a collection finished marking, with
+    // whether an object survives that collection
+    inline void RegisterMarkedFunc(std::function<void(std::function<bool(HeapObject *)>)> markedFunc)
+    {
+        std::unique_lock<std::mutex> lck(MarkedFuncMutex);
+
+        MarkedFunc.push_back(markedFunc);
+    }
+
+    // walks every cell in use and every large object, with the size it occupies;
+    // the caller must make sure no other thread is allocating meanwhile
+    void ForeachObject(std::function<void(HeapObject *, size_t)> callback);
+
+    // runs the registered root scan functions with scan instead of Remember
+    void ScanRoots(std::function<void(HeapObject *)> scan);
+
     inline void FeedbackInactiveRegion(Region *region)
     {
         FreeLists[region->Level].Push(region);
@@ -262,6 +285,10 @@ private:
     std::mutex RootScanFuncMutex;
     std::vector<std::function<void(std::function<void(HeapObject *)>)>> RootScanFunc;
 
+    std::mutex MarkedFuncMutex;
+    std::vector<std::function<void(std::function<bool(HeapObject *)>)>> MarkedFunc;
+    void RunMarkedFunc(std::function<bool(HeapObject *)> survives);
+
     std::set<HeapObject *> LargeSet;
     std::shared_mutex LargeSetMutex;
 
@@ -279,6 +306,9 @@ private:
     std::atomic<size_t> WaitingThreadsCount;
     std::shared_mutex RemarkMutex;
 
+    // held by each collection from its first phase until idle again
+    std::mutex CollectionMutex;
+
     std::mutex ShouldGCMutex;
     std::condition_variable ShouldGCCV;
     std::atomic<bool> YoungGCRequested;
@@ -305,6 +335,11 @@ private:
 
     bool AreAllWorkingThreadsReported();
 
+    Metrics::Id PauseHistogram;
+    Metrics::Id YoungGCCount;
+    Metrics::Id FullGCCount;
+    void RegisterMetrics();
+
     friend class ThreadAllocator;
     friend class GCScheduler;
 };
@@ -16,7 +16,7 @@ concurrent::LevelHashSet<Region> Region::RegionSet;
 
 size_t Region::YoungSweep()
 {
-    Logger::GetInstance()->Log() << "YoungSweep: " << this;
+    hydra_log_debug("YoungSweep: {}", this);
     auto perfSessoin = Logger::GetInstance()->Perf("YoungSweep");
 
     if (OldObjectCount.load() == 0)
@@ -31,7 +31,7 @@ size_t Region::YoungSweep()
         }
 
         Allocated = AllocateBegin(Level);
-        Logger::GetInstance()->Log() << "Region " << this << " clear";
+        hydra_log_debug("Region {} clear", this);
 
         return 0;
     }
@@ -66,7 +66,7 @@ size_t Region::YoungSweep()
 
 size_t Region::FullSweep()
 {
-    Logger::GetInstance()->Log() << "FullSweep: " << this;
+    hydra_log_debug("FullSweep: {}", this);
     auto perfSessoin = Logger::GetInstance()->Perf("FullSweep");
 
     size_t oldObjectCount = 0;
@@ -108,7 +108,7 @@ size_t Region::FullSweep()
 
 void Region::RemarkBlockObject()
 {
-    Logger::GetInstance()->Log() << "RemarkRegion: " << this;
+    hydra_log_debug("RemarkRegion: {}", this);
     auto perfSessoin = Logger::GetInstance()->Perf("Remark");
 
     auto checker = [](HeapObject *ref)
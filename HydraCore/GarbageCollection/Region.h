@@ -184,18 +184,29 @@ public:
         Region *region = NewInternal(level);
         RegionSet.Add(region);
 
-        Logger::GetInstance()->Log() << "New Region " << region << " level " << level;
+        hydra_log_debug("New Region {} level {}", region, level);
         return region;
     }
 
     inline static void Delete(Region *region)
     {
-        Logger::GetInstance()->Log() << "Delete Region " << region << " level " << region->Level;
+        hydra_log_debug("Delete Region {} level {}", region, region->Level);
 
         RegionSet.Remove(region);
         DeleteInternal(region);
     }
 
+    template <typename T_Callback>
+    inline static void ForeachRegion(T_Callback callback)
+    {
+        RegionSet.Foreach(callback);
+    }
+
+    inline size_t GetLevel() const
+    {
+        return Level;
+    }
+
     static constexpr size_t CellSizeFromLevel(size_t level)
     {
         return 1ull << (level + MINIMAL_ALLOCATE_SIZE_LEVEL);
@@ -21,6 +21,19 @@ using runtime::JSValue;
 
 std::set<ThreadAllocator *> ThreadAllocator::InactiveSets;
 std::mutex ThreadAllocator::InactiveSetsMutex;
+std::set<ThreadAllocator *> ThreadAllocator::ParkedSets;
+std::mutex ThreadAllocator::ParkedSetsMutex;
+thread_local std::function<void(gc::HeapObject *)> *ThreadAllocator::CurrentScan = nullptr;
+std::atomic<ThreadAllocator::SampleFunc> ThreadAllocator::Sampler { nullptr };
+
+const Metrics::Id ThreadAllocator::Allocations =
+    Metrics::GetInstance()->RegisterCounters("gc.allocations.level", LEVEL_NR);
+const Metrics::Id ThreadAllocator::AllocatedBytes =
+    Metrics::GetInstance()->RegisterCounters("gc.allocated_bytes.level", LEVEL_NR);
+const Metrics::Id ThreadAllocator::LargeAllocations =
+    Metrics::GetInstance()->RegisterCounter("gc.allocations.large");
+const Metrics::Id ThreadAllocator::LargeAllocatedBytes =
+    Metrics::GetInstance()->RegisterCounter("gc.allocated_bytes.large");
 
 void ThreadAllocator::Initialize()
 {
@@ -45,6 +58,24 @@ void ThreadAllocator::ThreadScan()
 }
 
 void ThreadAllocator::ScanWordOnStack(void **stackPtr)
+{
+    auto obj = ObjectOfWord(stackPtr);
+    if (!obj)
+    {
+        return;
+    }
+
+    if (CurrentScan)
+    {
+        (*CurrentScan)(obj);
+    }
+    else
+    {
+        Heap::GetInstance()->Remember(obj);
+    }
+}
+
+HeapObject *ThreadAllocator::ObjectOfWord(void **stackPtr)
 {
     auto heap = Heap::GetInstance();
     void *ptr = nullptr;
@@ -66,23 +97,57 @@ void ThreadAllocator::ScanWordOnStack(void **stackPtr)
         {
             hydra_assert(dynamic_cast<HeapObject*>(cell),
                 "must be an HeapObject");
-            heap->Remember(dynamic_cast<HeapObject*>(cell));
+            return dynamic_cast<HeapObject*>(cell);
         }
     }
     else if (heap->IsLargeObject(ptr))
     {
-        heap->Remember(reinterpret_cast<HeapObject*>(ptr));
+        return reinterpret_cast<HeapObject*>(ptr);
     }
+
+    return nullptr;
 }
 
 void ThreadAllocator::ScanAllInactiveThreads(std::function<void(gc::HeapObject *)> scan)
 {
     std::unique_lock<std::mutex> lck(InactiveSetsMutex);
 
+    CurrentScan = &scan;
     for (auto &allocator : InactiveSets)
     {
         allocator->ReporterFunction();
     }
+    CurrentScan = nullptr;
+}
+
+void ThreadAllocator::ScanParkedThreads(std::function<void(gc::HeapObject *)> scan)
+{
+    std::unique_lock<std::mutex> lck(ParkedSetsMutex);
+
+    CurrentScan = &scan;
+    for (auto &allocator : ParkedSets)
+    {
+        allocator->ReporterFunction();
+    }
+    CurrentScan = nullptr;
+}
+
+void ThreadAllocator::Park()
+{
+    platform::StackState state = platform::GetCurrentStackState();
+    ReporterFunction = [=]()
+    {
+        platform::ForeachWordOnStackWithState(state, ScanWordOnStack);
+    };
+
+    std::unique_lock<std::mutex> lck(ParkedSetsMutex);
+    ParkedSets.insert(this);
+}
+
+void ThreadAllocator::Unpark()
+{
+    std::unique_lock<std::mutex> lck(ParkedSetsMutex);
+    ParkedSets.erase(this);
 }
 
 } // namespace gc
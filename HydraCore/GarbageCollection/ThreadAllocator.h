@@ -9,6 +9,7 @@
 
 #include "Common/Platform.h"
 #include "Common/AutoCounter.h"
+#include "Common/Metrics.h"
 #include "Heap.h"
 
 #include <algorithm>
@@ -29,7 +30,9 @@ public:
         : Owner(owner),
         ReportedGCRound(0),
         RunningLock(Owner->RunningMutex),
-        Active(true)
+        Active(true),
+        MetricShard(Metrics::GetLocalShard()),
+        SampleCountdown(0)
     {
         LocalPool.fill(nullptr);
 
@@ -67,16 +70,22 @@ public:
 
         if (size > MAXIMAL_ALLOCATE_SIZE)
         {
+            Count(LargeAllocations);
+            Count(LargeAllocatedBytes, size);
+
             void *ptr = malloc(size);
             hydra_assert(ptr, "failed to allocate memory");
 
             T *allocated = new (ptr) T(HeapObject::IS_LARGE, args...);
             Owner->RegisterLargeObject(allocated);
 
-            return allocated;
+            return Sample(allocated, size);
         }
 
         size_t level = Region::GetLevelFromSize(size);
+        Count(Allocations + level);
+        Count(AllocatedBytes + level, size);
+
         if (!LocalPool[level])
         {
             LocalPool[level] = Owner->GetFreeRegion(level);
@@ -93,7 +102,7 @@ public:
             } while (!allocated);
         }
 
-        return allocated;
+        return Sample(allocated, size);
     }
 
     template <typename T, typename ...T_Args>
@@ -107,7 +116,7 @@ public:
     {
         if (Active.exchange(false))
         {
-            Logger::GetInstance()->Log() << "Thread Inactive";
+            hydra_log_info("Thread Inactive");
             {
                 std::unique_lock<std::mutex> lck(InactiveSetsMutex);
                 InactiveSets.insert(this);
@@ -135,7 +144,7 @@ public:
     {
         if (!Active.exchange(true))
         {
-            Logger::GetInstance()->Log() << "Thread active";
+            hydra_log_info("Thread active");
 
             Owner->TotalThreads.fetch_add(1, std::memory_order_relaxed);
             RunningLock.lock();
@@ -163,23 +172,29 @@ public:
         {
             auto checkpointPerf = Logger::GetInstance()->Perf("CheckpointPauseRequest");
 
-            reportFunc();
-            currentGCRound = Owner->GCRound.load();
-            if (currentGCRound != ReportedGCRound)
+            // a pause between collections (a heap snapshot) marks nothing
+            if (Owner->GCCurrentPhase.load() != Heap::GCPhase::GC_IDLE)
             {
-                ReportedGCRound = currentGCRound;
-                Owner->ReportedThreads.fetch_add(1);
+                reportFunc();
+                currentGCRound = Owner->GCRound.load();
+                if (currentGCRound != ReportedGCRound)
+                {
+                    ReportedGCRound = currentGCRound;
+                    Owner->ReportedThreads.fetch_add(1);
+                }
             }
 
             checkpointPerf.Phase("Report");
             std::shared_lock<std::shared_mutex> remarkingLock(Owner->RemarkMutex);
 
+            Park();
             {
                 std::shared_lock<std::shared_mutex> waitingLock(Owner->WaitingMutex);
                 AutoCounter<size_t> autoWaitingThreadCount(Owner->WaitingThreadsCount);
                 Owner->WakeupCV.wait(RunningLock,
                     [this]() { return !Owner->PauseRequested.load(); });
             }
+            Unpark();
 
             checkpointPerf.Phase("Wakeup");
 
@@ -202,13 +217,67 @@ public:
 
     static void Initialize();
 
+    // bumps a counter in the shard of the thread owning this allocator
+    inline void Count(Metrics::Id id, u64 value = 1)
+    {
+        Metrics::Add(MetricShard, id, value);
+    }
+
+    inline static uintptr_t OffsetMetricShard()
+    {
+        return reinterpret_cast<uintptr_t>(
+            &reinterpret_cast<ThreadAllocator*>(0)->MetricShard);
+    }
+
+    // per size level, bytes as requested
+    static const Metrics::Id Allocations;
+    static const Metrics::Id AllocatedBytes;
+    static const Metrics::Id LargeAllocations;
+    static const Metrics::Id LargeAllocatedBytes;
+
+    // the heap object a stack word refers to, or nullptr
+    static HeapObject *ObjectOfWord(void **stackPtr);
+
+    // scans the stack of every thread waiting at a checkpoint, for callers
+    // that stopped the world themselves
+    static void ScanParkedThreads(std::function<void(gc::HeapObject *)> scan);
+
+    // called about once every so many allocated bytes, returns the bytes to
+    // allocate before the next call. object is nullptr when the thread only
+    // needs its first countdown
+    using SampleFunc = size_t (*)(HeapObject *object, size_t size);
+
+    // installed by an allocation profiler, nullptr while sampling is off
+    static std::atomic<SampleFunc> Sampler;
+
 private:
+    template <typename T>
+    inline T *Sample(T *allocated, size_t size)
+    {
+        auto sampler = Sampler.load(std::memory_order_relaxed);
+        if (sampler)
+        {
+            if (size < SampleCountdown)
+            {
+                SampleCountdown -= size;
+            }
+            else
+            {
+                SampleCountdown = sampler(SampleCountdown ? allocated : nullptr, size);
+            }
+        }
+
+        return allocated;
+    }
+
     Heap *Owner;
     std::array<Region *, LEVEL_NR> LocalPool;
     size_t ReportedGCRound;
     std::shared_lock<std::shared_mutex> RunningLock;
     std::atomic<bool> Active;
     std::function<void()> ReporterFunction;
+    Metrics::Shard *MetricShard;
+    size_t SampleCountdown;
 
     static void ThreadScan();
     static void ScanWordOnStack(void **stackPtr);
@@ -217,6 +286,17 @@ private:
     static std::set<ThreadAllocator *> InactiveSets;
     static std::mutex InactiveSetsMutex;
 
+    // while waiting at a checkpoint, ReporterFunction scans the stack as of Park
+    void Park();
+    void Unpark();
+
+    static std::set<ThreadAllocator *> ParkedSets;
+    static std::mutex ParkedSetsMutex;
+
+    // set while ScanAllInactiveThreads or ScanParkedThreads runs, so reporters
+    // feed the caller's scan
+    static thread_local std::function<void(gc::HeapObject *)> *CurrentScan;
+
     friend class hydra::ThreadAllocatorTester;
 };
 
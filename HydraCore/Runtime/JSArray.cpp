@@ -5,6 +5,8 @@ namespace hydra
 namespace runtime
 {
 
+std::atomic<void *> JSArray::VTable{ nullptr };
+
 JSArray *JSArray::New(gc::ThreadAllocator &allocator, size_t splitPoint)
 {
     Array *tablePart = Array::New(allocator, splitPoint * 2);
@@ -23,7 +25,13 @@ JSArray *JSArray::New(gc::ThreadAllocator &allocator, size_t splitPoint)
     }
 
     auto emptyKlass = Klass::EmptyKlass(allocator);
-    return emptyKlass->NewObject<JSArray>(allocator, tablePart, hashPart, splitPoint);
+    auto ret = emptyKlass->NewObject<JSArray>(allocator, tablePart, hashPart, splitPoint);
+
+    if (!VTable.load(std::memory_order_relaxed))
+    {
+        VTable.store(*reinterpret_cast<void **>(ret), std::memory_order_relaxed);
+    }
+    return ret;
 }
 
 bool JSArray::Get(size_t key, JSValue &value, JSObjectPropertyAttribute &attribute)
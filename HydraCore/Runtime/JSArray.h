@@ -7,6 +7,8 @@
 #include "JSObject.h"
 #include "Klass.h"
 
+#include <atomic>
+
 namespace hydra
 {
 namespace runtime
@@ -63,6 +65,32 @@ public:
         Length = newLength;
     }
 
+    // vtable pointer of every JSArray, nullptr until the first one is created,
+    // which semantic::Initialize does. compiled code compares against it to
+    // access elements inline
+    static inline void *GetVTable()
+    {
+        return VTable.load(std::memory_order_relaxed);
+    }
+
+    static inline size_t OffsetTablePart()
+    {
+        return reinterpret_cast<size_t>(
+            &(reinterpret_cast<JSArray*>(0)->TablePart));
+    }
+
+    static inline size_t OffsetSplitPoint()
+    {
+        return reinterpret_cast<size_t>(
+            &(reinterpret_cast<JSArray*>(0)->SplitPoint));
+    }
+
+    static inline size_t OffsetLength()
+    {
+        return reinterpret_cast<size_t>(
+            &(reinterpret_cast<JSArray*>(0)->Length));
+    }
+
 private:
     bool GetSlowInternal(size_t key, JSValue &value, JSObjectPropertyAttribute &attribute);
     void SetSlowInternal(gc::ThreadAllocator &allocator,
@@ -94,6 +122,8 @@ private:
     Array *HashPart;
     size_t SplitPoint;
     size_t Length;
+
+    static std::atomic<void *> VTable;
 };
 
 } // namespace runtime
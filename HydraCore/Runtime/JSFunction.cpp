@@ -1,8 +1,13 @@
 #include "JSFunction.h"
+#include "Semantic.h"
 
 #include "VirtualMachine/IR.h"
 #include "VirtualMachine/Scope.h"
 #include "VirtualMachine/CompiledFunction.h"
+#include "VirtualMachine/CompileQueue.h"
+#include "VirtualMachine/Profiler.h"
+
+#include "Common/Platform.h"
 
 #include <vector>
 
@@ -11,41 +16,42 @@ namespace hydra
 namespace runtime
 {
 
-bool JSNativeFunction::Call(gc::ThreadAllocator &allocator,
-    JSValue thisArg,
-    JSArray *arguments,
-    JSValue &retVal,
-    JSValue &error)
+static inline vm::CompiledFunction *GetCompiled(vm::IRFunc *func)
 {
-    return Func(allocator, thisArg, arguments, retVal, error);
+    auto compiled = func->Compiled.load();
+    if (compiled)
+    {
+        return compiled;
+    }
+
+    if (func->Hotness.load(std::memory_order_relaxed) >= vm::JIT_HOTNESS_THRESHOLD &&
+        !func->BaselineRequested.exchange(true))
+    {
+        vm::CompileQueue::GetInstance()->EnqueueBaseline(func, vm::CompilePriority::High);
+    }
+
+    // keep interpreting until the baseline code is ready, unless a compiler
+    // took the IR before it was ever lowered
+    compiled = vm::CompiledFunction::Interpret(func);
+    if (!compiled)
+    {
+        compiled = vm::CompileQueue::GetInstance()->WaitBaseline(func);
+    }
+    return compiled;
 }
 
-JSCompiledFunction::JSCompiledFunction(u8 property, runtime::Klass *klass, Array *table, vm::Scope *scope, RangeArray *captured, vm::IRFunc *func)
-    : JSFunction(property, klass, table), Scope(scope), Captured(captured), Func(func)
+static inline size_t GetArgumentsLength(JSArray *arguments)
 {
-    gc::Heap::GetInstance()->WriteBarrier(this, Scope);
-    gc::Heap::GetInstance()->WriteBarrier(this, Captured);
+    return arguments->GetLength();
 }
 
-void JSCompiledFunction::Scan(std::function<void(gc::HeapObject*)> scan)
+static inline size_t GetArgumentsLength(const ArgumentVector &arguments)
 {
-    JSObject::Scan(scan);
-    if (Scope) scan(Scope);
-    if (Captured) scan(Captured);
+    return arguments.Length;
 }
 
-bool JSCompiledFunction::Call(gc::ThreadAllocator &allocator, JSValue thisArg, JSArray *arguments, JSValue &retVal, JSValue &error)
+static void CopyArguments(RangeArray *arrayArgs, JSArray *arguments)
 {
-    auto compiled = Func->Compiled.load();
-    if (!compiled)
-    {
-        compiled = Func->BaselineFuture.get();
-    }
-
-    Array *regs = Array::New(allocator, compiled->GetRegisterCount());
-    Array *table = Array::New(allocator, compiled->GetVarCount());
-
-    RangeArray *arrayArgs = RangeArray::New(allocator, arguments->GetLength());
     for (size_t i = 0; i < arguments->GetLength(); ++i)
     {
         JSValue value;
@@ -64,74 +70,223 @@ bool JSCompiledFunction::Call(gc::ThreadAllocator &allocator, JSValue thisArg, J
             arrayArgs->at(i) = JSValue();
         }
     }
+}
+
+static void CopyArguments(RangeArray *arrayArgs, const ArgumentVector &arguments)
+{
+    for (size_t i = 0; i < arguments.Length; ++i)
+    {
+        JSValue value = arguments.Values[i];
+        arrayArgs->at(i) = value;
+        if (value.IsReference())
+        {
+            gc::Heap::GetInstance()->WriteBarrier(arrayArgs, value.ToReference());
+        }
+    }
+}
+
+template <typename T_Args>
+static bool EnterCompiled(
+    gc::ThreadAllocator &allocator,
+    vm::IRFunc *func,
+    vm::CompiledFunction *compiled,
+    vm::Scope *upper,
+    RangeArray *captured,
+    JSValue thisArg,
+    T_Args arguments,
+    JSValue &retVal,
+    JSValue &error)
+{
+    if (compiled->IsInterpreted())
+    {
+        func->Hotness.fetch_add(1, std::memory_order_relaxed);
+    }
+    else if (!func->OptimizeRequested.load(std::memory_order_relaxed) &&
+        func->Hotness.fetch_add(1, std::memory_order_relaxed) >= vm::OPTIMIZE_HOTNESS_THRESHOLD &&
+        !func->OptimizeRequested.exchange(true))
+    {
+        // keep running baseline code, later calls pick up the optimized one
+        vm::CompileQueue::GetInstance()->EnqueueOptimize(func);
+    }
+
+    size_t length = GetArgumentsLength(arguments);
+
+    size_t regsSize = gc::Region::CellSizeFromLevel(Array::LevelFromCapacity(compiled->GetRegisterCount()));
+    size_t argsSize = gc::Region::CellSizeFromLevel(RangeArray::LevelFromCapacity(length));
+    size_t tableSize = compiled->GetVarCount() ? 0 : gc::Region::CellSizeFromLevel(0);
+    size_t frameSize = regsSize + argsSize + tableSize + sizeof(vm::Scope);
+
+    if (compiled->IsScopeEscaped() || frameSize > MAXIMAL_STACK_FRAME_SIZE)
+    {
+        Array *regs = Array::New(allocator, compiled->GetRegisterCount());
+        Array *table = Array::New(allocator, compiled->GetVarCount());
+
+        RangeArray *arrayArgs = RangeArray::New(allocator, length);
+        CopyArguments(arrayArgs, arguments);
+
+        vm::Scope *newScope = allocator.AllocateAuto<vm::Scope>(
+            upper,
+            regs,
+            table,
+            captured,
+            thisArg,
+            arrayArgs);
+
+        vm::AutoThreadTop autoThreadTop(newScope);
+        vm::AutoProfileFrame autoProfileFrame(compiled);
+        return compiled->Call(allocator, newScope, retVal, error);
+    }
+
+    // nothing can reference the frame after returning, so it is kept on the
+    // native stack where the conservative stack scan finds its values.
+    // Table stays in heap if any alloca is left, since stores into it are
+    // write barriered by region
+    u8 *buffer = static_cast<u8 *>(hydra_alloca(frameSize));
+
+    Array *regs = Array::NewInPlace(buffer, Array::LevelFromCapacity(compiled->GetRegisterCount()));
+    buffer += regsSize;
+
+    RangeArray *arrayArgs = RangeArray::NewInPlace(buffer, RangeArray::LevelFromCapacity(length), length);
+    CopyArguments(arrayArgs, arguments);
+    buffer += argsSize;
+
+    Array *table = nullptr;
+    if (tableSize)
+    {
+        table = Array::NewInPlace(buffer, 0);
+        buffer += tableSize;
+    }
+    else
+    {
+        table = Array::New(allocator, compiled->GetVarCount());
+    }
 
-    vm::Scope *newScope = allocator.AllocateAuto<vm::Scope>(
-        Scope,
+    vm::Scope *newScope = new (buffer) vm::Scope(0,
+        upper,
         regs,
         table,
-        Captured,
+        captured,
         thisArg,
         arrayArgs);
 
     vm::AutoThreadTop autoThreadTop(newScope);
+    vm::AutoProfileFrame autoProfileFrame(compiled);
     return compiled->Call(allocator, newScope, retVal, error);
 }
 
-JSCompiledArrowFunction::JSCompiledArrowFunction(u8 property, runtime::Klass *klass, Array *table, vm::Scope *scope, RangeArray *captured, vm::IRFunc *func)
+bool JSNativeFunction::Call(gc::ThreadAllocator &allocator,
+    JSValue thisArg,
+    JSArray *arguments,
+    JSValue &retVal,
+    JSValue &error)
+{
+    ArgumentVector vector{ nullptr, arguments ? arguments->GetLength() : 0 };
+    if (vector.Length)
+    {
+        // the stack copy is found by the conservative scan like any local
+        vector.Values = static_cast<JSValue *>(hydra_alloca(vector.Length * sizeof(JSValue)));
+        for (size_t i = 0; i < vector.Length; ++i)
+        {
+            JSObjectPropertyAttribute attribute;
+            if (!arguments->Get(i, vector.Values[i], attribute))
+            {
+                vector.Values[i] = JSValue();
+            }
+        }
+    }
+
+    return Func(allocator, thisArg, vector, retVal, error);
+}
+
+bool JSNativeFunction::CallWithArgv(gc::ThreadAllocator &allocator,
+    JSValue thisArg,
+    const ArgumentVector &arguments,
+    JSValue &retVal,
+    JSValue &error)
+{
+    return Func(allocator, thisArg, arguments, retVal, error);
+}
+
+std::atomic<void *> JSCompiledFunction::VTable{ nullptr };
+
+JSCompiledFunction::JSCompiledFunction(u8 property, runtime::Klass *klass, Array *table, vm::Scope *scope, RangeArray *captured, vm::IRFunc *func)
     : JSFunction(property, klass, table), Scope(scope), Captured(captured), Func(func)
 {
     gc::Heap::GetInstance()->WriteBarrier(this, Scope);
     gc::Heap::GetInstance()->WriteBarrier(this, Captured);
+
+    if (!VTable.load(std::memory_order_relaxed))
+    {
+        VTable.store(*reinterpret_cast<void **>(this), std::memory_order_relaxed);
+    }
 }
 
-void JSCompiledArrowFunction::Scan(std::function<void(gc::HeapObject*)> scan)
+void JSCompiledFunction::Scan(std::function<void(gc::HeapObject*)> scan)
 {
     JSObject::Scan(scan);
     if (Scope) scan(Scope);
     if (Captured) scan(Captured);
 }
 
-bool JSCompiledArrowFunction::Call(gc::ThreadAllocator &allocator, JSValue thisArg, JSArray *arguments, JSValue &retVal, JSValue &error)
+bool JSCompiledFunction::Call(gc::ThreadAllocator &allocator, JSValue thisArg, JSArray *arguments, JSValue &retVal, JSValue &error)
 {
-    auto compiled = Func->Compiled.load();
-    if (!compiled)
+    return CallCompiled(allocator, GetCompiled(Func), thisArg, arguments, retVal, error);
+}
+
+bool JSCompiledFunction::CallWithArgv(gc::ThreadAllocator &allocator, JSValue thisArg, const ArgumentVector &arguments, JSValue &retVal, JSValue &error)
+{
+    return CallCompiled(allocator, GetCompiled(Func), thisArg, arguments, retVal, error);
+}
+
+bool JSCompiledFunction::CallCompiled(gc::ThreadAllocator &allocator, vm::CompiledFunction *compiled, JSValue thisArg, JSArray *arguments, JSValue &retVal, JSValue &error)
+{
+    return EnterCompiled(allocator, Func, compiled, Scope, Captured, thisArg, arguments, retVal, error);
+}
+
+bool JSCompiledFunction::CallCompiled(gc::ThreadAllocator &allocator, vm::CompiledFunction *compiled, JSValue thisArg, const ArgumentVector &arguments, JSValue &retVal, JSValue &error)
+{
+    return EnterCompiled<const ArgumentVector &>(allocator, Func, compiled, Scope, Captured, thisArg, arguments, retVal, error);
+}
+
+std::atomic<void *> JSCompiledArrowFunction::VTable{ nullptr };
+
+JSCompiledArrowFunction::JSCompiledArrowFunction(u8 property, runtime::Klass *klass, Array *table, vm::Scope *scope, RangeArray *captured, vm::IRFunc *func)
+    : JSFunction(property, klass, table), Scope(scope), Captured(captured), Func(func)
+{
+    gc::Heap::GetInstance()->WriteBarrier(this, Scope);
+    gc::Heap::GetInstance()->WriteBarrier(this, Captured);
+
+    if (!VTable.load(std::memory_order_relaxed))
     {
-        compiled = Func->BaselineFuture.get();
+        VTable.store(*reinterpret_cast<void **>(this), std::memory_order_relaxed);
     }
+}
 
-    Array *regs = Array::New(allocator, compiled->GetRegisterCount());
-    Array *table = Array::New(allocator, compiled->GetVarCount());
+void JSCompiledArrowFunction::Scan(std::function<void(gc::HeapObject*)> scan)
+{
+    JSObject::Scan(scan);
+    if (Scope) scan(Scope);
+    if (Captured) scan(Captured);
+}
 
-    RangeArray *arrayArgs = RangeArray::New(allocator, arguments->GetLength());
-    for (size_t i = 0; i < arguments->GetLength(); ++i)
-    {
-        JSValue value;
-        JSObjectPropertyAttribute attribute;
+bool JSCompiledArrowFunction::Call(gc::ThreadAllocator &allocator, JSValue thisArg, JSArray *arguments, JSValue &retVal, JSValue &error)
+{
+    return CallCompiled(allocator, GetCompiled(Func), thisArg, arguments, retVal, error);
+}
 
-        if (arguments->Get(i, value, attribute))
-        {
-            arrayArgs->at(i) = value;
-            if (value.IsReference())
-            {
-                gc::Heap::GetInstance()->WriteBarrier(arrayArgs, value.ToReference());
-            }
-        }
-        else
-        {
-            arrayArgs->at(i) = JSValue();
-        }
-    }
+bool JSCompiledArrowFunction::CallWithArgv(gc::ThreadAllocator &allocator, JSValue thisArg, const ArgumentVector &arguments, JSValue &retVal, JSValue &error)
+{
+    return CallCompiled(allocator, GetCompiled(Func), thisArg, arguments, retVal, error);
+}
 
-    vm::Scope *newScope = allocator.AllocateAuto<vm::Scope>(
-        Scope,
-        regs,
-        table,
-        Captured,
-        Scope->GetThisArg(),
-        arrayArgs);
+bool JSCompiledArrowFunction::CallCompiled(gc::ThreadAllocator &allocator, vm::CompiledFunction *compiled, JSValue thisArg, JSArray *arguments, JSValue &retVal, JSValue &error)
+{
+    return EnterCompiled(allocator, Func, compiled, Scope, Captured, Scope->GetThisArg(), arguments, retVal, error);
+}
 
-    vm::AutoThreadTop autoThreadTop(newScope);
-    return compiled->Call(allocator, newScope, retVal, error);
+bool JSCompiledArrowFunction::CallCompiled(gc::ThreadAllocator &allocator, vm::CompiledFunction *compiled, JSValue thisArg, const ArgumentVector &arguments, JSValue &retVal, JSValue &error)
+{
+    return EnterCompiled<const ArgumentVector &>(allocator, Func, compiled, Scope, Captured, Scope->GetThisArg(), arguments, retVal, error);
 }
 
 } // namespace runtime
@@ -18,6 +18,7 @@ namespace hydra
 namespace vm
 {
 class Scope;
+class CompiledFunction;
 struct IRFunc;
 }
 
@@ -72,6 +73,19 @@ namespace runtime
 #define return_lib_call(__func, __this, __arguments)                                     \
     return __func(allocator, __this, __arguments, retVal, error)
 
+// arguments living on the caller's native stack, only valid during the call
+struct ArgumentVector
+{
+    JSValue *Values;
+    size_t Length;
+
+    // undefined past the end, as a missing element of an arguments array
+    inline JSValue Get(size_t index) const
+    {
+        return index < Length ? Values[index] : JSValue();
+    }
+};
+
 class JSFunction : public JSObject
 {
 public:
@@ -80,19 +94,23 @@ public:
     { }
 
     virtual bool Call(gc::ThreadAllocator &allocator, JSValue thisArg, JSArray *arguments, JSValue &retVal, JSValue &error) = 0;
+
+    virtual bool CallWithArgv(gc::ThreadAllocator &allocator, JSValue thisArg, const ArgumentVector &arguments, JSValue &retVal, JSValue &error) = 0;
 };
 
 class JSNativeFunction : public JSFunction
 {
 public:
-    using Functor = std::function<bool(gc::ThreadAllocator&, JSValue, JSArray*, JSValue&, JSValue&)>;
+    using Functor = std::function<bool(gc::ThreadAllocator&, JSValue, const ArgumentVector&, JSValue&, JSValue&)>;
 
     JSNativeFunction(u8 property, runtime::Klass *klass, Array *table, Functor func)
         : JSFunction(property, klass, table),
         Func(func)
     { }
 
+    // copies the array onto the stack, natives only read a vector
     virtual bool Call(gc::ThreadAllocator &allocator, JSValue thisArg, JSArray *arguments, JSValue &retVal, JSValue &error) override final;
+    virtual bool CallWithArgv(gc::ThreadAllocator &allocator, JSValue thisArg, const ArgumentVector &arguments, JSValue &retVal, JSValue &error) override final;
 
 private:
     Functor Func;
@@ -106,11 +124,49 @@ public:
     virtual void Scan(std::function<void(gc::HeapObject*)> scan) override final;
 
     virtual bool Call(gc::ThreadAllocator &allocator, JSValue thisArg, JSArray *arguments, JSValue &retVal, JSValue &error) override final;
+    virtual bool CallWithArgv(gc::ThreadAllocator &allocator, JSValue thisArg, const ArgumentVector &arguments, JSValue &retVal, JSValue &error) override final;
+
+    // call with an already resolved body of Func, skips the lookup of Func->Compiled
+    bool CallCompiled(gc::ThreadAllocator &allocator, vm::CompiledFunction *compiled, JSValue thisArg, JSArray *arguments, JSValue &retVal, JSValue &error);
+    bool CallCompiled(gc::ThreadAllocator &allocator, vm::CompiledFunction *compiled, JSValue thisArg, const ArgumentVector &arguments, JSValue &retVal, JSValue &error);
+
+    inline vm::IRFunc *GetFunc() const
+    {
+        return Func;
+    }
+
+    // holds the vtable pointer of every JSCompiledFunction, nullptr until the
+    // first one is created. compiled code loads and compares it to enter Func
+    // directly, it may be compiled before any function exists
+    static inline std::atomic<void *> *AddressOfVTable()
+    {
+        return &VTable;
+    }
+
+    static inline size_t OffsetScope()
+    {
+        return reinterpret_cast<size_t>(
+            &(reinterpret_cast<JSCompiledFunction*>(0)->Scope));
+    }
+
+    static inline size_t OffsetCaptured()
+    {
+        return reinterpret_cast<size_t>(
+            &(reinterpret_cast<JSCompiledFunction*>(0)->Captured));
+    }
+
+    static inline size_t OffsetFunc()
+    {
+        return reinterpret_cast<size_t>(
+            &(reinterpret_cast<JSCompiledFunction*>(0)->Func));
+    }
 
 private:
     vm::Scope *Scope;
     RangeArray *Captured;
     vm::IRFunc *Func;
+
+    static std::atomic<void *> VTable;
 };
 
 class JSCompiledArrowFunction : public JSFunction
@@ -121,11 +177,47 @@ public:
     virtual void Scan(std::function<void(gc::HeapObject*)> scan) override final;
 
     virtual bool Call(gc::ThreadAllocator &allocator, JSValue thisArg, JSArray *arguments, JSValue &retVal, JSValue &error) override final;
+    virtual bool CallWithArgv(gc::ThreadAllocator &allocator, JSValue thisArg, const ArgumentVector &arguments, JSValue &retVal, JSValue &error) override final;
+
+    // call with an already resolved body of Func, skips the lookup of Func->Compiled
+    bool CallCompiled(gc::ThreadAllocator &allocator, vm::CompiledFunction *compiled, JSValue thisArg, JSArray *arguments, JSValue &retVal, JSValue &error);
+    bool CallCompiled(gc::ThreadAllocator &allocator, vm::CompiledFunction *compiled, JSValue thisArg, const ArgumentVector &arguments, JSValue &retVal, JSValue &error);
+
+    inline vm::IRFunc *GetFunc() const
+    {
+        return Func;
+    }
+
+    // see JSCompiledFunction::AddressOfVTable
+    static inline std::atomic<void *> *AddressOfVTable()
+    {
+        return &VTable;
+    }
+
+    static inline size_t OffsetScope()
+    {
+        return reinterpret_cast<size_t>(
+            &(reinterpret_cast<JSCompiledArrowFunction*>(0)->Scope));
+    }
+
+    static inline size_t OffsetCaptured()
+    {
+        return reinterpret_cast<size_t>(
+            &(reinterpret_cast<JSCompiledArrowFunction*>(0)->Captured));
+    }
+
+    static inline size_t OffsetFunc()
+    {
+        return reinterpret_cast<size_t>(
+            &(reinterpret_cast<JSCompiledArrowFunction*>(0)->Func));
+    }
 
 private:
     vm::Scope *Scope;
     RangeArray *Captured;
     vm::IRFunc *Func;
+
+    static std::atomic<void *> VTable;
 };
 
 } // namespace runtime
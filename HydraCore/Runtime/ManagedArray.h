@@ -71,6 +71,13 @@ public:
             gc::Region::CellSizeFromLevel(level), level);
     }
 
+    // buffer must hold CellSizeFromLevel(level) bytes and outlive every use,
+    // the array is not managed and only found by scanning the stack
+    static Array *NewInPlace(void *buffer, size_t level)
+    {
+        return new (buffer) Array(0, level);
+    }
+
     inline static size_t OffsetTable()
     {
         return sizeof(Array);
@@ -161,11 +168,22 @@ public:
             gc::Region::CellSizeFromLevel(level), level, length);
     }
 
+    static RangeArray *NewInPlace(void *buffer, size_t level, size_t length)
+    {
+        return new (buffer) RangeArray(0, level, length);
+    }
+
     inline static size_t OffsetTable()
     {
         return sizeof(RangeArray);
     }
 
+    inline static size_t OffsetLength()
+    {
+        return reinterpret_cast<size_t>(
+            &reinterpret_cast<RangeArray*>(0)->Length);
+    }
+
 private:
     RangeArray(u8 property, size_t level, size_t length)
         : HeapObject(property), Level(level), Length(length)
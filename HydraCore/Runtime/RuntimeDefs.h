@@ -13,6 +13,8 @@ constexpr static size_t DEFAULT_TRANSACTION_SIZE_IN_KLASS = 16;
 
 constexpr static size_t DEFAULT_JSARRAY_SPLIT_POINT = 8;
 
+constexpr static size_t MAXIMAL_STACK_FRAME_SIZE = 4096;
+
 } // namespace runtime
 } // namespace hydra
 
@@ -14,6 +14,7 @@
 #include <iostream>
 #include <queue>
 #include <chrono>
+#include <typeinfo>
 
 namespace hydra
 {
@@ -57,15 +58,15 @@ namespace semantic
     def(u"slice", SLICE)                \
 
 
-static bool lib_Object(gc::ThreadAllocator &allocator, JSValue thisArg, JSArray *arguments, JSValue &retVal, JSValue &error);
-static bool lib_Object_prototype_hasOwnProperty(gc::ThreadAllocator &allocator, JSValue thisArg, JSArray *arguments, JSValue &retVal, JSValue &error);
-static bool lib_Function(gc::ThreadAllocator &allocator, JSValue thisArg, JSArray *arguments, JSValue &retVal, JSValue &error);
-static bool lib_Array(gc::ThreadAllocator &allocator, JSValue thisArg, JSArray *arguments, JSValue &retVal, JSValue &error);
-static bool lib_Array_IsArray(gc::ThreadAllocator &allocator, JSValue thisArg, JSArray *arguments, JSValue &retVal, JSValue &error);
+static bool lib_Object(gc::ThreadAllocator &allocator, JSValue thisArg, const ArgumentVector &arguments, JSValue &retVal, JSValue &error);
+static bool lib_Object_prototype_hasOwnProperty(gc::ThreadAllocator &allocator, JSValue thisArg, const ArgumentVector &arguments, JSValue &retVal, JSValue &error);
+static bool lib_Function(gc::ThreadAllocator &allocator, JSValue thisArg, const ArgumentVector &arguments, JSValue &retVal, JSValue &error);
+static bool lib_Array(gc::ThreadAllocator &allocator, JSValue thisArg, const ArgumentVector &arguments, JSValue &retVal, JSValue &error);
+static bool lib_Array_IsArray(gc::ThreadAllocator &allocator, JSValue thisArg, const ArgumentVector &arguments, JSValue &retVal, JSValue &error);
 static bool lib_Array_IsArraySafe(JSValue value);
 static void InitializeArray(gc::ThreadAllocator &allocator);
 
-static bool lib___parallel(gc::ThreadAllocator &allocator, JSValue thisArg, JSArray *arguments, JSValue &retVal, JSValue &error);
+static bool lib___parallel(gc::ThreadAllocator &allocator, JSValue thisArg, const ArgumentVector &arguments, JSValue &retVal, JSValue &error);
 
 namespace strs
 {
@@ -210,20 +211,18 @@ void Initialize()
     hydra_assert(result, "Error on setting global.Array");
     InitializeArray(allocator);
 
-    auto __write = NewNativeFunc(allocator, [](gc::ThreadAllocator &allocator, JSValue thisArg, JSArray *arguments, JSValue &retVal, JSValue &error) -> bool
+    // compiled code checks for arrays by their vtable, known once one exists
+    NewArrayInternal(allocator);
+    hydra_assert(JSArray::GetVTable(), "JSArray vtable must be known");
+
+    auto __write = NewNativeFunc(allocator, [](gc::ThreadAllocator &allocator, JSValue thisArg, const ArgumentVector &arguments, JSValue &retVal, JSValue &error) -> bool
     {
-        for (size_t i = 0; i < arguments->GetLength(); ++i)
+        for (size_t i = 0; i < arguments.Length; ++i)
         {
             JSValue retVal;
             JSValue error;
-            JSObjectPropertyAttribute attribute;
-
-            if (!arguments->Get(i, retVal, attribute))
-            {
-                js_throw_error(ValueError, "Unable to get arguments");
-            }
 
-            if (!ToString(allocator, retVal, retVal, error))
+            if (!ToString(allocator, arguments.Values[i], retVal, error))
             {
                 return false;
             }
@@ -239,7 +238,7 @@ void Initialize()
 
     hydra_assert(result, "Error on setting global.__write");
 
-    auto __random = NewNativeFunc(allocator, [](gc::ThreadAllocator &allocator, JSValue thisArg, JSArray *arguments, JSValue &retVal, JSValue &error) -> bool
+    auto __random = NewNativeFunc(allocator, [](gc::ThreadAllocator &allocator, JSValue thisArg, const ArgumentVector &arguments, JSValue &retVal, JSValue &error) -> bool
     {
         double randVal = std::rand();
         js_return(JSValue::FromNumber(randVal / RAND_MAX));
@@ -249,7 +248,7 @@ void Initialize()
 
     hydra_assert(result, "Error on setting global.__random");
 
-    auto __datetime = NewNativeFunc(allocator, [](gc::ThreadAllocator &allocator, JSValue thisArg, JSArray *arguments, JSValue &retVal, JSValue &error) -> bool
+    auto __datetime = NewNativeFunc(allocator, [](gc::ThreadAllocator &allocator, JSValue thisArg, const ArgumentVector &arguments, JSValue &retVal, JSValue &error) -> bool
     {
         u64 ms = std::chrono::duration_cast<std::chrono::milliseconds>(
             std::chrono::system_clock::now().time_since_epoch()).count();
@@ -383,6 +382,103 @@ bool Call(gc::ThreadAllocator &allocator, JSValue callee, JSValue thisArg, JSArr
     return func->Call(allocator, thisArg, arguments, retVal, error);
 }
 
+bool CallWithArgv(gc::ThreadAllocator &allocator, JSValue callee, JSValue thisArg, const ArgumentVector &arguments, JSValue &retVal, JSValue &error)
+{
+    if (JSValue::GetType(callee) != Type::T_OBJECT)
+    {
+        js_throw_error(TypeError, "Object dosen't support this action");
+    }
+
+    JSObject *obj = callee.Object();
+    JSFunction *func = dynamic_cast<JSFunction*>(obj);
+
+    if (func == nullptr)
+    {
+        js_throw_error(ValueError, "Object expected");
+    }
+
+    return func->CallWithArgv(allocator, thisArg, arguments, retVal, error);
+}
+
+static inline bool CallFunction(gc::ThreadAllocator &allocator, JSFunction *func, JSValue thisArg, JSArray *arguments, JSValue &retVal, JSValue &error)
+{
+    return func->Call(allocator, thisArg, arguments, retVal, error);
+}
+
+static inline bool CallFunction(gc::ThreadAllocator &allocator, JSFunction *func, JSValue thisArg, const ArgumentVector &arguments, JSValue &retVal, JSValue &error)
+{
+    return func->CallWithArgv(allocator, thisArg, arguments, retVal, error);
+}
+
+template <typename T, typename T_Args>
+static inline bool CallCompiledWithCache(gc::ThreadAllocator &allocator, T *func, JSValue thisArg, T_Args arguments, JSValue &retVal, JSValue &error, vm::CallSiteCache *cache)
+{
+    // also misses once the function is tiered up and Compiled is swapped.
+    // hits of compiled code with a direct entry never get here, the others
+    // still go through CallCompiled, which allocates the frame
+    auto target = cache->Target.load(std::memory_order_relaxed);
+    if (target && target == func->GetFunc()->Compiled.load(std::memory_order_relaxed))
+    {
+        allocator.Count(vm::CallCacheCounters.Hit);
+        return func->CallCompiled(allocator, target, thisArg, arguments, retVal, error);
+    }
+
+    allocator.Count(vm::CallCacheCounters.Miss);
+    if (target)
+    {
+        allocator.Count(vm::CallCacheCounters.Repatch);
+    }
+
+    target = func->GetFunc()->Compiled.load();
+    if (!target)
+    {
+        // not compiled yet, let the normal path wait for it
+        return CallFunction(allocator, func, thisArg, arguments, retVal, error);
+    }
+
+    cache->Target.store(target, std::memory_order_relaxed);
+    return func->CallCompiled(allocator, target, thisArg, arguments, retVal, error);
+}
+
+bool CallWithCache(gc::ThreadAllocator &allocator, JSValue callee, JSValue thisArg, JSArray *arguments, JSValue &retVal, JSValue &error, vm::CallSiteCache *cache)
+{
+    if (JSValue::GetType(callee) == Type::T_OBJECT)
+    {
+        // exact type match is much cheaper than the dynamic_cast in Call
+        JSObject *obj = callee.Object();
+        if (obj && typeid(*obj) == typeid(JSCompiledFunction))
+        {
+            return CallCompiledWithCache(allocator, static_cast<JSCompiledFunction *>(obj), thisArg, arguments, retVal, error, cache);
+        }
+        else if (obj && typeid(*obj) == typeid(JSCompiledArrowFunction))
+        {
+            return CallCompiledWithCache(allocator, static_cast<JSCompiledArrowFunction *>(obj), thisArg, arguments, retVal, error, cache);
+        }
+    }
+
+    return Call(allocator, callee, thisArg, arguments, retVal, error);
+}
+
+bool CallWithArgvAndCache(gc::ThreadAllocator &allocator, JSValue callee, JSValue thisArg, const ArgumentVector *arguments, JSValue &retVal, JSValue &error, vm::CallSiteCache *cache)
+{
+    if (JSValue::GetType(callee) == Type::T_OBJECT)
+    {
+        JSObject *obj = callee.Object();
+        if (obj && typeid(*obj) == typeid(JSCompiledFunction))
+        {
+            return CallCompiledWithCache<JSCompiledFunction, const ArgumentVector &>(
+                allocator, static_cast<JSCompiledFunction *>(obj), thisArg, *arguments, retVal, error, cache);
+        }
+        else if (obj && typeid(*obj) == typeid(JSCompiledArrowFunction))
+        {
+            return CallCompiledWithCache<JSCompiledArrowFunction, const ArgumentVector &>(
+                allocator, static_cast<JSCompiledArrowFunction *>(obj), thisArg, *arguments, retVal, error, cache);
+        }
+    }
+
+    return CallWithArgv(allocator, callee, thisArg, *arguments, retVal, error);
+}
+
 bool GetGlobal(gc::ThreadAllocator &allocator, String *name, JSValue &retVal, JSValue &error)
 {
     hydra_assert(name, "name should not be nullptr");
@@ -439,6 +535,8 @@ JSFunction *NewRootFunc(gc::ThreadAllocator &allocator, vm::IRFunc *func, JSValu
         thisArg,
         nullptr);
 
+    func->Module->Materialize(allocator, func);
+
     auto ret = emptyObjectKlass->NewObject<JSCompiledArrowFunction>(allocator, scope, nullptr, func);
     InitializeFunction(allocator, ret);
     return ret;
@@ -451,6 +549,21 @@ JSNativeFunction *NewNativeFunc(gc::ThreadAllocator &allocator, JSNativeFunction
     return ret;
 }
 
+bool NewFunc(gc::ThreadAllocator &allocator, vm::Scope *scope, vm::IRFunc *func, RangeArray *captured, JSValue &retVal, JSValue &error)
+{
+    hydra_assert(func,
+        "func cannot be null");
+
+    func->Module->Materialize(allocator, func);
+
+    auto ret = emptyObjectKlass->NewObject<JSCompiledFunction>(allocator, NewContext(allocator, scope), captured, func);
+    InitializeFunction(allocator, ret);
+    retVal = JSValue::FromObject(ret);
+    gc::Heap::WriteBarrierIfInHeap(gc::Heap::GetInstance(), &retVal, retVal.Object());
+
+    return true;
+}
+
 bool NewFuncWithInst(gc::ThreadAllocator &allocator, vm::Scope *scope, vm::IRInst *inst, JSValue &retVal, JSValue &error)
 {
     auto funcInst = inst->As<vm::ir::Func>();
@@ -462,10 +575,17 @@ bool NewFuncWithInst(gc::ThreadAllocator &allocator, vm::Scope *scope, vm::IRIns
         captured->at(index++) = scope->GetRegs()->at(ref->InstIndex);
     }
 
-    hydra_assert(funcInst->FuncPtr,
-        "funcInst->FuncPtr cannot be null");
+    return NewFunc(allocator, scope, funcInst->FuncPtr, captured, retVal, error);
+}
 
-    auto ret = emptyObjectKlass->NewObject<JSCompiledFunction>(allocator, scope, captured, funcInst->FuncPtr);
+bool NewArrow(gc::ThreadAllocator &allocator, vm::Scope *scope, vm::IRFunc *func, RangeArray *captured, JSValue &retVal, JSValue &error)
+{
+    hydra_assert(func != nullptr,
+        "func cannot be null");
+
+    func->Module->Materialize(allocator, func);
+
+    auto ret = emptyObjectKlass->NewObject<JSCompiledArrowFunction>(allocator, NewContext(allocator, scope), captured, func);
     InitializeFunction(allocator, ret);
     retVal = JSValue::FromObject(ret);
     gc::Heap::WriteBarrierIfInHeap(gc::Heap::GetInstance(), &retVal, retVal.Object());
@@ -484,19 +604,35 @@ bool NewArrowWithInst(gc::ThreadAllocator &allocator, vm::Scope *scope, vm::IRIn
         captured->at(index++) = scope->GetRegs()->at(ref->InstIndex);
     }
 
-    hydra_assert(funcInst->FuncPtr != nullptr,
-        "funcInst->FuncPtr cannot be null");
+    return NewArrow(allocator, scope, funcInst->FuncPtr, captured, retVal, error);
+}
 
-    auto ret = emptyObjectKlass->NewObject<JSCompiledArrowFunction>(allocator, scope, captured, funcInst->FuncPtr);
-    InitializeFunction(allocator, ret);
-    retVal = JSValue::FromObject(ret);
-    gc::Heap::WriteBarrierIfInHeap(gc::Heap::GetInstance(), &retVal, retVal.Object());
+// a klass and slot the entry can not hold leave the site as it is
+static void FillPropertyCache(
+    gc::ThreadAllocator &allocator,
+    vm::PropertyCacheSite *site,
+    Klass *klass,
+    size_t index,
+    const vm::InlineCacheCounters &counters)
+{
+    u64 klassU64 = reinterpret_cast<u64>(klass);
+    if ((klassU64 >> vm::PropertyCacheSite::INDEX_SHIFT) || index >= vm::PropertyCacheSite::INDEX_LIMIT)
+    {
+        return;
+    }
 
-    return true;
+    u64 entry = klassU64 | (static_cast<u64>(index) << vm::PropertyCacheSite::INDEX_SHIFT);
+    if (site->Entry.exchange(entry, std::memory_order_relaxed) != 0)
+    {
+        allocator.Count(counters.Repatch);
+        site->Inst->Feedback.fetch_or(vm::IRInst::FEEDBACK_NOT_MONOMORPHIC, std::memory_order_relaxed);
+    }
 }
 
-bool ObjectGetAndFixCache(gc::ThreadAllocator &allocator, JSValue object, JSValue key, void *fixup, JSValue &retVal, JSValue &error)
+bool ObjectGetAndFixCache(gc::ThreadAllocator &allocator, JSValue object, JSValue key, vm::PropertyCacheSite *site, JSValue &retVal, JSValue &error)
 {
+    allocator.Count(vm::GetItemCacheCounters.Miss);
+
     if (lib_Array_IsArraySafe(object))
     {
         JSArray *arr = dynamic_cast<JSArray*>(object.Object());
@@ -543,13 +679,7 @@ bool ObjectGetAndFixCache(gc::ThreadAllocator &allocator, JSValue object, JSValu
             return ObjectGetSafeObject(allocator, object.Object(), stringKey.String(), retVal, error);
         }
 
-        // Fix up
-        u64 klassU64 = reinterpret_cast<u64>(klass);
-        u64 offset = index * 16 + 8 + Array::OffsetTable();
-
-        u8 *memory = reinterpret_cast<u8*>(fixup);
-        std::memcpy(memory + 2, &klassU64, 8);
-        std::memcpy(memory + 22, &offset, 8);
+        FillPropertyCache(allocator, site, klass, index, vm::GetItemCacheCounters);
 
         return true;
     }
@@ -560,8 +690,10 @@ bool ObjectGetAndFixCache(gc::ThreadAllocator &allocator, JSValue object, JSValu
     }
 }
 
-bool ObjectSetAndFixCache(gc::ThreadAllocator &allocator, JSValue object, JSValue key, void *fixup, JSValue value, JSValue &error)
+bool ObjectSetAndFixCache(gc::ThreadAllocator &allocator, JSValue object, JSValue key, vm::PropertyCacheSite *site, JSValue value, JSValue &error)
 {
+    allocator.Count(vm::SetItemCacheCounters.Miss);
+
     if (lib_Array_IsArraySafe(object))
     {
         JSArray *arr = dynamic_cast<JSArray*>(object.Object());
@@ -607,13 +739,7 @@ bool ObjectSetAndFixCache(gc::ThreadAllocator &allocator, JSValue object, JSValu
 
         obj->SetIndex(index, value, attribute);
 
-        // Fix up
-        u64 klassU64 = reinterpret_cast<u64>(klass);
-        u64 offset = index * 16 + 8 + Array::OffsetTable();
-
-        u8 *memory = reinterpret_cast<u8*>(fixup);
-        std::memcpy(memory + 2, &klassU64, 8);
-        std::memcpy(memory + 22, &offset, 8);
+        FillPropertyCache(allocator, site, klass, index, vm::SetItemCacheCounters);
 
         return true;
     }
@@ -691,7 +817,7 @@ static inline bool ObjectInvokeGetter(gc::ThreadAllocator &allocator, JSValue de
     hydra_assert(getterFunc != nullptr,
         "getterFunc must not be null");
 
-    return_js_call(getterFunc, JSValue::FromObject(object), nullptr);
+    return getterFunc->CallWithArgv(allocator, JSValue::FromObject(object), ArgumentVector{ nullptr, 0 }, retVal, error);
 }
 
 bool ObjectGetSafeObjectInternal(
@@ -871,10 +997,7 @@ static inline bool ObjectInvokeSetter(gc::ThreadAllocator &allocator, JSValue de
 
     JSValue retVal; // that we don't care
 
-    JSArray *arguments = NewArrayInternal(allocator, 1);
-    arguments->Set(allocator, 0, value);
-
-    return_js_call(setterFunc, JSValue::FromObject(object), arguments);
+    return setterFunc->CallWithArgv(allocator, JSValue::FromObject(object), ArgumentVector{ &value, 1 }, retVal, error);
 }
 
 bool ObjectSetSafeObject(gc::ThreadAllocator &allocator, JSObject *object, String *key, JSValue value, JSValue &error)
@@ -927,15 +1050,8 @@ bool ObjectSetSafeArray(gc::ThreadAllocator &allocator, JSArray *array, size_t k
 
 bool ObjectDelete(gc::ThreadAllocator &allocator, JSValue object, JSValue key, JSValue &error)
 {
-    JSArray *arguments = NewArrayInternal(allocator, 1);
-    auto result = ObjectSetSafeArray(allocator, arguments, 0, key, error);
-    if (!result)
-    {
-        js_throw(error);
-    }
-
     JSValue hasOwnProperty;
-    lib_call(hasOwnProperty, lib_Object_prototype_hasOwnProperty, object, arguments);
+    lib_call(hasOwnProperty, lib_Object_prototype_hasOwnProperty, object, (ArgumentVector{ &key, 1 }));
 
     if (!hasOwnProperty.Boolean())
     {
@@ -1807,9 +1923,8 @@ bool OpTypeOf(gc::ThreadAllocator &allocator, JSValue a, JSValue &retVal, JSValu
     }
 }
 
-vm::Scope *NewScope(gc::ThreadAllocator &allocator, vm::Scope *upper, vm::IRInst *inst)
+vm::Scope *NewScopeWithInst(gc::ThreadAllocator &allocator, vm::Scope *upper, vm::IRInst *inst)
 {
-    runtime::Array *table = Array::New(allocator, inst->As<vm::ir::PushScope>()->Size);
     runtime::RangeArray *captured = RangeArray::New(allocator, inst->As<vm::ir::PushScope>()->Captured.size());
 
     size_t index = 0;
@@ -1818,6 +1933,13 @@ vm::Scope *NewScope(gc::ThreadAllocator &allocator, vm::Scope *upper, vm::IRInst
         captured->at(index++) = upper->GetRegs()->at(ref->InstIndex);
     }
 
+    return NewScope(allocator, upper, inst->As<vm::ir::PushScope>()->Size, captured);
+}
+
+vm::Scope *NewScope(gc::ThreadAllocator &allocator, vm::Scope *upper, size_t size, RangeArray *captured)
+{
+    runtime::Array *table = Array::New(allocator, size);
+
     vm::Scope *ret = allocator.AllocateAuto<vm::Scope>(upper,
         upper->GetRegs(),
         table,
@@ -1828,6 +1950,34 @@ vm::Scope *NewScope(gc::ThreadAllocator &allocator, vm::Scope *upper, vm::IRInst
     return ret;
 }
 
+// what a closure keeps of the scope it is created in: the Tables its captured
+// cells may live in, down to the one of the frame, and what the frame was
+// called with. the frame itself may be on the native stack
+vm::Scope *NewContext(gc::ThreadAllocator &allocator, vm::Scope *scope)
+{
+    vm::Scope *upper = scope->GetUpper();
+    RangeArray *arguments = nullptr;
+
+    gc::Cell *cell;
+    if (upper && upper->GetRegs() == scope->GetRegs())
+    {
+        // pushed scopes share Regs with the scope they are pushed in
+        upper = NewContext(allocator, upper);
+    }
+    else if (gc::Region::IsInRegion(scope, cell))
+    {
+        // parameters captured in place, the frame is on the heap for them
+        arguments = scope->GetArguments();
+    }
+
+    return allocator.AllocateAuto<vm::Scope>(upper,
+        nullptr,
+        scope->GetTable(),
+        nullptr,
+        scope->GetThisArg(),
+        arguments);
+}
+
 bool ToBoolean(JSValue a)
 {
     auto typeA = JSValue::GetType(a);
@@ -1976,24 +2126,20 @@ bool ToPrimitive(gc::ThreadAllocator &allocator, JSValue value, JSValue &retVal,
 }
 
 /*********************** lib ***********************/
-static bool lib_Object(gc::ThreadAllocator &allocator, JSValue thisArg, JSArray *arguments, JSValue &retVal, JSValue &error)
+static bool lib_Object(gc::ThreadAllocator &allocator, JSValue thisArg, const ArgumentVector &arguments, JSValue &retVal, JSValue &error)
 {
     js_return_obj(NewEmptyObjectSafe(allocator));
 }
 
-static bool lib_Object_prototype_hasOwnProperty(gc::ThreadAllocator &allocator, JSValue thisArg, JSArray *arguments, JSValue &retVal, JSValue &error)
+static bool lib_Object_prototype_hasOwnProperty(gc::ThreadAllocator &allocator, JSValue thisArg, const ArgumentVector &arguments, JSValue &retVal, JSValue &error)
 {
     if (JSValue::GetType(thisArg) != Type::T_OBJECT)
     {
         js_throw_error(TypeError, "this is not an object");
     }
 
-    JSValue keyArg;
-    auto result = ObjectGetSafeArray(allocator, arguments, 0, keyArg, error);
-    if (!result)
-    {
-        js_throw(error);
-    }
+    JSValue keyArg = arguments.Get(0);
+    bool result;
 
     if (lib_Array_IsArraySafe(thisArg))
     {
@@ -2051,28 +2197,21 @@ static bool lib_Object_prototype_hasOwnProperty(gc::ThreadAllocator &allocator,
     js_return(JSValue::FromBoolean(value != JSValue() && attribute.HasValue()));
 }
 
-static bool lib_Function(gc::ThreadAllocator &allocator, JSValue thisArg, JSArray *arguments, JSValue &retVal, JSValue &error)
+static bool lib_Function(gc::ThreadAllocator &allocator, JSValue thisArg, const ArgumentVector &arguments, JSValue &retVal, JSValue &error)
 {
     hydra_trap("TODO");
     return false;
 }
 
-static bool lib_Array(gc::ThreadAllocator &allocator, JSValue thisArg, JSArray *argument, JSValue &retVal, JSValue &error)
+static bool lib_Array(gc::ThreadAllocator &allocator, JSValue thisArg, const ArgumentVector &arguments, JSValue &retVal, JSValue &error)
 {
     // TODO
     return NewArray(allocator, retVal, error);
 }
 
-static bool lib_Array_IsArray(gc::ThreadAllocator &allocator, JSValue thisArg, JSArray *arguments, JSValue &retVal, JSValue &error)
+static bool lib_Array_IsArray(gc::ThreadAllocator &allocator, JSValue thisArg, const ArgumentVector &arguments, JSValue &retVal, JSValue &error)
 {
-    JSValue arg;
-
-    if (!ObjectGetSafeArray(allocator, arguments, 0, arg, error))
-    {
-        return false;
-    }
-
-    js_return(JSValue::FromBoolean(lib_Array_IsArraySafe(arg)));
+    js_return(JSValue::FromBoolean(lib_Array_IsArraySafe(arguments.Get(0))));
 }
 
 static bool lib_Array_IsArraySafe(JSValue value)
@@ -2086,7 +2225,7 @@ static bool lib_Array_IsArraySafe(JSValue value)
     return dynamic_cast<JSArray*>(obj) != nullptr;
 }
 
-static bool lib_Array_prototype_length_get(gc::ThreadAllocator &allocator, JSValue thisArg, JSArray *arguments, JSValue &retVal, JSValue &error)
+static bool lib_Array_prototype_length_get(gc::ThreadAllocator &allocator, JSValue thisArg, const ArgumentVector &arguments, JSValue &retVal, JSValue &error)
 {
     if (!lib_Array_IsArraySafe(thisArg))
     {
@@ -2096,7 +2235,7 @@ static bool lib_Array_prototype_length_get(gc::ThreadAllocator &allocator, JSVal
     js_return(JSValue::FromSmallInt(dynamic_cast<JSArray*>(thisArg.Object())->GetLength()));
 }
 
-static bool lib_Array_prototype_slice(gc::ThreadAllocator &allocator, JSValue thisArg, JSArray *arguments, JSValue &retVal, JSValue &error)
+static bool lib_Array_prototype_slice(gc::ThreadAllocator &allocator, JSValue thisArg, const ArgumentVector &arguments, JSValue &retVal, JSValue &error)
 {
     if (!lib_Array_IsArraySafe(thisArg))
     {
@@ -2105,18 +2244,8 @@ static bool lib_Array_prototype_slice(gc::ThreadAllocator &allocator, JSValue th
 
     JSArray *arr = dynamic_cast<JSArray*>(thisArg.Object());
 
-    JSValue startVal;
-    JSValue endVal;
-
-    if (!ObjectGetSafeArray(allocator, arguments, 0, startVal, error))
-    {
-        return false;
-    }
-
-    if (!ObjectGetSafeArray(allocator, arguments, 1, endVal, error))
-    {
-        return false;
-    }
+    JSValue startVal = arguments.Get(0);
+    JSValue endVal = arguments.Get(1);
 
     i64 start = (startVal.IsUndefined() ? 0 : startVal.SmallInt()),
         end = (endVal.IsUndefined() ? arr->GetLength() : endVal.SmallInt());
@@ -2179,7 +2308,7 @@ static void InitializeArray(gc::ThreadAllocator &allocator)
     }
 }
 
-static bool lib___parallel(gc::ThreadAllocator &allocator, JSValue thisArg, JSArray *arguments, JSValue &retVal, JSValue &error)
+static bool lib___parallel(gc::ThreadAllocator &allocator, JSValue thisArg, const ArgumentVector &arguments, JSValue &retVal, JSValue &error)
 {
     auto taskRunner = [](JSFunction *func, JSValue *retVal, JSValue *error) -> bool
     {
@@ -2192,16 +2321,8 @@ static bool lib___parallel(gc::ThreadAllocator &allocator, JSValue thisArg, JSAr
     auto heap = gc::Heap::GetInstance();
     auto threadPool = ThreadPool::GetInstance();
 
-    JSValue tasksArray;
-    if (!ObjectGetSafeArray(allocator, arguments, 0, tasksArray, error))
-    {
-        return false;
-    }
-    JSValue concurrencyVal;
-    if (!ObjectGetSafeArray(allocator, arguments, 1, concurrencyVal, error))
-    {
-        return false;
-    }
+    JSValue tasksArray = arguments.Get(0);
+    JSValue concurrencyVal = arguments.Get(1);
     if (JSValue::GetType(concurrencyVal) != Type::T_SMALL_INT)
     {
         concurrencyVal = JSValue::FromSmallInt(std::thread::hardware_concurrency());
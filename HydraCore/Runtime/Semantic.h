@@ -15,6 +15,8 @@ namespace vm
 {
 struct IRInst;
 struct IRFunc;
+struct CallSiteCache;
+struct PropertyCacheSite;
 class Scope;
 }
 
@@ -38,6 +40,9 @@ bool NewObjectSafe(gc::ThreadAllocator &allocator, JSFunction *constructor, JSAr
 bool NewObject(gc::ThreadAllocator &allocator, JSValue constructor, JSArray *arguments, JSValue &retVal, JSValue &error);
 
 bool Call(gc::ThreadAllocator &allocator, JSValue callee, JSValue thisArg, JSArray *arguments, JSValue &retVal, JSValue &error);
+bool CallWithArgv(gc::ThreadAllocator &allocator, JSValue callee, JSValue thisArg, const ArgumentVector &arguments, JSValue &retVal, JSValue &error);
+bool CallWithCache(gc::ThreadAllocator &allocator, JSValue callee, JSValue thisArg, JSArray *arguments, JSValue &retVal, JSValue &error, vm::CallSiteCache *cache);
+bool CallWithArgvAndCache(gc::ThreadAllocator &allocator, JSValue callee, JSValue thisArg, const ArgumentVector *arguments, JSValue &retVal, JSValue &error, vm::CallSiteCache *cache);
 bool GetGlobal(gc::ThreadAllocator &allocator, String *name, JSValue &retVal, JSValue &error);
 bool SetGlobal(gc::ThreadAllocator &allocator, String *name, JSValue value, JSValue &error);
 
@@ -65,11 +70,13 @@ bool NewArray(gc::ThreadAllocator &allocator, T_iterator begin, T_iterator end,
 
 JSFunction *NewRootFunc(gc::ThreadAllocator &allocator, vm::IRFunc *func, JSValue thisArg);
 JSNativeFunction *NewNativeFunc(gc::ThreadAllocator &allocator, JSNativeFunction::Functor func);
+bool NewFunc(gc::ThreadAllocator &allocator, vm::Scope *scope, vm::IRFunc *func, RangeArray *captured, JSValue &retVal, JSValue &error);
 bool NewFuncWithInst(gc::ThreadAllocator &allocator, vm::Scope *scope, vm::IRInst *inst, JSValue &retVal, JSValue &error);
+bool NewArrow(gc::ThreadAllocator &allocator, vm::Scope *scope, vm::IRFunc *func, RangeArray *captured, JSValue &retVal, JSValue &error);
 bool NewArrowWithInst(gc::ThreadAllocator &allocator, vm::Scope *scope, vm::IRInst *inst, JSValue &retVal, JSValue &error);
 
-bool ObjectGetAndFixCache(gc::ThreadAllocator &allocator, JSValue object, JSValue key, void *fixup, JSValue &retVal, JSValue &error);
-bool ObjectSetAndFixCache(gc::ThreadAllocator &allocator, JSValue object, JSValue key, void *fixup, JSValue value, JSValue &error);
+bool ObjectGetAndFixCache(gc::ThreadAllocator &allocator, JSValue object, JSValue key, vm::PropertyCacheSite *site, JSValue &retVal, JSValue &error);
+bool ObjectSetAndFixCache(gc::ThreadAllocator &allocator, JSValue object, JSValue key, vm::PropertyCacheSite *site, JSValue value, JSValue &error);
 
 bool ObjectGet(gc::ThreadAllocator &allocator, JSValue object, JSValue key, JSValue &retVal, JSValue &error);
 bool ObjectGetSafeObject(gc::ThreadAllocator &allocator, JSObject *object, String *key, JSValue &retVal, JSValue &error);
@@ -111,7 +118,9 @@ bool OpIn(gc::ThreadAllocator &allocator, JSValue a, JSValue b, JSValue &retVal,
 bool OpInstanceOf(gc::ThreadAllocator &allocator, JSValue a, JSValue b, JSValue &retVal, JSValue &error);
 bool OpTypeOf(gc::ThreadAllocator &allocator, JSValue a, JSValue &retVal, JSValue &error);
 
-vm::Scope *NewScope(gc::ThreadAllocator &allocator, vm::Scope *upper, vm::IRInst *inst);
+vm::Scope *NewScopeWithInst(gc::ThreadAllocator &allocator, vm::Scope *upper, vm::IRInst *inst);
+vm::Scope *NewScope(gc::ThreadAllocator &allocator, vm::Scope *upper, size_t size, RangeArray *captured);
+vm::Scope *NewContext(gc::ThreadAllocator &allocator, vm::Scope *scope);
 
 bool ToBoolean(JSValue value);
 
@@ -0,0 +1,223 @@
+#include "AllocationProfiler.h"
+
+#include "HeapSnapshot.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <random>
+
+namespace hydra
+{
+namespace vm
+{
+
+AllocationProfiler::AllocationProfiler()
+    : Running(false), Interval(ALLOCATION_PROFILER_DEFAULT_INTERVAL), Samples(0)
+{
+    gc::Heap::GetInstance()->RegisterMarkedFunc(
+        [this](std::function<bool(gc::HeapObject *)> survives)
+        {
+            OnMarked(survives);
+        });
+}
+
+AllocationProfiler::~AllocationProfiler()
+{
+    Stop();
+}
+
+bool AllocationProfiler::Start(const std::string &path, size_t interval)
+{
+    if (interval == 0 || Running.exchange(true))
+    {
+        return false;
+    }
+
+    ++Profiler::FrameWalkers;
+
+    {
+        std::unique_lock<std::mutex> lck(Mutex);
+        Path = path;
+        Samples = 0;
+        Sites.clear();
+        Unresolved.clear();
+    }
+
+    Interval = interval;
+    gc::ThreadAllocator::Sampler = &AllocationProfiler::OnSample;
+
+    return true;
+}
+
+void AllocationProfiler::Stop()
+{
+    if (!Running.exchange(false))
+    {
+        return;
+    }
+
+    gc::ThreadAllocator::Sampler = nullptr;
+    --Profiler::FrameWalkers;
+
+    auto report = Collect();
+    {
+        std::unique_lock<std::mutex> lck(Mutex);
+        Sites.clear();
+        Unresolved.clear();
+    }
+
+    std::ofstream file(Path, std::ios::trunc);
+    report.Write(file);
+}
+
+AllocationProfiler::Report AllocationProfiler::Collect()
+{
+    std::unique_lock<std::mutex> lck(Mutex);
+
+    Report report;
+    report.Interval = Interval.load();
+    report.Samples = Samples;
+    report.Sites = Sites;
+    return report;
+}
+
+size_t AllocationProfiler::OnSample(gc::HeapObject *object, size_t size)
+{
+    auto profiler = GetInstance();
+    if (object)
+    {
+        profiler->Record(object, size);
+    }
+    return profiler->NextSample();
+}
+
+size_t AllocationProfiler::NextSample()
+{
+    static thread_local std::mt19937_64 engine { std::random_device()() };
+
+    std::exponential_distribution<double> distribution(1.0 / Interval.load(std::memory_order_relaxed));
+    return std::max<size_t>(1, static_cast<size_t>(distribution(engine)));
+}
+
+void AllocationProfiler::Record(gc::HeapObject *object, size_t size)
+{
+    // an allocation of size bytes is picked with this chance
+    double probability = 1 - std::exp(-static_cast<double>(size) / Interval.load(std::memory_order_relaxed));
+
+    std::vector<CompiledFunction *> frames;
+    for (auto frame = Profiler::ThreadFrame;
+        frame && frames.size() < PROFILER_MAX_DEPTH;
+        frame = frame->Caller)
+    {
+        frames.push_back(frame->Function);
+    }
+
+    std::string stack;
+    for (size_t i = frames.size(); i-- > 0;)
+    {
+        stack += Profiler::FrameName(frames[i]);
+        if (i)
+        {
+            stack += ";";
+        }
+    }
+
+    if (stack.empty())
+    {
+        stack = "[native]";
+    }
+
+    auto type = HeapSnapshot::TypeName(object);
+
+    std::unique_lock<std::mutex> lck(Mutex);
+    if (!Running.load())
+    {
+        return;
+    }
+
+    ++Samples;
+
+    auto &site = Sites[std::make_pair(type, stack)];
+    site.Count += 1 / probability;
+    site.Bytes += size / probability;
+    site.PendingBytes += size / probability;
+
+    Unresolved.push_back(Pending { object, &site, size / probability });
+}
+
+void AllocationProfiler::OnMarked(std::function<bool(gc::HeapObject *)> survives)
+{
+    std::unique_lock<std::mutex> lck(Mutex);
+
+    for (auto &pending : Unresolved)
+    {
+        pending.At->PendingBytes -= pending.Bytes;
+        if (survives(pending.Object))
+        {
+            pending.At->PromotedBytes += pending.Bytes;
+        }
+    }
+
+    Unresolved.clear();
+}
+
+static u64 Round(double value)
+{
+    return static_cast<u64>(std::llround(std::max(value, 0.0)));
+}
+
+void AllocationProfiler::Report::Write(std::ostream &out) const
+{
+    using Entry = std::map<std::pair<std::string, std::string>, Site>::const_iterator;
+
+    std::vector<Entry> ranked;
+    for (auto it = Sites.begin(); it != Sites.end(); ++it)
+    {
+        ranked.push_back(it);
+    }
+
+    auto writeSite = [&](Entry entry)
+    {
+        auto &site = entry->second;
+        out << Round(site.Bytes) << '\t'
+            << Round(site.Count) << '\t'
+            << Round(site.PromotedBytes) << '\t'
+            << Round(site.PendingBytes) << '\t'
+            << entry->first.first << '\t'
+            << entry->first.second << '\n';
+    };
+
+    out << "# hydra allocation profile, a sample every " << Interval
+        << " bytes on average, " << Samples << " samples" << '\n';
+
+    std::sort(ranked.begin(), ranked.end(), [](Entry a, Entry b)
+    {
+        return a->second.Bytes > b->second.Bytes;
+    });
+
+    out << '\n' << "[allocated] bytes count promoted pending type stack" << '\n';
+    for (auto entry : ranked)
+    {
+        writeSite(entry);
+    }
+
+    std::sort(ranked.begin(), ranked.end(), [](Entry a, Entry b)
+    {
+        return a->second.PromotedBytes > b->second.PromotedBytes;
+    });
+
+    out << '\n' << "[promoted] bytes count promoted pending type stack" << '\n';
+    for (auto entry : ranked)
+    {
+        if (Round(entry->second.PromotedBytes) == 0)
+        {
+            break;
+        }
+        writeSite(entry);
+    }
+}
+
+} // namespace vm
+} // namespace hydra
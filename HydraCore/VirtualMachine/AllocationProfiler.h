@@ -0,0 +1,93 @@
+#ifndef _ALLOCATION_PROFILER_H_
+#define _ALLOCATION_PROFILER_H_
+
+#include "Common/HydraCore.h"
+#include "Common/Singleton.h"
+#include "GarbageCollection/GC.h"
+
+#include "VMDefs.h"
+
+#include <atomic>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace hydra
+{
+namespace vm
+{
+
+// samples allocations about once every Interval bytes, the gaps drawn from
+// an exponential distribution so every byte is equally likely to be picked.
+// A sample keeps the C++ type and the JS stack of the allocating thread, and
+// whether the object survived the next collection. Numbers are estimates for
+// all allocations, each sample weighted by the inverse of its chance
+class AllocationProfiler : public Singleton<AllocationProfiler>
+{
+public:
+    struct Site
+    {
+        double Count = 0;
+        double Bytes = 0;
+
+        // survived the collection after their allocation
+        double PromotedBytes = 0;
+
+        // no collection has run since their allocation
+        double PendingBytes = 0;
+    };
+
+    struct Report
+    {
+        size_t Interval = 0;
+        size_t Samples = 0;
+
+        // by type, then collapsed JS stack "outer;inner;leaf"
+        std::map<std::pair<std::string, std::string>, Site> Sites;
+
+        // sites ranked by bytes allocated, then by bytes promoted
+        void Write(std::ostream &out) const;
+    };
+
+    AllocationProfiler();
+    ~AllocationProfiler();
+
+    // false if already running
+    bool Start(const std::string &path, size_t interval = ALLOCATION_PROFILER_DEFAULT_INTERVAL);
+
+    // stops sampling and writes the report
+    void Stop();
+
+    Report Collect();
+
+private:
+    struct Pending
+    {
+        gc::HeapObject *Object;
+        Site *At;
+        double Bytes;
+    };
+
+    static size_t OnSample(gc::HeapObject *object, size_t size);
+    size_t NextSample();
+    void Record(gc::HeapObject *object, size_t size);
+    void OnMarked(std::function<bool(gc::HeapObject *)> survives);
+
+    std::atomic<bool> Running;
+    std::atomic<size_t> Interval;
+    std::string Path;
+
+    std::mutex Mutex;
+    size_t Samples;
+    std::map<std::pair<std::string, std::string>, Site> Sites;
+    std::vector<Pending> Unresolved;
+};
+
+} // namespace vm
+} // namespace hydra
+
+#endif // _ALLOCATION_PROFILER_H_
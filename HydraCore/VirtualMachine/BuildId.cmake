@@ -0,0 +1,28 @@
+# writes OUTPUT defining HYDRA_BUILD_ID, the git revision of SOURCE_DIR or,
+# out of a checkout, the time of the build. OUTPUT is only touched when the
+# id changes, so an unchanged revision rebuilds nothing
+
+set(BUILD_ID "")
+
+find_package(Git QUIET)
+if (GIT_FOUND)
+    execute_process(
+        COMMAND ${GIT_EXECUTABLE} rev-parse HEAD
+        WORKING_DIRECTORY ${SOURCE_DIR}
+        OUTPUT_VARIABLE BUILD_ID
+        OUTPUT_STRIP_TRAILING_WHITESPACE
+        RESULT_VARIABLE GIT_RESULT
+        ERROR_QUIET)
+
+    if (NOT GIT_RESULT EQUAL 0)
+        set(BUILD_ID "")
+    endif()
+endif()
+
+if ("${BUILD_ID}" STREQUAL "")
+    string(TIMESTAMP BUILD_ID "%Y-%m-%dT%H:%M:%S" UTC)
+endif()
+
+file(WRITE ${OUTPUT}.tmp "#define HYDRA_BUILD_ID \"${BUILD_ID}\"\n")
+execute_process(COMMAND ${CMAKE_COMMAND} -E copy_if_different ${OUTPUT}.tmp ${OUTPUT})
+file(REMOVE ${OUTPUT}.tmp)
@@ -87,52 +87,130 @@ std::unique_ptr<IRModule> ByteCode::Load(gc::ThreadAllocator &allocator)
 {
     runtime::JSArray *strings = runtime::JSArray::New(allocator);
     std::unique_ptr<IRModule> ret(new IRModule(strings));
-    std::map<u32, runtime::String *> stringMap;
 
-    LoadStringPool(allocator, strings, stringMap);
+    hydra_assert(StringPoolOffset != 0,
+        "No string pool found");
 
     for (auto section : Sections)
     {
         if (section.first == FUNCTION)
         {
-            ret->Functions.emplace_back(LoadFunction(section.second, stringMap));
-            ret->Functions.back()->Module = ret.get();
+            ret->Functions.emplace_back(LoadFunctionHeader(ret.get(), section.second));
+            LoadFunction(allocator, ret->Functions.back().get(), section.second);
         }
     }
 
     return ret;
 }
 
-void ByteCode::LoadStringPool(
+std::unique_ptr<IRModule> ByteCode::LoadLazily(
     gc::ThreadAllocator &allocator,
-    runtime::JSArray *strings,
-    std::map<u32, runtime::String *> &stringMap)
+    std::unique_ptr<ByteCode> byteCode)
 {
-    hydra_assert(StringPoolOffset != 0,
+    runtime::JSArray *strings = runtime::JSArray::New(allocator);
+    std::unique_ptr<IRModule> ret(new IRModule(strings));
+
+    hydra_assert(byteCode->StringPoolOffset != 0,
         "No string pool found");
 
+    for (auto section : byteCode->Sections)
+    {
+        if (section.first == FUNCTION)
+        {
+            ret->Functions.emplace_back(byteCode->LoadFunctionHeader(ret.get(), section.second));
+            ret->Functions.back()->Materialized = false;
+            byteCode->Pending[ret->Functions.back().get()] = section.second;
+        }
+    }
+
+    ret->Source = std::move(byteCode);
+
+    // the entry runs right away, everything else waits for its FUNC or ARROW
+    if (!ret->Functions.empty())
+    {
+        ret->Materialize(allocator, ret->Functions.front().get());
+    }
+
+    return ret;
+}
+
+void ByteCode::Materialize(gc::ThreadAllocator &allocator, IRFunc *func)
+{
+    auto iter = Pending.find(func);
+    hydra_assert(iter != Pending.end(),
+        "func must be pending");
+
+    auto section = iter->second;
+    Pending.erase(iter);
+
+    LoadFunction(allocator, func, section);
+}
+
+u32 ByteCode::GetSectionOffset(ByteCodeSectionType type) const
+{
+    for (auto &section : Sections)
+    {
+        if (section.first == type)
+        {
+            return section.second;
+        }
+    }
+    return 0;
+}
+
+runtime::String *ByteCode::GetString(gc::ThreadAllocator &allocator, IRModule *module, u32 offset)
+{
+    auto iter = StringMap.find(offset);
+    if (iter != StringMap.end())
+    {
+        return iter->second;
+    }
+
     SectionReader reader(this, StringPoolOffset);
+    reader.Skip(offset);
 
     u32 length;
+    u32 current;
     std::pair<const char_t *, const char_t *> range;
 
-    u32 current;
-    while (reader.String(length, current, range))
-    {
-        runtime::String *str = runtime::String::New(allocator, range.first, range.second);
-        stringMap[current] = str;
-        strings->Set(allocator, strings->GetLength(), runtime::JSValue::FromString(str));
-    }
+    auto result = reader.String(length, current, range);
+    hydra_assert(result && current == offset,
+        "Invalid string reference");
+
+    runtime::String *str = runtime::String::New(allocator, range.first, range.second);
+    StringMap[offset] = str;
+
+    auto strings = module->StringsReferenced;
+    strings->Set(allocator, strings->GetLength(), runtime::JSValue::FromString(str));
+
+    return str;
 }
 
-std::unique_ptr<IRFunc> ByteCode::LoadFunction(
-    size_t section,
-    std::map<u32, runtime::String *> &stringMap)
+std::unique_ptr<IRFunc> ByteCode::LoadFunctionHeader(IRModule *module, size_t section)
+{
+    SectionReader reader(this, section);
+
+    u32 funcName;
+    auto result = reader.Uint(funcName);
+    hydra_assert(result, "Error on reading function name");
+
+    u32 length;
+    result = reader.Uint(length);
+    hydra_assert(result, "Error on reading function length");
+
+    std::unique_ptr<IRFunc> ret(new IRFunc(module, nullptr, length));
+    return ret;
+}
+
+void ByteCode::LoadFunction(gc::ThreadAllocator &allocator, IRFunc *func, size_t section)
 {
     std::vector<IRInst *> insts;
     std::vector<IRBlock *> blocks;
     bool result;
-    std::unique_ptr<IRFunc> ret;
+    IRFunc *ret = func;
+
+    hydra_assert(ret->Blocks.empty(),
+        "Function is loaded only once");
 
 #pragma region FIRST_SCAN
     {
@@ -141,15 +219,12 @@ std::unique_ptr<IRFunc> ByteCode::LoadFunction(
         result = reader.Uint(funcName);
         hydra_assert(result, "Error on reading function name");
 
-        runtime::String *name = stringMap[funcName];
-        hydra_assert(name != nullptr, "Invalid function name");
+        ret->Name = GetString(allocator, ret->Module, funcName);
 
         u32 length;
         result = reader.Uint(length);
         hydra_assert(result, "Error on reading function length");
 
-        ret.reset(new IRFunc(nullptr, stringMap[funcName], length));
-
         u32 blockCount;
         result = reader.Uint(blockCount);
         hydra_assert(result, "Error on reading block count");
@@ -353,7 +428,7 @@ std::unique_ptr<IRFunc> ByteCode::LoadFunction(
 #define LoadRegister(_type, _member)    \
     { reader.Uint(other); As(_type)->_member = insts[other]; }
 #define LoadHydraString(_type, _member)      \
-    { reader.Uint(other), As(_type)->_member = stringMap[other]; }
+    { reader.Uint(other), As(_type)->_member = GetString(allocator, ret->Module, other); }
 #define LoadDouble(_type, _member)      \
     { reader.Double(As(_type)->_member); }
 #define LoadSizeT(_type, _member)       \
@@ -604,8 +679,6 @@ std::unique_ptr<IRFunc> ByteCode::LoadFunction(
         }
     }
 #pragma endregion SECOND_SCAN
-
-    return ret;
 }
 
 } // namespace vm
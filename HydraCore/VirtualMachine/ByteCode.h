@@ -20,7 +20,8 @@ namespace vm
 enum ByteCodeSectionType
 {
     FUNCTION = 0,
-    STRING_POOL = 1
+    STRING_POOL = 1,
+    CACHE_INFO = 2
 };
 
 class SectionReader;
@@ -37,24 +38,42 @@ public:
         return reinterpret_cast<T*>(reinterpret_cast<uintptr_t>(view) + offset);
     }
 
+    // builds every function up front
     std::unique_ptr<IRModule> Load(gc::ThreadAllocator &allocator);
 
+    // builds only the entry function, the module keeps byteCode and builds
+    // the others on their first instantiation, see IRModule::Materialize
+    static std::unique_ptr<IRModule> LoadLazily(
+        gc::ThreadAllocator &allocator,
+        std::unique_ptr<ByteCode> byteCode);
+
+    // reads the body of a function left out by LoadLazily
+    void Materialize(gc::ThreadAllocator &allocator, IRFunc *func);
+
+    // offset of the first section of type, 0 if there is none
+    u32 GetSectionOffset(ByteCodeSectionType type) const;
+
     static constexpr u32 MAGIC_WORD = 0x52495948;   // 'H', 'Y', 'I', 'R'
 
 private:
     bool ParseHeader();
 
-    void LoadStringPool(gc::ThreadAllocator &allocator,
-        runtime::JSArray *strings,
-        std::map<u32, runtime::String *> &stringMap);
+    // a function without its body, its name is read along with the blocks
+    std::unique_ptr<IRFunc> LoadFunctionHeader(IRModule *module, size_t section);
 
-    std::unique_ptr<IRFunc> LoadFunction(
-        size_t section,
-        std::map<u32, runtime::String *> &stringMap);
+    void LoadFunction(gc::ThreadAllocator &allocator, IRFunc *func, size_t section);
+
+    // strings of the pool are created on their first reference
+    runtime::String *GetString(gc::ThreadAllocator &allocator, IRModule *module, u32 offset);
 
     platform::MappedFile FileMapping;
     std::vector<std::pair<u32, u32>> Sections;
     u32 StringPoolOffset;
+
+    std::map<u32, runtime::String *> StringMap;
+
+    // sections of the functions not materialized yet
+    std::map<IRFunc *, u32> Pending;
 };
 
 class SectionReader
@@ -117,6 +136,11 @@ public:
         return true;
     }
 
+    inline void Skip(size_t size)
+    {
+        Offset += size;
+    }
+
     inline size_t Current() const
     {
         return Offset - Start;
@@ -0,0 +1,891 @@
+#include "CodeCache.h"
+
+#include "ByteCode.h"
+#include "IRInsts.h"
+#include "Optimizer.h"
+
+#include "Common/Logger.h"
+#include "Common/Platform.h"
+
+#include "BuildId.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <random>
+#include <set>
+
+#pragma push_macro("NULL")
+#pragma push_macro("TRUE")
+#pragma push_macro("FALSE")
+#pragma push_macro("IN")
+#pragma push_macro("THIS")
+
+#ifdef NULL
+#undef NULL
+#endif
+
+#ifdef TRUE
+#undef TRUE
+#endif
+
+#ifdef FALSE
+#undef FALSE
+#endif
+
+#ifdef IN
+#undef IN
+#endif
+
+#ifdef THIS
+#undef THIS
+#endif
+
+namespace hydra
+{
+namespace vm
+{
+
+// a cache written by another build of the engine is never picked up, the id
+// is generated by BuildId.cmake
+static const char BUILD_ID[] = HYDRA_BUILD_ID;
+
+std::atomic<bool> CodeCache::Enabled { true };
+
+static constexpr u32 CACHE_FUNCTION_OPTIMIZED = 1;
+
+// CACHE_INFO is the key, the checksum and the function count, then the flags
+// of each function
+static constexpr size_t CACHE_INFO_HEADER_WORDS = 5;
+
+static constexpr u64 FNV_OFFSET_BASIS = 14695981039346656037ull;
+static constexpr u64 FNV_PRIME = 1099511628211ull;
+
+static u64 Fnv1a(const char *data, size_t size, u64 hash = FNV_OFFSET_BASIS)
+{
+    for (size_t i = 0; i < size; ++i)
+    {
+        hash ^= static_cast<u8>(data[i]);
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+std::string CodeCache::CachePath(const std::string &byteCodePath)
+{
+    return byteCodePath + ".cache";
+}
+
+u64 CodeCache::Key(const std::string &byteCodePath)
+{
+    u64 hash = Fnv1a(BUILD_ID, sizeof(BUILD_ID));
+    hash = Fnv1a(reinterpret_cast<const char *>(&CODE_CACHE_VERSION), sizeof(CODE_CACHE_VERSION), hash);
+
+    std::ifstream file(byteCodePath, std::ios::binary);
+    char buffer[4096];
+    while (file.read(buffer, sizeof(buffer)) || file.gcount())
+    {
+        hash = Fnv1a(buffer, static_cast<size_t>(file.gcount()), hash);
+    }
+
+    return hash;
+}
+
+std::unique_ptr<IRModule> CodeCache::Load(
+    gc::ThreadAllocator &allocator,
+    const std::string &byteCodePath,
+    u64 key)
+{
+    if (!IsEnabled())
+    {
+        return nullptr;
+    }
+
+    auto cachePath = CachePath(byteCodePath);
+    std::ifstream file(cachePath, std::ios::binary | std::ios::ate);
+    if (!file)
+    {
+        return nullptr;
+    }
+
+    auto perfSession = Logger::GetInstance()->Perf("LoadCodeCache");
+
+    // the bytecode loader trusts its input, so the whole file is checked
+    // before it gets to see it
+    std::vector<u32> words(static_cast<size_t>(file.tellg()) / sizeof(u32));
+    file.seekg(0);
+    file.read(reinterpret_cast<char *>(words.data()), words.size() * sizeof(u32));
+    if (!file || file.peek() != std::ifstream::traits_type::eof())
+    {
+        return Reject(cachePath, "truncated or not a whole number of words");
+    }
+    file.close();
+
+    Layout layout;
+    if (auto reason = CheckLayout(words, layout))
+    {
+        return Reject(cachePath, reason);
+    }
+
+    auto info = &words[layout.InfoOffset / sizeof(u32) + 1];
+    if (((static_cast<u64>(info[1]) << 32) | info[0]) != key)
+    {
+        // written for another bytecode or build, Store replaces it
+        return nullptr;
+    }
+
+    auto checksum = Fnv1a(reinterpret_cast<const char *>(words.data()), layout.InfoOffset);
+    if (((static_cast<u64>(info[3]) << 32) | info[2]) != checksum)
+    {
+        return Reject(cachePath, "checksum mismatch");
+    }
+
+    if (auto reason = CheckFunctions(words, layout))
+    {
+        return Reject(cachePath, reason);
+    }
+
+    ByteCode byteCode(cachePath);
+    auto module = byteCode.Load(allocator);
+    if (module->Functions.size() != layout.Functions.size())
+    {
+        // replaced by another writer since it was checked
+        return nullptr;
+    }
+
+    auto flags = info + CACHE_INFO_HEADER_WORDS;
+    for (auto &func : module->Functions)
+    {
+        if (*flags++ & CACHE_FUNCTION_OPTIMIZED)
+        {
+            // only the IR itself is stored, what the analyses derive from it is not
+            Optimizer::Reanalyze(func.get());
+            func->InitialOptimized = true;
+        }
+    }
+
+    return module;
+}
+
+bool CodeCache::Store(IRModule *module, const std::string &byteCodePath, u64 key)
+{
+    if (!IsEnabled())
+    {
+        return false;
+    }
+
+    auto perfSession = Logger::GetInstance()->Perf("StoreCodeCache");
+
+    // the string pool of the module, every string the IR refers to comes from it
+    std::vector<u32> stringPool;
+    std::map<runtime::String *, u32> stringOffsets;
+
+    auto strings = module->StringsReferenced;
+    for (size_t i = 0; i < strings->GetLength(); ++i)
+    {
+        runtime::JSValue value;
+        runtime::JSObjectPropertyAttribute attribute;
+        if (!strings->Get(i, value, attribute))
+        {
+            continue;
+        }
+
+        auto str = value.String();
+        auto length = str->length();
+
+        stringOffsets[str] = static_cast<u32>(stringPool.size() * sizeof(u32));
+        stringPool.push_back(static_cast<u32>(length));
+
+        for (size_t j = 0; j < length; j += 2)
+        {
+            u32 word = static_cast<u16>(str->at(j));
+            if (j + 1 < length)
+            {
+                word |= static_cast<u32>(static_cast<u16>(str->at(j + 1))) << 16;
+            }
+            stringPool.push_back(word);
+        }
+    }
+
+    std::vector<std::vector<u32>> functions;
+    std::vector<u32> info = {
+        static_cast<u32>(key),
+        static_cast<u32>(key >> 32),
+        0,
+        0,
+        static_cast<u32>(module->Functions.size())
+    };
+
+    for (auto &func : module->Functions)
+    {
+        std::lock_guard<std::mutex> lock(func->IRMutex);
+
+        functions.emplace_back();
+        if (!SerializeFunction(func.get(), stringOffsets, functions.back()))
+        {
+            return false;
+        }
+        info.push_back(func->InitialOptimized ? CACHE_FUNCTION_OPTIMIZED : 0);
+    }
+
+    std::vector<std::pair<u32, const std::vector<u32> *>> sections;
+    sections.emplace_back(ByteCodeSectionType::STRING_POOL, &stringPool);
+    for (auto &function : functions)
+    {
+        sections.emplace_back(ByteCodeSectionType::FUNCTION, &function);
+    }
+    sections.emplace_back(ByteCodeSectionType::CACHE_INFO, &info);
+
+    // every section, the header included, starts with its size in bytes
+    std::vector<u32> header = {
+        ByteCode::MAGIC_WORD,
+        static_cast<u32>(sections.size())
+    };
+
+    u32 offset = static_cast<u32>((1 + 2 + 2 * sections.size()) * sizeof(u32));
+    for (auto &section : sections)
+    {
+        header.push_back(section.first);
+        header.push_back(offset);
+        offset += static_cast<u32>((1 + section.second->size()) * sizeof(u32));
+    }
+
+    // the checksum covers everything in front of CACHE_INFO, the last section
+    u64 checksum = FNV_OFFSET_BASIS;
+    auto hash = [&](const std::vector<u32> &words)
+    {
+        u32 size = static_cast<u32>(words.size() * sizeof(u32));
+        checksum = Fnv1a(reinterpret_cast<const char *>(&size), sizeof(size), checksum);
+        checksum = Fnv1a(reinterpret_cast<const char *>(words.data()), size, checksum);
+    };
+
+    hash(header);
+    for (size_t i = 0; i + 1 < sections.size(); ++i)
+    {
+        hash(*sections[i].second);
+    }
+    info[2] = static_cast<u32>(checksum);
+    info[3] = static_cast<u32>(checksum >> 32);
+
+    // written aside and renamed, so a reader never sees half a cache. The name
+    // is unique to the writer, processes storing the same module at once each
+    // write their own file and the last rename wins
+    auto cachePath = CachePath(byteCodePath);
+    auto tempPath = cachePath + "." +
+        std::to_string(platform::CurrentProcessId()) + "." +
+        std::to_string(std::random_device()()) + ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        if (!file)
+        {
+            return false;
+        }
+
+        auto write = [&](const std::vector<u32> &words)
+        {
+            u32 size = static_cast<u32>(words.size() * sizeof(u32));
+            file.write(reinterpret_cast<const char *>(&size), sizeof(size));
+            file.write(reinterpret_cast<const char *>(words.data()), size);
+        };
+
+        write(header);
+        for (auto &section : sections)
+        {
+            write(*section.second);
+        }
+
+        if (!file)
+        {
+            file.close();
+            std::remove(tempPath.c_str());
+            return false;
+        }
+    }
+
+    std::remove(cachePath.c_str());
+    if (std::rename(tempPath.c_str(), cachePath.c_str()) != 0)
+    {
+        std::remove(tempPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+std::unique_ptr<IRModule> CodeCache::Reject(const std::string &cachePath, const char *reason)
+{
+    // the caller loads the bytecode instead, and Store writes a new cache
+    hydra_log_warn("Code cache rejected: {}", reason);
+    std::remove(cachePath.c_str());
+    return nullptr;
+}
+
+const char *CodeCache::CheckLayout(const std::vector<u32> &words, Layout &layout)
+{
+    if (words.size() < 3 || words[1] != ByteCode::MAGIC_WORD)
+    {
+        return "no header";
+    }
+
+    auto sectionCount = static_cast<size_t>(words[2]);
+    if (words[0] != (2 + 2 * sectionCount) * sizeof(u32) ||
+        sectionCount > (words.size() - 3) / 2)
+    {
+        return "section count out of bounds";
+    }
+
+    std::vector<std::pair<u32, u32>> ranges;
+    for (size_t i = 0; i < sectionCount; ++i)
+    {
+        auto type = words[3 + 2 * i];
+        auto offset = words[3 + 2 * i + 1];
+        if (offset % sizeof(u32) || offset / sizeof(u32) >= words.size())
+        {
+            return "section offset out of bounds";
+        }
+
+        auto size = words[offset / sizeof(u32)];
+        if (size % sizeof(u32) || size / sizeof(u32) > words.size() - offset / sizeof(u32) - 1)
+        {
+            return "section size out of bounds";
+        }
+
+        switch (type)
+        {
+        case ByteCodeSectionType::FUNCTION:
+            layout.Functions.push_back(offset);
+            break;
+        case ByteCodeSectionType::STRING_POOL:
+            if (layout.StringPoolOffset)
+            {
+                return "two string pools";
+            }
+            layout.StringPoolOffset = offset;
+            break;
+        case ByteCodeSectionType::CACHE_INFO:
+            if (layout.InfoOffset)
+            {
+                return "two cache infos";
+            }
+            layout.InfoOffset = offset;
+            break;
+        default:
+            return "unknown section";
+        }
+
+        ranges.emplace_back(offset, offset + static_cast<u32>(sizeof(u32)) + size);
+    }
+
+    if (!layout.StringPoolOffset || !layout.InfoOffset)
+    {
+        return "missing section";
+    }
+
+    // the checksum covers everything in front of CACHE_INFO, nothing may follow it
+    for (auto &range : ranges)
+    {
+        if (range.first != layout.InfoOffset && range.second > layout.InfoOffset)
+        {
+            return "section after cache info";
+        }
+
+        if (range.first == layout.InfoOffset && range.second != words.size() * sizeof(u32))
+        {
+            return "data after cache info";
+        }
+    }
+
+    auto infoSize = words[layout.InfoOffset / sizeof(u32)] / sizeof(u32);
+    if (infoSize < CACHE_INFO_HEADER_WORDS ||
+        words[layout.InfoOffset / sizeof(u32) + CACHE_INFO_HEADER_WORDS] != layout.Functions.size() ||
+        infoSize != CACHE_INFO_HEADER_WORDS + layout.Functions.size())
+    {
+        return "function count mismatch";
+    }
+
+    return nullptr;
+}
+
+const char *CodeCache::CheckFunctions(const std::vector<u32> &words, const Layout &layout)
+{
+    // offsets of the strings in the pool, as the functions refer to them
+    std::set<u32> strings;
+    {
+        auto begin = layout.StringPoolOffset / sizeof(u32) + 1;
+        auto end = begin + words[layout.StringPoolOffset / sizeof(u32)] / sizeof(u32);
+        for (auto index = begin; index < end; )
+        {
+            strings.insert(static_cast<u32>((index - begin) * sizeof(u32)));
+
+            // two characters to a word
+            auto length = static_cast<size_t>(words[index]);
+            if ((length + 1) / 2 > end - index - 1)
+            {
+                return "string out of bounds";
+            }
+            index += 1 + (length + 1) / 2;
+        }
+    }
+
+    for (auto offset : layout.Functions)
+    {
+        auto index = offset / sizeof(u32) + 1;
+        auto end = index + words[offset / sizeof(u32)] / sizeof(u32);
+
+        bool valid = true;
+        auto read = [&]() -> u32
+        {
+            if (index >= end)
+            {
+                valid = false;
+                return 0;
+            }
+            return words[index++];
+        };
+
+        // refs may point forward, they are checked once every inst is known
+        std::vector<u32> refs;
+        std::vector<u32> blockRefs;
+        std::set<u32> terminators;
+
+        auto readRefs = [&](size_t count)
+        {
+            while (valid && count--)
+            {
+                refs.push_back(read());
+            }
+        };
+
+        auto readString = [&]()
+        {
+            if (!strings.count(read()))
+            {
+                valid = false;
+            }
+        };
+
+        auto readFunc = [&]()
+        {
+            if (read() >= layout.Functions.size())
+            {
+                valid = false;
+            }
+        };
+
+        readString();
+        read();
+
+        u32 instIndex = 0;
+        u32 blockCount = read();
+        for (u32 block = 0; valid && block < blockCount; ++block)
+        {
+            bool terminated = false;
+            u32 instCount = read();
+            for (u32 i = 0; valid && i < instCount; ++i, ++instIndex)
+            {
+                if (terminated)
+                {
+                    return "instruction after a jump";
+                }
+
+                switch (read())
+                {
+                case UNDEFINED:
+                case NULL:
+                case TRUE:
+                case FALSE:
+                case POP_SCOPE:
+                case ALLOCA:
+                case THIS:
+                case ARGUMENTS:
+                case DEBUGGER:
+                    break;
+                case RETURN:
+                case LOAD:
+                case BNOT:
+                case LNOT:
+                case TYPEOF:
+                case MOVE:
+                    readRefs(1);
+                    break;
+                case STORE:
+                case GET_ITEM:
+                case DEL_ITEM:
+                case NEW:
+                case ADD:
+                case SUB:
+                case MUL:
+                case DIV:
+                case MOD:
+                case BAND:
+                case BOR:
+                case BXOR:
+                case SLL:
+                case SRL:
+                case SRR:
+                case EQ:
+                case EQQ:
+                case NE:
+                case NEE:
+                case GT:
+                case GE:
+                case LT:
+                case LE:
+                case IN:
+                case INSTANCEOF:
+                    readRefs(2);
+                    break;
+                case SET_ITEM:
+                case CALL:
+                    readRefs(3);
+                    break;
+                case GET_GLOBAL:
+                case STRING:
+                    readString();
+                    break;
+                case SET_GLOBAL:
+                    readString();
+                    readRefs(1);
+                    break;
+                case NUMBER:
+                    read();
+                    read();
+                    break;
+                case ARG:
+                case CAPTURE:
+                    read();
+                    break;
+                case OBJECT:
+                    readRefs(2 * static_cast<size_t>(read()));
+                    break;
+                case ARRAY:
+                    readRefs(read());
+                    break;
+                case FUNC:
+                case ARROW:
+                    readFunc();
+                    readRefs(read());
+                    break;
+                case PUSH_SCOPE:
+                    read();
+                    readRefs(read());
+                    break;
+                case PHI:
+                    for (u32 count = read(); valid && count; --count)
+                    {
+                        blockRefs.push_back(read());
+                        readRefs(1);
+                    }
+                    break;
+                case JUMP:
+                    blockRefs.push_back(read());
+                    terminators.insert(instIndex);
+                    terminated = true;
+                    break;
+                case BRANCH:
+                    readRefs(1);
+                    blockRefs.push_back(read());
+                    blockRefs.push_back(read());
+                    terminators.insert(instIndex);
+                    terminated = true;
+                    break;
+                default:
+                    return "unknown instruction";
+                }
+            }
+        }
+
+        if (!valid)
+        {
+            return "function out of bounds";
+        }
+
+        // jumps take an index of their own, but are nothing to refer to
+        for (auto ref : refs)
+        {
+            if (ref >= instIndex || terminators.count(ref))
+            {
+                return "reference out of bounds";
+            }
+        }
+
+        for (auto ref : blockRefs)
+        {
+            if (ref >= blockCount)
+            {
+                return "block out of bounds";
+            }
+        }
+    }
+
+    return nullptr;
+}
+
+size_t CodeCache::OptimizedCount(IRModule *module)
+{
+    size_t count = 0;
+    for (auto &func : module->Functions)
+    {
+        std::lock_guard<std::mutex> lock(func->IRMutex);
+        if (func->InitialOptimized)
+        {
+            ++count;
+        }
+    }
+    return count;
+}
+
+bool CodeCache::SerializeFunction(
+    IRFunc *func,
+    const std::map<runtime::String *, u32> &stringOffsets,
+    std::vector<u32> &out)
+{
+    // jumps and branches take an inst index of their own, as in the bytecode
+    std::map<IRInst *, u32> instIndices;
+    std::map<IRBlock *, u32> blockIndices;
+
+    u32 instIndex = 0;
+    for (auto &block : func->Blocks)
+    {
+        blockIndices[block.get()] = static_cast<u32>(blockIndices.size());
+        for (auto &inst : block->Insts)
+        {
+            instIndices[inst.get()] = instIndex++;
+        }
+
+        if (block->Consequent)
+        {
+            ++instIndex;
+        }
+    }
+
+    bool valid = true;
+
+    auto writeRef = [&](const IRInst::Ref &ref)
+    {
+        auto iter = instIndices.find(ref.Get());
+        if (iter == instIndices.end())
+        {
+            valid = false;
+            out.push_back(0);
+            return;
+        }
+        out.push_back(iter->second);
+    };
+
+    auto writeBlock = [&](const IRBlock::Ref &ref)
+    {
+        auto iter = blockIndices.find(ref.Get());
+        if (iter == blockIndices.end())
+        {
+            valid = false;
+            out.push_back(0);
+            return;
+        }
+        out.push_back(iter->second);
+    };
+
+    auto writeString = [&](runtime::String *str)
+    {
+        auto iter = stringOffsets.find(str);
+        if (iter == stringOffsets.end())
+        {
+            valid = false;
+            out.push_back(0);
+            return;
+        }
+        out.push_back(iter->second);
+    };
+
+    writeString(func->Name);
+    out.push_back(static_cast<u32>(func->Length));
+    out.push_back(static_cast<u32>(func->Blocks.size()));
+
+    for (auto &block : func->Blocks)
+    {
+        out.push_back(static_cast<u32>(block->Insts.size() + (block->Consequent ? 1 : 0)));
+
+        for (auto &inst : block->Insts)
+        {
+            out.push_back(static_cast<u32>(inst->GetType()));
+
+            switch (inst->GetType())
+            {
+            case RETURN:
+                writeRef(inst->As<ir::Return>()->_Value);
+                break;
+            case LOAD:
+                writeRef(inst->As<ir::Load>()->_Addr);
+                break;
+            case STORE:
+                writeRef(inst->As<ir::Store>()->_Addr);
+                writeRef(inst->As<ir::Store>()->_Value);
+                break;
+            case GET_ITEM:
+                writeRef(inst->As<ir::GetItem>()->_Obj);
+                writeRef(inst->As<ir::GetItem>()->_Key);
+                break;
+            case SET_ITEM:
+                writeRef(inst->As<ir::SetItem>()->_Obj);
+                writeRef(inst->As<ir::SetItem>()->_Key);
+                writeRef(inst->As<ir::SetItem>()->_Value);
+                break;
+            case DEL_ITEM:
+                writeRef(inst->As<ir::DelItem>()->_Obj);
+                writeRef(inst->As<ir::DelItem>()->_Key);
+                break;
+            case NEW:
+                writeRef(inst->As<ir::New>()->_Callee);
+                writeRef(inst->As<ir::New>()->_Args);
+                break;
+            case CALL:
+                writeRef(inst->As<ir::Call>()->_Callee);
+                writeRef(inst->As<ir::Call>()->_ThisArg);
+                writeRef(inst->As<ir::Call>()->_Args);
+                break;
+            case GET_GLOBAL:
+                writeString(inst->As<ir::GetGlobal>()->Name);
+                break;
+            case SET_GLOBAL:
+                writeString(inst->As<ir::SetGlobal>()->Name);
+                writeRef(inst->As<ir::SetGlobal>()->_Value);
+                break;
+            case UNDEFINED:
+            case NULL:
+            case TRUE:
+            case FALSE:
+                break;
+            case NUMBER:
+            {
+                u32 words[2];
+                std::memcpy(words, &inst->As<ir::Number>()->Value, sizeof(words));
+                out.push_back(words[0]);
+                out.push_back(words[1]);
+                break;
+            }
+            case STRING:
+                writeString(inst->As<ir::String>()->Value);
+                break;
+            case OBJECT:
+                out.push_back(static_cast<u32>(inst->As<ir::Object>()->Initialization.size()));
+                for (auto &pair : inst->As<ir::Object>()->Initialization)
+                {
+                    writeRef(pair.first);
+                    writeRef(pair.second);
+                }
+                break;
+            case ARRAY:
+                out.push_back(static_cast<u32>(inst->As<ir::Array>()->Initialization.size()));
+                for (auto &ref : inst->As<ir::Array>()->Initialization)
+                {
+                    writeRef(ref);
+                }
+                break;
+            case FUNC:
+                out.push_back(static_cast<u32>(inst->As<ir::Func>()->FuncId));
+                out.push_back(static_cast<u32>(inst->As<ir::Func>()->Captured.size()));
+                for (auto &ref : inst->As<ir::Func>()->Captured)
+                {
+                    writeRef(ref);
+                }
+                break;
+            case ARROW:
+                out.push_back(static_cast<u32>(inst->As<ir::Arrow>()->FuncId));
+                out.push_back(static_cast<u32>(inst->As<ir::Arrow>()->Captured.size()));
+                for (auto &ref : inst->As<ir::Arrow>()->Captured)
+                {
+                    writeRef(ref);
+                }
+                break;
+            case ADD:
+            case SUB:
+            case MUL:
+            case DIV:
+            case MOD:
+            case BAND:
+            case BOR:
+            case BXOR:
+            case SLL:
+            case SRL:
+            case SRR:
+            case EQ:
+            case EQQ:
+            case NE:
+            case NEE:
+            case GT:
+            case GE:
+            case LT:
+            case LE:
+            case IN:
+            case INSTANCEOF:
+                writeRef(inst->As<ir::Binary>()->_A);
+                writeRef(inst->As<ir::Binary>()->_B);
+                break;
+            case BNOT:
+            case LNOT:
+            case TYPEOF:
+                writeRef(inst->As<ir::Unary>()->_A);
+                break;
+            case PUSH_SCOPE:
+                out.push_back(static_cast<u32>(inst->As<ir::PushScope>()->Size));
+                out.push_back(static_cast<u32>(inst->As<ir::PushScope>()->Captured.size()));
+                for (auto &ref : inst->As<ir::PushScope>()->Captured)
+                {
+                    writeRef(ref);
+                }
+                break;
+            case POP_SCOPE:
+            case ALLOCA:
+                break;
+            case ARG:
+                out.push_back(static_cast<u32>(inst->As<ir::Arg>()->Index));
+                break;
+            case CAPTURE:
+                out.push_back(static_cast<u32>(inst->As<ir::Capture>()->Index));
+                break;
+            case THIS:
+            case ARGUMENTS:
+                break;
+            case MOVE:
+                writeRef(inst->As<ir::Move>()->_Other);
+                break;
+            case PHI:
+                out.push_back(static_cast<u32>(inst->As<ir::Phi>()->Branches.size()));
+                for (auto &branch : inst->As<ir::Phi>()->Branches)
+                {
+                    writeBlock(branch.first);
+                    writeRef(branch.second);
+                }
+                break;
+            case DEBUGGER:
+                break;
+            default:
+                return false;
+            }
+        }
+
+        if (block->Condition)
+        {
+            out.push_back(static_cast<u32>(BRANCH));
+            writeRef(block->Condition);
+            writeBlock(block->Consequent);
+            writeBlock(block->Alternate);
+        }
+        else if (block->Consequent)
+        {
+            out.push_back(static_cast<u32>(JUMP));
+            writeBlock(block->Consequent);
+        }
+    }
+
+    return valid;
+}
+
+} // namespace vm
+} // namespace hydra
+
+#pragma pop_macro("THIS")
+#pragma pop_macro("IN")
+#pragma pop_macro("FALSE")
+#pragma pop_macro("TRUE")
+#pragma pop_macro("NULL")
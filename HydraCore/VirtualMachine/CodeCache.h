@@ -0,0 +1,88 @@
+#ifndef _CODE_CACHE_H_
+#define _CODE_CACHE_H_
+
+#include "Common/HydraCore.h"
+
+#include "GarbageCollection/GC.h"
+
+#include "IR.h"
+#include "VMDefs.h"
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace hydra
+{
+namespace vm
+{
+
+// keeps the IR of a module next to its bytecode as <bytecode>.cache, in the
+// bytecode format plus a CACHE_INFO section. Functions already through
+// Optimizer::InitialOptimize are stored optimized, so a warm start goes
+// straight to code generation for them. Machine code is not cached: it loads
+// the addresses of IR, caches, klasses and runtime helpers of this process
+// as immediates, none of which a later run has at the same place
+class CodeCache
+{
+public:
+    static std::string CachePath(const std::string &byteCodePath);
+
+    // identifies the bytecode and the engine build that produced a cache
+    static u64 Key(const std::string &byteCodePath);
+
+    // nullptr if there is no cache for key. A cache that is truncated, fails
+    // its checksum or refers out of its bounds is deleted and nullptr too, the
+    // module is then compiled from the bytecode again
+    static std::unique_ptr<IRModule> Load(
+        gc::ThreadAllocator &allocator,
+        const std::string &byteCodePath,
+        u64 key);
+
+    // false if the module holds IR the bytecode format can not express, or
+    // the cache is disabled
+    static bool Store(IRModule *module, const std::string &byteCodePath, u64 key);
+
+    static size_t OptimizedCount(IRModule *module);
+
+    // while disabled Load always misses and Store writes nothing, for runs
+    // that must not depend on an earlier one
+    inline static void SetEnabled(bool enabled)
+    {
+        Enabled.store(enabled);
+    }
+
+    inline static bool IsEnabled()
+    {
+        return Enabled.load(std::memory_order_relaxed);
+    }
+
+private:
+    static std::atomic<bool> Enabled;
+
+    // byte offsets of the sections of a cache file
+    struct Layout
+    {
+        u32 StringPoolOffset = 0;
+        u32 InfoOffset = 0;
+        std::vector<u32> Functions;
+    };
+
+    static std::unique_ptr<IRModule> Reject(const std::string &cachePath, const char *reason);
+
+    // each returns why words are rejected, nullptr if they pass
+    static const char *CheckLayout(const std::vector<u32> &words, Layout &layout);
+    static const char *CheckFunctions(const std::vector<u32> &words, const Layout &layout);
+
+    static bool SerializeFunction(
+        IRFunc *func,
+        const std::map<runtime::String *, u32> &stringOffsets,
+        std::vector<u32> &out);
+};
+
+} // namespace vm
+} // namespace hydra
+
+#endif // _CODE_CACHE_H_
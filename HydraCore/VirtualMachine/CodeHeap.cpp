@@ -0,0 +1,164 @@
+#include "CodeHeap.h"
+#include "JitSymbols.h"
+
+#include <cstring>
+
+namespace hydra
+{
+namespace vm
+{
+
+// size classes are MIN_CLASS_SIZE << i, anything larger is page granular
+static constexpr size_t MIN_CLASS_SIZE = 64;
+static constexpr size_t CLASS_COUNT = 11;
+static constexpr size_t MAX_CLASS_SIZE = MIN_CLASS_SIZE << (CLASS_COUNT - 1);
+static constexpr size_t LARGE_GRANULARITY = 4096;
+
+// int3, in case anything still jumps into freed code
+static constexpr u8 FREED_CODE_FILL = 0xCC;
+
+CodeHeap::CodeHeap()
+    : Current(nullptr), FreeLists(CLASS_COUNT), Mapped(0), Used(0)
+{ }
+
+CodeHeap::~CodeHeap()
+{
+    for (auto &pair : Arenas)
+    {
+        platform::UnmapDual(pair.second.Mapping);
+    }
+}
+
+u8 *CodeHeap::Install(const u8 *code, size_t size)
+{
+    u8 *ret;
+    u8 *writable;
+
+    {
+        std::lock_guard<std::mutex> lock(Mutex);
+        ret = Allocate(size);
+        writable = ToWritable(ret);
+    }
+
+    // the block belongs to nobody else, no need to hold the lock for the copy
+    std::memcpy(writable, code, size);
+    return ret;
+}
+
+void CodeHeap::Free(u8 *code, size_t size)
+{
+    auto allocationSize = AllocationSize(size);
+
+    std::lock_guard<std::mutex> lock(Mutex);
+
+    std::memset(ToWritable(code), FREED_CODE_FILL, allocationSize);
+    Used -= allocationSize;
+
+    // a perf map can not say a range was unloaded, the entry of new code
+    // there would overlap the stale one, so with symbols on it stays unused
+    if (JitSymbols::Enabled)
+    {
+        return;
+    }
+
+    if (allocationSize <= MAX_CLASS_SIZE)
+    {
+        FreeLists[platform::GetLSB(allocationSize / MIN_CLASS_SIZE)].push_back(code);
+    }
+    else
+    {
+        LargeFreeList.emplace(allocationSize, code);
+    }
+}
+
+size_t CodeHeap::GetMapped()
+{
+    std::lock_guard<std::mutex> lock(Mutex);
+    return Mapped;
+}
+
+size_t CodeHeap::GetUsed()
+{
+    std::lock_guard<std::mutex> lock(Mutex);
+    return Used;
+}
+
+size_t CodeHeap::AllocationSize(size_t size)
+{
+    if (size > MAX_CLASS_SIZE)
+    {
+        return (size + LARGE_GRANULARITY - 1) & ~(LARGE_GRANULARITY - 1);
+    }
+
+    size_t ret = MIN_CLASS_SIZE;
+    while (ret < size)
+    {
+        ret <<= 1;
+    }
+    return ret;
+}
+
+u8 *CodeHeap::Allocate(size_t size)
+{
+    auto allocationSize = AllocationSize(size);
+    Used += allocationSize;
+
+    if (allocationSize <= MAX_CLASS_SIZE)
+    {
+        auto &freeList = FreeLists[platform::GetLSB(allocationSize / MIN_CLASS_SIZE)];
+        if (!freeList.empty())
+        {
+            auto ret = freeList.back();
+            freeList.pop_back();
+            return ret;
+        }
+    }
+    else
+    {
+        auto iter = LargeFreeList.find(allocationSize);
+        if (iter != LargeFreeList.end())
+        {
+            auto ret = iter->second;
+            LargeFreeList.erase(iter);
+            return ret;
+        }
+    }
+
+    if (!Current || Current->Top + allocationSize > Current->Mapping.Size)
+    {
+        // whatever is left of the current arena stays unused
+        size_t arenaSize = (allocationSize + CODE_HEAP_ARENA_SIZE - 1) & ~(CODE_HEAP_ARENA_SIZE - 1);
+
+        Arena arena;
+        arena.Top = 0;
+        if (!platform::MapDual(arenaSize, CODE_HEAP_LARGE_PAGES, arena.Mapping))
+        {
+            hydra_trap("Mapping code heap failed");
+        }
+
+        auto base = reinterpret_cast<u8 *>(arena.Mapping.Executable);
+        Current = &(Arenas[base] = arena);
+        Mapped += arenaSize;
+    }
+
+    auto ret = reinterpret_cast<u8 *>(Current->Mapping.Executable) + Current->Top;
+    Current->Top += allocationSize;
+    return ret;
+}
+
+u8 *CodeHeap::ToWritable(u8 *code)
+{
+    auto iter = Arenas.upper_bound(code);
+    hydra_assert(iter != Arenas.begin(),
+        "code must be in the code heap");
+    --iter;
+
+    auto offset = static_cast<size_t>(code - iter->first);
+    hydra_assert(offset < iter->second.Mapping.Size,
+        "code must be in the code heap");
+
+    return reinterpret_cast<u8 *>(iter->second.Mapping.Writable) + offset;
+}
+
+} // namespace vm
+} // namespace hydra
@@ -0,0 +1,68 @@
+#ifndef _CODE_HEAP_H_
+#define _CODE_HEAP_H_
+
+#include "Common/HydraCore.h"
+#include "Common/Platform.h"
+#include "Common/Singleton.h"
+
+#include "VMDefs.h"
+
+#include <map>
+#include <mutex>
+#include <vector>
+
+namespace hydra
+{
+namespace vm
+{
+
+// shared home of all generated code. Arenas are mapped twice, code is
+// copied in through the writable view and runs from the executable one.
+// Small code is rounded up to a power of two size class, freed code goes to
+// the free list of its class and is reused before the arena grows. Builds
+// writing JitSymbols never reuse freed code
+class CodeHeap : public Singleton<CodeHeap>
+{
+public:
+    CodeHeap();
+    ~CodeHeap();
+
+    // returns the executable address of the copy
+    u8 *Install(const u8 *code, size_t size);
+
+    // size is the one given to Install
+    void Free(u8 *code, size_t size);
+
+    // bytes mapped for arenas, and bytes held by live code
+    size_t GetMapped();
+    size_t GetUsed();
+
+private:
+    struct Arena
+    {
+        platform::DualMapping Mapping;
+        size_t Top;
+    };
+
+    static size_t AllocationSize(size_t size);
+
+    u8 *Allocate(size_t size);
+    u8 *ToWritable(u8 *code);
+
+    // keyed by the executable base address
+    std::map<u8 *, Arena> Arenas;
+    Arena *Current;
+
+    std::vector<std::vector<u8 *>> FreeLists;
+    std::multimap<size_t, u8 *> LargeFreeList;
+
+    size_t Mapped;
+    size_t Used;
+
+    std::mutex Mutex;
+};
+
+} // namespace vm
+} // namespace hydra
+
+#endif // _CODE_HEAP_H_
@@ -2,8 +2,13 @@
 
 #include "IR.h"
 #include "IRInsts.h"
+#include "CompiledFunction.h"
+#include "Profiler.h"
 #include "runtime/Semantic.h"
 
+#include <algorithm>
+#include <map>
+#include <set>
 #include <vector>
 
 namespace hydra
@@ -11,6 +16,12 @@ namespace hydra
 namespace vm
 {
 
+ScratchAllocator CompileTask::Scratch;
+
+const InlineCacheCounters GetItemCacheCounters("get_item");
+const InlineCacheCounters SetItemCacheCounters("set_item");
+const InlineCacheCounters CallCacheCounters("call");
+
 #define LOAD_REG(_reg, _SrcReg)                                 \
     mov(_reg, ptr[rdx + Scope::OffsetRegs()]);                  \
     add(_reg, static_cast<u32>(runtime::Array::OffsetTable())); \
@@ -80,13 +91,8 @@ void BaselineCompileTask::CheckWrittenValue(Xbyak::Reg64 valueReg, Xbyak::Reg64
     outLocalLabel();
 }
 
-GeneratedCode BaselineCompileTask::Compile(size_t &registerCount)
+void BaselineCompileTask::EmitPrologue(u32 frameSize)
 {
-    registerCount = IR->UpdateIndex();
-
-    std::vector<Label> labels(IR->Blocks.size());
-    Label returnPoint, throwPoint;
-
     mov(ptr[rsp + 32], r9);
     mov(ptr[rsp + 24], r8);
     mov(ptr[rsp + 16], rdx);
@@ -97,10 +103,665 @@ GeneratedCode BaselineCompileTask::Compile(size_t &registerCount)
     push(r10);
     push(r15);
 
-    sub(rsp, 56);
-    lea(rbp, ptr[rsp + 88]);
+    sub(rsp, frameSize);
+    lea(rbp, ptr[rsp + frameSize + 32]);
 
     mov(r15, cexpr::Mask(0, 48));
+}
+
+void BaselineCompileTask::RecordFeedback(IRInst *inst)
+{
+    // expects operands in rax and rbx. Other threads set bits of the same
+    // instruction, so a bit is set with a locked or, and only the first time
+    Label mark, larger, notNumber, finish;
+
+    inLocalLabel();
+
+    mov(r10, rax);
+    shr(r10, 48);
+    mov(r11, rbx);
+    shr(r11, 48);
+
+    cmp(r10, 0xFFF8);
+    jne(mark);
+    cmp(r11, 0xFFF8);
+    je(finish);
+
+    // the larger tag decides, doubles are the tags below the small ints
+    L(mark);
+    cmp(r10, r11);
+    jae(larger);
+    mov(r10, r11);
+
+    L(larger);
+    mov(r11, reinterpret_cast<u64>(&inst->Feedback));
+    cmp(r10, 0xFFF8);
+    ja(notNumber);
+
+    test(byte[r11], IRInst::FEEDBACK_NOT_SMALL_INT);
+    jnz(finish);
+    lock();
+    or(byte[r11], IRInst::FEEDBACK_NOT_SMALL_INT);
+    jmp(finish);
+
+    L(notNumber);
+    test(byte[r11], IRInst::FEEDBACK_NOT_NUMBER);
+    jnz(finish);
+    lock();
+    or(byte[r11], IRInst::FEEDBACK_NOT_SMALL_INT | IRInst::FEEDBACK_NOT_NUMBER);
+
+    L(finish);
+    outLocalLabel();
+}
+
+void BaselineCompileTask::EmitDeopt(IRInst *inst, u8 feedback)
+{
+    // nothing is written before the guards pass, so the baseline code of the
+    // same instruction can redo it on the same frame
+    mov(rcx, reinterpret_cast<u64>(IR));
+    mov(rdx, reinterpret_cast<u64>(inst));
+    mov(r8, DeoptCount);
+    mov(r9, static_cast<u32>(feedback));
+    mov(rax, reinterpret_cast<u64>(CompiledFunction::Deoptimize));
+    call(rax);
+
+    mov(r9, ptr[rbp + 32]);
+    mov(r8, ptr[rbp + 24]);
+    mov(rdx, ptr[rbp + 16]);
+    mov(rcx, ptr[rbp + 8]);
+
+    mov(rax, reinterpret_cast<u64>(IR->BaselineFunction->GetInstCode(inst->InstIndex)));
+    jmp(rax);
+}
+
+static bool IsSmallIntCompare(IRInst *inst)
+{
+    auto type = inst->GetType();
+    return type == LT || type == LE || type == GT || type == GE || type == EQQ || type == NEE;
+}
+
+static bool IsSmallIntArith(IRInst *inst)
+{
+    auto type = inst->GetType();
+    return type == ADD || type == SUB || type == MUL || type == BAND || type == BOR || type == BXOR;
+}
+
+static bool IsNumberCompare(IRInst *inst)
+{
+    auto type = inst->GetType();
+    return type == LT || type == LE || type == GT || type == GE;
+}
+
+static bool IsNumberArith(IRInst *inst)
+{
+    auto type = inst->GetType();
+    return type == ADD || type == SUB || type == MUL || type == DIV;
+}
+
+void BaselineCompileTask::SmallIntFastPath(IRInst *inst)
+{
+    // no generic path, a failed guard deoptimizes
+    auto type = inst->GetType();
+    bool isCompare = IsSmallIntCompare(inst);
+
+    LOAD_REG(rax, inst->As<ir::Binary>()->_A);
+    LOAD_REG(rbx, inst->As<ir::Binary>()->_B);
+
+    // guard both are small ints
+    mov(r10, rax);
+    shr(r10, 48);
+    cmp(r10, 0xFFF8);
+    jne(".deopt", T_NEAR);
+
+    mov(r10, rbx);
+    shr(r10, 48);
+    cmp(r10, 0xFFF8);
+    jne(".deopt", T_NEAR);
+
+    // sign extend the 48bit payloads
+    shl(rax, 16);
+    sar(rax, 16);
+    shl(rbx, 16);
+    sar(rbx, 16);
+
+    if (isCompare)
+    {
+        cmp(rax, rbx);
+        switch (type)
+        {
+        case LT: setl(al); break;
+        case LE: setle(al); break;
+        case GT: setg(al); break;
+        case GE: setge(al); break;
+        case EQQ: sete(al); break;
+        case NEE: setne(al); break;
+        }
+        movzx(rax, al);
+        mov(r10, runtime::JSValue::FromBoolean(false).Payload);
+        or(rax, r10);
+    }
+    else
+    {
+        switch (type)
+        {
+        case ADD: add(rax, rbx); break;
+        case SUB: sub(rax, rbx); break;
+        case MUL: imul(rax, rbx); jo(".deopt", T_NEAR); break;
+        case BAND: and(rax, rbx); break;
+        case BOR: or(rax, rbx); break;
+        case BXOR: xor(rax, rbx); break;
+        }
+
+        // guard the result still fits in 48bits
+        mov(r10, rax);
+        shl(r10, 16);
+        sar(r10, 16);
+        cmp(r10, rax);
+        jne(".deopt", T_NEAR);
+
+        and(rax, r15);
+        mov(r10, runtime::JSValue::FromSmallInt(0).Payload);
+        or(rax, r10);
+    }
+
+    SET_RESULT(rbx, rax);
+    jmp(".finish", T_NEAR);
+
+    L(".deopt");
+    EmitDeopt(inst, IRInst::FEEDBACK_NOT_SMALL_INT);
+}
+
+void BaselineCompileTask::LoadNumber(Xbyak::Reg64 value, Xbyak::Reg64 tag, const Xbyak::Xmm &number)
+{
+    // value is a small int or a double, tag holds its upper 16 bits
+    inLocalLabel();
+
+    cmp(tag, 0xFFF8);
+    jne(".double");
+
+    shl(value, 16);
+    sar(value, 16);
+    cvtsi2sd(number, value);
+    jmp(".finish");
+
+    L(".double");
+    movq(number, value);
+
+    L(".finish");
+    outLocalLabel();
+}
+
+void BaselineCompileTask::NumberFastPath(IRInst *inst)
+{
+    // doubles and small ints are computed as doubles, anything else
+    // deoptimizes. ADD, SUB and MUL of two small ints give a small int, those
+    // jump to ".generic" of the caller
+    auto type = inst->GetType();
+    bool isCompare = IsNumberCompare(inst);
+
+    LOAD_REG(rax, inst->As<ir::Binary>()->_A);
+    LOAD_REG(rbx, inst->As<ir::Binary>()->_B);
+
+    // guard both are numbers
+    mov(r10, rax);
+    shr(r10, 48);
+    cmp(r10, 0xFFF8);
+    ja(".deopt", T_NEAR);
+
+    mov(r11, rbx);
+    shr(r11, 48);
+    cmp(r11, 0xFFF8);
+    ja(".deopt", T_NEAR);
+
+    if (!isCompare && type != DIV)
+    {
+        cmp(r10, 0xFFF8);
+        jne(".convert");
+        cmp(r11, 0xFFF8);
+        je(".generic", T_NEAR);
+        L(".convert");
+    }
+
+    LoadNumber(rax, r10, xmm0);
+    LoadNumber(rbx, r11, xmm1);
+
+    if (isCompare)
+    {
+        // unordered sets the carry, so every compare is an above with the
+        // operands in order, and false for NaN
+        switch (type)
+        {
+        case LT: ucomisd(xmm1, xmm0); seta(al); break;
+        case LE: ucomisd(xmm1, xmm0); setae(al); break;
+        case GT: ucomisd(xmm0, xmm1); seta(al); break;
+        case GE: ucomisd(xmm0, xmm1); setae(al); break;
+        }
+        movzx(rax, al);
+        mov(r10, runtime::JSValue::FromBoolean(false).Payload);
+        or(rax, r10);
+    }
+    else
+    {
+        switch (type)
+        {
+        case ADD: addsd(xmm0, xmm1); break;
+        case SUB: subsd(xmm0, xmm1); break;
+        case MUL: mulsd(xmm0, xmm1); break;
+        case DIV: divsd(xmm0, xmm1); break;
+        }
+
+        // as JSValue::FromNumber, every NaN is the one NaN
+        movq(rax, xmm0);
+        ucomisd(xmm0, xmm0);
+        jnp(".number");
+        mov(rax, runtime::JSValue::NAN_PAYLOAD);
+        L(".number");
+    }
+
+    SET_RESULT(rbx, rax);
+    jmp(".finish", T_NEAR);
+
+    L(".deopt");
+    EmitDeopt(inst, IRInst::FEEDBACK_NOT_NUMBER);
+}
+
+void BaselineCompileTask::KlassGuard(IRInst *obj, u64 entry)
+{
+    // leaves the object in rax if its klass is the one of entry, jumps to
+    // ".deopt" of the caller otherwise
+    LOAD_REG(rax, obj);
+
+    mov(rbx, rax);
+    shr(rbx, 48);
+    cmp(rbx, 0xFFFA);
+    jne(".deopt", T_NEAR);
+
+    and(rax, r15);
+    jz(".deopt", T_NEAR);       // is null
+
+    mov(rbx, entry & cexpr::Mask(0, PropertyCacheSite::INDEX_SHIFT));
+    cmp(rbx, ptr[rax + runtime::JSObject::OffsetKlass()]);
+    jne(".deopt", T_NEAR);
+}
+
+// the value of the slot entry caches, a slot is the attribute and then the value
+static u32 SlotValueOffset(u64 entry)
+{
+    return static_cast<u32>((entry >> PropertyCacheSite::INDEX_SHIFT) * 16 + 8 + runtime::Array::OffsetTable());
+}
+
+u64 BaselineCompileTask::MonomorphicEntry(IRInst *inst)
+{
+    // the cache entry baseline code filled for inst, 0 if it has none or saw
+    // more than one klass
+    if (inst->Feedback.load(std::memory_order_relaxed) & IRInst::FEEDBACK_NOT_MONOMORPHIC)
+    {
+        return 0;
+    }
+
+    auto site = IR->BaselineFunction->GetPropertySite(inst);
+    return site ? site->Entry.load(std::memory_order_relaxed) : 0;
+}
+
+void BaselineCompileTask::ArrayElementGuard(IRInst *obj, IRInst *key, bool indexKey, bool checkedOnEntry, Label &slowPath)
+{
+    // leaves the array in rax and the key in rbx, unless obj is an array
+    // with key in its table part
+    LOAD_REG(rax, obj);
+
+    if (checkedOnEntry)
+    {
+        // LoopEntryCheck has seen both, the split point may shrink inside
+        // the loop but the table part never does, and the slots it gave up
+        // hold no value
+        and(rax, r15);
+        LOAD_REG(rbx, key);
+        and(rbx, r15);
+        return;
+    }
+
+    mov(rbx, rax);
+    shr(rbx, 48);
+    cmp(rbx, 0xFFFA);
+    jne(slowPath, T_NEAR);
+
+    and(rax, r15);
+    jz(slowPath, T_NEAR);       // is null
+
+    hydra_assert(runtime::JSArray::GetVTable(), "semantic::Initialize must have made a JSArray");
+    mov(rbx, reinterpret_cast<u64>(runtime::JSArray::GetVTable()));
+    cmp(rbx, ptr[rax]);
+    jne(slowPath, T_NEAR);
+
+    LOAD_REG(rbx, key);
+    if (!indexKey)
+    {
+        mov(r10, rbx);
+        shr(r10, 48);
+        cmp(r10, 0xFFF8);
+        jne(slowPath, T_NEAR);
+    }
+
+    // unsigned, negative keys are in the hash part
+    and(rbx, r15);
+    cmp(rbx, ptr[rax + runtime::JSArray::OffsetSplitPoint()]);
+    jae(slowPath, T_NEAR);
+}
+
+void BaselineCompileTask::LoopEntryCheck(IRBlock *header, const std::vector<std::pair<IRInst *, IRInst *>> &arrays)
+{
+    // each pair is an array and the bound of the keys the loop accesses it
+    // with. Runs once the phis of header are resolved, so a failed check
+    // continues in the baseline code of header
+    inLocalLabel();
+
+    hydra_assert(runtime::JSArray::GetVTable(), "semantic::Initialize must have made a JSArray");
+
+    for (auto &pair : arrays)
+    {
+        LOAD_REG(rax, pair.first);
+        mov(rbx, rax);
+        shr(rbx, 48);
+        cmp(rbx, 0xFFFA);
+        jne(".deopt", T_NEAR);
+
+        and(rax, r15);
+        jz(".deopt", T_NEAR);
+
+        mov(rbx, reinterpret_cast<u64>(runtime::JSArray::GetVTable()));
+        cmp(rbx, ptr[rax]);
+        jne(".deopt", T_NEAR);
+
+        LOAD_REG(rbx, pair.second);
+        mov(r10, rbx);
+        shr(r10, 48);
+        cmp(r10, 0xFFF8);
+        jne(".deopt", T_NEAR);
+
+        // unsigned, a negative bound fails as well
+        and(rbx, r15);
+        cmp(rbx, ptr[rax + runtime::JSArray::OffsetSplitPoint()]);
+        ja(".deopt", T_NEAR);
+    }
+    jmp(".finish", T_NEAR);
+
+    L(".deopt");
+    EmitDeopt(header->Insts.front().get(), IRInst::FEEDBACK_NOT_IN_BOUNDS);
+
+    L(".finish");
+    outLocalLabel();
+}
+
+void BaselineCompileTask::OsrCheck(IRBlock *header, Label &osrExit)
+{
+    // expects &IR->Hotness in rax, phis of header already resolved
+    inLocalLabel();
+
+    mov(rbx, reinterpret_cast<u64>(&header->OsrEntry));
+    mov(rbx, ptr[rbx]);
+    test(rbx, rbx);
+    jnz(".transfer", T_NEAR);
+
+    cmp(qword[rax], static_cast<u32>(OPTIMIZE_HOTNESS_THRESHOLD));
+    jb(".finish", T_NEAR);
+
+    mov(rax, reinterpret_cast<u64>(&IR->OptimizeRequested));
+    cmp(byte[rax], 0);
+    jne(".finish", T_NEAR);
+
+    mov(rcx, reinterpret_cast<u64>(IR));
+    mov(rax, reinterpret_cast<u64>(CompiledFunction::RequestOptimize));
+    call(rax);
+
+    mov(r9, ptr[rbp + 32]);
+    mov(r8, ptr[rbp + 24]);
+    mov(rdx, ptr[rbp + 16]);
+    mov(rcx, ptr[rbp + 8]);
+    jmp(".finish", T_NEAR);
+
+    // all values live in Scope, so the optimized code continues the frame
+    // as is, and its result is the result of this call
+    L(".transfer");
+    call(rbx);
+    jmp(osrExit, T_NEAR);
+
+    L(".finish");
+    outLocalLabel();
+}
+
+bool BaselineCompileTask::EmitDirectEntry(Label &body, Label &entry, size_t registerCount)
+{
+    // entered from a CALL of compiled code like CallWithArgvAndCache without
+    // the cache: allocator, the masked callee, thisArg, argv, &retVal and
+    // &error. Builds the stack frame of EnterCompiled in place, so it only
+    // exists for functions whose Scope does not escape and whose Table is
+    // empty. ThreadTop is not linked, nothing reads it, and callers only
+    // come here while no profiler walks ThreadFrame
+    if (IR->ScopeEscaped || IR->GetVarCount() != 0)
+    {
+        return false;
+    }
+
+    size_t regsLevel = runtime::Array::LevelFromCapacity(registerCount);
+    size_t argsLevel = runtime::RangeArray::LevelFromCapacity(IR->Length);
+    size_t regsSize = gc::Region::CellSizeFromLevel(regsLevel);
+    size_t argsSize = gc::Region::CellSizeFromLevel(argsLevel);
+    size_t tableSize = gc::Region::CellSizeFromLevel(0);
+    size_t frameSize = regsSize + argsSize + tableSize + sizeof(Scope);
+
+    if (frameSize > runtime::MAXIMAL_STACK_FRAME_SIZE)
+    {
+        return false;
+    }
+
+    // the headers are the same on every call, they are built here once and
+    // copied word by word. Pointers into the frame are patched after
+    std::vector<u64> image(frameSize / sizeof(u64));
+    u8 *buffer = reinterpret_cast<u8 *>(image.data());
+    runtime::Array::NewInPlace(buffer, regsLevel);
+    runtime::RangeArray::NewInPlace(buffer + regsSize, argsLevel, 0);
+    runtime::Array::NewInPlace(buffer + regsSize + argsSize, 0);
+    new (buffer + regsSize + argsSize + tableSize) Scope(0,
+        nullptr,
+        nullptr,
+        nullptr,
+        nullptr,
+        runtime::JSValue(),
+        nullptr);
+
+    // the frame at [rsp + 48] above the shadow space of the body, then rbx,
+    // the return address, the home of the four register arguments, &retVal
+    // and &error
+    u32 stackSize = static_cast<u32>((48 + frameSize + 15) & ~static_cast<size_t>(15));
+    u32 regs = 48;
+    u32 args = static_cast<u32>(regs + regsSize);
+    u32 table = static_cast<u32>(args + argsSize);
+    u32 scope = static_cast<u32>(table + tableSize);
+
+    inLocalLabel();
+
+    L(entry);
+    push(rbx);
+    sub(rsp, stackSize);
+
+    mov(ptr[rsp + stackSize + 16], rcx);
+    mov(ptr[rsp + stackSize + 24], rdx);
+    mov(ptr[rsp + stackSize + 32], r8);
+    mov(ptr[rsp + stackSize + 40], r9);
+
+    // counted like EnterCompiled does, until the optimized code is requested
+    mov(rax, reinterpret_cast<u64>(&IR->OptimizeRequested));
+    cmp(byte[rax], 0);
+    jne(".counted", T_NEAR);
+
+    mov(r10, reinterpret_cast<u64>(&IR->Hotness));
+    mov(rax, 1);
+    lock();
+    xadd(qword[r10], rax);
+    cmp(rax, static_cast<u32>(OPTIMIZE_HOTNESS_THRESHOLD));
+    jb(".counted", T_NEAR);
+
+    mov(rcx, reinterpret_cast<u64>(IR));
+    mov(rax, reinterpret_cast<u64>(CompiledFunction::RequestOptimize));
+    call(rax);
+
+    mov(r9, ptr[rsp + stackSize + 40]);
+    mov(r8, ptr[rsp + stackSize + 32]);
+    mov(rdx, ptr[rsp + stackSize + 24]);
+    mov(rcx, ptr[rsp + stackSize + 16]);
+
+    L(".counted");
+
+    // every value starts as not exists, arguments past the end included
+    lea(r10, ptr[rsp + regs]);
+    mov(rax, runtime::JSValue::NOT_EXISTS_PAYLOAD);
+    mov(r11, image.size());
+    L(".fill");
+    mov(ptr[r10], rax);
+    add(r10, 8);
+    dec(r11);
+    jnz(".fill");
+
+    for (size_t i = 0; i < image.size(); ++i)
+    {
+        if (image[i] != runtime::JSValue::NOT_EXISTS_PAYLOAD)
+        {
+            mov(rax, image[i]);
+            mov(ptr[rsp + static_cast<u32>(regs + 8 * i)], rax);
+        }
+    }
+
+    lea(rax, ptr[rsp + regs]);
+    mov(ptr[rsp + static_cast<u32>(scope + Scope::OffsetRegs())], rax);
+    lea(rax, ptr[rsp + table]);
+    mov(ptr[rsp + static_cast<u32>(scope + Scope::OffsetTable())], rax);
+    lea(rax, ptr[rsp + args]);
+    mov(ptr[rsp + static_cast<u32>(scope + Scope::OffsetArguments())], rax);
+    mov(rax, ptr[rdx + runtime::JSCompiledFunction::OffsetScope()]);
+    mov(ptr[rsp + static_cast<u32>(scope + Scope::OffsetUpper())], rax);
+    mov(rax, ptr[rdx + runtime::JSCompiledFunction::OffsetCaptured()]);
+    mov(ptr[rsp + static_cast<u32>(scope + Scope::OffsetCaptured())], rax);
+    mov(ptr[rsp + static_cast<u32>(scope + Scope::OffsetThisArg())], r8);
+
+    // the cells are white, so copying needs no write barrier
+    mov(r11, ptr[r9 + 8]);
+    mov(ptr[rsp + static_cast<u32>(args + runtime::RangeArray::OffsetLength())], r11);
+    test(r11, r11);
+    jz(".copied");
+    mov(r10, ptr[r9]);
+    lea(rbx, ptr[rsp + static_cast<u32>(args + runtime::RangeArray::OffsetTable())]);
+    L(".copy");
+    mov(rax, ptr[r10]);
+    mov(ptr[rbx], rax);
+    add(r10, 8);
+    add(rbx, 8);
+    dec(r11);
+    jnz(".copy");
+    L(".copied");
+
+    lea(rdx, ptr[rsp + scope]);
+    mov(r8, ptr[rsp + stackSize + 48]);
+    mov(r9, ptr[rsp + stackSize + 56]);
+    call(body);
+
+    add(rsp, stackSize);
+    pop(rbx);
+    ret();
+
+    outLocalLabel();
+
+    DirectArgumentLimit = runtime::RangeArray::CapacityFromLevel(argsLevel);
+    return true;
+}
+
+std::string BaselineCompileTask::SymbolName() const
+{
+    return "js:" + IR->Name->ToString() + (Speculative ? " [optimized]" : " [baseline]");
+}
+
+GeneratedCode BaselineCompileTask::Compile(size_t &registerCount)
+{
+    registerCount = IR->UpdateIndex();
+
+    if (Speculative)
+    {
+        hydra_assert(IR->BaselineFunction, "deoptimization needs baseline code");
+        DeoptCount = IR->DeoptCount.load();
+    }
+
+    std::vector<Label> labels(IR->Blocks.size());
+    Label body, returnPoint, throwPoint, osrExit, directEntry;
+
+    // argument arrays consumed only by a CALL in the same block are never
+    // materialized, the values are passed as an ArgumentVector on the stack
+    std::set<IRInst *> argumentVectors;
+    size_t maxArgumentCount = 0;
+    for (auto &block : IR->Blocks)
+    {
+        std::set<IRInst *> defined;
+        for (auto &inst : block->Insts)
+        {
+            if (inst->Is<ir::Call>())
+            {
+                auto args = inst->As<ir::Call>()->_Args.Get();
+                if (args->Is<ir::Array>() && args->UsedCount() == 1 && defined.count(args))
+                {
+                    argumentVectors.insert(args);
+                    maxArgumentCount = std::max(maxArgumentCount, args->As<ir::Array>()->Initialization.size());
+                }
+            }
+            defined.insert(inst.get());
+        }
+    }
+
+    // array accesses with a bound over their loop are checked once when
+    // entering it, from the only block outside that jumps to the header. A
+    // failed check marks the first instruction of the header
+    std::map<IRBlock *, std::vector<std::pair<IRInst *, IRInst *>>> entryChecks;
+    std::set<IRInst *> checkedOnEntry;
+    if (Speculative)
+    {
+        for (auto &block : IR->Blocks)
+        {
+            for (auto &inst : block->Insts)
+            {
+                std::pair<IRInst *, IRInst *> array;
+                if (inst->Is<ir::GetItem>())
+                {
+                    array = { inst->As<ir::GetItem>()->_Obj.Get(), inst->As<ir::GetItem>()->Bound };
+                }
+                else if (inst->Is<ir::SetItem>())
+                {
+                    array = { inst->As<ir::SetItem>()->_Obj.Get(), inst->As<ir::SetItem>()->Bound };
+                }
+                else
+                {
+                    continue;
+                }
+
+                auto header = block->LoopHeader.Get();
+                if (!array.second || header->Insts.empty() || header->LoopPrev->Condition ||
+                    (header->Insts.front()->Feedback.load(std::memory_order_relaxed) & IRInst::FEEDBACK_NOT_IN_BOUNDS))
+                {
+                    continue;
+                }
+
+                auto &arrays = entryChecks[header];
+                if (std::find(arrays.begin(), arrays.end(), array) == arrays.end())
+                {
+                    arrays.push_back(array);
+                }
+                checkedOnEntry.insert(inst.get());
+            }
+        }
+    }
+
+    // [rsp + 56] ArgumentVector, [rsp + 72] values
+    size_t argumentArea = argumentVectors.empty() ? 0 : ((16 + 8 * maxArgumentCount + 15) & ~static_cast<size_t>(15));
+    u32 frameSize = static_cast<u32>(56 + argumentArea);
+
+    L(body);
+    EmitPrologue(frameSize);
 
     for (auto &block : IR->Blocks)
     {
@@ -108,6 +769,8 @@ GeneratedCode BaselineCompileTask::Compile(size_t &registerCount)
 
         for (auto &inst : block->Insts)
         {
+            InstOffsets.emplace_back(static_cast<u32>(getSize()), static_cast<u32>(inst->InstIndex));
+
             switch (inst->GetType())
             {
             case RETURN:
@@ -162,11 +825,35 @@ GeneratedCode BaselineCompileTask::Compile(size_t &registerCount)
             }
             case GET_ITEM:
             {
-                if (inst->As<ir::GetItem>()->_Key->Is<ir::String>())
+                u64 entry = Speculative ? MonomorphicEntry(inst.get()) : 0;
+                if (entry)
+                {
+                    // the klass baseline code saw is a constant, any other deoptimizes
+                    inLocalLabel();
+
+                    KlassGuard(inst->As<ir::GetItem>()->_Obj.Get(), entry);
+
+                    mov(rax, ptr[rax + runtime::JSObject::OffsetTable()]);
+                    mov(rax, ptr[rax + SlotValueOffset(entry)]);
+                    RETVAL_REG(rbx);
+                    mov(ptr[rbx], rax);
+                    CheckWrittenValue(rax, rbx);
+                    jmp(".finish", T_NEAR);
+
+                    L(".deopt");
+                    EmitDeopt(inst.get(), IRInst::FEEDBACK_NOT_MONOMORPHIC);
+
+                    L(".finish");
+                    outLocalLabel();
+                }
+                else if (inst->As<ir::GetItem>()->_Key->Is<ir::String>())
                 {
                     // inline cached version
                     inLocalLabel();
 
+                    PropertySites.emplace_back(inst.get());
+                    auto site = &PropertySites.back();
+
                     LOAD_REG(rax, inst->As<ir::GetItem>()->_Obj);
 
                     // make sure it is an object
@@ -175,20 +862,28 @@ GeneratedCode BaselineCompileTask::Compile(size_t &registerCount)
                     cmp(rbx, 0xFFFA);
                     jne(".slowPath", T_NEAR);
 
-                    // detect cached
+                    // detect cached, the klass and the slot come from one load
                     and(rax, r15);
-                    L(".cached");
-                    mov(rbx, (u64)0x0123456789ABCDEFull);
-                    cmp(rbx, ptr[rax + runtime::JSObject::OffsetKlass()]);
+                    mov(rbx, reinterpret_cast<u64>(site));
+                    mov(rbx, ptr[rbx]);
+                    mov(r10, rbx);
+                    shl(r10, 64 - PropertyCacheSite::INDEX_SHIFT);
+                    shr(r10, 64 - PropertyCacheSite::INDEX_SHIFT);
+                    cmp(r10, ptr[rax + runtime::JSObject::OffsetKlass()]);
                     jne(".slowPath", T_NEAR);
 
-                    // load by index
-                    mov(rbx, (u64)0x0123456789ABCDEFull);
+                    // a slot is the attribute and then the value
+                    shr(rbx, PropertyCacheSite::INDEX_SHIFT);
+                    shl(rbx, 4);
                     mov(rax, ptr[rax + runtime::JSObject::OffsetTable()]);
-                    mov(rax, ptr[rax + rbx]);
+                    mov(rax, ptr[rax + rbx + 8 + runtime::Array::OffsetTable()]);
                     RETVAL_REG(rbx);
                     mov(ptr[rbx], rax);
                     CheckWrittenValue(rax, rbx);
+
+                    // count the hit in the metrics shard of this thread
+                    mov(rax, ptr[rcx + gc::ThreadAllocator::OffsetMetricShard()]);
+                    inc(qword[rax + 8 * GetItemCacheCounters.Hit]);
                     jmp(".finish");
 
                     L(".slowPath");
@@ -202,8 +897,8 @@ GeneratedCode BaselineCompileTask::Compile(size_t &registerCount)
                     RETVAL_REG(r9);
                     mov(ptr[rsp + 32], r9);
 
-                    // fixup
-                    mov(r9, ".cached");
+                    // site
+                    mov(r9, reinterpret_cast<u64>(site));
 
                     // key
                     mov(r8, rbx);
@@ -227,6 +922,36 @@ GeneratedCode BaselineCompileTask::Compile(size_t &registerCount)
                 }
                 else
                 {
+                    Label slowPath, finish;
+
+                    ArrayElementGuard(
+                        inst->As<ir::GetItem>()->_Obj.Get(),
+                        inst->As<ir::GetItem>()->_Key.Get(),
+                        inst->As<ir::GetItem>()->IndexKey,
+                        checkedOnEntry.count(inst.get()) != 0,
+                        slowPath);
+
+                    mov(rax, ptr[rax + runtime::JSArray::OffsetTablePart()]);
+                    shl(rbx, 4);
+                    lea(rax, ptr[rax + rbx + runtime::Array::OffsetTable()]);
+
+                    // holes and accessors take the slow path
+                    mov(rbx, ptr[rax]);
+                    and(rbx, static_cast<u32>(
+                        runtime::JSObjectPropertyAttribute::HAS_VALUE |
+                        runtime::JSObjectPropertyAttribute::IS_DATA_MASK));
+                    cmp(rbx, static_cast<u32>(
+                        runtime::JSObjectPropertyAttribute::HAS_VALUE |
+                        runtime::JSObjectPropertyAttribute::IS_DATA_MASK));
+                    jne(slowPath, T_NEAR);
+
+                    mov(rax, ptr[rax + 8]);
+                    RETVAL_REG(rbx);
+                    mov(ptr[rbx], rax);
+                    CheckWrittenValue(rax, rbx);
+                    jmp(finish, T_NEAR);
+
+                    L(slowPath);
                     LOAD_REG(rax, inst->As<ir::GetItem>()->_Obj);
                     LOAD_REG(rbx, inst->As<ir::GetItem>()->_Key);
 
@@ -252,17 +977,62 @@ GeneratedCode BaselineCompileTask::Compile(size_t &registerCount)
 
                     test(al, al);
                     jz(throwPoint, T_NEAR);
+
+                    L(finish);
                 }
 
                 break;
             }
             case SET_ITEM:
             {
-                if (inst->As<ir::SetItem>()->_Key->Is<ir::String>())
+                u64 entry = Speculative ? MonomorphicEntry(inst.get()) : 0;
+                if (entry)
+                {
+                    // the klass baseline code saw is a constant, any other deoptimizes
+                    inLocalLabel();
+
+                    KlassGuard(inst->As<ir::SetItem>()->_Obj.Get(), entry);
+
+                    mov(rbx, ptr[rax + runtime::JSObject::OffsetTable()]);
+                    LOAD_REG(r10, inst->As<ir::SetItem>()->_Value);
+                    mov(ptr[rbx + SlotValueOffset(entry)], r10);
+
+                    mov(rax, r10);
+                    shr(rax, 48);
+                    cmp(rax, 0xFFFA);   // object
+                    je(".writeBarrier");
+
+                    cmp(rax, 0xFFFB);   // string
+                    jne(".finish", T_NEAR);
+
+                    L(".writeBarrier");
+                    and(r10, r15);
+                    mov(r8, r10);
+                    mov(rdx, rbx);
+                    mov(rcx, reinterpret_cast<u64>(gc::Heap::GetInstance()));
+                    mov(rax, reinterpret_cast<u64>(gc::Heap::WriteBarrierStatic));
+                    call(rax);
+
+                    mov(r9, ptr[rbp + 32]);
+                    mov(r8, ptr[rbp + 24]);
+                    mov(rdx, ptr[rbp + 16]);
+                    mov(rcx, ptr[rbp + 8]);
+                    jmp(".finish", T_NEAR);
+
+                    L(".deopt");
+                    EmitDeopt(inst.get(), IRInst::FEEDBACK_NOT_MONOMORPHIC);
+
+                    L(".finish");
+                    outLocalLabel();
+                }
+                else if (inst->As<ir::SetItem>()->_Key->Is<ir::String>())
                 {
                     // inline cached version
                     inLocalLabel();
 
+                    PropertySites.emplace_back(inst.get());
+                    auto site = &PropertySites.back();
+
                     LOAD_REG(rax, inst->As<ir::SetItem>()->_Obj);
 
                     // make sure it is an object
@@ -271,17 +1041,25 @@ GeneratedCode BaselineCompileTask::Compile(size_t &registerCount)
                     cmp(rbx, 0xFFFA);
                     jne(".slowPath", T_NEAR);
 
-                    // detect cached
+                    // detect cached, the klass and the slot come from one load
                     and(rax, r15);
-                    L(".cached");
-                    mov(rbx, (u64)(0x0123456789ABCDEFull));
-                    cmp(rbx, ptr[rax + runtime::JSObject::OffsetKlass()]);
+                    mov(rbx, reinterpret_cast<u64>(site));
+                    mov(rbx, ptr[rbx]);
+                    mov(r10, rbx);
+                    shl(r10, 64 - PropertyCacheSite::INDEX_SHIFT);
+                    shr(r10, 64 - PropertyCacheSite::INDEX_SHIFT);
+                    cmp(r10, ptr[rax + runtime::JSObject::OffsetKlass()]);
                     jne(".slowPath", T_NEAR);
 
-                    mov(rbx, (u64)(0x0123456789ABCDEFull));
+                    // a slot is the attribute and then the value
+                    shr(rbx, PropertyCacheSite::INDEX_SHIFT);
+                    shl(rbx, 4);
                     mov(rax, ptr[rax + runtime::JSObject::OffsetTable()]);
                     LOAD_REG(r10, inst->As<ir::SetItem>()->_Value);
-                    mov(ptr[rax + rbx], r10);
+                    mov(ptr[rax + rbx + 8 + runtime::Array::OffsetTable()], r10);
+
+                    mov(rax, ptr[rcx + gc::ThreadAllocator::OffsetMetricShard()]);
+                    inc(qword[rax + 8 * SetItemCacheCounters.Hit]);
 
                     mov(rax, r10);
                     shr(rax, 48);
@@ -325,8 +1103,8 @@ GeneratedCode BaselineCompileTask::Compile(size_t &registerCount)
                     // value
                     mov(ptr[rsp + 32], r10);
 
-                    // fixup
-                    mov(r9, ".cached");
+                    // site
+                    mov(r9, reinterpret_cast<u64>(site));
 
                     // key
                     mov(r8, rbx);
@@ -350,6 +1128,70 @@ GeneratedCode BaselineCompileTask::Compile(size_t &registerCount)
                 }
                 else
                 {
+                    Label slowPath, writeBarrier, finish;
+
+                    ArrayElementGuard(
+                        inst->As<ir::SetItem>()->_Obj.Get(),
+                        inst->As<ir::SetItem>()->_Key.Get(),
+                        inst->As<ir::SetItem>()->IndexKey,
+                        checkedOnEntry.count(inst.get()) != 0,
+                        slowPath);
+
+                    // only overwrite existing elements, length stays the same
+                    cmp(rbx, ptr[rax + runtime::JSArray::OffsetLength()]);
+                    jae(slowPath, T_NEAR);
+
+                    mov(rax, ptr[rax + runtime::JSArray::OffsetTablePart()]);
+                    shl(rbx, 4);
+                    lea(rax, ptr[rax + rbx + runtime::Array::OffsetTable()]);
+
+                    // holes, accessors and readonly elements take the slow path
+                    mov(rbx, ptr[rax]);
+                    and(rbx, static_cast<u32>(
+                        runtime::JSObjectPropertyAttribute::HAS_VALUE |
+                        runtime::JSObjectPropertyAttribute::IS_DATA_MASK |
+                        runtime::JSObjectPropertyAttribute::IS_WRITABLE_MASK));
+                    cmp(rbx, static_cast<u32>(
+                        runtime::JSObjectPropertyAttribute::HAS_VALUE |
+                        runtime::JSObjectPropertyAttribute::IS_DATA_MASK |
+                        runtime::JSObjectPropertyAttribute::IS_WRITABLE_MASK));
+                    jne(slowPath, T_NEAR);
+
+                    LOAD_REG(r10, inst->As<ir::SetItem>()->_Value);
+                    mov(ptr[rax + 8], r10);
+
+                    mov(rax, r10);
+                    shr(rax, 48);
+                    cmp(rax, 0xFFFA);   // object
+                    je(writeBarrier);
+
+                    cmp(rax, 0xFFFB);   // string
+                    jne(finish, T_NEAR);
+
+                    L(writeBarrier);
+                    // ref
+                    and(r10, r15);
+                    mov(r8, r10);
+
+                    // target
+                    LOAD_REG(rax, inst->As<ir::SetItem>()->_Obj);
+                    and(rax, r15);
+                    mov(rdx, ptr[rax + runtime::JSArray::OffsetTablePart()]);
+
+                    // this
+                    mov(rcx, reinterpret_cast<u64>(gc::Heap::GetInstance()));
+
+                    mov(rax, reinterpret_cast<u64>(gc::Heap::WriteBarrierStatic));
+                    call(rax);
+
+                    mov(r9, ptr[rbp + 32]);
+                    mov(r8, ptr[rbp + 24]);
+                    mov(rdx, ptr[rbp + 16]);
+                    mov(rcx, ptr[rbp + 8]);
+
+                    jmp(finish, T_NEAR);
+
+                    L(slowPath);
                     LOAD_REG(rax, inst->As<ir::SetItem>()->_Obj);
                     LOAD_REG(rbx, inst->As<ir::SetItem>()->_Key);
                     LOAD_REG(r10, inst->As<ir::SetItem>()->_Value);
@@ -376,6 +1218,8 @@ GeneratedCode BaselineCompileTask::Compile(size_t &registerCount)
 
                     test(al, al);
                     jz(throwPoint, T_NEAR);
+
+                    L(finish);
                 }
                 break;
             }
@@ -437,9 +1281,34 @@ GeneratedCode BaselineCompileTask::Compile(size_t &registerCount)
             }
             case CALL:
             {
+                CallSites.emplace_back();
+
+                // cache
+                mov(rax, reinterpret_cast<u64>(&CallSites.back()));
+                mov(ptr[rsp + 48], rax);
+
+                auto args = inst->As<ir::Call>()->_Args.Get();
+                bool useVector = argumentVectors.count(args) != 0;
+
+                if (useVector)
+                {
+                    auto &values = args->As<ir::Array>()->Initialization;
+
+                    lea(rax, ptr[rsp + 72]);
+                    mov(ptr[rsp + 56], rax);
+                    mov(rax, values.size());
+                    mov(ptr[rsp + 64], rax);
+
+                    size_t index = 0;
+                    for (auto &value : values)
+                    {
+                        LOAD_REG(rax, value);
+                        mov(ptr[rsp + static_cast<u32>(72 + 8 * index++)], rax);
+                    }
+                }
+
                 LOAD_REG(rax, inst->As<ir::Call>()->_Callee);
                 LOAD_REG(r10, inst->As<ir::Call>()->_ThisArg);
-                LOAD_REG(rbx, inst->As<ir::Call>()->_Args);
 
                 // &error
                 mov(ptr[rsp + 40], r9);
@@ -448,9 +1317,18 @@ GeneratedCode BaselineCompileTask::Compile(size_t &registerCount)
                 RETVAL_REG(r9);
                 mov(ptr[rsp + 32], r9);
 
-                // *arguments
-                mov(r9, rbx);
-                and(r9, r15);
+                if (useVector)
+                {
+                    // *arguments
+                    lea(r9, ptr[rsp + 56]);
+                }
+                else
+                {
+                    // *arguments
+                    LOAD_REG(rbx, inst->As<ir::Call>()->_Args);
+                    mov(r9, rbx);
+                    and(r9, r15);
+                }
 
                 // thisArg
                 mov(r8, r10);
@@ -458,8 +1336,82 @@ GeneratedCode BaselineCompileTask::Compile(size_t &registerCount)
                 // callee
                 mov(rdx, rax);
 
-                mov(rax, reinterpret_cast<u64>(runtime::semantic::Call));
-                call(rax);
+                if (useVector)
+                {
+                    // a hit on a function with a direct entry skips the
+                    // helper, the callee builds its frame on this stack
+                    inLocalLabel();
+
+                    mov(rbx, rdx);
+                    shr(rbx, 48);
+                    cmp(rbx, 0xFFFA);
+                    jne(".generic", T_NEAR);
+
+                    mov(rax, rdx);
+                    and(rax, r15);
+                    jz(".generic", T_NEAR);
+
+                    // exactly one of the compiled function types, the fields
+                    // are at the same offsets in both
+                    hydra_assert(runtime::JSCompiledFunction::OffsetScope() == runtime::JSCompiledArrowFunction::OffsetScope() &&
+                        runtime::JSCompiledFunction::OffsetCaptured() == runtime::JSCompiledArrowFunction::OffsetCaptured() &&
+                        runtime::JSCompiledFunction::OffsetFunc() == runtime::JSCompiledArrowFunction::OffsetFunc(),
+                        "compiled function layouts differ");
+
+                    mov(rbx, reinterpret_cast<u64>(runtime::JSCompiledFunction::AddressOfVTable()));
+                    mov(rbx, ptr[rbx]);
+                    cmp(rbx, ptr[rax]);
+                    je(".function", T_NEAR);
+
+                    mov(rbx, reinterpret_cast<u64>(runtime::JSCompiledArrowFunction::AddressOfVTable()));
+                    mov(rbx, ptr[rbx]);
+                    cmp(rbx, ptr[rax]);
+                    jne(".generic", T_NEAR);
+
+                    // arrow functions take thisArg from their scope, the
+                    // helper ignores the one passed as well
+                    mov(r8, ptr[rax + runtime::JSCompiledArrowFunction::OffsetScope()]);
+                    mov(r8, ptr[r8 + Scope::OffsetThisArg()]);
+
+                    L(".function");
+                    mov(rbx, ptr[rax + runtime::JSCompiledFunction::OffsetFunc()]);
+                    mov(rbx, ptr[rbx + IRFunc::OffsetCompiled()]);
+                    test(rbx, rbx);
+                    jz(".generic", T_NEAR);
+                    mov(r11, reinterpret_cast<u64>(&CallSites.back()));
+                    cmp(rbx, ptr[r11]);
+                    jne(".generic", T_NEAR);
+
+                    cmp(qword[rbx + CompiledFunction::OffsetDirectArgumentLimit()], static_cast<u32>(args->As<ir::Array>()->Initialization.size()));
+                    jb(".generic", T_NEAR);
+                    mov(r11, ptr[rbx + CompiledFunction::OffsetDirectEntry()]);
+                    test(r11, r11);
+                    jz(".generic", T_NEAR);
+
+                    // profilers need every frame linked in ThreadFrame
+                    mov(rbx, reinterpret_cast<u64>(&Profiler::FrameWalkers));
+                    cmp(qword[rbx], 0);
+                    jne(".generic", T_NEAR);
+
+                    mov(rbx, ptr[rcx + gc::ThreadAllocator::OffsetMetricShard()]);
+                    inc(qword[rbx + 8 * CallCacheCounters.Hit]);
+
+                    mov(rdx, rax);
+                    call(r11);
+                    jmp(".returned", T_NEAR);
+
+                    L(".generic");
+                    mov(rax, reinterpret_cast<u64>(runtime::semantic::CallWithArgvAndCache));
+                    call(rax);
+
+                    L(".returned");
+                    outLocalLabel();
+                }
+                else
+                {
+                    mov(rax, reinterpret_cast<u64>(runtime::semantic::CallWithCache));
+                    call(rax);
+                }
 
                 mov(r9, ptr[rbp + 32]);
                 mov(r8, ptr[rbp + 24]);
@@ -602,6 +1554,11 @@ GeneratedCode BaselineCompileTask::Compile(size_t &registerCount)
             }
             case ARRAY:
             {
+                if (argumentVectors.count(inst.get()))
+                {
+                    break;
+                }
+
                 // &error
                 mov(ptr[rsp + 32], r9);
 
@@ -682,9 +1639,38 @@ GeneratedCode BaselineCompileTask::Compile(size_t &registerCount)
 #define CASE_BINARY(BIN, func)                                              \
             case BIN:                                                       \
             {                                                               \
+                inLocalLabel();                                             \
+                                                                            \
+                auto feedback =                                             \
+                    inst->Feedback.load(std::memory_order_relaxed);         \
+                bool smallInt = IsSmallIntCompare(inst.get()) ||            \
+                    IsSmallIntArith(inst.get());                            \
+                bool number = IsNumberCompare(inst.get()) ||                \
+                    IsNumberArith(inst.get());                              \
+                if (Speculative && smallInt &&                              \
+                    !(feedback & IRInst::FEEDBACK_NOT_SMALL_INT))           \
+                {                                                           \
+                    SmallIntFastPath(inst.get());                           \
+                    L(".finish");                                           \
+                    outLocalLabel();                                        \
+                    break;                                                  \
+                }                                                           \
+                                                                            \
+                if (Speculative && number &&                                \
+                    !(feedback & IRInst::FEEDBACK_NOT_NUMBER))              \
+                {                                                           \
+                    NumberFastPath(inst.get());                             \
+                    L(".generic");                                          \
+                }                                                           \
+                                                                            \
                 LOAD_REG(rax, inst->As<ir::Binary>()->_A);                  \
                 LOAD_REG(rbx, inst->As<ir::Binary>()->_B);                  \
                                                                             \
+                if (!Speculative && (smallInt || number))                   \
+                {                                                           \
+                    RecordFeedback(inst.get());                             \
+                }                                                           \
+                                                                            \
                 mov(ptr[rsp + 32], r9);                                     \
                                                                             \
                 RETVAL_REG(r9);                                             \
@@ -704,6 +1690,8 @@ GeneratedCode BaselineCompileTask::Compile(size_t &registerCount)
                 test(al, al);                                               \
                 jz(throwPoint, T_NEAR);                                     \
                                                                             \
+                L(".finish");                                               \
+                outLocalLabel();                                            \
                 break;                                                      \
             }
             CASE_BINARY(ADD, OpAdd);
@@ -763,7 +1751,7 @@ GeneratedCode BaselineCompileTask::Compile(size_t &registerCount)
                 // inst
                 mov(r8, reinterpret_cast<uintptr_t>(inst.get()));
 
-                mov(rax, reinterpret_cast<u64>(runtime::semantic::NewScope));
+                mov(rax, reinterpret_cast<u64>(runtime::semantic::NewScopeWithInst));
                 call(rax);
 
                 mov(rdx, rax);
@@ -951,6 +1939,23 @@ GeneratedCode BaselineCompileTask::Compile(size_t &registerCount)
         }
         else if (block->Consequent)
         {
+            if (!Speculative && block->Consequent->Index <= block->Index)
+            {
+                // back edge, racy increments only lose some counts
+                mov(rax, reinterpret_cast<u64>(&IR->Hotness));
+                inc(qword[rax]);
+
+                if (block->Consequent->LoopHeader.Get() == block->Consequent.Get())
+                {
+                    OsrCheck(block->Consequent.Get(), osrExit);
+                }
+            }
+
+            auto checks = entryChecks.find(block->Consequent.Get());
+            if (checks != entryChecks.end() && block->Consequent->LoopPrev.Get() == block.get())
+            {
+                LoopEntryCheck(checks->first, checks->second);
+            }
             jmp(labels[block->Consequent->Index], T_NEAR);
         }
     }
@@ -976,7 +1981,7 @@ GeneratedCode BaselineCompileTask::Compile(size_t &registerCount)
 
     L("returnAfterWriteBarrier");
     mov(rax, 1);
-    add(rsp, 56);
+    add(rsp, frameSize);
     pop(r15);
     pop(r10);
     pop(rbx);
@@ -985,14 +1990,52 @@ GeneratedCode BaselineCompileTask::Compile(size_t &registerCount)
 
     L(throwPoint);
     mov(rax, 0);
-    add(rsp, 56);
+    L(osrExit);
+    add(rsp, frameSize);
     pop(r15);
     pop(r10);
     pop(rbx);
     pop(rbp);
     ret();
 
-    return GetCode();
+    bool hasDirectEntry = EmitDirectEntry(body, directEntry, registerCount);
+
+    // same frame as the main entry, then straight to the loop header
+    std::list<std::pair<IRBlock *, Label>> osrEntries;
+    if (Speculative)
+    {
+        for (auto &block : IR->Blocks)
+        {
+            if (block->LoopHeader.Get() == block.get())
+            {
+                osrEntries.emplace_back();
+                osrEntries.back().first = block.get();
+                L(osrEntries.back().second);
+                EmitPrologue(frameSize);
+
+                auto checks = entryChecks.find(block.get());
+                if (checks != entryChecks.end())
+                {
+                    LoopEntryCheck(checks->first, checks->second);
+                }
+                jmp(labels[block->Index], T_NEAR);
+            }
+        }
+    }
+
+    auto code = GetCode();
+
+    if (hasDirectEntry)
+    {
+        DirectEntry = Relocate(directEntry.getAddress());
+    }
+
+    for (auto &pair : osrEntries)
+    {
+        pair.first->OsrEntry.store(reinterpret_cast<GeneratedCode>(Relocate(pair.second.getAddress())));
+    }
+
+    return code;
 }
 
 } // namespace vm
@@ -6,16 +6,47 @@
 #include "Runtime/Type.h"
 #include "GarbageCollection/GC.h"
 
+#include "CodeHeap.h"
+#include "JitSymbols.h"
 #include "VMDefs.h"
 
 #include "xbyak/xbyak/xbyak.h"
 
+#include <cstdlib>
+#include <list>
+#include <string>
+#include <utility>
+#include <vector>
+
 namespace hydra
 {
 namespace vm
 {
 
 struct IRFunc;
+struct IRInst;
+struct IRBlock;
+
+// the assembler buffer is plain memory that never runs, GetCode copies
+// the finished code into the CodeHeap
+class ScratchAllocator : public Xbyak::Allocator
+{
+public:
+    virtual uint8_t *alloc(size_t size) override
+    {
+        return static_cast<uint8_t *>(std::malloc(size));
+    }
+
+    virtual void free(uint8_t *p) override
+    {
+        std::free(p);
+    }
+
+    virtual bool useProtect() const override
+    {
+        return false;
+    }
+};
 
 class CompileTask : public Xbyak::CodeGenerator
 {
@@ -23,7 +54,8 @@ public:
     using Label = Xbyak::Label;
 
     CompileTask()
-        : Xbyak::CodeGenerator(4096, Xbyak::AutoGrow), Generated(nullptr)
+        : Xbyak::CodeGenerator(4096, Xbyak::AutoGrow, &Scratch), Generated(nullptr), Installed(nullptr), CodeSize(0),
+        DirectEntry(nullptr), DirectArgumentLimit(0)
     { }
 
     virtual GeneratedCode Compile(size_t &registerCount) = 0;
@@ -47,29 +79,130 @@ public:
         return Generated;
     }
 
+    inline size_t GetCodeSize() const
+    {
+        return CodeSize;
+    }
+
+    // the caches have to outlive the task, which is dropped once compiled
+    inline std::list<CallSiteCache> TakeCallSites()
+    {
+        return std::move(CallSites);
+    }
+
+    inline std::list<PropertyCacheSite> TakePropertySites()
+    {
+        return std::move(PropertySites);
+    }
+
+    inline std::vector<std::pair<u32, u32>> TakeInstOffsets()
+    {
+        return std::move(InstOffsets);
+    }
+
+    // nullptr if the code has no direct entry
+    inline const u8 *GetDirectEntry(size_t &argumentLimit) const
+    {
+        argumentLimit = DirectArgumentLimit;
+        return DirectEntry;
+    }
+
+    // how profilers name the code
+    virtual std::string SymbolName() const = 0;
+
 protected:
     GeneratedCode GetCode()
     {
+        // with labels resolved the code only jumps relative to itself, every
+        // absolute address it loads is outside the buffer, caches included, so
+        // it can be moved as it is. OSR entries are relocated by the caller
         ready();
-        return getCode<GeneratedCode>();
+        CodeSize = getSize();
+        Installed = CodeHeap::GetInstance()->Install(getCode(), CodeSize);
+
+        if (JitSymbols::Enabled)
+        {
+            JitSymbols::GetInstance()->Register(Installed, CodeSize, SymbolName(), InstOffsets);
+        }
+
+        return reinterpret_cast<GeneratedCode>(Installed);
+    }
+
+    // where an address in the assembler buffer ended up in the CodeHeap
+    inline u8 *Relocate(const u8 *address) const
+    {
+        return Installed + (address - getCode());
     }
 
     GeneratedCode Generated;
     size_t RegisterCount;
+
+    u8 *Installed;
+    size_t CodeSize;
+
+    // see BaselineCompileTask::EmitDirectEntry
+    const u8 *DirectEntry;
+    size_t DirectArgumentLimit;
+
+    // code offset where each IR instruction starts, by InstIndex
+    std::vector<std::pair<u32, u32>> InstOffsets;
+
+    // referenced by address from the generated code, must never move
+    std::list<CallSiteCache> CallSites;
+    std::list<PropertyCacheSite> PropertySites;
+
+    static ScratchAllocator Scratch;
 };
 
 class BaselineCompileTask : public CompileTask
 {
 public:
     BaselineCompileTask(IRFunc *ir)
-        : CompileTask(), IR(ir)
+        : BaselineCompileTask(ir, false)
     { }
 
     virtual GeneratedCode Compile(size_t &registerCount) override final;
+    virtual std::string SymbolName() const override;
     void CheckWrittenValue(Xbyak::Reg64 valueReg, Xbyak::Reg64 tmp1);
 
+protected:
+    BaselineCompileTask(IRFunc *ir, bool speculative)
+        : CompileTask(), IR(ir), Speculative(speculative), DeoptCount(0)
+    { }
+
 private:
+    void EmitPrologue(u32 frameSize);
+    void RecordFeedback(IRInst *inst);
+    void EmitDeopt(IRInst *inst, u8 feedback);
+    void SmallIntFastPath(IRInst *inst);
+    void LoadNumber(Xbyak::Reg64 value, Xbyak::Reg64 tag, const Xbyak::Xmm &number);
+    void NumberFastPath(IRInst *inst);
+    void KlassGuard(IRInst *obj, u64 entry);
+    u64 MonomorphicEntry(IRInst *inst);
+    void ArrayElementGuard(IRInst *obj, IRInst *key, bool indexKey, bool checkedOnEntry, Label &slowPath);
+    void LoopEntryCheck(IRBlock *header, const std::vector<std::pair<IRInst *, IRInst *>> &arrays);
+    void OsrCheck(IRBlock *header, Label &osrExit);
+    bool EmitDirectEntry(Label &body, Label &entry, size_t registerCount);
+
     IRFunc *IR;
+    bool Speculative;
+    size_t DeoptCount;
+};
+
+// same frame layout as baseline, but binary operations speculate on small
+// ints wherever baseline never saw anything else, else on numbers computed
+// as doubles, and property accesses on the one klass their baseline cache
+// saw. Arrays indexed below a bound their loop never changes are checked
+// once on entering the loop. A failed guard deoptimizes: the frame jumps into the baseline code of the
+// same instruction and IRFunc::Compiled goes back to baseline. Every loop
+// header gets an extra entry for on stack replacement, published in
+// IRBlock::OsrEntry
+class OptimizedCompileTask : public BaselineCompileTask
+{
+public:
+    OptimizedCompileTask(IRFunc *ir)
+        : BaselineCompileTask(ir, true)
+    { }
 };
 
 } // namespace vm
@@ -0,0 +1,161 @@
+#include "CompileQueue.h"
+
+#include "IR.h"
+#include "CompiledFunction.h"
+
+#include "Common/ThreadPool.h"
+
+#include <algorithm>
+
+namespace hydra
+{
+namespace vm
+{
+
+CompileQueue::CompileQueue(size_t maxCompilerThreads)
+    : Sequence(0), ActiveCompilers(0), MaxCompilerThreads(maxCompilerThreads)
+{ }
+
+void CompileQueue::EnqueueBaseline(IRFunc *func, CompilePriority priority)
+{
+    Enqueue(func, priority, false);
+}
+
+void CompileQueue::EnqueueOptimize(IRFunc *func)
+{
+    Enqueue(func, CompilePriority::High, true);
+}
+
+CompiledFunction *CompileQueue::WaitBaseline(IRFunc *func)
+{
+    if (!func->BaselineClaimed.exchange(true))
+    {
+        return CompiledFunction::Baseline(func);
+    }
+
+    // a compiler is working on it, or has just finished
+    return func->BaselineFuture.get();
+}
+
+void CompileQueue::Cancel(IRModule *module)
+{
+    DropAndWait([module](IRFunc *func)
+    {
+        return func->Module == module;
+    });
+}
+
+void CompileQueue::Drain()
+{
+    DropAndWait([](IRFunc *)
+    {
+        return true;
+    });
+}
+
+void CompileQueue::DropAndWait(std::function<bool(IRFunc *)> pred)
+{
+    std::unique_lock<std::mutex> lock(Mutex);
+
+    std::vector<Entry> kept;
+    while (!Pending.empty())
+    {
+        if (!pred(Pending.top().Func))
+        {
+            kept.push_back(Pending.top());
+        }
+        Pending.pop();
+    }
+
+    for (auto &entry : kept)
+    {
+        Pending.push(entry);
+    }
+
+    Finished.wait(lock, [&]()
+    {
+        return std::none_of(Running.begin(), Running.end(), pred);
+    });
+}
+
+void CompileQueue::SetMaxCompilerThreads(size_t maxCompilerThreads)
+{
+    hydra_assert(maxCompilerThreads > 0,
+        "at least one compiler thread is required");
+
+    {
+        std::lock_guard<std::mutex> lock(Mutex);
+        MaxCompilerThreads = maxCompilerThreads;
+    }
+
+    SpawnCompilers();
+}
+
+void CompileQueue::Enqueue(IRFunc *func, CompilePriority priority, bool optimize)
+{
+    {
+        std::lock_guard<std::mutex> lock(Mutex);
+        Pending.push(Entry{ func, priority, optimize, Sequence++ });
+    }
+
+    SpawnCompilers();
+}
+
+void CompileQueue::SpawnCompilers()
+{
+    size_t toSpawn = 0;
+
+    {
+        std::lock_guard<std::mutex> lock(Mutex);
+        while (ActiveCompilers < MaxCompilerThreads && ActiveCompilers < Pending.size())
+        {
+            ++ActiveCompilers;
+            ++toSpawn;
+        }
+    }
+
+    auto threadPool = ThreadPool::GetInstance();
+    while (toSpawn--)
+    {
+        threadPool->Dispatch<void>(&CompileQueue::CompilerWorker, this);
+    }
+}
+
+void CompileQueue::CompilerWorker()
+{
+    while (true)
+    {
+        Entry entry;
+
+        {
+            std::lock_guard<std::mutex> lock(Mutex);
+            if (Pending.empty() || ActiveCompilers > MaxCompilerThreads)
+            {
+                --ActiveCompilers;
+                return;
+            }
+
+            entry = Pending.top();
+            Pending.pop();
+            Running.push_back(entry.Func);
+        }
+
+        if (entry.Optimize)
+        {
+            CompiledFunction::Optimize(entry.Func);
+        }
+        else if (!entry.Func->BaselineClaimed.exchange(true))
+        {
+            CompiledFunction::Baseline(entry.Func);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(Mutex);
+            Running.erase(std::find(Running.begin(), Running.end(), entry.Func));
+        }
+        Finished.notify_all();
+    }
+}
+
+} // namespace vm
+} // namespace hydra
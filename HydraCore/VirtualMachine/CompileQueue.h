@@ -0,0 +1,99 @@
+#ifndef _COMPILE_QUEUE_H_
+#define _COMPILE_QUEUE_H_
+
+#include "Common/HydraCore.h"
+#include "Common/Singleton.h"
+
+#include "VMDefs.h"
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <vector>
+
+namespace hydra
+{
+namespace vm
+{
+
+enum class CompilePriority : u8
+{
+    Low,
+    Normal,
+    High
+};
+
+// compiles functions on ThreadPool workers, at most MaxCompilerThreads at a time
+class CompileQueue : public Singleton<CompileQueue>
+{
+public:
+    CompileQueue(size_t maxCompilerThreads = DEFAULT_MAX_COMPILER_THREADS);
+
+    void EnqueueBaseline(IRFunc *func, CompilePriority priority);
+    void EnqueueOptimize(IRFunc *func);
+
+    // the code to run for func, compiles on the calling thread if no worker picked it up yet
+    CompiledFunction *WaitBaseline(IRFunc *func);
+
+    // drops the entries of module and waits for compilers still working on
+    // its functions, so none of them outlives the module
+    void Cancel(IRModule *module);
+
+    // drops every entry and waits for all compilers in flight
+    void Drain();
+
+    void SetMaxCompilerThreads(size_t maxCompilerThreads);
+
+    inline size_t GetMaxCompilerThreads()
+    {
+        std::lock_guard<std::mutex> lock(Mutex);
+        return MaxCompilerThreads;
+    }
+
+    inline size_t GetPendingCount()
+    {
+        std::lock_guard<std::mutex> lock(Mutex);
+        return Pending.size();
+    }
+
+private:
+    struct Entry
+    {
+        IRFunc *Func;
+        CompilePriority Priority;
+        bool Optimize;
+        size_t Sequence;
+
+        inline bool operator < (const Entry &other) const
+        {
+            // higher priority first, then first come first served
+            if (Priority != other.Priority)
+            {
+                return Priority < other.Priority;
+            }
+            return Sequence > other.Sequence;
+        }
+    };
+
+    void Enqueue(IRFunc *func, CompilePriority priority, bool optimize);
+    void SpawnCompilers();
+    void CompilerWorker();
+    void DropAndWait(std::function<bool(IRFunc *)> pred);
+
+    std::mutex Mutex;
+    std::priority_queue<Entry> Pending;
+
+    // functions a compiler has taken from Pending, signaled when one is done
+    std::vector<IRFunc *> Running;
+    std::condition_variable Finished;
+
+    size_t Sequence;
+    size_t ActiveCompilers;
+    size_t MaxCompilerThreads;
+};
+
+} // namespace vm
+} // namespace hydra
+
+#endif // _COMPILE_QUEUE_H_
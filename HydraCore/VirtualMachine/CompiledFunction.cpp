@@ -1,9 +1,184 @@
 #include "CompiledFunction.h"
 
+#include "IR.h"
+#include "Optimizer.h"
+#include "CompileQueue.h"
+
+#include "Common/Logger.h"
+
+#include <algorithm>
+
 namespace hydra
 {
 namespace vm
 {
 
+const Metrics::Id CompiledFunction::CompileTime =
+    Metrics::GetInstance()->RegisterHistogram("jit.compile_us");
+const Metrics::Id CompiledFunction::Deopts =
+    Metrics::GetInstance()->RegisterCounter("jit.deopts");
+
+size_t CompiledFunction::GetInstIndex(const u8 *pc) const
+{
+    auto code = GetCode();
+    if (!code || pc < code || pc >= code + CodeSize)
+    {
+        return static_cast<size_t>(-1);
+    }
+
+    u32 offset = static_cast<u32>(pc - code);
+    auto iter = std::upper_bound(InstOffsets.begin(), InstOffsets.end(), offset,
+        [](u32 offset, const std::pair<u32, u32> &entry)
+    {
+        return offset < entry.first;
+    });
+
+    // before the first instruction, in the prologue
+    if (iter == InstOffsets.begin())
+    {
+        return static_cast<size_t>(-1);
+    }
+    return (--iter)->second;
+}
+
+const u8 *CompiledFunction::GetInstCode(size_t instIndex) const
+{
+    for (auto &entry : InstOffsets)
+    {
+        if (entry.second == instIndex)
+        {
+            return GetCode() + entry.first;
+        }
+    }
+    return nullptr;
+}
+
+const PropertyCacheSite *CompiledFunction::GetPropertySite(IRInst *inst) const
+{
+    for (auto &site : PropertySites)
+    {
+        if (site.Inst == inst)
+        {
+            return &site;
+        }
+    }
+    return nullptr;
+}
+
+CompiledFunction *CompiledFunction::Interpret(IRFunc *func)
+{
+    auto interpreted = func->Interpreted.load();
+    if (interpreted)
+    {
+        return interpreted;
+    }
+
+    if (!func->Interpretable)
+    {
+        return nullptr;
+    }
+
+    std::lock_guard<std::mutex> lock(func->IRMutex);
+    if (!func->InterpretedFunction && !func->InitialOptimized)
+    {
+        func->InterpretedFunction = std::make_unique<CompiledFunction>(
+            func,
+            InterpretedCode::Lower(func),
+            func->Length);
+        func->Interpreted.store(func->InterpretedFunction.get());
+    }
+
+    return func->InterpretedFunction.get();
+}
+
+CompiledFunction *CompiledFunction::Baseline(IRFunc *func)
+{
+    {
+        std::lock_guard<std::mutex> lock(func->IRMutex);
+
+        // already done if a caller inlined it
+        if (!func->InitialOptimized)
+        {
+            Optimizer::InitialOptimize(func);
+            func->InitialOptimized = true;
+        }
+    }
+
+    std::unique_ptr<CompileTask> task(new BaselineCompileTask(func));
+    func->BaselineFunction = std::make_unique<CompiledFunction>(
+        func,
+        std::move(task),
+        func->Length,
+        func->GetVarCount(),
+        func->ScopeEscaped);
+
+    auto baseline = func->BaselineFunction.get();
+
+    CompiledFunction *current = nullptr;
+    func->Compiled.compare_exchange_strong(current, baseline);
+
+    // a waiter may free func as soon as the promise is set
+    func->BaselinePromise.set_value(baseline);
+    return baseline;
+}
+
+CompiledFunction *CompiledFunction::Optimize(IRFunc *func)
+{
+    auto perfSession = Logger::GetInstance()->Perf("Optimize");
+
+    std::unique_ptr<CompileTask> task(new OptimizedCompileTask(func));
+    auto optimized = std::make_unique<CompiledFunction>(
+        func,
+        std::move(task),
+        func->Length,
+        func->GetVarCount(),
+        func->ScopeEscaped);
+
+    std::lock_guard<std::mutex> lock(func->IRMutex);
+    if (func->OptimizedFunction)
+    {
+        func->RetiredFunctions.push_back(std::move(func->OptimizedFunction));
+    }
+    func->OptimizedFunction = std::move(optimized);
+
+    // baseline stays alive, frames already running in it move over at loop headers
+    func->Compiled.store(func->OptimizedFunction.get());
+    return func->OptimizedFunction.get();
+}
+
+void CompiledFunction::Deoptimize(IRFunc *func, IRInst *inst, size_t deoptCount, u8 feedback)
+{
+    // the next round will not speculate on this instruction again
+    inst->Feedback.fetch_or(feedback, std::memory_order_relaxed);
+
+    std::lock_guard<std::mutex> lock(func->IRMutex);
+    if (func->DeoptCount.load() != deoptCount)
+    {
+        // a frame of an earlier round, its code is already replaced
+        return;
+    }
+
+    Metrics::Add(Deopts);
+    func->Compiled.store(func->BaselineFunction.get());
+    for (auto &block : func->Blocks)
+    {
+        block->OsrEntry.store(nullptr);
+    }
+
+    if (func->DeoptCount.fetch_add(1) + 1 < MAXIMAL_DEOPT_COUNT)
+    {
+        func->Hotness.store(0, std::memory_order_relaxed);
+        func->OptimizeRequested.store(false);
+    }
+}
+
+void CompiledFunction::RequestOptimize(IRFunc *func)
+{
+    if (!func->OptimizeRequested.exchange(true))
+    {
+        CompileQueue::GetInstance()->EnqueueOptimize(func);
+    }
+}
+
 }
 }
\ No newline at end of file
@@ -1,13 +1,20 @@
 #ifndef _COMPILED_FUNCTION_H_
 #define _COMPILED_FUNCTION_H_
 
+#include "Common/Tracer.h"
 #include "Runtime/Type.h"
 
 #include "Compile.h"
+#include "Interpreter.h"
 
 #include "VMDefs.h"
 
+#include <chrono>
+#include <list>
 #include <memory>
+#include <string>
+#include <utility>
+#include <vector>
 
 namespace hydra
 {
@@ -16,14 +23,50 @@ namespace vm
 
 class Scope;
 struct IRFunc;
+struct IRInst;
 
 class CompiledFunction
 {
 public:
-    CompiledFunction(std::unique_ptr<CompileTask> &&task, size_t length, size_t varCount)
-        : Task(std::move(task)), Func(nullptr), Length(length), VarCount(varCount)
+    // the task is dropped once its code is in the CodeHeap
+    CompiledFunction(IRFunc *owner, std::unique_ptr<CompileTask> &&task, size_t length, size_t varCount, bool scopeEscaped)
+        : Owner(owner), Func(nullptr), CodeSize(0), DirectEntry(nullptr), DirectArgumentLimit(0),
+        Length(length), VarCount(varCount), ScopeEscaped(scopeEscaped)
     {
-        Func = Task->Get(RegisterCount);
+        Tracer::Span span("jit", "Compile", task->SymbolName());
+        auto start = std::chrono::high_resolution_clock::now();
+
+        Func = task->Get(RegisterCount);
+        Metrics::Record(CompileTime, std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::high_resolution_clock::now() - start).count());
+
+        CodeSize = task->GetCodeSize();
+        CallSites = task->TakeCallSites();
+        PropertySites = task->TakePropertySites();
+        InstOffsets = task->TakeInstOffsets();
+        SymbolName = task->SymbolName();
+        DirectEntry = task->GetDirectEntry(DirectArgumentLimit);
+    }
+
+    CompiledFunction(IRFunc *owner, std::unique_ptr<InterpretedCode> &&code, size_t length)
+        : Owner(owner), Code(std::move(code)), Func(nullptr), CodeSize(0), DirectEntry(nullptr), DirectArgumentLimit(0),
+        Length(length), ScopeEscaped(false)
+    {
+        // parameters are copied into Table, closures never need the frame
+        RegisterCount = Code->GetRegisterCount();
+        VarCount = Code->GetVarCount();
+    }
+
+    CompiledFunction(const CompiledFunction &) = delete;
+    CompiledFunction &operator = (const CompiledFunction &) = delete;
+
+    // functions die with their module, so does their code
+    ~CompiledFunction()
+    {
+        if (Func)
+        {
+            CodeHeap::GetInstance()->Free(reinterpret_cast<u8 *>(Func), CodeSize);
+        }
     }
 
     inline bool Call(
@@ -32,7 +75,69 @@ public:
         runtime::JSValue &retVal,
         runtime::JSValue &error)
     {
-        return Func(allocator, scope, retVal, error);
+        if (Func)
+        {
+            return Func(allocator, scope, retVal, error);
+        }
+        return Code->Execute(allocator, scope, retVal, error);
+    }
+
+    inline bool IsInterpreted() const
+    {
+        return Func == nullptr;
+    }
+
+    inline bool IsScopeEscaped() const
+    {
+        return ScopeEscaped;
+    }
+
+    inline IRFunc *GetOwner() const
+    {
+        return Owner;
+    }
+
+    inline const u8 *GetCode() const
+    {
+        return reinterpret_cast<const u8 *>(Func);
+    }
+
+    inline size_t GetCodeSize() const
+    {
+        return CodeSize;
+    }
+
+    // empty for interpreted functions
+    inline const std::string &GetSymbolName() const
+    {
+        return SymbolName;
+    }
+
+    // index of the IR instruction that code at pc belongs to, -1 if none
+    size_t GetInstIndex(const u8 *pc) const;
+
+    // where the code of an IR instruction starts, nullptr if none
+    const u8 *GetInstCode(size_t instIndex) const;
+
+    // the property cache of inst, nullptr if inst has none
+    const PropertyCacheSite *GetPropertySite(IRInst *inst) const;
+
+    // nullptr unless compiled code can call it without EnterCompiled
+    inline const u8 *GetDirectEntry() const
+    {
+        return DirectEntry;
+    }
+
+    inline static size_t OffsetDirectEntry()
+    {
+        return reinterpret_cast<size_t>(
+            &reinterpret_cast<CompiledFunction*>(0)->DirectEntry);
+    }
+
+    inline static size_t OffsetDirectArgumentLimit()
+    {
+        return reinterpret_cast<size_t>(
+            &reinterpret_cast<CompiledFunction*>(0)->DirectArgumentLimit);
     }
 
     inline size_t GetRegisterCount() const
@@ -50,12 +155,45 @@ public:
         return VarCount;
     }
 
+    // nullptr if the IR has already been optimized
+    static CompiledFunction *Interpret(IRFunc *func);
+    static CompiledFunction *Baseline(IRFunc *func);
+    static CompiledFunction *Optimize(IRFunc *func);
+
+    // queues Optimize in background once per function
+    static void RequestOptimize(IRFunc *func);
+
+    // called by optimized code of round deoptCount when a guard of inst
+    // fails, before the frame continues in baseline code. feedback names
+    // the speculation that failed
+    static void Deoptimize(IRFunc *func, IRInst *inst, size_t deoptCount, u8 feedback);
+
+    // time spent generating code, baseline and optimized alike
+    static const Metrics::Id CompileTime;
+    static const Metrics::Id Deopts;
+
 protected:
-    std::unique_ptr<CompileTask> Task;
+    IRFunc *Owner;
+    std::unique_ptr<InterpretedCode> Code;
     GeneratedCode Func;
+    size_t CodeSize;
+
+    // where callers in compiled code enter with at most DirectArgumentLimit
+    // arguments, nullptr if the frame has to be built by EnterCompiled
+    const u8 *DirectEntry;
+    size_t DirectArgumentLimit;
+
+    // referenced by address from Func
+    std::list<CallSiteCache> CallSites;
+    std::list<PropertyCacheSite> PropertySites;
+
+    std::vector<std::pair<u32, u32>> InstOffsets;
+    std::string SymbolName;
+
     size_t RegisterCount;
     size_t Length;
     size_t VarCount;
+    bool ScopeEscaped;
 };
 
 } // namespace vm
@@ -0,0 +1,519 @@
+#include "HeapSnapshot.h"
+
+#include "Runtime/JSObject.h"
+#include "Runtime/Klass.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <typeinfo>
+#include <unordered_map>
+
+#ifdef __GNUG__
+#include <cxxabi.h>
+#endif
+
+namespace hydra
+{
+namespace vm
+{
+
+namespace
+{
+
+constexpr u32 UNDEFINED_NODE = static_cast<u32>(-1);
+constexpr u32 NO_GROUP = static_cast<u32>(-1);
+
+enum Grouping
+{
+    BY_TYPE,
+    BY_SHAPE,
+    BY_LEVEL,
+    GROUPING_NR
+};
+
+void EraseAll(std::string &str, const std::string &pattern)
+{
+    size_t pos;
+    while ((pos = str.find(pattern)) != std::string::npos)
+    {
+        str.erase(pos, pattern.size());
+    }
+}
+
+struct Groups
+{
+    std::map<std::string, u32> Ids;
+    std::vector<std::string> Names;
+    std::vector<HeapSnapshot::Entry> Entries;
+
+    u32 Get(const std::string &name)
+    {
+        auto iter = Ids.find(name);
+        if (iter != Ids.end())
+        {
+            return iter->second;
+        }
+
+        u32 id = static_cast<u32>(Names.size());
+        Ids.emplace(name, id);
+        Names.push_back(name);
+        Entries.emplace_back();
+        return id;
+    }
+
+    std::map<std::string, HeapSnapshot::Entry> ToMap() const
+    {
+        std::map<std::string, HeapSnapshot::Entry> out;
+        for (size_t i = 0; i < Names.size(); ++i)
+        {
+            out[Names[i]] = Entries[i];
+        }
+        return out;
+    }
+};
+
+void WriteEntry(std::ostream &out, const HeapSnapshot::Entry &entry, const std::string &name)
+{
+    out << entry.Count << '\t'
+        << entry.ShallowBytes << '\t'
+        << entry.RetainedBytes << '\t'
+        << name << '\n';
+}
+
+void WriteGroup(std::ostream &out, const char *title, const std::map<std::string, HeapSnapshot::Entry> &group)
+{
+    out << '\n' << "[" << title << "] count shallow retained name" << '\n';
+    for (auto &pair : group)
+    {
+        WriteEntry(out, pair.second, pair.first);
+    }
+}
+
+} // namespace
+
+HeapSnapshot HeapSnapshot::Take(gc::ThreadAllocator &allocator)
+{
+    HeapSnapshot snapshot;
+
+    // the stack of this thread is scanned as that of an inactive one
+    allocator.SetInactive();
+    gc::Heap::GetInstance()->RunWithWorldStopped([&]()
+    {
+        snapshot = TakeStopped();
+    });
+    allocator.SetActive();
+
+    return snapshot;
+}
+
+HeapSnapshot HeapSnapshot::TakeStopped()
+{
+    HeapSnapshot snapshot;
+    auto heap = gc::Heap::GetInstance();
+
+    // node 0 is a virtual root pointing at every root
+    std::vector<gc::HeapObject *> objects { nullptr };
+    std::vector<size_t> sizes { 0 };
+    std::unordered_map<gc::HeapObject *, u32> indices;
+
+    heap->ForeachObject([&](gc::HeapObject *obj, size_t size)
+    {
+        indices.emplace(obj, static_cast<u32>(objects.size()));
+        objects.push_back(obj);
+        sizes.push_back(size);
+    });
+
+    gc::Region::ForeachRegion([&](gc::Region *)
+    {
+        ++snapshot.RegionCount;
+    });
+
+    size_t count = objects.size();
+
+    // outgoing references, edgeBegin[i]..edgeBegin[i + 1] belong to node i
+    std::vector<u32> edgeBegin(count + 1, 0);
+    std::vector<u32> edges;
+
+    auto addEdge = [&](gc::HeapObject *obj)
+    {
+        if (!obj)
+        {
+            return;
+        }
+
+        auto iter = indices.find(obj);
+        if (iter != indices.end())
+        {
+            edges.push_back(iter->second);
+        }
+    };
+
+    heap->ScanRoots(addEdge);
+    gc::ThreadAllocator::ScanParkedThreads(addEdge);
+    edgeBegin[1] = static_cast<u32>(edges.size());
+
+    for (size_t i = 1; i < count; ++i)
+    {
+        objects[i]->Scan(addEdge);
+        edgeBegin[i + 1] = static_cast<u32>(edges.size());
+    }
+
+    // depth first from the root for a postorder
+    std::vector<u32> postorder;
+    std::vector<u32> postIndex(count, UNDEFINED_NODE);
+    {
+        std::vector<bool> visited(count, false);
+        std::vector<std::pair<u32, u32>> stack { { 0, edgeBegin[0] } };
+        visited[0] = true;
+
+        while (!stack.empty())
+        {
+            auto &top = stack.back();
+            if (top.second < edgeBegin[top.first + 1])
+            {
+                u32 next = edges[top.second++];
+                if (!visited[next])
+                {
+                    visited[next] = true;
+                    stack.emplace_back(next, edgeBegin[next]);
+                }
+            }
+            else
+            {
+                postIndex[top.first] = static_cast<u32>(postorder.size());
+                postorder.push_back(top.first);
+                stack.pop_back();
+            }
+        }
+    }
+
+    // incoming references among reachable nodes
+    std::vector<u32> predBegin(count + 1, 0);
+    std::vector<u32> preds(edges.size());
+    for (u32 from : postorder)
+    {
+        for (u32 e = edgeBegin[from]; e < edgeBegin[from + 1]; ++e)
+        {
+            ++predBegin[edges[e] + 1];
+        }
+    }
+    for (size_t i = 0; i < count; ++i)
+    {
+        predBegin[i + 1] += predBegin[i];
+    }
+    {
+        std::vector<u32> fill(predBegin.begin(), predBegin.end() - 1);
+        for (u32 from : postorder)
+        {
+            for (u32 e = edgeBegin[from]; e < edgeBegin[from + 1]; ++e)
+            {
+                preds[fill[edges[e]]++] = from;
+            }
+        }
+    }
+
+    // immediate dominators, Cooper, Harvey and Kennedy's iteration in reverse postorder
+    std::vector<u32> idom(count, UNDEFINED_NODE);
+    idom[0] = 0;
+
+    auto intersect = [&](u32 a, u32 b)
+    {
+        while (a != b)
+        {
+            while (postIndex[a] < postIndex[b])
+            {
+                a = idom[a];
+            }
+            while (postIndex[b] < postIndex[a])
+            {
+                b = idom[b];
+            }
+        }
+        return a;
+    };
+
+    for (bool changed = true; changed; )
+    {
+        changed = false;
+        for (auto iter = postorder.rbegin(); iter != postorder.rend(); ++iter)
+        {
+            u32 node = *iter;
+            if (node == 0)
+            {
+                continue;
+            }
+
+            u32 newIdom = UNDEFINED_NODE;
+            for (u32 p = predBegin[node]; p < predBegin[node + 1]; ++p)
+            {
+                u32 pred = preds[p];
+                if (idom[pred] == UNDEFINED_NODE)
+                {
+                    continue;
+                }
+
+                newIdom = (newIdom == UNDEFINED_NODE) ? pred : intersect(pred, newIdom);
+            }
+
+            if (idom[node] != newIdom)
+            {
+                idom[node] = newIdom;
+                changed = true;
+            }
+        }
+    }
+
+    // a dominator always comes later in postorder than what it dominates
+    std::vector<size_t> retained(count, 0);
+    for (u32 node : postorder)
+    {
+        retained[node] += sizes[node];
+        if (node != 0)
+        {
+            retained[idom[node]] += retained[node];
+        }
+    }
+
+    // census
+    Groups groups[GROUPING_NR];
+    std::vector<u32> groupOf[GROUPING_NR];
+    for (auto &group : groupOf)
+    {
+        group.resize(count, NO_GROUP);
+    }
+
+    for (size_t i = 1; i < count; ++i)
+    {
+        auto obj = objects[i];
+        std::string shape = ShapeName(obj);
+
+        groupOf[BY_TYPE][i] = groups[BY_TYPE].Get(TypeName(obj));
+        groupOf[BY_LEVEL][i] = groups[BY_LEVEL].Get(LevelName(obj, sizes[i]));
+        if (!shape.empty())
+        {
+            groupOf[BY_SHAPE][i] = groups[BY_SHAPE].Get(shape);
+        }
+
+        for (size_t g = 0; g < GROUPING_NR; ++g)
+        {
+            if (groupOf[g][i] != NO_GROUP)
+            {
+                auto &entry = groups[g].Entries[groupOf[g][i]];
+                entry.Count++;
+                entry.ShallowBytes += sizes[i];
+            }
+        }
+
+        snapshot.Total.Count++;
+        snapshot.Total.ShallowBytes += sizes[i];
+        if (obj->IsLarge())
+        {
+            snapshot.LargeCount++;
+        }
+
+        if (postIndex[i] != UNDEFINED_NODE)
+        {
+            snapshot.Reachable.Count++;
+            snapshot.Reachable.ShallowBytes += sizes[i];
+        }
+    }
+    snapshot.Total.RetainedBytes = retained[0];
+    snapshot.Reachable.RetainedBytes = retained[0];
+
+    // walk the dominator tree, a node adds to its group's retained size
+    // unless a member of the same group already dominates it
+    std::vector<u32> childBegin(count + 1, 0);
+    std::vector<u32> children(postorder.empty() ? 0 : postorder.size() - 1);
+    for (u32 node : postorder)
+    {
+        if (node != 0)
+        {
+            ++childBegin[idom[node] + 1];
+        }
+    }
+    for (size_t i = 0; i < count; ++i)
+    {
+        childBegin[i + 1] += childBegin[i];
+    }
+    {
+        std::vector<u32> fill(childBegin.begin(), childBegin.end() - 1);
+        for (u32 node : postorder)
+        {
+            if (node != 0)
+            {
+                children[fill[idom[node]]++] = node;
+            }
+        }
+    }
+
+    std::vector<u32> onPath[GROUPING_NR];
+    for (size_t g = 0; g < GROUPING_NR; ++g)
+    {
+        onPath[g].resize(groups[g].Names.size(), 0);
+    }
+
+    std::vector<std::pair<u32, u32>> stack { { 0, childBegin[0] } };
+    while (!stack.empty())
+    {
+        auto &top = stack.back();
+        if (top.second < childBegin[top.first + 1])
+        {
+            u32 next = children[top.second++];
+            for (size_t g = 0; g < GROUPING_NR; ++g)
+            {
+                u32 group = groupOf[g][next];
+                if (group != NO_GROUP && onPath[g][group]++ == 0)
+                {
+                    groups[g].Entries[group].RetainedBytes += retained[next];
+                }
+            }
+            stack.emplace_back(next, childBegin[next]);
+        }
+        else
+        {
+            u32 node = top.first;
+            for (size_t g = 0; g < GROUPING_NR; ++g)
+            {
+                u32 group = groupOf[g][node];
+                if (group != NO_GROUP)
+                {
+                    onPath[g][group]--;
+                }
+            }
+            stack.pop_back();
+        }
+    }
+
+    snapshot.ByType = groups[BY_TYPE].ToMap();
+    snapshot.ByShape = groups[BY_SHAPE].ToMap();
+    snapshot.ByLevel = groups[BY_LEVEL].ToMap();
+
+    std::vector<u32> top;
+    for (u32 node : postorder)
+    {
+        if (node != 0)
+        {
+            top.push_back(node);
+        }
+    }
+
+    size_t topCount = std::min(top.size(), HEAP_SNAPSHOT_TOP_DOMINATORS);
+    std::partial_sort(top.begin(), top.begin() + topCount, top.end(),
+        [&](u32 a, u32 b) { return retained[a] > retained[b]; });
+
+    for (size_t i = 0; i < topCount; ++i)
+    {
+        u32 node = top[i];
+        snapshot.Dominators.push_back(Dominator {
+            groups[BY_TYPE].Names[groupOf[BY_TYPE][node]],
+            ShapeName(objects[node]),
+            sizes[node],
+            retained[node]
+        });
+    }
+
+    return snapshot;
+}
+
+void HeapSnapshot::Write(std::ostream &out) const
+{
+    out << "# hydra heap snapshot" << '\n';
+    WriteEntry(out, Total, "total");
+    WriteEntry(out, Reachable, "reachable");
+    out << "regions " << RegionCount << '\n';
+    out << "large " << LargeCount << '\n';
+
+    WriteGroup(out, "type", ByType);
+    WriteGroup(out, "shape", ByShape);
+    WriteGroup(out, "level", ByLevel);
+
+    out << '\n' << "[dominators] shallow retained type shape" << '\n';
+    for (auto &dominator : Dominators)
+    {
+        out << dominator.ShallowBytes << '\t'
+            << dominator.RetainedBytes << '\t'
+            << dominator.Type << '\t'
+            << dominator.Shape << '\n';
+    }
+}
+
+bool HeapSnapshot::Write(const std::string &path) const
+{
+    std::ofstream out(path);
+    if (!out)
+    {
+        return false;
+    }
+
+    Write(out);
+    return static_cast<bool>(out);
+}
+
+std::string HeapSnapshot::TypeName(gc::HeapObject *obj)
+{
+    std::string name = typeid(*obj).name();
+
+#ifdef __GNUG__
+    int status = 0;
+    char *demangled = abi::__cxa_demangle(name.c_str(), nullptr, nullptr, &status);
+    if (demangled)
+    {
+        name = demangled;
+        free(demangled);
+    }
+#endif
+
+    EraseAll(name, "class ");
+    EraseAll(name, "struct ");
+    EraseAll(name, "hydra::");
+    EraseAll(name, "runtime::");
+    EraseAll(name, "vm::");
+    EraseAll(name, "gc::");
+
+    return name;
+}
+
+std::string HeapSnapshot::ShapeName(gc::HeapObject *obj)
+{
+    auto object = dynamic_cast<runtime::JSObject *>(obj);
+    if (!object)
+    {
+        return "";
+    }
+
+    std::string name = "{";
+    auto klass = object->GetKlass();
+    if (klass)
+    {
+        bool first = true;
+        for (auto key : *klass)
+        {
+            if (!first)
+            {
+                name += ",";
+            }
+            first = false;
+            name += key ? key->ToString() : "?";
+        }
+    }
+    name += "}";
+
+    return name;
+}
+
+std::string HeapSnapshot::LevelName(gc::HeapObject *obj, size_t size)
+{
+    if (obj->IsLarge())
+    {
+        return "large";
+    }
+
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "%02zu %zuB",
+        gc::Region::GetRegionOfObject(obj)->GetLevel(), size);
+    return buffer;
+}
+
+} // namespace vm
+} // namespace hydra
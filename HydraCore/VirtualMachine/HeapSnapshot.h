@@ -0,0 +1,76 @@
+#ifndef _HEAP_SNAPSHOT_H_
+#define _HEAP_SNAPSHOT_H_
+
+#include "Common/HydraCore.h"
+
+#include "GarbageCollection/GC.h"
+
+#include "VMDefs.h"
+
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace hydra
+{
+namespace vm
+{
+
+// census of every live cell, grouped by C++ type, by the shape of JSObjects
+// and by size level. Retained sizes come from the dominator tree over the
+// registered roots plus the stack of every thread; cells nothing reaches
+// are counted but retain nothing. Take stops the world, other threads wait
+// at their next checkpoint until the snapshot is done
+class HeapSnapshot
+{
+public:
+    struct Entry
+    {
+        size_t Count = 0;
+        size_t ShallowBytes = 0;
+
+        // bytes freed if the group went away: objects dominated by another
+        // member of the same group are not counted again
+        size_t RetainedBytes = 0;
+    };
+
+    struct Dominator
+    {
+        std::string Type;
+        std::string Shape;
+        size_t ShallowBytes;
+        size_t RetainedBytes;
+    };
+
+    // allocator belongs to the calling thread, inactive while the world is stopped
+    static HeapSnapshot Take(gc::ThreadAllocator &allocator);
+
+    // lines sorted by group name, so two snapshots diff cleanly
+    void Write(std::ostream &out) const;
+    bool Write(const std::string &path) const;
+
+    Entry Total;
+    Entry Reachable;
+    size_t RegionCount = 0;
+    size_t LargeCount = 0;
+
+    std::map<std::string, Entry> ByType;
+    std::map<std::string, Entry> ByShape;
+    std::map<std::string, Entry> ByLevel;
+    std::vector<Dominator> Dominators;
+
+    // demangled, without namespaces
+    static std::string TypeName(gc::HeapObject *obj);
+
+private:
+    static HeapSnapshot TakeStopped();
+
+    static std::string ShapeName(gc::HeapObject *obj);
+    static std::string LevelName(gc::HeapObject *obj, size_t size);
+};
+
+} // namespace vm
+} // namespace hydra
+
+#endif // _HEAP_SNAPSHOT_H_
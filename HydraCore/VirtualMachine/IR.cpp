@@ -1,6 +1,8 @@
 #include "IR.h"
 
 #include "IRInsts.h"
+#include "ByteCode.h"
+#include "CompileQueue.h"
 
 #include "GarbageCollection/GC.h"
 
@@ -20,9 +22,82 @@ IRModule::IRModule(runtime::JSArray *stringsReferenced)
 
 IRModule::~IRModule()
 {
+    // queued entries and running compilers hold plain pointers to our functions
+    CompileQueue::GetInstance()->Cancel(this);
     IRModuleGCHelper::GetInstance()->RemoveModule(this);
 }
 
+void IRModule::Materialize(gc::ThreadAllocator &allocator, IRFunc *func)
+{
+    if (func->Materialized.load())
+    {
+        return;
+    }
+
+    std::vector<IRFunc *> materialized;
+    {
+        // the holder may be allocating, gc must not wait for this thread meanwhile
+        std::unique_lock<std::mutex> lock(SourceMutex, std::try_to_lock);
+        if (!lock.owns_lock())
+        {
+            allocator.SetInactive();
+            lock.lock();
+            allocator.SetActive();
+        }
+
+        std::vector<IRFunc *> worklist{ func };
+        while (!worklist.empty())
+        {
+            auto current = worklist.back(); worklist.pop_back();
+            if (current->Materialized.load())
+            {
+                continue;
+            }
+
+            Source->Materialize(allocator, current);
+            current->Materialized = true;
+            materialized.push_back(current);
+
+            for (auto &block : current->Blocks)
+            {
+                for (auto &inst : block->Insts)
+                {
+                    if (!inst->Is<ir::Call>())
+                    {
+                        continue;
+                    }
+
+                    auto callee = inst->As<ir::Call>()->_Callee.Get();
+                    if (callee->Is<ir::Func>())
+                    {
+                        worklist.push_back(Functions[callee->As<ir::Func>()->FuncId].get());
+                    }
+                    else if (callee->Is<ir::Arrow>())
+                    {
+                        worklist.push_back(Functions[callee->As<ir::Arrow>()->FuncId].get());
+                    }
+                }
+            }
+        }
+    }
+
+    if (OnMaterialize)
+    {
+        for (auto current : materialized)
+        {
+            OnMaterialize(current);
+        }
+    }
+}
+
+void IRModule::MaterializeAll(gc::ThreadAllocator &allocator)
+{
+    for (auto &func : Functions)
+    {
+        Materialize(allocator, func.get());
+    }
+}
+
 size_t IRFunc::GetVarCount() const
 {
     size_t varCount = 0;
@@ -11,11 +11,13 @@
 
 #include "Common/Singleton.h"
 
+#include <functional>
 #include <list>
 #include <set>
 #include <vector>
 #include <memory>
 #include <future>
+#include <mutex>
 #include <ostream>
 
 namespace hydra
@@ -46,6 +48,16 @@ struct IRInst : public Replacable<struct IRInst>
 
     size_t InstIndex;
 
+    // bits are set by baseline code, the caches and deoptimization on any
+    // thread and never cleared, the optimized tier reads them when compiling
+    static constexpr u8 FEEDBACK_NOT_SMALL_INT = 1u;
+    static constexpr u8 FEEDBACK_NOT_NUMBER = 2u;
+    static constexpr u8 FEEDBACK_NOT_MONOMORPHIC = 4u;
+    // on the first instruction of a loop header, the array check on entering
+    // the loop failed
+    static constexpr u8 FEEDBACK_NOT_IN_BOUNDS = 8u;
+    std::atomic<u8> Feedback{ 0 };
+
     virtual void Dump(std::ostream &os) = 0;
 };
 
@@ -67,10 +79,14 @@ struct IRBlock : public Replacable<struct IRBlock>
     IRBlock::Ref LoopPrev;
     size_t LoopDepth;
 
+    // entry into optimized code at this loop header, taken by baseline code on back edges
+    std::atomic<GeneratedCode> OsrEntry{ nullptr };
+
     void Dump(std::ostream &os);
 };
 
 struct IRModule;
+class ByteCode;
 
 struct IRFunc
 {
@@ -78,7 +94,18 @@ struct IRFunc
         : Module(module),
         Name(name),
         Length(length),
+        Materialized(true),
+        ScopeEscaped(true),
+        Hotness(0),
+        OptimizeRequested(false),
+        DeoptCount(0),
+        BaselineClaimed(false),
+        BaselineRequested(false),
+        Interpretable(true),
+        InitialOptimized(false),
+        Interpreted(nullptr),
         Compiled(nullptr),
+        BaselineFuture(BaselinePromise.get_future().share()),
         BaselineFunction(nullptr),
         OptimizedFunction(nullptr)
     { }
@@ -88,13 +115,47 @@ struct IRFunc
     runtime::String *Name;
     size_t Length;
 
+    // false while Blocks and Name still sit in IRModule::Source
+    std::atomic<bool> Materialized;
+
+    // false if no closure or inner scope can reference the frame of a call,
+    // filled by Optimizer::ScopeEscapeAnalyze
+    bool ScopeEscaped;
+
+    // invocations plus back edges taken in baseline code, drives tier up
+    std::atomic<size_t> Hotness;
+    std::atomic<bool> OptimizeRequested;
+
+    // failed speculations that sent the function back to baseline, also
+    // tells optimized code of an earlier round from the current one
+    std::atomic<size_t> DeoptCount;
+
+    // set by whoever starts the baseline compilation, a compile worker or the first caller
+    std::atomic<bool> BaselineClaimed;
+    std::atomic<bool> BaselineRequested;
+
+    // false if interpreted frames could get stuck in a hot loop, as they can
+    // not be transferred into compiled code
+    bool Interpretable;
+
+    // guards Blocks between lowering for the interpreter and InitialOptimize
+    std::mutex IRMutex;
+    bool InitialOptimized;
+
+    std::atomic<CompiledFunction *> Interpreted;
+
     std::atomic<CompiledFunction *> Compiled;
 
+    std::promise<CompiledFunction *> BaselinePromise;
     std::shared_future<CompiledFunction *> BaselineFuture;
 
+    std::unique_ptr<CompiledFunction> InterpretedFunction;
     std::unique_ptr<CompiledFunction> BaselineFunction;
     std::unique_ptr<CompiledFunction> OptimizedFunction;
 
+    // optimized code that was replaced, frames may still be running in it
+    std::vector<std::unique_ptr<CompiledFunction>> RetiredFunctions;
+
     inline size_t UpdateIndex()
     {
         size_t blockIndex = 0;
@@ -112,6 +173,12 @@ struct IRFunc
 
     size_t GetVarCount() const;
 
+    inline static size_t OffsetCompiled()
+    {
+        return reinterpret_cast<size_t>(
+            &reinterpret_cast<IRFunc*>(0)->Compiled);
+    }
+
     void Dump(std::ostream &os);
 };
 
@@ -125,8 +192,20 @@ struct IRModule
 
     ~IRModule();
 
+    // reads func from Source on its first instantiation. Functions it calls
+    // right where they are created come along, so the inliner sees them
+    void Materialize(gc::ThreadAllocator &allocator, IRFunc *func);
+    void MaterializeAll(gc::ThreadAllocator &allocator);
+
     std::vector<std::unique_ptr<IRFunc>> Functions;
     runtime::JSArray *StringsReferenced;
+
+    // the bytecode of a lazily loaded module, kept for its pending functions
+    std::unique_ptr<ByteCode> Source;
+    std::mutex SourceMutex;
+
+    // called with each function materialized after the load
+    std::function<void(IRFunc *)> OnMaterialize;
 };
 
 class IRModuleGCHelper : public Singleton<IRModuleGCHelper>
@@ -181,6 +181,13 @@ struct GetItem : public IRInst
     Ref _Obj;
     Ref _Key;
 
+    // _Key is proven a non-negative small int, filled by Optimizer::RangeAnalyze
+    bool IndexKey = false;
+
+    // _Key is below Bound within the innermost loop, where _Obj and Bound
+    // never change. nullptr if not proven, filled by Optimizer::RangeAnalyze
+    IRInst *Bound = nullptr;
+
     DUMP("get_item",
         DUMP_REF(_Obj) _()
         DUMP_REF(_Key)
@@ -194,6 +201,13 @@ struct SetItem : public IRInst
     Ref _Key;
     Ref _Value;
 
+    // _Key is proven a non-negative small int, filled by Optimizer::RangeAnalyze
+    bool IndexKey = false;
+
+    // _Key is below Bound within the innermost loop, where _Obj and Bound
+    // never change. nullptr if not proven, filled by Optimizer::RangeAnalyze
+    IRInst *Bound = nullptr;
+
     DUMP("set_item",
         DUMP_REF(_Obj) _()
         DUMP_REF(_Key) _()
@@ -251,7 +265,7 @@ struct GetGlobal : public IRInst
 
 struct SetGlobal : public IRInst
 {
-    DECL_INST(GET_GLOBAL)
+    DECL_INST(SET_GLOBAL)
     runtime::String *Name;
     Ref _Value;
 
@@ -0,0 +1,628 @@
+#include "Interpreter.h"
+
+#include "IR.h"
+#include "IRInsts.h"
+#include "Scope.h"
+#include "CompileQueue.h"
+
+#include "Runtime/Semantic.h"
+#include "Common/Platform.h"
+
+#include <map>
+
+#ifdef NULL
+#undef NULL
+#endif
+
+#ifdef TRUE
+#undef TRUE
+#endif
+
+#ifdef FALSE
+#undef FALSE
+#endif
+
+#ifdef IN
+#undef IN
+#endif
+
+#ifdef THIS
+#undef THIS
+#endif
+
+namespace hydra
+{
+namespace vm
+{
+
+using JSValue = runtime::JSValue;
+
+static inline JSValue *AddressOf(JSValue value)
+{
+    return reinterpret_cast<JSValue *>(value.Payload & cexpr::Mask(0, 48));
+}
+
+static inline JSValue FromAddress(JSValue *address)
+{
+    return JSValue(reinterpret_cast<u64>(address));
+}
+
+static inline void SetRegister(runtime::Array *regs, u32 index, JSValue value)
+{
+    regs->at(index) = value;
+    if (value.IsReference() && value.ToReference())
+    {
+        gc::Heap::WriteBarrierIfInHeap(gc::Heap::GetInstance(), regs, value.ToReference());
+    }
+}
+
+std::unique_ptr<InterpretedCode> InterpretedCode::Lower(IRFunc *func)
+{
+    std::unique_ptr<InterpretedCode> code(new InterpretedCode(func));
+
+    // registers are numbered in the order of instructions, like IRFunc::UpdateIndex
+    std::map<IRInst *, u32> registers;
+    size_t allocaCount = 0;
+    for (auto &block : func->Blocks)
+    {
+        for (auto &inst : block->Insts)
+        {
+            registers.emplace(inst.get(), static_cast<u32>(registers.size()));
+            if (inst->Is<ir::Alloca>())
+            {
+                ++allocaCount;
+            }
+        }
+    }
+
+    auto reg = [&](IRInst *inst) -> u32
+    {
+        auto iter = registers.find(inst);
+        hydra_assert(iter != registers.end(),
+            "operand must be defined in the same function");
+        return iter->second;
+    };
+
+    auto operands = [&](const std::list<IRInst::Ref> &refs) -> u32
+    {
+        u32 offset = static_cast<u32>(code->Operands.size());
+        for (auto &ref : refs)
+        {
+            code->Operands.push_back(reg(ref.Get()));
+        }
+        return offset;
+    };
+
+    std::map<IRBlock *, u32> entries;
+    std::vector<std::pair<size_t, IRBlock *>> consequents;
+    std::vector<std::pair<size_t, IRBlock *>> alternates;
+
+    for (auto &block : func->Blocks)
+    {
+        entries[block.get()] = static_cast<u32>(code->Insts.size());
+
+        bool returned = false;
+        for (auto &inst : block->Insts)
+        {
+            InterpretedInst lowered = {};
+            lowered.Type = static_cast<u32>(inst->GetType());
+            lowered.Result = reg(inst.get());
+
+            switch (inst->GetType())
+            {
+            case RETURN:
+                lowered.A = reg(inst->As<ir::Return>()->_Value.Get());
+                returned = true;
+                break;
+            case LOAD:
+                lowered.A = reg(inst->As<ir::Load>()->_Addr.Get());
+                break;
+            case STORE:
+                lowered.A = reg(inst->As<ir::Store>()->_Addr.Get());
+                lowered.B = reg(inst->As<ir::Store>()->_Value.Get());
+                break;
+            case GET_ITEM:
+                lowered.A = reg(inst->As<ir::GetItem>()->_Obj.Get());
+                lowered.B = reg(inst->As<ir::GetItem>()->_Key.Get());
+                break;
+            case SET_ITEM:
+                lowered.A = reg(inst->As<ir::SetItem>()->_Obj.Get());
+                lowered.B = reg(inst->As<ir::SetItem>()->_Key.Get());
+                lowered.C = reg(inst->As<ir::SetItem>()->_Value.Get());
+                break;
+            case DEL_ITEM:
+                lowered.A = reg(inst->As<ir::DelItem>()->_Obj.Get());
+                lowered.B = reg(inst->As<ir::DelItem>()->_Key.Get());
+                break;
+            case NEW:
+                lowered.A = reg(inst->As<ir::New>()->_Callee.Get());
+                lowered.B = reg(inst->As<ir::New>()->_Args.Get());
+                break;
+            case CALL:
+                lowered.A = reg(inst->As<ir::Call>()->_Callee.Get());
+                lowered.B = reg(inst->As<ir::Call>()->_ThisArg.Get());
+                lowered.C = reg(inst->As<ir::Call>()->_Args.Get());
+                code->CallSites.emplace_back();
+                lowered.Cache = &code->CallSites.back();
+                break;
+            case GET_GLOBAL:
+                lowered.Name = inst->As<ir::GetGlobal>()->Name;
+                break;
+            case SET_GLOBAL:
+                lowered.Name = inst->As<ir::SetGlobal>()->Name;
+                lowered.A = reg(inst->As<ir::SetGlobal>()->_Value.Get());
+                break;
+            case UNDEFINED:
+                lowered.Payload = JSValue::UNDEFINED_PAYLOAD;
+                break;
+            case NULL:
+                lowered.Payload = JSValue::FromObject(nullptr).Payload;
+                break;
+            case TRUE:
+                lowered.Payload = JSValue::FromBoolean(true).Payload;
+                break;
+            case FALSE:
+                lowered.Payload = JSValue::FromBoolean(false).Payload;
+                break;
+            case NUMBER:
+            {
+                double intpart;
+                double value = inst->As<ir::Number>()->Value;
+                if (value < (1ll << 47) && (value > -(1ll << 47)) &&
+                    std::modf(value, &intpart) == 0.0)
+                {
+                    lowered.Payload = JSValue::FromSmallInt(static_cast<i64>(intpart)).Payload;
+                }
+                else
+                {
+                    lowered.Payload = JSValue::FromNumber(value).Payload;
+                }
+                break;
+            }
+            case STRING:
+                lowered.Payload = JSValue::FromString(inst->As<ir::String>()->Value).Payload;
+                break;
+            case REGEX:
+                hydra_trap("Not supporting regex");
+                break;
+            case OBJECT:
+            {
+                auto &initialization = inst->As<ir::Object>()->Initialization;
+                lowered.A = static_cast<u32>(code->Operands.size());
+                lowered.B = static_cast<u32>(initialization.size());
+                for (auto &pair : initialization)
+                {
+                    code->Operands.push_back(reg(pair.first.Get()));
+                    code->Operands.push_back(reg(pair.second.Get()));
+                }
+                break;
+            }
+            case ARRAY:
+                lowered.A = operands(inst->As<ir::Array>()->Initialization);
+                lowered.B = static_cast<u32>(inst->As<ir::Array>()->Initialization.size());
+                break;
+            case FUNC:
+                lowered.Func = func->Module->Functions[inst->As<ir::Func>()->FuncId].get();
+                lowered.A = operands(inst->As<ir::Func>()->Captured);
+                lowered.B = static_cast<u32>(inst->As<ir::Func>()->Captured.size());
+                break;
+            case ARROW:
+                lowered.Func = func->Module->Functions[inst->As<ir::Arrow>()->FuncId].get();
+                lowered.A = operands(inst->As<ir::Arrow>()->Captured);
+                lowered.B = static_cast<u32>(inst->As<ir::Arrow>()->Captured.size());
+                break;
+            case ADD: case SUB: case MUL: case DIV: case MOD:
+            case BAND: case BOR: case BXOR:
+            case SLL: case SRL: case SRR:
+            case EQ: case EQQ: case NE: case NEE:
+            case GT: case GE: case LT: case LE:
+            case IN: case INSTANCEOF:
+                lowered.A = reg(inst->As<ir::Binary>()->_A.Get());
+                lowered.B = reg(inst->As<ir::Binary>()->_B.Get());
+                break;
+            case BNOT: case LNOT: case TYPEOF:
+                lowered.A = reg(inst->As<ir::Unary>()->_A.Get());
+                break;
+            case PUSH_SCOPE:
+                lowered.Index = inst->As<ir::PushScope>()->Size;
+                lowered.A = operands(inst->As<ir::PushScope>()->Captured);
+                lowered.B = static_cast<u32>(inst->As<ir::PushScope>()->Captured.size());
+                break;
+            case POP_SCOPE:
+            case ALLOCA:
+                break;
+            case ARG:
+                lowered.Index = inst->As<ir::Arg>()->Index;
+                break;
+            case CAPTURE:
+                lowered.Index = inst->As<ir::Capture>()->Index;
+                break;
+            case THIS:
+            case ARGUMENTS:
+                break;
+            case MOVE:
+                lowered.A = reg(inst->As<ir::Move>()->_Other.Get());
+                break;
+            case PHI:
+                hydra_trap("Phi is not expected before optimization");
+                break;
+            case DEBUGGER:
+                break;
+            default:
+                hydra_trap("Unknown inst");
+            }
+
+            code->Insts.push_back(lowered);
+
+            if (returned)
+            {
+                break;
+            }
+        }
+
+        if (returned)
+        {
+            continue;
+        }
+
+        if (block->Condition)
+        {
+            InterpretedInst branch = {};
+            branch.Type = BRANCH;
+            branch.A = reg(block->Condition.Get());
+
+            consequents.emplace_back(code->Insts.size(), block->Consequent.Get());
+            alternates.emplace_back(code->Insts.size(), block->Alternate.Get());
+            code->Insts.push_back(branch);
+        }
+        else if (block->Consequent)
+        {
+            InterpretedInst jump = {};
+            jump.Type = JUMP;
+
+            consequents.emplace_back(code->Insts.size(), block->Consequent.Get());
+            code->Insts.push_back(jump);
+        }
+    }
+
+    for (auto &pair : consequents)
+    {
+        code->Insts[pair.first].Target = entries.at(pair.second);
+    }
+
+    for (auto &pair : alternates)
+    {
+        code->Insts[pair.first].C = entries.at(pair.second);
+    }
+
+    // allocas of inner scopes go to their own tables, counting all of them
+    // here only wastes a few slots
+    code->RegisterCount = registers.size();
+    code->ArgCount = func->Length;
+    code->VarCount = allocaCount + func->Length;
+
+    return code;
+}
+
+void InterpretedCode::CountBackEdge()
+{
+    // a hot loop gets its baseline code queued right away, later calls run
+    // compiled while this frame finishes in the interpreter
+    if (Owner->Hotness.fetch_add(1, std::memory_order_relaxed) + 1 >= JIT_HOTNESS_THRESHOLD &&
+        !Owner->BaselineRequested.load(std::memory_order_relaxed) &&
+        !Owner->BaselineRequested.exchange(true))
+    {
+        CompileQueue::GetInstance()->EnqueueBaseline(Owner, CompilePriority::High);
+    }
+}
+
+bool InterpretedCode::Execute(gc::ThreadAllocator &allocator, Scope *scope, JSValue &retVal, JSValue &error)
+{
+    namespace semantic = runtime::semantic;
+
+    auto heap = gc::Heap::GetInstance();
+    runtime::Array *regs = scope->GetRegs();
+
+    // parameters get slots of their own, like ArgToLocalAllocaAndMoveCapture
+    // does for compiled code, missing ones are left as not exists
+    JSValue *argSlots = nullptr;
+    for (size_t i = 0; i < ArgCount; ++i)
+    {
+        JSValue *slot = scope->Allocate();
+        if (!argSlots)
+        {
+            argSlots = slot;
+        }
+
+        if (i < scope->GetArguments()->GetLength())
+        {
+            *slot = scope->GetArguments()->at(i);
+            if (slot->IsReference() && slot->ToReference())
+            {
+                gc::Heap::WriteBarrierIfInHeap(heap, slot, slot->ToReference());
+            }
+        }
+    }
+
+    size_t pc = 0;
+    while (pc < Insts.size())
+    {
+        const InterpretedInst &inst = Insts[pc++];
+
+        switch (inst.Type)
+        {
+        case RETURN:
+        {
+            retVal = regs->at(inst.A);
+            if (retVal.IsReference() && retVal.ToReference())
+            {
+                gc::Heap::WriteBarrierIfInHeap(heap, &retVal, retVal.ToReference());
+            }
+            return true;
+        }
+        case LOAD:
+        {
+            SetRegister(regs, inst.Result, *AddressOf(regs->at(inst.A)));
+            break;
+        }
+        case STORE:
+        {
+            JSValue *address = AddressOf(regs->at(inst.A));
+            JSValue value = regs->at(inst.B);
+            *address = value;
+            if (value.IsReference() && value.ToReference())
+            {
+                gc::Heap::WriteBarrierIfInHeap(heap, address, value.ToReference());
+            }
+            break;
+        }
+        case GET_ITEM:
+        {
+            if (!semantic::ObjectGet(allocator, regs->at(inst.A), regs->at(inst.B), regs->at(inst.Result), error))
+            {
+                return false;
+            }
+            break;
+        }
+        case SET_ITEM:
+        {
+            if (!semantic::ObjectSet(allocator, regs->at(inst.A), regs->at(inst.B), regs->at(inst.C), error))
+            {
+                return false;
+            }
+            break;
+        }
+        case DEL_ITEM:
+        {
+            if (!semantic::ObjectDelete(allocator, regs->at(inst.A), regs->at(inst.B), error))
+            {
+                return false;
+            }
+            break;
+        }
+        case NEW:
+        {
+            auto arguments = static_cast<runtime::JSArray *>(regs->at(inst.B).Object());
+            if (!semantic::NewObject(allocator, regs->at(inst.A), arguments, regs->at(inst.Result), error))
+            {
+                return false;
+            }
+            break;
+        }
+        case CALL:
+        {
+            auto arguments = static_cast<runtime::JSArray *>(regs->at(inst.C).Object());
+            if (!semantic::CallWithCache(allocator, regs->at(inst.A), regs->at(inst.B), arguments, regs->at(inst.Result), error, inst.Cache))
+            {
+                return false;
+            }
+            break;
+        }
+        case GET_GLOBAL:
+        {
+            if (!semantic::GetGlobal(allocator, inst.Name, regs->at(inst.Result), error))
+            {
+                return false;
+            }
+            break;
+        }
+        case SET_GLOBAL:
+        {
+            if (!semantic::SetGlobal(allocator, inst.Name, regs->at(inst.A), error))
+            {
+                return false;
+            }
+            break;
+        }
+        case UNDEFINED:
+        case NULL:
+        case TRUE:
+        case FALSE:
+        case NUMBER:
+        case STRING:
+        {
+            SetRegister(regs, inst.Result, JSValue(inst.Payload));
+            break;
+        }
+        case OBJECT:
+        {
+            JSValue object = JSValue::FromObject(semantic::NewEmptyObjectSafe(allocator));
+            SetRegister(regs, inst.Result, object);
+
+            for (size_t i = 0; i < inst.B; ++i)
+            {
+                JSValue key = regs->at(Operands[inst.A + 2 * i]);
+                JSValue value = regs->at(Operands[inst.A + 2 * i + 1]);
+                if (!semantic::ObjectSet(allocator, object, key, value, error))
+                {
+                    return false;
+                }
+            }
+            break;
+        }
+        case ARRAY:
+        {
+            auto array = semantic::NewArrayInternal(allocator, inst.B);
+            SetRegister(regs, inst.Result, JSValue::FromObject(array));
+
+            for (size_t i = 0; i < inst.B; ++i)
+            {
+                if (!semantic::ObjectSetSafeArray(allocator, array, i, regs->at(Operands[inst.A + i]), error))
+                {
+                    return false;
+                }
+            }
+            break;
+        }
+        case FUNC:
+        case ARROW:
+        {
+            auto captured = runtime::RangeArray::New(allocator, inst.B);
+            for (size_t i = 0; i < inst.B; ++i)
+            {
+                captured->at(i) = regs->at(Operands[inst.A + i]);
+            }
+
+            bool result = (inst.Type == FUNC)
+                ? semantic::NewFunc(allocator, scope, inst.Func, captured, regs->at(inst.Result), error)
+                : semantic::NewArrow(allocator, scope, inst.Func, captured, regs->at(inst.Result), error);
+            if (!result)
+            {
+                return false;
+            }
+            break;
+        }
+
+#define CASE_BINARY(BIN, func)                                                                              \
+        case BIN:                                                                                           \
+        {                                                                                                   \
+            if (!semantic::func(allocator, regs->at(inst.A), regs->at(inst.B), regs->at(inst.Result), error)) \
+            {                                                                                               \
+                return false;                                                                               \
+            }                                                                                               \
+            break;                                                                                          \
+        }
+        CASE_BINARY(ADD, OpAdd);
+        CASE_BINARY(SUB, OpSub);
+        CASE_BINARY(MUL, OpMul);
+        CASE_BINARY(DIV, OpDiv);
+        CASE_BINARY(MOD, OpMod);
+        CASE_BINARY(BAND, OpBand);
+        CASE_BINARY(BOR, OpBor);
+        CASE_BINARY(BXOR, OpBxor);
+        CASE_BINARY(SLL, OpSll);
+        CASE_BINARY(SRL, OpSrl);
+        CASE_BINARY(SRR, OpSrr);
+        CASE_BINARY(EQ, OpEq);
+        CASE_BINARY(EQQ, OpEqq);
+        CASE_BINARY(NE, OpNe);
+        CASE_BINARY(NEE, OpNee);
+        CASE_BINARY(LT, OpLt);
+        CASE_BINARY(LE, OpLe);
+        CASE_BINARY(GT, OpGt);
+        CASE_BINARY(GE, OpGe);
+        CASE_BINARY(IN, OpIn);
+        CASE_BINARY(INSTANCEOF, OpInstanceOf);
+#undef CASE_BINARY
+
+#define CASE_UNARY(UNA, func)                                                       \
+        case UNA:                                                                   \
+        {                                                                           \
+            if (!semantic::func(allocator, regs->at(inst.A), regs->at(inst.Result), error)) \
+            {                                                                       \
+                return false;                                                       \
+            }                                                                       \
+            break;                                                                  \
+        }
+        CASE_UNARY(BNOT, OpBnot);
+        CASE_UNARY(LNOT, OpLnot);
+        CASE_UNARY(TYPEOF, OpTypeOf);
+#undef CASE_UNARY
+
+        case PUSH_SCOPE:
+        {
+            auto captured = runtime::RangeArray::New(allocator, inst.B);
+            for (size_t i = 0; i < inst.B; ++i)
+            {
+                captured->at(i) = regs->at(Operands[inst.A + i]);
+            }
+
+            scope = semantic::NewScope(allocator, scope, inst.Index, captured);
+            Scope::ThreadTop = scope;
+            break;
+        }
+        case POP_SCOPE:
+        {
+            scope = scope->GetUpper();
+            Scope::ThreadTop = scope;
+            break;
+        }
+        case ALLOCA:
+        {
+            regs->at(inst.Result) = FromAddress(scope->Allocate());
+            break;
+        }
+        case ARG:
+        {
+            regs->at(inst.Result) = FromAddress(argSlots + inst.Index);
+            break;
+        }
+        case CAPTURE:
+        {
+            SetRegister(regs, inst.Result, scope->GetCaptured()->at(inst.Index));
+            break;
+        }
+        case THIS:
+        {
+            SetRegister(regs, inst.Result, scope->GetThisArg());
+            break;
+        }
+        case ARGUMENTS:
+        {
+            if (!semantic::GetArguments(allocator, scope, regs->at(inst.Result), error))
+            {
+                return false;
+            }
+            break;
+        }
+        case MOVE:
+        {
+            SetRegister(regs, inst.Result, regs->at(inst.A));
+            break;
+        }
+        case DEBUGGER:
+        {
+            platform::Break();
+            break;
+        }
+        case JUMP:
+        {
+            if (inst.Target < pc)
+            {
+                CountBackEdge();
+            }
+            pc = inst.Target;
+            break;
+        }
+        case BRANCH:
+        {
+            size_t target = semantic::ToBoolean(regs->at(inst.A)) ? inst.Target : inst.C;
+            if (target < pc)
+            {
+                CountBackEdge();
+            }
+            pc = target;
+            break;
+        }
+        default:
+            hydra_trap("Unknown inst");
+        }
+    }
+
+    // fell off the end without a return
+    retVal = JSValue(JSValue::UNDEFINED_PAYLOAD);
+    return true;
+}
+
+} // namespace vm
+} // namespace hydra
@@ -0,0 +1,81 @@
+#ifndef _INTERPRETER_H_
+#define _INTERPRETER_H_
+
+#include "Common/HydraCore.h"
+#include "Runtime/Type.h"
+
+#include "VMDefs.h"
+
+#include <list>
+#include <memory>
+#include <vector>
+
+namespace hydra
+{
+namespace vm
+{
+
+// one lowered IR instruction, registers are indices into Scope::Regs
+struct InterpretedInst
+{
+    u32 Type;
+    u32 Result;
+    u32 A;
+    u32 B;
+    u32 C;
+
+    union
+    {
+        u64 Payload;                // constants
+        runtime::String *Name;      // get_global, set_global
+        IRFunc *Func;               // func, arrow
+        CallSiteCache *Cache;       // call
+        size_t Index;               // arg, capture, size of push_scope
+        size_t Target;              // jump, consequent of branch
+    };
+};
+
+// dense form of an IRFunc as loaded, before any optimization. It keeps no
+// reference to the IR, which is free to be optimized and compiled meanwhile
+class InterpretedCode
+{
+public:
+    static std::unique_ptr<InterpretedCode> Lower(IRFunc *func);
+
+    bool Execute(gc::ThreadAllocator &allocator, Scope *scope, runtime::JSValue &retVal, runtime::JSValue &error);
+
+    inline size_t GetRegisterCount() const
+    {
+        return RegisterCount;
+    }
+
+    // leading allocas plus a slot for each parameter
+    inline size_t GetVarCount() const
+    {
+        return VarCount;
+    }
+
+private:
+    InterpretedCode(IRFunc *owner)
+        : Owner(owner), RegisterCount(0), VarCount(0), ArgCount(0)
+    { }
+
+    void CountBackEdge();
+
+    IRFunc *Owner;
+    std::vector<InterpretedInst> Insts;
+
+    // variable length operands of object, array, func, arrow and push_scope
+    std::vector<u32> Operands;
+
+    std::list<CallSiteCache> CallSites;
+
+    size_t RegisterCount;
+    size_t VarCount;
+    size_t ArgCount;
+};
+
+} // namespace vm
+} // namespace hydra
+
+#endif // _INTERPRETER_H_
@@ -0,0 +1,214 @@
+#include "JitSymbols.h"
+
+#ifndef _MSC_VER
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+namespace hydra
+{
+namespace vm
+{
+
+#ifndef _MSC_VER
+
+// see tools/perf/Documentation/jitdump-specification.txt in the linux tree
+static constexpr u32 JITDUMP_MAGIC = 0x4A695444;
+static constexpr u32 JITDUMP_VERSION = 1;
+static constexpr u32 JITDUMP_ELF_MACHINE_X86_64 = 62;
+
+static constexpr u32 JIT_CODE_LOAD = 0;
+static constexpr u32 JIT_CODE_DEBUG_INFO = 2;
+
+struct JitDumpHeader
+{
+    u32 Magic;
+    u32 Version;
+    u32 TotalSize;
+    u32 ElfMachine;
+    u32 Padding;
+    u32 Pid;
+    u64 Timestamp;
+    u64 Flags;
+};
+
+struct JitDumpRecordHeader
+{
+    u32 Id;
+    u32 TotalSize;
+    u64 Timestamp;
+};
+
+// followed by the name and the code
+struct JitDumpCodeLoad
+{
+    JitDumpRecordHeader Header;
+    u32 Pid;
+    u32 Tid;
+    u64 Vma;
+    u64 CodeAddress;
+    u64 CodeSize;
+    u64 CodeIndex;
+};
+
+// followed by the entries, each one followed by its file name
+struct JitDumpDebugInfo
+{
+    JitDumpRecordHeader Header;
+    u64 CodeAddress;
+    u64 EntryCount;
+};
+
+struct JitDumpDebugEntry
+{
+    u64 CodeAddress;
+    u32 Line;
+    u32 Discriminator;
+};
+
+// perf record -k mono orders the records by this clock
+static u64 MonotonicTimestamp()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<u64>(ts.tv_sec) * 1000000000ull + static_cast<u64>(ts.tv_nsec);
+}
+
+#endif
+
+JitSymbols::JitSymbols()
+    : PerfMap(nullptr), JitDump(nullptr), JitDumpMarker(nullptr), CodeIndex(0)
+{
+#ifndef _MSC_VER
+
+#ifdef HYDRA_ENABLE_PERF_MAP
+    PerfMap = std::fopen(("/tmp/perf-" + std::to_string(getpid()) + ".map").c_str(), "w");
+#endif
+
+#ifdef HYDRA_ENABLE_JITDUMP
+    JitDump = std::fopen(("./jit-" + std::to_string(getpid()) + ".dump").c_str(), "w+");
+    if (JitDump)
+    {
+        // perf record spots the dump by this executable mapping of it
+        JitDumpMarker = mmap(nullptr, sysconf(_SC_PAGESIZE), PROT_READ | PROT_EXEC, MAP_PRIVATE, fileno(JitDump), 0);
+        if (JitDumpMarker == MAP_FAILED)
+        {
+            JitDumpMarker = nullptr;
+        }
+
+        JitDumpHeader header{
+            JITDUMP_MAGIC,
+            JITDUMP_VERSION,
+            sizeof(JitDumpHeader),
+            JITDUMP_ELF_MACHINE_X86_64,
+            0,
+            static_cast<u32>(getpid()),
+            MonotonicTimestamp(),
+            0
+        };
+        std::fwrite(&header, sizeof(header), 1, JitDump);
+        std::fflush(JitDump);
+    }
+#endif
+
+#endif
+}
+
+JitSymbols::~JitSymbols()
+{
+    if (PerfMap)
+    {
+        std::fclose(PerfMap);
+    }
+
+#ifndef _MSC_VER
+    if (JitDumpMarker)
+    {
+        munmap(JitDumpMarker, sysconf(_SC_PAGESIZE));
+    }
+#endif
+
+    if (JitDump)
+    {
+        std::fclose(JitDump);
+    }
+}
+
+void JitSymbols::Register(
+    const u8 *code,
+    size_t size,
+    const std::string &name,
+    const std::vector<std::pair<u32, u32>> &instOffsets)
+{
+    std::lock_guard<std::mutex> lock(Mutex);
+
+    if (PerfMap)
+    {
+        std::fprintf(PerfMap, "%llx %llx %s\n",
+            static_cast<unsigned long long>(reinterpret_cast<uintptr_t>(code)),
+            static_cast<unsigned long long>(size),
+            name.c_str());
+        std::fflush(PerfMap);
+    }
+
+    if (JitDump)
+    {
+        WriteJitDump(code, size, name, instOffsets);
+    }
+}
+
+void JitSymbols::WriteJitDump(
+    const u8 *code,
+    size_t size,
+    const std::string &name,
+    const std::vector<std::pair<u32, u32>> &instOffsets)
+{
+#ifndef _MSC_VER
+    auto address = static_cast<u64>(reinterpret_cast<uintptr_t>(code));
+    auto timestamp = MonotonicTimestamp();
+
+    // has to come before the code it describes
+    if (!instOffsets.empty())
+    {
+        std::string fileName = name + ".ir";
+
+        JitDumpDebugInfo info;
+        info.Header.Id = JIT_CODE_DEBUG_INFO;
+        info.Header.TotalSize = static_cast<u32>(sizeof(info) +
+            instOffsets.size() * (sizeof(JitDumpDebugEntry) + fileName.size() + 1));
+        info.Header.Timestamp = timestamp;
+        info.CodeAddress = address;
+        info.EntryCount = instOffsets.size();
+        std::fwrite(&info, sizeof(info), 1, JitDump);
+
+        for (auto &pair : instOffsets)
+        {
+            // lines count from 1
+            JitDumpDebugEntry entry{ address + pair.first, pair.second + 1, 0 };
+            std::fwrite(&entry, sizeof(entry), 1, JitDump);
+            std::fwrite(fileName.c_str(), fileName.size() + 1, 1, JitDump);
+        }
+    }
+
+    JitDumpCodeLoad load;
+    load.Header.Id = JIT_CODE_LOAD;
+    load.Header.TotalSize = static_cast<u32>(sizeof(load) + name.size() + 1 + size);
+    load.Header.Timestamp = timestamp;
+    load.Pid = static_cast<u32>(getpid());
+    load.Tid = static_cast<u32>(syscall(SYS_gettid));
+    load.Vma = address;
+    load.CodeAddress = address;
+    load.CodeSize = size;
+    load.CodeIndex = CodeIndex++;
+
+    std::fwrite(&load, sizeof(load), 1, JitDump);
+    std::fwrite(name.c_str(), name.size() + 1, 1, JitDump);
+    std::fwrite(code, size, 1, JitDump);
+    std::fflush(JitDump);
+#endif
+}
+
+} // namespace vm
+} // namespace hydra
@@ -0,0 +1,64 @@
+#ifndef _JIT_SYMBOLS_H_
+#define _JIT_SYMBOLS_H_
+
+#include "Common/HydraCore.h"
+#include "Common/Singleton.h"
+
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace hydra
+{
+namespace vm
+{
+
+// tells linux perf what generated code is. HYDRA_ENABLE_PERF_MAP appends
+// to /tmp/perf-<pid>.map, HYDRA_ENABLE_JITDUMP writes ./jit-<pid>.dump with
+// the code bytes and the IR instruction of each address as its line, for
+// perf inject --jit. Nothing is written on other platforms. Neither format
+// records unloads, so CodeHeap never hands out an address range twice while
+// symbols are enabled, and every entry stays valid to the end of the process
+class JitSymbols : public Singleton<JitSymbols>
+{
+public:
+    static constexpr bool Enabled =
+#if defined(HYDRA_ENABLE_PERF_MAP) || defined(HYDRA_ENABLE_JITDUMP)
+        true;
+#else
+        false;
+#endif
+
+    JitSymbols();
+    ~JitSymbols();
+
+    // instOffsets pairs a code offset with the index of the IR instruction
+    // emitted from there on, in increasing order
+    void Register(
+        const u8 *code,
+        size_t size,
+        const std::string &name,
+        const std::vector<std::pair<u32, u32>> &instOffsets);
+
+private:
+    void WriteJitDump(
+        const u8 *code,
+        size_t size,
+        const std::string &name,
+        const std::vector<std::pair<u32, u32>> &instOffsets);
+
+    std::mutex Mutex;
+
+    std::FILE *PerfMap;
+
+    std::FILE *JitDump;
+    void *JitDumpMarker;
+    u64 CodeIndex;
+};
+
+} // namespace vm
+} // namespace hydra
+
+#endif // _JIT_SYMBOLS_H_
@@ -1,8 +1,14 @@
 #include "Optimizer.h"
 
+#include "Runtime/Semantic.h"
+
+#include <cmath>
+#include <cstring>
 #include <stack>
 #include <queue>
 #include <map>
+#include <mutex>
+#include <tuple>
 
 #ifdef NULL
 #undef NULL
@@ -37,9 +43,24 @@ void Optimizer::InitialOptimize(IRFunc *func)
     ArgToLocalAllocaAndMoveCapture(func);
     MemToReg(func);
     CleanupBlocks(func);
-    LoopAnalyze(func);
     RemoveMove(func);
+    InlineCalls(func);
+    ScalarReplaceLiterals(func);
+    ConstantPropagate(func);
+    GlobalValueNumbering(func);
+    RemoveDeadCode(func);
+    LoopAnalyze(func);
     RemoveLoopInvariant(func);
+    RangeAnalyze(func);
+    ScopeEscapeAnalyze(func);
+}
+
+void Optimizer::Reanalyze(IRFunc *func)
+{
+    ControlFlowAnalyze(func);
+    LoopAnalyze(func);
+    RangeAnalyze(func);
+    ScopeEscapeAnalyze(func);
 }
 
 void Optimizer::RemoveAfterReturn(IRFunc *func)
@@ -1006,206 +1027,1374 @@ void Optimizer::CleanupBlocks(IRFunc *func)
     RemoveUnreferencedBlocks(func);
 }
 
-void Optimizer::LoopAnalyze(IRFunc *func)
+void Optimizer::InlineCalls(IRFunc *func)
 {
-    std::vector<bool> visited(func->Blocks.size(), false);
-    std::vector<bool> inStack(func->Blocks.size(), false);
-    std::vector<IRBlock *> stack;
+    // functions whose IRMutex is held by this thread, they are never waited for
+    static thread_local std::vector<IRFunc *> inlining;
 
-    auto updateLoopHeader = [&](IRBlock *header)
+    inlining.push_back(func);
+
+    size_t growth = 0;
+    bool inlined = false;
+
+    for (auto blockIter = func->Blocks.begin(); blockIter != func->Blocks.end(); ++blockIter)
     {
-        for (auto iter = stack.rbegin(); iter != stack.rend(); ++iter)
+        auto block = blockIter->get();
+
+        for (auto iter = block->Insts.begin(); iter != block->Insts.end(); ++iter)
         {
-            if ((*iter)->LoopHeader)
-            {
-                if (DominatedBy(header, (*iter)->LoopHeader.Get()))
-                {
-                    (*iter)->LoopHeader = header;
-                }
-            }
-            else
+            if (!(*iter)->Is<ir::Call>())
             {
-                (*iter)->LoopHeader = header;
+                continue;
             }
 
-            if ((*iter) == header)
+            auto call = (*iter)->As<ir::Call>();
+            if (!call->_Args->Is<ir::Array>())
             {
-                break;
+                continue;
             }
-        }
-    };
-
-    std::function<void(IRBlock *)> dfs = [&](IRBlock *block)
-    {
-        visited[block->Index] = true;
-        inStack[block->Index] = true;
-        stack.push_back(block);
 
-        if (block->Consequent)
-        {
-            if (inStack[block->Consequent->Index])
+            IRFunc *callee = nullptr;
+            bool isArrow = false;
+            if (call->_Callee->Is<ir::Func>())
             {
-                auto header = block->Consequent.Get();
-                updateLoopHeader(header);
+                callee = func->Module->Functions[call->_Callee->As<ir::Func>()->FuncId].get();
             }
-            else if (visited[block->Consequent->Index])
+            else if (call->_Callee->Is<ir::Arrow>())
             {
-                auto header = block->Consequent->LoopHeader.Get();
-                if (header)
-                {
-                    updateLoopHeader(header);
-                }
+                callee = func->Module->Functions[call->_Callee->As<ir::Arrow>()->FuncId].get();
+                isArrow = true;
             }
-            else
+
+            // a callee still in the bytecode has never been created, nor called
+            if (!callee || !callee->Materialized.load() ||
+                std::find(inlining.begin(), inlining.end(), callee) != inlining.end())
             {
-                dfs(block->Consequent.Get());
+                continue;
             }
-        }
 
-        if (block->Alternate)
-        {
-            if (inStack[block->Alternate->Index])
+            // a busy callee is being lowered or optimized by another thread, skip it
+            std::unique_lock<std::mutex> lock(callee->IRMutex, std::try_to_lock);
+            if (!lock.owns_lock())
             {
-                auto header = block->Alternate.Get();
-                updateLoopHeader(header);
+                continue;
             }
-            else if (visited[block->Alternate->Index])
+
+            auto countInsts = [&]()
             {
-                auto header = block->Alternate->LoopHeader.Get();
-                if (header)
+                size_t count = 0;
+                for (auto &calleeBlock : callee->Blocks)
                 {
-                    updateLoopHeader(header);
+                    count += calleeBlock->Insts.size();
+                }
+                return count;
+            };
+
+            if (!callee->InitialOptimized)
+            {
+                // loaded IR shrinks a lot in MemToReg, but do not give up the interpreter for a large callee
+                if (countInsts() > 2 * INLINE_INSTRUCTION_LIMIT)
+                {
+                    continue;
                 }
+
+                InitialOptimize(callee);
+                callee->InitialOptimized = true;
             }
-            else
+
+            size_t calleeSize = countInsts();
+            if (calleeSize > INLINE_INSTRUCTION_LIMIT ||
+                growth + calleeSize > INLINE_GROWTH_BUDGET ||
+                !IsInlinable(callee, isArrow))
             {
-                dfs(block->Alternate.Get());
+                continue;
+            }
+
+            if (InlineCall(func, blockIter, iter, callee))
+            {
+                growth += calleeSize;
+                inlined = true;
+
+                // the rest of block is moved to the block after the inlined ones
+                break;
             }
         }
+    }
 
-        inStack[block->Index] = false;
-        stack.pop_back();
-    };
+    inlining.pop_back();
 
-    dfs(func->Blocks.front().get());
+    if (inlined)
+    {
+        RebuildControlFlow(func);
+    }
+}
 
-    std::fill(visited.begin(), visited.end(), false);
-    std::function<void(IRBlock *)> dfsToUpdateDepth = [&](IRBlock *block)
+// the value a NUMBER inst materializes into, see BaselineCompileTask::Compile
+static runtime::JSValue NumberConstant(double value)
+{
+    double intpart;
+    if (value < (1ll << 47) && (value > -(1ll << 47)) &&
+        std::modf(value, &intpart) == 0.0)
     {
-        visited[block->Index] = true;
-        if (block->LoopHeader)
-        {
-            if (block->LoopHeader.Get() == block)
-            {
-                auto iter = std::find_if(
-                    block->Precedences.begin(),
-                    block->Precedences.end(),
-                    [&](const IRBlock::Ref &prec)
-                    {
-                        return !DominatedBy(prec.Get(), block);
-                    }
-                );
+        return runtime::JSValue::FromSmallInt(static_cast<i64>(intpart));
+    }
+    return runtime::JSValue::FromNumber(value);
+}
 
-                hydra_assert(iter != block->Precedences.end(),
-                    "Loop must have a previous");
+static inline bool IsNumeric(runtime::JSValue value)
+{
+    auto type = runtime::JSValue::GetType(value);
+    return type == runtime::Type::T_SMALL_INT || type == runtime::Type::T_NUMBER;
+}
 
-                block->LoopPrev = iter->Get();
+static inline double NumericValue(runtime::JSValue value)
+{
+    return (runtime::JSValue::GetType(value) == runtime::Type::T_SMALL_INT) ?
+        value.SmallInt() :
+        value.Number();
+}
 
-                iter = std::find_if(
-                    block->Precedences.begin(),
-                    block->Precedences.end(),
-                    [&](const IRBlock::Ref &prec)
-                    {
-                        return (prec.Get() != block->LoopPrev.Get()) &&
-                            !DominatedBy(prec.Get(), block);
-                    }
-                );
-                hydra_assert(iter == block->Precedences.end(),
-                    "Loop must have only one previous");
+// follows the fast paths in runtime::semantic, false for anything else
+static bool FoldConstant(size_t type, runtime::JSValue a, runtime::JSValue b, runtime::JSValue &result)
+{
+    using runtime::JSValue;
+    using runtime::Type;
 
-                hydra_assert(visited[block->LoopPrev->Index],
-                    "loop previous must be visited");
-                block->LoopDepth = block->LoopPrev->LoopDepth + 1;
-            }
-            else
+    bool smallInts = JSValue::GetType(a) == Type::T_SMALL_INT &&
+        JSValue::GetType(b) == Type::T_SMALL_INT;
+    bool numbers = IsNumeric(a) && IsNumeric(b);
+
+    switch (type)
+    {
+    case ADD:
+        if (smallInts)
+        {
+            result = JSValue::FromSmallInt(a.SmallInt() + b.SmallInt());
+            return true;
+        }
+        else if (numbers)
+        {
+            result = JSValue::FromNumber(NumericValue(a) + NumericValue(b));
+            return true;
+        }
+        return false;
+    case SUB:
+        if (smallInts)
+        {
+            result = JSValue::FromSmallInt(a.SmallInt() - b.SmallInt());
+            return true;
+        }
+        else if (numbers)
+        {
+            result = JSValue::FromNumber(NumericValue(a) - NumericValue(b));
+            return true;
+        }
+        return false;
+    case MUL:
+        if (smallInts)
+        {
+            result = JSValue::FromSmallInt(static_cast<i64>(
+                static_cast<u64>(a.SmallInt()) * static_cast<u64>(b.SmallInt())));
+            return true;
+        }
+        else if (numbers)
+        {
+            result = JSValue::FromNumber(NumericValue(a) * NumericValue(b));
+            return true;
+        }
+        return false;
+    case DIV:
+        if (numbers)
+        {
+            result = JSValue::FromNumber(NumericValue(a) / NumericValue(b));
+            return true;
+        }
+        return false;
+    case MOD:
+        if (smallInts)
+        {
+            if (b.SmallInt() == 0)
             {
-                block->LoopPrev = block->LoopHeader->LoopPrev;
-                block->LoopDepth = block->LoopHeader->LoopDepth;
+                return false;
             }
+            result = JSValue::FromSmallInt(a.SmallInt() % b.SmallInt());
+            return true;
+        }
+        else if (numbers)
+        {
+            result = JSValue::FromNumber(std::fmod(NumericValue(a), NumericValue(b)));
+            return true;
+        }
+        return false;
+    case LT:
+        if (numbers)
+        {
+            result = JSValue::FromBoolean(NumericValue(a) < NumericValue(b));
+            return true;
+        }
+        return false;
+    case LE:
+        if (numbers)
+        {
+            result = JSValue::FromBoolean(NumericValue(a) <= NumericValue(b));
+            return true;
+        }
+        return false;
+    case GT:
+        if (numbers)
+        {
+            result = JSValue::FromBoolean(NumericValue(a) > NumericValue(b));
+            return true;
+        }
+        return false;
+    case GE:
+        if (numbers)
+        {
+            result = JSValue::FromBoolean(NumericValue(a) >= NumericValue(b));
+            return true;
+        }
+        return false;
+    case EQQ:
+    case NEE:
+    {
+        // strings never reach here, everything else compares by payload
+        bool equal;
+        if (JSValue::GetType(a) == Type::T_UNDEFINED && JSValue::GetType(b) == Type::T_UNDEFINED)
+        {
+            equal = true;
+        }
+        else if (JSValue::GetType(a) != JSValue::GetType(b))
+        {
+            equal = false;
         }
         else
         {
-            block->LoopDepth = 0;
+            equal = a.Payload == b.Payload;
         }
+        result = JSValue::FromBoolean((type == EQQ) ? equal : !equal);
+        return true;
+    }
+    case LNOT:
+        result = JSValue::FromBoolean(!runtime::semantic::ToBoolean(a));
+        return true;
+    default:
+        return false;
+    }
+}
 
-        if (block->Consequent && !visited[block->Consequent->Index])
+// nullptr if value has no constant instruction materializing exactly into it
+static IRInst *NewConstant(runtime::JSValue value)
+{
+    switch (runtime::JSValue::GetType(value))
+    {
+    case runtime::Type::T_BOOLEAN:
+        if (value.Boolean())
         {
-            dfsToUpdateDepth(block->Consequent.Get());
+            return new ir::True();
         }
-
-        if (block->Alternate && !visited[block->Alternate->Index])
+        return new ir::False();
+    case runtime::Type::T_UNDEFINED:
+        return new ir::Undefined();
+    case runtime::Type::T_OBJECT:
+        // null is the only object tracked
+        return new ir::Null();
+    case runtime::Type::T_SMALL_INT:
+    case runtime::Type::T_NUMBER:
+    {
+        if (NumberConstant(NumericValue(value)).Payload != value.Payload)
         {
-            dfsToUpdateDepth(block->Alternate.Get());
+            return nullptr;
         }
-    };
-    dfsToUpdateDepth(func->Blocks.front().get());
+        auto number = new ir::Number();
+        number->Value = NumericValue(value);
+        return number;
+    }
+    default:
+        return nullptr;
+    }
 }
 
-void Optimizer::RemoveMove(IRFunc *func)
+static bool IsConstant(IRInst *inst)
 {
-    for (auto &block : func->Blocks)
+    switch (inst->GetType())
     {
-        block->Insts.remove_if([&](const std::unique_ptr<IRInst> &inst)
-        {
-            if (inst->Is<ir::Move>())
-            {
-                inst->ReplaceWith(inst->As<ir::Move>()->_Other.Get());
-                return true;
-            }
+    case UNDEFINED:
+    case NULL:
+    case TRUE:
+    case FALSE:
+    case NUMBER:
+    case STRING:
+        return true;
+    default:
+        return false;
+    }
+}
 
-            return false;
-        });
+// neither writes memory nor calls back into scripts, so may be removed when unused
+static bool IsSideEffectFree(IRInst *inst)
+{
+    switch (inst->GetType())
+    {
+    case UNDEFINED:
+    case NULL:
+    case TRUE:
+    case FALSE:
+    case NUMBER:
+    case STRING:
+    case OBJECT:
+    case ARRAY:
+    case FUNC:
+    case ARROW:
+    case LOAD:
+    case ARG:
+    case CAPTURE:
+    case THIS:
+    case ARGUMENTS:
+    case MOVE:
+    case PHI:
+    // ADD, EQ, NE and the relations may call toString
+    case SUB:
+    case MUL:
+    case DIV:
+    case MOD:
+    case BAND:
+    case BOR:
+    case BXOR:
+    case BNOT:
+    case LNOT:
+    case SLL:
+    case SRL:
+    case SRR:
+    case EQQ:
+    case NEE:
+    case TYPEOF:
+        return true;
+    default:
+        return false;
     }
 }
 
-void Optimizer::RemoveLoopInvariant(IRFunc *func)
+struct ConstantLattice
 {
-    std::map<IRInst *, IRBlock *> instToBlock;
+    enum State : u8
+    {
+        UNKNOWN,
+        CONSTANT,
+        OVERDEFINED
+    };
 
-    for (auto &block : func->Blocks)
+    State Kind = UNKNOWN;
+    runtime::JSValue Value;
+
+    static ConstantLattice Constant(runtime::JSValue value)
     {
-        for (auto &inst : block->Insts)
+        ConstantLattice ret;
+        ret.Kind = CONSTANT;
+        ret.Value = value;
+        return ret;
+    }
+
+    static ConstantLattice Overdefined()
+    {
+        ConstantLattice ret;
+        ret.Kind = OVERDEFINED;
+        return ret;
+    }
+
+    void Meet(const ConstantLattice &other)
+    {
+        if (other.Kind == UNKNOWN || Kind == OVERDEFINED)
         {
-            instToBlock[inst.get()] = block.get();
+            return;
+        }
+
+        if (Kind == UNKNOWN)
+        {
+            *this = other;
+        }
+        else if (other.Kind == OVERDEFINED || other.Value.Payload != Value.Payload)
+        {
+            Kind = OVERDEFINED;
         }
     }
 
-    std::vector<bool> visited(func->Blocks.size(), false);
-    std::function<void(IRBlock *)> dfs = [&](IRBlock *block)
+    bool operator == (const ConstantLattice &other) const
     {
-        visited[block->Index] = true;
+        return Kind == other.Kind &&
+            (Kind != CONSTANT || Value.Payload == other.Value.Payload);
+    }
+};
 
-        if (block->LoopHeader)
+void Optimizer::ScalarReplaceLiterals(IRFunc *func)
+{
+    // slot of each key of the object literals, in order of first appearance
+    std::map<IRInst *, std::vector<runtime::String *>> candidates;
+
+    for (auto &block : func->Blocks)
+    {
+        for (auto &inst : block->Insts)
         {
-            block->Insts.remove_if([&](std::unique_ptr<IRInst> &inst)
+            if (inst->Is<ir::Array>())
             {
-                switch (inst->GetType())
-                {
-                case UNDEFINED:
-                case NULL:
-                case TRUE:
-                case FALSE:
-                case NUMBER:
-                case STRING:
-                case REGEX:
-                case THIS:
+                candidates[inst.get()];
+            }
+            else if (inst->Is<ir::Object>())
+            {
+                std::vector<runtime::String *> keys;
+                bool constantKeys = true;
+
+                for (auto &pair : inst->As<ir::Object>()->Initialization)
                 {
-                    auto dst = block;
-                    while (dst->LoopHeader)
+                    // __proto__ is an own property of every object
+                    if (!pair.first->Is<ir::String>() ||
+                        pair.first->As<ir::String>()->Value->ToString() == "__proto__")
                     {
-                        dst = dst->LoopPrev.Get();
+                        constantKeys = false;
+                        break;
                     }
-                    hydra_assert(dst != block, "must have a LoopPrev");
+
+                    auto key = pair.first->As<ir::String>()->Value;
+                    if (std::find_if(keys.begin(), keys.end(), [&](runtime::String *other)
+                        {
+                            return other->EqualsTo(key);
+                        }) == keys.end())
+                    {
+                        keys.push_back(key);
+                    }
+                }
+
+                if (constantKeys)
+                {
+                    candidates[inst.get()] = std::move(keys);
+                }
+            }
+        }
+    }
+
+    if (candidates.empty())
+    {
+        return;
+    }
+
+    // the slot key reads or writes, or -1 if it may be anything else, like a
+    // missing property found on the prototype
+    auto slotOf = [&](IRInst *literal, IRInst *key) -> size_t
+    {
+        if (literal->Is<ir::Array>())
+        {
+            if (!key->Is<ir::Number>())
+            {
+                return static_cast<size_t>(-1);
+            }
+
+            auto index = NumberConstant(key->As<ir::Number>()->Value);
+            if (runtime::JSValue::GetType(index) != runtime::Type::T_SMALL_INT ||
+                index.SmallInt() < 0 ||
+                static_cast<size_t>(index.SmallInt()) >= literal->As<ir::Array>()->Initialization.size())
+            {
+                return static_cast<size_t>(-1);
+            }
+            return static_cast<size_t>(index.SmallInt());
+        }
+
+        if (!key->Is<ir::String>())
+        {
+            return static_cast<size_t>(-1);
+        }
+
+        auto &keys = candidates[literal];
+        auto iter = std::find_if(keys.begin(), keys.end(), [&](runtime::String *other)
+        {
+            return other->EqualsTo(key->As<ir::String>()->Value);
+        });
+        return (iter == keys.end()) ? static_cast<size_t>(-1) : static_cast<size_t>(iter - keys.begin());
+    };
+
+    // a literal is replaced only if every use of it is a get_item or
+    // set_item on it with a known slot, anything else lets it escape. A
+    // replaced literal is never materialized: one that may escape on any path
+    // keeps its allocation on all of them, and deoptimized frames continue in
+    // baseline code of this same IR, where it is replaced as well
+    std::map<IRInst *, size_t> accesses;
+    for (auto &block : func->Blocks)
+    {
+        for (auto &inst : block->Insts)
+        {
+            IRInst *obj = nullptr, *key = nullptr;
+            if (inst->Is<ir::GetItem>())
+            {
+                obj = inst->As<ir::GetItem>()->_Obj.Get();
+                key = inst->As<ir::GetItem>()->_Key.Get();
+            }
+            else if (inst->Is<ir::SetItem>())
+            {
+                obj = inst->As<ir::SetItem>()->_Obj.Get();
+                key = inst->As<ir::SetItem>()->_Key.Get();
+            }
+
+            if (obj && candidates.count(obj) && slotOf(obj, key) != static_cast<size_t>(-1))
+            {
+                ++accesses[obj];
+            }
+        }
+    }
+
+    std::map<IRInst *, std::vector<ir::Alloca *>> replaced;
+    for (auto &candidate : candidates)
+    {
+        if (accesses[candidate.first] == candidate.first->UsedCount())
+        {
+            replaced[candidate.first];
+        }
+    }
+
+    if (replaced.empty())
+    {
+        return;
+    }
+
+    for (auto &block : func->Blocks)
+    {
+        for (auto iter = block->Insts.begin(); iter != block->Insts.end(); ++iter)
+        {
+            auto inst = iter->get();
+            auto replacedIter = replaced.find(inst);
+
+            if (replacedIter != replaced.end())
+            {
+                // one alloca per slot, initialized in place of the literal
+                auto &slots = replacedIter->second;
+                auto newSlot = [&]()
+                {
+                    auto alloca = new ir::Alloca();
+                    block->Insts.emplace(iter, alloca);
+                    slots.push_back(alloca);
+                    return alloca;
+                };
+
+                auto initialize = [&](ir::Alloca *slot, IRInst *value)
+                {
+                    auto store = new ir::Store();
+                    store->_Addr = slot;
+                    store->_Value = value;
+                    block->Insts.emplace(iter, store);
+                };
+
+                if (inst->Is<ir::Array>())
+                {
+                    for (auto &ref : inst->As<ir::Array>()->Initialization)
+                    {
+                        initialize(newSlot(), ref.Get());
+                    }
+                }
+                else
+                {
+                    for (size_t i = 0; i < candidates[inst].size(); ++i)
+                    {
+                        newSlot();
+                    }
+                    for (auto &pair : inst->As<ir::Object>()->Initialization)
+                    {
+                        initialize(slots[slotOf(inst, pair.first.Get())], pair.second.Get());
+                    }
+                }
+            }
+        }
+    }
+
+    // blocks are not in dominance order, rewrite uses once all slots exist
+    for (auto &block : func->Blocks)
+    {
+        for (auto iter = block->Insts.begin(); iter != block->Insts.end(); )
+        {
+            auto inst = iter->get();
+
+            if (inst->Is<ir::GetItem>())
+            {
+                auto getItem = inst->As<ir::GetItem>();
+                auto objIter = replaced.find(getItem->_Obj.Get());
+                if (objIter != replaced.end())
+                {
+                    auto load = new ir::Load();
+                    load->_Addr = objIter->second[slotOf(objIter->first, getItem->_Key.Get())];
+                    block->Insts.emplace(iter, load);
+
+                    getItem->ReplaceWith(load);
+                    iter = block->Insts.erase(iter);
+                    continue;
+                }
+            }
+            else if (inst->Is<ir::SetItem>())
+            {
+                auto setItem = inst->As<ir::SetItem>();
+                auto objIter = replaced.find(setItem->_Obj.Get());
+                if (objIter != replaced.end())
+                {
+                    auto store = new ir::Store();
+                    store->_Addr = objIter->second[slotOf(objIter->first, setItem->_Key.Get())];
+                    store->_Value = setItem->_Value.Get();
+                    block->Insts.emplace(iter, store);
+
+                    iter = block->Insts.erase(iter);
+                    continue;
+                }
+            }
+
+            ++iter;
+        }
+    }
+
+    for (auto &block : func->Blocks)
+    {
+        block->Insts.remove_if([&](std::unique_ptr<IRInst> &inst)
+        {
+            return replaced.count(inst.get()) != 0;
+        });
+    }
+
+    MemToReg(func);
+}
+
+void Optimizer::ConstantPropagate(IRFunc *func)
+{
+    std::map<IRInst *, ConstantLattice> values;
+    std::map<IRInst *, IRBlock *> instToBlock;
+    std::map<IRInst *, std::vector<IRInst *>> users;
+    std::map<IRInst *, std::vector<IRBlock *>> conditionUsers;
+
+    std::set<IRBlock *> executable;
+    std::set<std::pair<IRBlock *, IRBlock *>> executableEdges;
+    std::queue<std::pair<IRBlock *, IRBlock *>> edgeQueue;
+    std::queue<IRInst *> instQueue;
+
+    for (auto &block : func->Blocks)
+    {
+        for (auto &inst : block->Insts)
+        {
+            instToBlock[inst.get()] = block.get();
+            ForEachOperand(inst.get(), [&](IRInst::Ref &ref)
+            {
+                users[ref.Get()].push_back(inst.get());
+            });
+        }
+
+        if (block->Condition)
+        {
+            conditionUsers[block->Condition.Get()].push_back(block.get());
+        }
+    }
+
+    auto valueOf = [&](IRInst *inst) -> ConstantLattice
+    {
+        auto iter = values.find(inst);
+        return (iter == values.end()) ? ConstantLattice() : iter->second;
+    };
+
+    auto evaluate = [&](IRInst *inst) -> ConstantLattice
+    {
+        switch (inst->GetType())
+        {
+        case UNDEFINED:
+            return ConstantLattice::Constant(runtime::JSValue(runtime::JSValue::UNDEFINED_PAYLOAD));
+        case NULL:
+            return ConstantLattice::Constant(runtime::JSValue::FromObject(nullptr));
+        case TRUE:
+            return ConstantLattice::Constant(runtime::JSValue::FromBoolean(true));
+        case FALSE:
+            return ConstantLattice::Constant(runtime::JSValue::FromBoolean(false));
+        case NUMBER:
+            return ConstantLattice::Constant(NumberConstant(inst->As<ir::Number>()->Value));
+        case PHI:
+        {
+            // only values flowing along executable edges count
+            ConstantLattice ret;
+            auto block = instToBlock[inst];
+            for (auto &branch : inst->As<ir::Phi>()->Branches)
+            {
+                if (executableEdges.count(std::make_pair(branch.first.Get(), block)))
+                {
+                    ret.Meet(valueOf(branch.second.Get()));
+                }
+            }
+            return ret;
+        }
+        default:
+            break;
+        }
+
+        ConstantLattice a, b;
+        if (inst->Is<ir::Binary>())
+        {
+            a = valueOf(inst->As<ir::Binary>()->_A.Get());
+            b = valueOf(inst->As<ir::Binary>()->_B.Get());
+        }
+        else if (inst->Is<ir::Unary>())
+        {
+            a = valueOf(inst->As<ir::Unary>()->_A.Get());
+            b = ConstantLattice::Constant(runtime::JSValue(runtime::JSValue::UNDEFINED_PAYLOAD));
+        }
+        else
+        {
+            return ConstantLattice::Overdefined();
+        }
+
+        if (a.Kind == ConstantLattice::OVERDEFINED || b.Kind == ConstantLattice::OVERDEFINED)
+        {
+            return ConstantLattice::Overdefined();
+        }
+        if (a.Kind == ConstantLattice::UNKNOWN || b.Kind == ConstantLattice::UNKNOWN)
+        {
+            return ConstantLattice();
+        }
+
+        runtime::JSValue result;
+        if (FoldConstant(inst->GetType(), a.Value, b.Value, result))
+        {
+            return ConstantLattice::Constant(result);
+        }
+        return ConstantLattice::Overdefined();
+    };
+
+    auto markEdge = [&](IRBlock *from, IRBlock *to)
+    {
+        if (executableEdges.insert(std::make_pair(from, to)).second)
+        {
+            edgeQueue.push(std::make_pair(from, to));
+        }
+    };
+
+    auto visitTerminator = [&](IRBlock *block)
+    {
+        if (block->Condition)
+        {
+            auto condition = valueOf(block->Condition.Get());
+            if (condition.Kind == ConstantLattice::CONSTANT)
+            {
+                markEdge(block, runtime::semantic::ToBoolean(condition.Value) ?
+                    block->Consequent.Get() :
+                    block->Alternate.Get());
+            }
+            else if (condition.Kind == ConstantLattice::OVERDEFINED)
+            {
+                markEdge(block, block->Consequent.Get());
+                markEdge(block, block->Alternate.Get());
+            }
+        }
+        else if (block->Consequent)
+        {
+            markEdge(block, block->Consequent.Get());
+        }
+    };
+
+    auto update = [&](IRInst *inst)
+    {
+        auto value = evaluate(inst);
+        auto &current = values[inst];
+        if (current == value)
+        {
+            return;
+        }
+
+        current = value;
+        for (auto user : users[inst])
+        {
+            instQueue.push(user);
+        }
+        for (auto block : conditionUsers[inst])
+        {
+            if (executable.count(block))
+            {
+                visitTerminator(block);
+            }
+        }
+    };
+
+    auto visitBlock = [&](IRBlock *block)
+    {
+        for (auto &inst : block->Insts)
+        {
+            update(inst.get());
+        }
+        visitTerminator(block);
+    };
+
+    executable.insert(func->Blocks.front().get());
+    visitBlock(func->Blocks.front().get());
+
+    while (!edgeQueue.empty() || !instQueue.empty())
+    {
+        while (!edgeQueue.empty())
+        {
+            auto edge = edgeQueue.front(); edgeQueue.pop();
+            if (executable.insert(edge.second).second)
+            {
+                visitBlock(edge.second);
+            }
+            else
+            {
+                for (auto &inst : edge.second->Insts)
+                {
+                    if (!inst->Is<ir::Phi>())
+                    {
+                        break;
+                    }
+                    update(inst.get());
+                }
+            }
+        }
+
+        while (!instQueue.empty())
+        {
+            auto inst = instQueue.front(); instQueue.pop();
+            if (executable.count(instToBlock[inst]))
+            {
+                update(inst);
+            }
+        }
+    }
+
+    bool changed = false;
+
+    // branches first, conditions are looked up by the original instructions
+    for (auto &block : func->Blocks)
+    {
+        if (!executable.count(block.get()) || !block->Condition)
+        {
+            continue;
+        }
+
+        auto condition = valueOf(block->Condition.Get());
+        if (condition.Kind != ConstantLattice::CONSTANT)
+        {
+            continue;
+        }
+
+        IRBlock *taken = block->Consequent.Get();
+        IRBlock *notTaken = block->Alternate.Get();
+        if (!runtime::semantic::ToBoolean(condition.Value))
+        {
+            std::swap(taken, notTaken);
+        }
+
+        if (notTaken != taken)
+        {
+            for (auto &inst : notTaken->Insts)
+            {
+                if (!inst->Is<ir::Phi>())
+                {
+                    break;
+                }
+
+                inst->As<ir::Phi>()->Branches.remove_if(
+                    [&](const std::pair<IRBlock::Ref, IRInst::Ref> &pair)
+                    {
+                        return pair.first.Get() == block.get();
+                    });
+            }
+        }
+
+        block->Condition.Reset();
+        block->Consequent = taken;
+        block->Alternate.Reset();
+        changed = true;
+    }
+
+    for (auto &block : func->Blocks)
+    {
+        if (!executable.count(block.get()))
+        {
+            // unreachable now, removed below
+            continue;
+        }
+
+        auto afterPhis = std::find_if(
+            block->Insts.begin(),
+            block->Insts.end(),
+            [](const std::unique_ptr<IRInst> &inst) { return !inst->Is<ir::Phi>(); });
+
+        for (auto iter = block->Insts.begin(); iter != block->Insts.end();)
+        {
+            auto inst = iter->get();
+            auto value = valueOf(inst);
+
+            IRInst *constant = nullptr;
+            if (value.Kind == ConstantLattice::CONSTANT && !IsConstant(inst))
+            {
+                constant = NewConstant(value.Value);
+            }
+
+            if (!constant)
+            {
+                ++iter;
+                continue;
+            }
+
+            block->Insts.emplace(inst->Is<ir::Phi>() ? afterPhis : iter, constant);
+            inst->ReplaceWith(constant);
+            iter = block->Insts.erase(iter);
+            changed = true;
+        }
+    }
+
+    if (changed)
+    {
+        RebuildControlFlow(func);
+    }
+}
+
+void Optimizer::GlobalValueNumbering(IRFunc *func)
+{
+    using Key = std::tuple<size_t, IRInst *, IRInst *, u64>;
+
+    // immediate dominators by the iterative algorithm of Cooper, Harvey and Kennedy
+    std::vector<IRBlock *> postOrder;
+    std::map<IRBlock *, size_t> postIndex;
+    {
+        std::set<IRBlock *> visited;
+        std::function<void(IRBlock *)> dfs = [&](IRBlock *block)
+        {
+            visited.insert(block);
+            for (auto successor : { block->Consequent.Get(), block->Alternate.Get() })
+            {
+                if (successor && !visited.count(successor))
+                {
+                    dfs(successor);
+                }
+            }
+            postIndex[block] = postOrder.size();
+            postOrder.push_back(block);
+        };
+        dfs(func->Blocks.front().get());
+    }
+
+    std::map<IRBlock *, IRBlock *> idom;
+    auto entry = func->Blocks.front().get();
+    idom[entry] = entry;
+
+    auto intersect = [&](IRBlock *a, IRBlock *b)
+    {
+        while (a != b)
+        {
+            while (postIndex[a] < postIndex[b])
+            {
+                a = idom[a];
+            }
+            while (postIndex[b] < postIndex[a])
+            {
+                b = idom[b];
+            }
+        }
+        return a;
+    };
+
+    bool changed = true;
+    while (changed)
+    {
+        changed = false;
+        for (auto iter = postOrder.rbegin(); iter != postOrder.rend(); ++iter)
+        {
+            auto block = *iter;
+            if (block == entry)
+            {
+                continue;
+            }
+
+            IRBlock *newIdom = nullptr;
+            for (auto &precedence : block->Precedences)
+            {
+                if (!idom.count(precedence.Get()))
+                {
+                    continue;
+                }
+                newIdom = newIdom ? intersect(precedence.Get(), newIdom) : precedence.Get();
+            }
+
+            if (newIdom && idom[block] != newIdom)
+            {
+                idom[block] = newIdom;
+                changed = true;
+            }
+        }
+    }
+
+    std::map<IRBlock *, std::vector<IRBlock *>> children;
+    for (auto iter = postOrder.rbegin(); iter != postOrder.rend(); ++iter)
+    {
+        if (*iter != entry)
+        {
+            children[idom[*iter]].push_back(*iter);
+        }
+    }
+
+    std::map<Key, IRInst *> available;
+
+    std::function<void(IRBlock *)> dfs = [&](IRBlock *block)
+    {
+        std::vector<Key> added;
+
+        // loads are only numbered within a block, anything else may write the variables
+        std::map<IRInst *, IRInst *> loaded;
+
+        for (auto iter = block->Insts.begin(); iter != block->Insts.end();)
+        {
+            auto inst = iter->get();
+            auto type = inst->GetType();
+            bool numbered = true;
+            Key key;
+
+            if (inst->Is<ir::Load>())
+            {
+                auto addr = inst->As<ir::Load>()->_Addr.Get();
+                auto found = loaded.find(addr);
+                if (found != loaded.end())
+                {
+                    inst->ReplaceWith(found->second);
+                    iter = block->Insts.erase(iter);
+                    continue;
+                }
+
+                loaded[addr] = inst;
+                ++iter;
+                continue;
+            }
+            else if (inst->Is<ir::Store>())
+            {
+                loaded.clear();
+                loaded[inst->As<ir::Store>()->_Addr.Get()] = inst->As<ir::Store>()->_Value.Get();
+                ++iter;
+                continue;
+            }
+
+            switch (type)
+            {
+            case UNDEFINED:
+            case NULL:
+            case TRUE:
+            case FALSE:
+                key = Key(type, nullptr, nullptr, 0);
+                break;
+            case NUMBER:
+            {
+                u64 bits;
+                std::memcpy(&bits, &inst->As<ir::Number>()->Value, sizeof(bits));
+                key = Key(type, nullptr, nullptr, bits);
+                break;
+            }
+            case STRING:
+                key = Key(type, nullptr, nullptr, reinterpret_cast<u64>(inst->As<ir::String>()->Value));
+                break;
+            // same as RemoveLoopInvariant, operators count as pure except these reading properties
+            case IN:
+            case INSTANCEOF:
+                numbered = false;
+                break;
+            case MUL:
+            case BAND:
+            case BOR:
+            case BXOR:
+            case EQQ:
+            case NEE:
+            {
+                auto a = inst->As<ir::Binary>()->_A.Get();
+                auto b = inst->As<ir::Binary>()->_B.Get();
+                key = (a < b) ? Key(type, a, b, 0) : Key(type, b, a, 0);
+                break;
+            }
+            default:
+                if (inst->Is<ir::Binary>())
+                {
+                    key = Key(type, inst->As<ir::Binary>()->_A.Get(), inst->As<ir::Binary>()->_B.Get(), 0);
+                }
+                else if (inst->Is<ir::Unary>())
+                {
+                    key = Key(type, inst->As<ir::Unary>()->_A.Get(), nullptr, 0);
+                }
+                else
+                {
+                    numbered = false;
+                }
+                break;
+            }
+
+            if (!IsSideEffectFree(inst))
+            {
+                loaded.clear();
+            }
+
+            if (numbered)
+            {
+                auto found = available.find(key);
+                if (found != available.end())
+                {
+                    inst->ReplaceWith(found->second);
+                    iter = block->Insts.erase(iter);
+                    continue;
+                }
+
+                available.emplace(key, inst);
+                added.push_back(key);
+            }
+
+            ++iter;
+        }
+
+        for (auto child : children[block])
+        {
+            dfs(child);
+        }
+
+        for (auto &key : added)
+        {
+            available.erase(key);
+        }
+    };
+
+    dfs(entry);
+}
+
+void Optimizer::RemoveDeadCode(IRFunc *func)
+{
+    std::set<IRInst *> live;
+    std::vector<IRInst *> worklist;
+
+    auto markLive = [&](IRInst *inst)
+    {
+        if (inst && live.insert(inst).second)
+        {
+            worklist.push_back(inst);
+        }
+    };
+
+    for (auto &block : func->Blocks)
+    {
+        markLive(block->Condition.Get());
+        for (auto &inst : block->Insts)
+        {
+            if (!IsSideEffectFree(inst.get()))
+            {
+                markLive(inst.get());
+            }
+        }
+    }
+
+    while (!worklist.empty())
+    {
+        auto inst = worklist.back(); worklist.pop_back();
+        ForEachOperand(inst, [&](IRInst::Ref &ref)
+        {
+            markLive(ref.Get());
+        });
+    }
+
+    for (auto &block : func->Blocks)
+    {
+        block->Insts.remove_if([&](const std::unique_ptr<IRInst> &inst)
+        {
+            return !live.count(inst.get());
+        });
+    }
+}
+
+void Optimizer::LoopAnalyze(IRFunc *func)
+{
+    std::vector<bool> visited(func->Blocks.size(), false);
+    std::vector<bool> inStack(func->Blocks.size(), false);
+    std::vector<IRBlock *> stack;
+
+    auto updateLoopHeader = [&](IRBlock *header)
+    {
+        for (auto iter = stack.rbegin(); iter != stack.rend(); ++iter)
+        {
+            if ((*iter)->LoopHeader)
+            {
+                if (DominatedBy(header, (*iter)->LoopHeader.Get()))
+                {
+                    (*iter)->LoopHeader = header;
+                }
+            }
+            else
+            {
+                (*iter)->LoopHeader = header;
+            }
+
+            if ((*iter) == header)
+            {
+                break;
+            }
+        }
+    };
+
+    std::function<void(IRBlock *)> dfs = [&](IRBlock *block)
+    {
+        visited[block->Index] = true;
+        inStack[block->Index] = true;
+        stack.push_back(block);
+
+        if (block->Consequent)
+        {
+            if (inStack[block->Consequent->Index])
+            {
+                auto header = block->Consequent.Get();
+                updateLoopHeader(header);
+            }
+            else if (visited[block->Consequent->Index])
+            {
+                auto header = block->Consequent->LoopHeader.Get();
+                if (header)
+                {
+                    updateLoopHeader(header);
+                }
+            }
+            else
+            {
+                dfs(block->Consequent.Get());
+            }
+        }
+
+        if (block->Alternate)
+        {
+            if (inStack[block->Alternate->Index])
+            {
+                auto header = block->Alternate.Get();
+                updateLoopHeader(header);
+            }
+            else if (visited[block->Alternate->Index])
+            {
+                auto header = block->Alternate->LoopHeader.Get();
+                if (header)
+                {
+                    updateLoopHeader(header);
+                }
+            }
+            else
+            {
+                dfs(block->Alternate.Get());
+            }
+        }
+
+        inStack[block->Index] = false;
+        stack.pop_back();
+    };
+
+    dfs(func->Blocks.front().get());
+
+    std::fill(visited.begin(), visited.end(), false);
+    std::function<void(IRBlock *)> dfsToUpdateDepth = [&](IRBlock *block)
+    {
+        visited[block->Index] = true;
+        if (block->LoopHeader)
+        {
+            if (block->LoopHeader.Get() == block)
+            {
+                auto iter = std::find_if(
+                    block->Precedences.begin(),
+                    block->Precedences.end(),
+                    [&](const IRBlock::Ref &prec)
+                    {
+                        return !DominatedBy(prec.Get(), block);
+                    }
+                );
+
+                hydra_assert(iter != block->Precedences.end(),
+                    "Loop must have a previous");
+
+                block->LoopPrev = iter->Get();
+
+                iter = std::find_if(
+                    block->Precedences.begin(),
+                    block->Precedences.end(),
+                    [&](const IRBlock::Ref &prec)
+                    {
+                        return (prec.Get() != block->LoopPrev.Get()) &&
+                            !DominatedBy(prec.Get(), block);
+                    }
+                );
+                hydra_assert(iter == block->Precedences.end(),
+                    "Loop must have only one previous");
+
+                hydra_assert(visited[block->LoopPrev->Index],
+                    "loop previous must be visited");
+                block->LoopDepth = block->LoopPrev->LoopDepth + 1;
+            }
+            else
+            {
+                block->LoopPrev = block->LoopHeader->LoopPrev;
+                block->LoopDepth = block->LoopHeader->LoopDepth;
+            }
+        }
+        else
+        {
+            block->LoopDepth = 0;
+        }
+
+        if (block->Consequent && !visited[block->Consequent->Index])
+        {
+            dfsToUpdateDepth(block->Consequent.Get());
+        }
+
+        if (block->Alternate && !visited[block->Alternate->Index])
+        {
+            dfsToUpdateDepth(block->Alternate.Get());
+        }
+    };
+    dfsToUpdateDepth(func->Blocks.front().get());
+}
+
+void Optimizer::RemoveMove(IRFunc *func)
+{
+    for (auto &block : func->Blocks)
+    {
+        block->Insts.remove_if([&](const std::unique_ptr<IRInst> &inst)
+        {
+            if (inst->Is<ir::Move>())
+            {
+                inst->ReplaceWith(inst->As<ir::Move>()->_Other.Get());
+                return true;
+            }
+
+            return false;
+        });
+    }
+}
+
+void Optimizer::RemoveLoopInvariant(IRFunc *func)
+{
+    std::map<IRInst *, IRBlock *> instToBlock;
+
+    for (auto &block : func->Blocks)
+    {
+        for (auto &inst : block->Insts)
+        {
+            instToBlock[inst.get()] = block.get();
+        }
+    }
+
+    std::vector<bool> visited(func->Blocks.size(), false);
+    std::function<void(IRBlock *)> dfs = [&](IRBlock *block)
+    {
+        visited[block->Index] = true;
+
+        if (block->LoopHeader)
+        {
+            block->Insts.remove_if([&](std::unique_ptr<IRInst> &inst)
+            {
+                switch (inst->GetType())
+                {
+                case UNDEFINED:
+                case NULL:
+                case TRUE:
+                case FALSE:
+                case NUMBER:
+                case STRING:
+                case REGEX:
+                case THIS:
+                {
+                    auto dst = block;
+                    while (dst->LoopHeader)
+                    {
+                        dst = dst->LoopPrev.Get();
+                    }
+                    hydra_assert(dst != block, "must have a LoopPrev");
 
                     instToBlock[inst.get()] = dst;
                     dst->Insts.emplace_back(inst.release());
@@ -1293,18 +2482,521 @@ void Optimizer::RemoveLoopInvariant(IRFunc *func)
             });
         }
 
-        if (block->Consequent && !visited[block->Consequent->Index])
+        if (block->Consequent && !visited[block->Consequent->Index])
+        {
+            dfs(block->Consequent.Get());
+        }
+
+        if (block->Alternate && !visited[block->Alternate->Index])
+        {
+            dfs(block->Alternate.Get());
+        }
+    };
+
+    dfs(func->Blocks.front().get());
+}
+
+// integer interval of a value that is always a small int. Wrap around at 48
+// bits is ignored, the only user is the inline element access, which sends a
+// wrapped (negative) key to the slow path by its unsigned split point compare
+struct IntegerRange
+{
+    enum State : u8
+    {
+        UNKNOWN,
+        INTEGER,
+        OVERDEFINED
+    };
+
+    static constexpr i64 SMALL_INT_MIN = -(1ll << 47);
+    static constexpr i64 SMALL_INT_MAX = (1ll << 47) - 1;
+
+    State Kind = UNKNOWN;
+    i64 Min = 0;
+    i64 Max = 0;
+
+    static IntegerRange Of(double min, double max)
+    {
+        IntegerRange ret;
+        ret.Kind = INTEGER;
+        ret.Min = (min < SMALL_INT_MIN) ? SMALL_INT_MIN : static_cast<i64>(std::min<double>(min, SMALL_INT_MAX));
+        ret.Max = (max > SMALL_INT_MAX) ? SMALL_INT_MAX : static_cast<i64>(std::max<double>(max, SMALL_INT_MIN));
+        return ret;
+    }
+
+    static IntegerRange Full()
+    {
+        return Of(SMALL_INT_MIN, SMALL_INT_MAX);
+    }
+
+    static IntegerRange Overdefined()
+    {
+        IntegerRange ret;
+        ret.Kind = OVERDEFINED;
+        return ret;
+    }
+
+    void Meet(const IntegerRange &other)
+    {
+        if (other.Kind == UNKNOWN || Kind == OVERDEFINED)
+        {
+            return;
+        }
+
+        if (Kind == UNKNOWN || other.Kind == OVERDEFINED)
+        {
+            *this = other;
+            return;
+        }
+
+        Min = std::min(Min, other.Min);
+        Max = std::max(Max, other.Max);
+    }
+
+    bool operator == (const IntegerRange &other) const
+    {
+        return Kind == other.Kind &&
+            (Kind != INTEGER || (Min == other.Min && Max == other.Max));
+    }
+
+    bool operator != (const IntegerRange &other) const
+    {
+        return !(*this == other);
+    }
+};
+
+static IntegerRange EvaluateRange(size_t type, const IntegerRange &a, const IntegerRange &b)
+{
+    // results of bor and bxor are small ints whatever the operands are
+    if (type == BOR || type == BXOR)
+    {
+        if (type == BOR && b.Kind == IntegerRange::INTEGER && b.Min == 0 && b.Max == 0)
+        {
+            return a.Kind == IntegerRange::INTEGER ? a : IntegerRange::Full();
+        }
+        return IntegerRange::Full();
+    }
+
+    if (a.Kind == IntegerRange::OVERDEFINED || b.Kind == IntegerRange::OVERDEFINED)
+    {
+        return IntegerRange::Overdefined();
+    }
+    if (a.Kind == IntegerRange::UNKNOWN || b.Kind == IntegerRange::UNKNOWN)
+    {
+        return IntegerRange();
+    }
+
+    // small int operands take the small int fast paths in runtime::semantic
+    switch (type)
+    {
+    case ADD:
+        return IntegerRange::Of(
+            static_cast<double>(a.Min) + b.Min,
+            static_cast<double>(a.Max) + b.Max);
+    case SUB:
+        return IntegerRange::Of(
+            static_cast<double>(a.Min) - b.Max,
+            static_cast<double>(a.Max) - b.Min);
+    case MUL:
+    {
+        double products[] = {
+            static_cast<double>(a.Min) * b.Min,
+            static_cast<double>(a.Min) * b.Max,
+            static_cast<double>(a.Max) * b.Min,
+            static_cast<double>(a.Max) * b.Max
+        };
+        return IntegerRange::Of(
+            *std::min_element(std::begin(products), std::end(products)),
+            *std::max_element(std::begin(products), std::end(products)));
+    }
+    case MOD:
+        if (b.Min > 0)
+        {
+            if (a.Min >= 0)
+            {
+                return IntegerRange::Of(0, static_cast<double>(std::min(a.Max, b.Max - 1)));
+            }
+            return IntegerRange::Of(static_cast<double>(1 - b.Max), static_cast<double>(b.Max - 1));
+        }
+        return IntegerRange::Full();
+    case BAND:
+        if (a.Min >= 0 && b.Min >= 0)
+        {
+            return IntegerRange::Of(0, static_cast<double>(std::min(a.Max, b.Max)));
+        }
+        if (a.Min >= 0 || b.Min >= 0)
+        {
+            return IntegerRange::Of(0, static_cast<double>(a.Min >= 0 ? a.Max : b.Max));
+        }
+        return IntegerRange::Full();
+    default:
+        return IntegerRange::Overdefined();
+    }
+}
+
+// narrows range of value in block by the relations on branches leading to it
+static IntegerRange RefineRange(
+    IRInst *value,
+    IRBlock *block,
+    IntegerRange range,
+    const std::map<IRInst *, IntegerRange> &ranges)
+{
+    if (range.Kind != IntegerRange::INTEGER)
+    {
+        return range;
+    }
+
+    for (auto child = block; child->Dominator && child->Dominator.Get() != child; child = child->Dominator.Get())
+    {
+        auto parent = child->Dominator.Get();
+        if (!parent->Condition || child->Precedences.size() != 1 ||
+            parent->Consequent.Get() == parent->Alternate.Get())
+        {
+            continue;
+        }
+
+        auto condition = parent->Condition.Get();
+        auto type = condition->GetType();
+        if (type != LT && type != LE && type != GT && type != GE)
+        {
+            continue;
+        }
+
+        IRInst *other;
+        if (condition->As<ir::Binary>()->_A.Get() == value)
+        {
+            other = condition->As<ir::Binary>()->_B.Get();
+        }
+        else if (condition->As<ir::Binary>()->_B.Get() == value)
+        {
+            other = condition->As<ir::Binary>()->_A.Get();
+            type = (type == LT) ? GT : (type == LE) ? GE : (type == GT) ? LT : LE;
+        }
+        else
+        {
+            continue;
+        }
+
+        // with both sides small ints the relation is numeric, so never NaN
+        auto iter = ranges.find(other);
+        if (iter == ranges.end() || iter->second.Kind != IntegerRange::INTEGER)
+        {
+            continue;
+        }
+        auto &bound = iter->second;
+
+        if (parent->Alternate.Get() == child)
+        {
+            type = (type == LT) ? GE : (type == LE) ? GT : (type == GT) ? LE : LT;
+        }
+
+        switch (type)
+        {
+        case LT: range.Max = std::min(range.Max, bound.Max - 1); break;
+        case LE: range.Max = std::min(range.Max, bound.Max); break;
+        case GT: range.Min = std::max(range.Min, bound.Min + 1); break;
+        case GE: range.Min = std::max(range.Min, bound.Min); break;
+        }
+    }
+
+    return range;
+}
+
+// the value value is below on every path to block, by a strict relation on
+// a branch leading to it, nullptr if none
+static IRInst *StrictUpperBound(IRInst *value, IRBlock *block)
+{
+    for (auto child = block; child->Dominator && child->Dominator.Get() != child; child = child->Dominator.Get())
+    {
+        auto parent = child->Dominator.Get();
+        if (!parent->Condition || child->Precedences.size() != 1 ||
+            parent->Consequent.Get() == parent->Alternate.Get())
+        {
+            continue;
+        }
+
+        auto condition = parent->Condition.Get();
+        auto type = condition->GetType();
+        if (type != LT && type != LE && type != GT && type != GE)
+        {
+            continue;
+        }
+
+        auto a = condition->As<ir::Binary>()->_A.Get();
+        auto b = condition->As<ir::Binary>()->_B.Get();
+        bool taken = parent->Consequent.Get() == child;
+
+        if (((type == LT && taken) || (type == GE && !taken)) && a == value)
+        {
+            return b;
+        }
+        if (((type == GT && taken) || (type == LE && !taken)) && b == value)
+        {
+            return a;
+        }
+    }
+
+    return nullptr;
+}
+
+static bool InLoop(IRBlock *block, IRBlock *header)
+{
+    for (auto loop = block->LoopHeader.Get(); loop; loop = loop->LoopPrev->LoopHeader.Get())
+    {
+        if (loop == header)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+void Optimizer::RangeAnalyze(IRFunc *func)
+{
+    std::map<IRInst *, IntegerRange> ranges;
+    std::map<IRInst *, size_t> phiChanges;
+
+    // induction variables, loop header phis stepping by a constant on the back edge
+    std::map<IRInst *, i64> steps;
+
+    for (auto &block : func->Blocks)
+    {
+        if (block->LoopHeader.Get() != block.get())
+        {
+            continue;
+        }
+
+        for (auto &inst : block->Insts)
+        {
+            if (!inst->Is<ir::Phi>())
+            {
+                break;
+            }
+
+            for (auto &branch : inst->As<ir::Phi>()->Branches)
+            {
+                if (branch.first.Get() == block->LoopPrev.Get())
+                {
+                    continue;
+                }
+
+                auto next = branch.second.Get();
+                if (!next->Is<ir::Add>() && !next->Is<ir::Sub>())
+                {
+                    continue;
+                }
+
+                auto a = next->As<ir::Binary>()->_A.Get();
+                auto b = next->As<ir::Binary>()->_B.Get();
+                if (a != inst.get())
+                {
+                    if (!next->Is<ir::Add>())
+                    {
+                        continue;
+                    }
+                    std::swap(a, b);
+                }
+
+                if (a != inst.get() || !b->Is<ir::Number>())
+                {
+                    continue;
+                }
+
+                auto step = NumberConstant(b->As<ir::Number>()->Value);
+                if (runtime::JSValue::GetType(step) != runtime::Type::T_SMALL_INT)
+                {
+                    continue;
+                }
+                steps[inst.get()] = next->Is<ir::Add>() ? step.SmallInt() : -step.SmallInt();
+            }
+        }
+    }
+
+    auto rangeOf = [&](IRInst *inst) -> IntegerRange
+    {
+        auto iter = ranges.find(inst);
+        return (iter == ranges.end()) ? IntegerRange() : iter->second;
+    };
+
+    auto evaluate = [&](IRInst *inst) -> IntegerRange
+    {
+        switch (inst->GetType())
+        {
+        case NUMBER:
+        {
+            auto value = NumberConstant(inst->As<ir::Number>()->Value);
+            if (runtime::JSValue::GetType(value) == runtime::Type::T_SMALL_INT)
+            {
+                return IntegerRange::Of(
+                    static_cast<double>(value.SmallInt()),
+                    static_cast<double>(value.SmallInt()));
+            }
+            return IntegerRange::Overdefined();
+        }
+        case MOVE:
+            return rangeOf(inst->As<ir::Move>()->_Other.Get());
+        case PHI:
+        {
+            IntegerRange ret;
+            for (auto &branch : inst->As<ir::Phi>()->Branches)
+            {
+                ret.Meet(rangeOf(branch.second.Get()));
+            }
+            return ret;
+        }
+        default:
+            if (inst->Is<ir::Binary>())
+            {
+                return EvaluateRange(
+                    inst->GetType(),
+                    rangeOf(inst->As<ir::Binary>()->_A.Get()),
+                    rangeOf(inst->As<ir::Binary>()->_B.Get()));
+            }
+            return IntegerRange::Overdefined();
+        }
+    };
+
+    bool changed = true;
+    while (changed)
+    {
+        changed = false;
+        for (auto &block : func->Blocks)
+        {
+            for (auto &inst : block->Insts)
+            {
+                auto range = evaluate(inst.get());
+                auto &current = ranges[inst.get()];
+                if (range == current)
+                {
+                    continue;
+                }
+
+                if (inst->Is<ir::Phi>() && range.Kind == IntegerRange::INTEGER &&
+                    current.Kind == IntegerRange::INTEGER)
+                {
+                    // an induction variable only moves away from its initial
+                    // value, anything else gets widened once it keeps growing
+                    auto iter = steps.find(inst.get());
+                    if (iter != steps.end() && iter->second > 0)
+                    {
+                        range.Max = IntegerRange::SMALL_INT_MAX;
+                    }
+                    else if (iter != steps.end() && iter->second < 0)
+                    {
+                        range.Min = IntegerRange::SMALL_INT_MIN;
+                    }
+                    else if (++phiChanges[inst.get()] > 2)
+                    {
+                        if (range.Min < current.Min)
+                        {
+                            range.Min = IntegerRange::SMALL_INT_MIN;
+                        }
+                        if (range.Max > current.Max)
+                        {
+                            range.Max = IntegerRange::SMALL_INT_MAX;
+                        }
+                    }
+                }
+
+                current = range;
+                changed = true;
+            }
+        }
+    }
+
+    std::map<IRInst *, IRBlock *> defined;
+    for (auto &block : func->Blocks)
+    {
+        for (auto &inst : block->Insts)
+        {
+            defined[inst.get()] = block.get();
+        }
+    }
+
+    for (auto &block : func->Blocks)
+    {
+        for (auto &inst : block->Insts)
         {
-            dfs(block->Consequent.Get());
+            IRInst *obj, *key;
+            if (inst->Is<ir::GetItem>())
+            {
+                obj = inst->As<ir::GetItem>()->_Obj.Get();
+                key = inst->As<ir::GetItem>()->_Key.Get();
+            }
+            else if (inst->Is<ir::SetItem>())
+            {
+                obj = inst->As<ir::SetItem>()->_Obj.Get();
+                key = inst->As<ir::SetItem>()->_Key.Get();
+            }
+            else
+            {
+                continue;
+            }
+
+            auto range = RefineRange(key, block.get(), rangeOf(key), ranges);
+            bool indexKey = range.Kind == IntegerRange::INTEGER && range.Min >= 0;
+
+            // a bound that holds for the whole loop lets the optimized tier
+            // check the array once when entering it, see OptimizedCompileTask
+            IRInst *bound = nullptr;
+            auto header = block->LoopHeader.Get();
+            if (indexKey && header)
+            {
+                auto invariant = [&](IRInst *value)
+                {
+                    auto iter = defined.find(value);
+                    return iter != defined.end() && !InLoop(iter->second, header);
+                };
+
+                bound = StrictUpperBound(key, block.get());
+                if (bound && (!invariant(bound) || !invariant(obj)))
+                {
+                    bound = nullptr;
+                }
+            }
+
+            if (inst->Is<ir::GetItem>())
+            {
+                inst->As<ir::GetItem>()->IndexKey = indexKey;
+                inst->As<ir::GetItem>()->Bound = bound;
+            }
+            else
+            {
+                inst->As<ir::SetItem>()->IndexKey = indexKey;
+                inst->As<ir::SetItem>()->Bound = bound;
+            }
         }
+    }
+}
 
-        if (block->Alternate && !visited[block->Alternate->Index])
+void Optimizer::ScopeEscapeAnalyze(IRFunc *func)
+{
+    // closures and inner scopes keep the Tables their captured cells live in,
+    // see semantic::NewContext, a cell anywhere else is in the frame, like a
+    // parameter still read in place from Arguments
+    auto capturesFrame = [](std::list<IRInst::Ref> &captured)
+    {
+        return std::any_of(captured.begin(), captured.end(), [](IRInst::Ref &ref)
         {
-            dfs(block->Alternate.Get());
-        }
+            return !ref->Is<ir::Alloca>() && !ref->Is<ir::Capture>();
+        });
     };
 
-    dfs(func->Blocks.front().get());
+    func->ScopeEscaped = false;
+
+    for (auto &block : func->Blocks)
+    {
+        for (auto &inst : block->Insts)
+        {
+            if ((inst->Is<ir::PushScope>() && capturesFrame(inst->As<ir::PushScope>()->Captured)) ||
+                (inst->Is<ir::Func>() && capturesFrame(inst->As<ir::Func>()->Captured)) ||
+                (inst->Is<ir::Arrow>() && capturesFrame(inst->As<ir::Arrow>()->Captured)))
+            {
+                func->ScopeEscaped = true;
+                return;
+            }
+        }
+    }
 }
 
 void Optimizer::RemoveUnreferencedBlocks(IRFunc *func)
@@ -1358,6 +3050,569 @@ void Optimizer::RemoveUnreferencedBlocks(IRFunc *func)
     }
 }
 
+bool Optimizer::IsInlinable(IRFunc *callee, bool isArrow)
+{
+    if (callee->Blocks.empty())
+    {
+        return false;
+    }
+
+    bool returns = false;
+    for (auto &block : callee->Blocks)
+    {
+        for (auto &inst : block->Insts)
+        {
+            switch (inst->GetType())
+            {
+            // anything creating or exposing a scope needs a frame of its own
+            case FUNC:
+            case ARROW:
+            case PUSH_SCOPE:
+            case POP_SCOPE:
+            case ALLOCA:
+            case ARGUMENTS:
+            case REGEX:
+                return false;
+            case THIS:
+                // arrows take this from where they are created
+                if (isArrow)
+                {
+                    return false;
+                }
+                break;
+            case CAPTURE:
+                if (inst->As<ir::Capture>()->Scope)
+                {
+                    return false;
+                }
+                break;
+            case RETURN:
+                returns = true;
+                break;
+            default:
+                break;
+            }
+        }
+
+        if (!block->Consequent &&
+            (block->Insts.empty() || !block->Insts.back()->Is<ir::Return>()))
+        {
+            return false;
+        }
+    }
+
+    return returns;
+}
+
+bool Optimizer::InlineCall(
+    IRFunc *func,
+    std::list<std::unique_ptr<IRBlock>>::iterator &blockIter,
+    std::list<std::unique_ptr<IRInst>>::iterator callIter,
+    IRFunc *callee)
+{
+    auto block = blockIter->get();
+    auto call = (*callIter)->As<ir::Call>();
+    auto calleeInst = call->_Callee.Get();
+    auto argsInst = call->_Args.Get();
+
+    std::vector<IRInst *> args;
+    for (auto &ref : argsInst->As<ir::Array>()->Initialization)
+    {
+        args.push_back(ref.Get());
+    }
+
+    std::vector<IRInst *> captured;
+    for (auto &ref : calleeInst->Is<ir::Func>() ?
+        calleeInst->As<ir::Func>()->Captured :
+        calleeInst->As<ir::Arrow>()->Captured)
+    {
+        captured.push_back(ref.Get());
+    }
+
+    IRInst *undefined = nullptr;
+    auto getUndefined = [&]() -> IRInst *
+    {
+        if (!undefined)
+        {
+            undefined = new ir::Undefined();
+            block->Insts.emplace(callIter, undefined);
+        }
+        return undefined;
+    };
+
+    std::map<IRBlock *, IRBlock *> blockMap;
+    std::map<IRInst *, IRInst *> instMap;
+    std::vector<std::pair<IRInst *, IRInst *>> cloned;
+    std::vector<std::pair<IRBlock *, IRInst *>> returns;
+    std::list<std::unique_ptr<IRBlock>> inlined;
+
+    for (auto &calleeBlock : callee->Blocks)
+    {
+        inlined.emplace_back(new IRBlock());
+        blockMap[calleeBlock.get()] = inlined.back().get();
+    }
+
+    // arguments, captures and this of the callee are values of the caller
+    for (auto &calleeBlock : callee->Blocks)
+    {
+        auto newBlock = blockMap[calleeBlock.get()];
+        for (auto &inst : calleeBlock->Insts)
+        {
+            if (inst->Is<ir::Arg>())
+            {
+                continue;
+            }
+            else if (inst->Is<ir::Load>() && inst->As<ir::Load>()->_Addr->Is<ir::Arg>())
+            {
+                auto index = inst->As<ir::Load>()->_Addr->As<ir::Arg>()->Index;
+                instMap[inst.get()] = index < args.size() ? args[index] : getUndefined();
+            }
+            else if (inst->Is<ir::Capture>())
+            {
+                auto index = inst->As<ir::Capture>()->Index;
+                if (index >= captured.size())
+                {
+                    return false;
+                }
+                instMap[inst.get()] = captured[index];
+            }
+            else if (inst->Is<ir::This>())
+            {
+                instMap[inst.get()] = call->_ThisArg.Get();
+            }
+            else if (inst->Is<ir::Return>())
+            {
+                returns.emplace_back(newBlock, inst->As<ir::Return>()->_Value.Get());
+            }
+            else
+            {
+                auto newInst = NewInstOfType(inst->GetType());
+                newBlock->Insts.emplace_back(newInst);
+                instMap[inst.get()] = newInst;
+                cloned.emplace_back(inst.get(), newInst);
+            }
+        }
+    }
+
+    for (auto &pair : cloned)
+    {
+        CopyOperands(pair.first, pair.second, instMap, blockMap);
+    }
+
+    auto continuation = new IRBlock();
+    continuation->Insts.splice(
+        continuation->Insts.end(),
+        block->Insts,
+        std::next(callIter),
+        block->Insts.end());
+    continuation->Condition = block->Condition;
+    continuation->Consequent = block->Consequent;
+    continuation->Alternate = block->Alternate;
+
+    for (auto successor : { block->Consequent.Get(), block->Alternate.Get() })
+    {
+        if (!successor)
+        {
+            continue;
+        }
+
+        for (auto &inst : successor->Insts)
+        {
+            if (!inst->Is<ir::Phi>())
+            {
+                break;
+            }
+
+            for (auto &branch : inst->As<ir::Phi>()->Branches)
+            {
+                if (branch.first.Get() == block)
+                {
+                    branch.first = continuation;
+                }
+            }
+        }
+    }
+
+    for (auto &calleeBlock : callee->Blocks)
+    {
+        auto newBlock = blockMap[calleeBlock.get()];
+        if (calleeBlock->Condition)
+        {
+            newBlock->Condition = instMap.at(calleeBlock->Condition.Get());
+        }
+        if (calleeBlock->Consequent)
+        {
+            newBlock->Consequent = blockMap.at(calleeBlock->Consequent.Get());
+        }
+        if (calleeBlock->Alternate)
+        {
+            newBlock->Alternate = blockMap.at(calleeBlock->Alternate.Get());
+        }
+    }
+
+    block->Condition.Reset();
+    block->Alternate.Reset();
+    block->Consequent = inlined.front().get();
+
+    auto returnValue = [&](IRInst *value) -> IRInst *
+    {
+        return value ? instMap.at(value) : getUndefined();
+    };
+
+    IRInst *result;
+    if (returns.size() == 1)
+    {
+        result = returnValue(returns.front().second);
+        returns.front().first->Consequent = continuation;
+    }
+    else
+    {
+        auto phi = new ir::Phi();
+        continuation->Insts.emplace_front(phi);
+        for (auto &pair : returns)
+        {
+            phi->Branches.emplace_back(pair.first, returnValue(pair.second));
+            pair.first->Consequent = continuation;
+        }
+        result = phi;
+    }
+
+    call->ReplaceWith(result);
+    block->Insts.erase(callIter);
+
+    // the closure and the argument array are pure, drop them if the call was their only user
+    for (auto unused : { argsInst, calleeInst })
+    {
+        if (unused->UsedCount())
+        {
+            continue;
+        }
+
+        for (auto &funcBlock : func->Blocks)
+        {
+            auto pos = std::find_if(
+                funcBlock->Insts.begin(),
+                funcBlock->Insts.end(),
+                [&](const std::unique_ptr<IRInst> &inst) { return inst.get() == unused; });
+
+            if (pos != funcBlock->Insts.end())
+            {
+                funcBlock->Insts.erase(pos);
+                break;
+            }
+        }
+    }
+
+    auto insertPos = std::next(blockIter);
+    func->Blocks.splice(insertPos, inlined);
+    blockIter = std::prev(func->Blocks.emplace(insertPos, continuation));
+    return true;
+}
+
+IRInst *Optimizer::NewInstOfType(size_t type)
+{
+#define NEW_INST(_case, _class)     \
+    case _case:                     \
+        return new ir::_class ()
+
+    switch (type)
+    {
+        NEW_INST(LOAD, Load);
+        NEW_INST(STORE, Store);
+        NEW_INST(GET_ITEM, GetItem);
+        NEW_INST(SET_ITEM, SetItem);
+        NEW_INST(DEL_ITEM, DelItem);
+        NEW_INST(NEW, New);
+        NEW_INST(CALL, Call);
+        NEW_INST(GET_GLOBAL, GetGlobal);
+        NEW_INST(SET_GLOBAL, SetGlobal);
+        NEW_INST(UNDEFINED, Undefined);
+        NEW_INST(NULL, Null);
+        NEW_INST(TRUE, True);
+        NEW_INST(FALSE, False);
+        NEW_INST(NUMBER, Number);
+        NEW_INST(STRING, String);
+        NEW_INST(OBJECT, Object);
+        NEW_INST(ARRAY, Array);
+        NEW_INST(ADD, Add);
+        NEW_INST(SUB, Sub);
+        NEW_INST(MUL, Mul);
+        NEW_INST(DIV, Div);
+        NEW_INST(MOD, Mod);
+        NEW_INST(BAND, Band);
+        NEW_INST(BOR, Bor);
+        NEW_INST(BXOR, Bxor);
+        NEW_INST(SLL, Sll);
+        NEW_INST(SRL, Srl);
+        NEW_INST(SRR, Srr);
+        NEW_INST(EQ, Eq);
+        NEW_INST(EQQ, Eqq);
+        NEW_INST(NE, Ne);
+        NEW_INST(NEE, Nee);
+        NEW_INST(GT, Gt);
+        NEW_INST(GE, Ge);
+        NEW_INST(LT, Lt);
+        NEW_INST(LE, Le);
+        NEW_INST(IN, In);
+        NEW_INST(INSTANCEOF, InstanceOf);
+        NEW_INST(BNOT, Bnot);
+        NEW_INST(LNOT, Lnot);
+        NEW_INST(TYPEOF, TypeOf);
+        NEW_INST(MOVE, Move);
+        NEW_INST(PHI, Phi);
+        NEW_INST(DEBUGGER, Debugger);
+    default:
+        hydra_trap("Unknown inst");
+    }
+
+#undef NEW_INST
+}
+
+void Optimizer::CopyOperands(
+    IRInst *from,
+    IRInst *to,
+    const std::map<IRInst *, IRInst *> &instMap,
+    const std::map<IRBlock *, IRBlock *> &blockMap)
+{
+    auto map = [&](const IRInst::Ref &ref) -> IRInst *
+    {
+        return ref ? instMap.at(ref.Get()) : nullptr;
+    };
+
+    switch (from->GetType())
+    {
+    case LOAD:
+        to->As<ir::Load>()->_Addr = map(from->As<ir::Load>()->_Addr);
+        break;
+    case STORE:
+        to->As<ir::Store>()->_Addr = map(from->As<ir::Store>()->_Addr);
+        to->As<ir::Store>()->_Value = map(from->As<ir::Store>()->_Value);
+        break;
+    case GET_ITEM:
+        to->As<ir::GetItem>()->_Obj = map(from->As<ir::GetItem>()->_Obj);
+        to->As<ir::GetItem>()->_Key = map(from->As<ir::GetItem>()->_Key);
+        break;
+    case SET_ITEM:
+        to->As<ir::SetItem>()->_Obj = map(from->As<ir::SetItem>()->_Obj);
+        to->As<ir::SetItem>()->_Key = map(from->As<ir::SetItem>()->_Key);
+        to->As<ir::SetItem>()->_Value = map(from->As<ir::SetItem>()->_Value);
+        break;
+    case DEL_ITEM:
+        to->As<ir::DelItem>()->_Obj = map(from->As<ir::DelItem>()->_Obj);
+        to->As<ir::DelItem>()->_Key = map(from->As<ir::DelItem>()->_Key);
+        break;
+    case NEW:
+        to->As<ir::New>()->_Callee = map(from->As<ir::New>()->_Callee);
+        to->As<ir::New>()->_Args = map(from->As<ir::New>()->_Args);
+        break;
+    case CALL:
+        to->As<ir::Call>()->_Callee = map(from->As<ir::Call>()->_Callee);
+        to->As<ir::Call>()->_ThisArg = map(from->As<ir::Call>()->_ThisArg);
+        to->As<ir::Call>()->_Args = map(from->As<ir::Call>()->_Args);
+        break;
+    case GET_GLOBAL:
+        to->As<ir::GetGlobal>()->Name = from->As<ir::GetGlobal>()->Name;
+        break;
+    case SET_GLOBAL:
+        to->As<ir::SetGlobal>()->Name = from->As<ir::SetGlobal>()->Name;
+        to->As<ir::SetGlobal>()->_Value = map(from->As<ir::SetGlobal>()->_Value);
+        break;
+    case NUMBER:
+        to->As<ir::Number>()->Value = from->As<ir::Number>()->Value;
+        break;
+    case STRING:
+        to->As<ir::String>()->Value = from->As<ir::String>()->Value;
+        break;
+    case OBJECT:
+        for (auto &pair : from->As<ir::Object>()->Initialization)
+        {
+            to->As<ir::Object>()->Initialization.emplace_back(map(pair.first), map(pair.second));
+        }
+        break;
+    case ARRAY:
+        for (auto &ref : from->As<ir::Array>()->Initialization)
+        {
+            to->As<ir::Array>()->Initialization.emplace_back(map(ref));
+        }
+        break;
+    case MOVE:
+        to->As<ir::Move>()->_Other = map(from->As<ir::Move>()->_Other);
+        break;
+    case PHI:
+        for (auto &pair : from->As<ir::Phi>()->Branches)
+        {
+            to->As<ir::Phi>()->Branches.emplace_back(blockMap.at(pair.first.Get()), map(pair.second));
+        }
+        break;
+    default:
+        if (from->Is<ir::Binary>())
+        {
+            to->As<ir::Binary>()->_A = map(from->As<ir::Binary>()->_A);
+            to->As<ir::Binary>()->_B = map(from->As<ir::Binary>()->_B);
+        }
+        else if (from->Is<ir::Unary>())
+        {
+            to->As<ir::Unary>()->_A = map(from->As<ir::Unary>()->_A);
+        }
+        break;
+    }
+}
+
+void Optimizer::RebuildControlFlow(IRFunc *func)
+{
+    RemoveUnreferencedBlocks(func);
+
+    // phis left with a single incoming value
+    bool changed;
+    do
+    {
+        changed = false;
+        for (auto &block : func->Blocks)
+        {
+            for (auto iter = block->Insts.begin(); iter != block->Insts.end();)
+            {
+                if (!(*iter)->Is<ir::Phi>())
+                {
+                    break;
+                }
+
+                auto phi = (*iter)->As<ir::Phi>();
+                std::set<IRInst *> incoming;
+                for (auto &branch : phi->Branches)
+                {
+                    if (branch.second.Get() != phi)
+                    {
+                        incoming.insert(branch.second.Get());
+                    }
+                }
+
+                if (incoming.size() == 1 && *incoming.begin())
+                {
+                    phi->ReplaceWith(*incoming.begin());
+                    iter = block->Insts.erase(iter);
+                    changed = true;
+                }
+                else
+                {
+                    ++iter;
+                }
+            }
+        }
+    } while (changed);
+
+    for (auto &block : func->Blocks)
+    {
+        block->Precedences.clear();
+        block->Dominator.Reset();
+        block->Scope.Reset();
+        block->EndScope.Reset();
+    }
+
+    ControlFlowAnalyze(func);
+    CleanupBlocks(func);
+}
+
+void Optimizer::ForEachOperand(IRInst *inst, std::function<void(IRInst::Ref &)> callback)
+{
+    auto visit = [&](IRInst::Ref &ref)
+    {
+        if (ref)
+        {
+            callback(ref);
+        }
+    };
+
+    switch (inst->GetType())
+    {
+    case RETURN:
+        visit(inst->As<ir::Return>()->_Value);
+        break;
+    case LOAD:
+        visit(inst->As<ir::Load>()->_Addr);
+        break;
+    case STORE:
+        visit(inst->As<ir::Store>()->_Addr);
+        visit(inst->As<ir::Store>()->_Value);
+        break;
+    case GET_ITEM:
+        visit(inst->As<ir::GetItem>()->_Obj);
+        visit(inst->As<ir::GetItem>()->_Key);
+        break;
+    case SET_ITEM:
+        visit(inst->As<ir::SetItem>()->_Obj);
+        visit(inst->As<ir::SetItem>()->_Key);
+        visit(inst->As<ir::SetItem>()->_Value);
+        break;
+    case DEL_ITEM:
+        visit(inst->As<ir::DelItem>()->_Obj);
+        visit(inst->As<ir::DelItem>()->_Key);
+        break;
+    case NEW:
+        visit(inst->As<ir::New>()->_Callee);
+        visit(inst->As<ir::New>()->_Args);
+        break;
+    case CALL:
+        visit(inst->As<ir::Call>()->_Callee);
+        visit(inst->As<ir::Call>()->_ThisArg);
+        visit(inst->As<ir::Call>()->_Args);
+        break;
+    case SET_GLOBAL:
+        visit(inst->As<ir::SetGlobal>()->_Value);
+        break;
+    case OBJECT:
+        for (auto &pair : inst->As<ir::Object>()->Initialization)
+        {
+            visit(pair.first);
+            visit(pair.second);
+        }
+        break;
+    case ARRAY:
+        for (auto &ref : inst->As<ir::Array>()->Initialization)
+        {
+            visit(ref);
+        }
+        break;
+    case FUNC:
+        for (auto &ref : inst->As<ir::Func>()->Captured)
+        {
+            visit(ref);
+        }
+        break;
+    case ARROW:
+        for (auto &ref : inst->As<ir::Arrow>()->Captured)
+        {
+            visit(ref);
+        }
+        break;
+    case PUSH_SCOPE:
+        for (auto &ref : inst->As<ir::PushScope>()->Captured)
+        {
+            visit(ref);
+        }
+        break;
+    case MOVE:
+        visit(inst->As<ir::Move>()->_Other);
+        break;
+    case PHI:
+        for (auto &pair : inst->As<ir::Phi>()->Branches)
+        {
+            visit(pair.second);
+        }
+        break;
+    default:
+        if (inst->Is<ir::Binary>())
+        {
+            visit(inst->As<ir::Binary>()->_A);
+            visit(inst->As<ir::Binary>()->_B);
+        }
+        else if (inst->Is<ir::Unary>())
+        {
+            visit(inst->As<ir::Unary>()->_A);
+        }
+        break;
+    }
+}
+
 bool Optimizer::DominatedBy(IRBlock *a, IRBlock *b)
 {
     while (a)
@@ -5,6 +5,9 @@
 #include "IR.h"
 #include "IRInsts.h"
 
+#include <functional>
+#include <map>
+
 namespace hydra
 {
 namespace vm
@@ -15,19 +18,44 @@ class Optimizer
 public:
     static void InitialOptimize(IRFunc *func);
 
+    // recomputes what InitialOptimize leaves beside the IR, for IR it optimized before
+    static void Reanalyze(IRFunc *func);
+
     static void RemoveAfterReturn(IRFunc *func);
     static void ControlFlowAnalyze(IRFunc *func);
     static void InlineScope(IRFunc *func);
     static void ArgToLocalAllocaAndMoveCapture(IRFunc *func);
     static void MemToReg(IRFunc *func);
     static void CleanupBlocks(IRFunc *func);
+    static void InlineCalls(IRFunc *func);
+    static void ScalarReplaceLiterals(IRFunc *func);
+    static void ConstantPropagate(IRFunc *func);
+    static void GlobalValueNumbering(IRFunc *func);
+    static void RemoveDeadCode(IRFunc *func);
     static void LoopAnalyze(IRFunc *func);
     static void RemoveMove(IRFunc *func);
     static void RemoveLoopInvariant(IRFunc *func);
+    static void RangeAnalyze(IRFunc *func);
+    static void ScopeEscapeAnalyze(IRFunc *func);
 
 private:
     static void RemoveUnreferencedBlocks(IRFunc *func);
     static bool DominatedBy(IRBlock *a, IRBlock *b);
+    static void RebuildControlFlow(IRFunc *func);
+    static void ForEachOperand(IRInst *inst, std::function<void(IRInst::Ref &)> callback);
+
+    static bool IsInlinable(IRFunc *callee, bool isArrow);
+    static bool InlineCall(
+        IRFunc *func,
+        std::list<std::unique_ptr<IRBlock>>::iterator &blockIter,
+        std::list<std::unique_ptr<IRInst>>::iterator callIter,
+        IRFunc *callee);
+    static IRInst *NewInstOfType(size_t type);
+    static void CopyOperands(
+        IRInst *from,
+        IRInst *to,
+        const std::map<IRInst *, IRInst *> &instMap,
+        const std::map<IRBlock *, IRBlock *> &blockMap);
 };
 
 } // namespace vm
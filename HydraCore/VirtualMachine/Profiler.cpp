@@ -0,0 +1,228 @@
+#include "Profiler.h"
+
+#include "CompiledFunction.h"
+#include "IR.h"
+
+#include "Common/Logger.h"
+
+#include <chrono>
+#include <fstream>
+
+#ifndef _MSC_VER
+#include <signal.h>
+#include <sys/time.h>
+#include <ucontext.h>
+#endif
+
+namespace hydra
+{
+namespace vm
+{
+
+thread_local ProfileFrame *Profiler::ThreadFrame = nullptr;
+std::atomic<size_t> Profiler::FrameWalkers{ 0 };
+
+// read from the signal handler, which can not go through GetInstance
+static std::atomic<Profiler *> ActiveProfiler{ nullptr };
+
+static constexpr auto COLLECT_INTERVAL = 100ms;
+
+#ifndef _MSC_VER
+
+static void OnProfileSignal(int, siginfo_t *, void *context)
+{
+    const u8 *pc = nullptr;
+#if defined(__linux__) && defined(__x86_64__)
+    pc = reinterpret_cast<const u8 *>(
+        reinterpret_cast<ucontext_t *>(context)->uc_mcontext.gregs[REG_RIP]);
+#endif
+
+    Profiler::TakeSample(pc);
+}
+
+#endif
+
+Profiler::Profiler()
+    : Samples(new Sample[PROFILER_BUFFER_SIZE]), Next(0), Dropped(0), Running(false)
+{
+    for (size_t i = 0; i < PROFILER_BUFFER_SIZE; ++i)
+    {
+        Samples[i].State = 0;
+    }
+}
+
+Profiler::~Profiler()
+{
+    Stop();
+}
+
+bool Profiler::Start(const std::string &path, size_t frequency)
+{
+#ifdef _MSC_VER
+    return false;
+#else
+    if (frequency == 0 || Running.exchange(true))
+    {
+        return false;
+    }
+
+    ++FrameWalkers;
+
+    Path = path;
+    Counts.clear();
+    Dropped = 0;
+
+    ActiveProfiler = this;
+    Collector = std::thread(&Profiler::Collect, this);
+
+    struct sigaction action = {};
+    action.sa_sigaction = OnProfileSignal;
+    action.sa_flags = SA_SIGINFO | SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGPROF, &action, nullptr);
+
+    // cpu time of the whole process, so the signal lands on a busy thread
+    itimerval timer = {};
+    timer.it_interval.tv_sec = static_cast<time_t>(1 / frequency);
+    timer.it_interval.tv_usec = static_cast<suseconds_t>(1000000 / frequency % 1000000);
+    timer.it_value = timer.it_interval;
+    setitimer(ITIMER_PROF, &timer, nullptr);
+
+    return true;
+#endif
+}
+
+void Profiler::Stop()
+{
+#ifndef _MSC_VER
+    if (!Running.exchange(false))
+    {
+        return;
+    }
+
+    itimerval timer = {};
+    setitimer(ITIMER_PROF, &timer, nullptr);
+    signal(SIGPROF, SIG_IGN);
+    ActiveProfiler = nullptr;
+
+    Collector.join();
+    Drain();
+    --FrameWalkers;
+
+    std::ofstream file(Path, std::ios::trunc);
+    for (auto &pair : Counts)
+    {
+        file << pair.first << " " << pair.second << std::endl;
+    }
+
+    if (Dropped.load())
+    {
+        hydra_log_warn("Profiler dropped {} samples", Dropped.load());
+    }
+#endif
+}
+
+void Profiler::TakeSample(const u8 *pc)
+{
+    auto profiler = ActiveProfiler.load(std::memory_order_relaxed);
+    auto frame = ThreadFrame;
+
+    // not running JS
+    if (!profiler || !frame)
+    {
+        return;
+    }
+
+    auto &sample = profiler->Samples[profiler->Next.fetch_add(1, std::memory_order_relaxed) % PROFILER_BUFFER_SIZE];
+
+    u32 expected = 0;
+    if (!sample.State.compare_exchange_strong(expected, 1, std::memory_order_acquire))
+    {
+        profiler->Dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    sample.Pc = pc;
+    sample.Depth = 0;
+    while (frame && sample.Depth < PROFILER_MAX_DEPTH)
+    {
+        sample.Frames[sample.Depth++] = frame->Function;
+        frame = frame->Caller;
+    }
+
+    sample.State.store(2, std::memory_order_release);
+}
+
+void Profiler::Collect()
+{
+    while (Running.load())
+    {
+        std::this_thread::sleep_for(COLLECT_INTERVAL);
+        Drain();
+    }
+}
+
+void Profiler::Drain()
+{
+    for (size_t i = 0; i < PROFILER_BUFFER_SIZE; ++i)
+    {
+        auto &sample = Samples[i];
+        if (sample.State.load(std::memory_order_acquire) == 2)
+        {
+            ++Counts[Describe(sample)];
+            sample.State.store(0, std::memory_order_release);
+        }
+    }
+}
+
+std::string Profiler::FrameName(CompiledFunction *function)
+{
+    if (function->IsInterpreted())
+    {
+        auto name = function->GetOwner()->Name;
+        return "js:" + (name ? name->ToString() : std::string()) + " [interpreted]";
+    }
+    return function->GetSymbolName();
+}
+
+std::string Profiler::Describe(const Sample &sample)
+{
+    std::string ret;
+    for (size_t i = sample.Depth; i-- > 0;)
+    {
+        ret += FrameName(sample.Frames[i]);
+        if (i)
+        {
+            ret += ";";
+        }
+    }
+
+    auto leaf = sample.Frames[0];
+    if (leaf->IsInterpreted())
+    {
+        return ret;
+    }
+
+    // frames entered through OSR run in the optimized code of their owner
+    auto inst = leaf->GetInstIndex(sample.Pc);
+    auto current = leaf->GetOwner()->Compiled.load();
+    if (inst == static_cast<size_t>(-1) && current && current != leaf)
+    {
+        inst = current->GetInstIndex(sample.Pc);
+    }
+
+    if (inst == static_cast<size_t>(-1))
+    {
+        // in a runtime helper called from the leaf
+        ret += ";[native]";
+    }
+    else
+    {
+        ret += ":" + std::to_string(inst);
+    }
+
+    return ret;
+}
+
+} // namespace vm
+} // namespace hydra
@@ -0,0 +1,100 @@
+#ifndef _PROFILER_H_
+#define _PROFILER_H_
+
+#include "Common/HydraCore.h"
+#include "Common/Singleton.h"
+
+#include "VMDefs.h"
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+
+namespace hydra
+{
+namespace vm
+{
+
+// one JS call on the native stack. Scope::Upper is the lexical parent, not
+// the caller, so calls are linked separately
+struct ProfileFrame
+{
+    CompiledFunction *Function;
+    ProfileFrame *Caller;
+};
+
+// samples the JS stack of whichever thread is running, driven by SIGPROF.
+// The signal handler only copies frames into a ring buffer, a collector
+// thread names them and counts identical stacks. Stop writes collapsed
+// stacks, "outer;inner;leaf:inst count" per line, for flamegraph.pl and
+// the like. Not supported on windows
+class Profiler : public Singleton<Profiler>
+{
+public:
+    Profiler();
+    ~Profiler();
+
+    // false if sampling is not supported or already running
+    bool Start(const std::string &path, size_t frequency = PROFILER_DEFAULT_FREQUENCY);
+    void Stop();
+
+    // called from the signal handler with the interrupted pc
+    static void TakeSample(const u8 *pc);
+
+    static std::string FrameName(CompiledFunction *function);
+
+    static thread_local ProfileFrame *ThreadFrame;
+
+    // running profilers that walk ThreadFrame. compiled code only calls
+    // other compiled code directly, without linking a frame, while it is 0
+    static std::atomic<size_t> FrameWalkers;
+
+private:
+    struct Sample
+    {
+        // 0 free, 1 being written, 2 ready
+        std::atomic<u32> State;
+        u32 Depth;
+        const u8 *Pc;
+        CompiledFunction *Frames[PROFILER_MAX_DEPTH];
+    };
+
+    void Collect();
+    void Drain();
+    std::string Describe(const Sample &sample);
+
+    std::unique_ptr<Sample[]> Samples;
+    std::atomic<size_t> Next;
+    std::atomic<size_t> Dropped;
+
+    std::string Path;
+    std::atomic<bool> Running;
+    std::thread Collector;
+
+    std::map<std::string, size_t> Counts;
+};
+
+struct AutoProfileFrame
+{
+    AutoProfileFrame(CompiledFunction *function)
+        : Frame{ function, Profiler::ThreadFrame }
+    {
+        // the handler runs on this thread, it must see the frame complete
+        std::atomic_signal_fence(std::memory_order_release);
+        Profiler::ThreadFrame = &Frame;
+    }
+
+    ~AutoProfileFrame()
+    {
+        Profiler::ThreadFrame = Frame.Caller;
+    }
+
+    ProfileFrame Frame;
+};
+
+} // namespace vm
+} // namespace hydra
+
+#endif // _PROFILER_H_
@@ -1,5 +1,7 @@
 #include "Scope.h"
 
+#include "GarbageCollection/Region.h"
+
 namespace hydra
 {
 namespace vm
@@ -14,6 +16,20 @@ Scope::JSValue *Scope::AllocateStatic(Scope *scope)
 
 void Scope::Scan(std::function<void(gc::HeapObject *)> scan)
 {
+    // a scope pushed in a frame on the native stack shares its Regs and
+    // Arguments, the conservative stack scan keeps all three
+    gc::Cell *cell;
+    if (Upper && !gc::Region::IsInRegion(Upper, cell))
+    {
+        if (Table) scan(Table);
+        if (Captured) scan(Captured);
+        if (ThisArg.IsReference() && ThisArg.ToReference())
+        {
+            scan(ThisArg.ToReference());
+        }
+        return;
+    }
+
     if (Upper) scan(Upper);
     if (Regs) scan(Regs);
     if (Table) scan(Table);
@@ -42,7 +58,7 @@ void Scope::Safepoint(Scope *scope)
 
     if (scope->Table)
     {
-        for (auto &value : *(scope->Regs))
+        for (auto &value : *(scope->Table))
         {
             if (value.IsReference() && value.ToReference())
             {
@@ -4,11 +4,17 @@
 #include "Runtime/Semantic.h"
 
 #include "Common/Singleton.h"
+#include "Common/Metrics.h"
 #include "Common/Platform.h"
+#include "Common/Tracer.h"
 
 #include "ByteCode.h"
-#include "Optimizer.h"
+#include "CodeCache.h"
+#include "CompileQueue.h"
+#include "HeapSnapshot.h"
+#include "IRInsts.h"
 
+#include <functional>
 #include <iostream>
 
 namespace hydra
@@ -22,6 +28,7 @@ struct VMInitializeHelper : public Singleton<VMInitializeHelper>
     using JSArray = runtime::JSArray;
     using String = runtime::String;
     using Type = runtime::Type;
+    using ArgumentVector = runtime::ArgumentVector;
 
     VMInitializeHelper()
     {
@@ -36,9 +43,19 @@ struct VMInitializeHelper : public Singleton<VMInitializeHelper>
             allocator,
             String::New(allocator, u"__normalize_path"),
             JSValue::FromObject(runtime::semantic::NewNativeFunc(allocator, lib_NormalizePath)));
+
+        runtime::semantic::SetOnGlobal(
+            allocator,
+            String::New(allocator, u"__heap_snapshot"),
+            JSValue::FromObject(runtime::semantic::NewNativeFunc(allocator, lib_HeapSnapshot)));
+
+        runtime::semantic::SetOnGlobal(
+            allocator,
+            String::New(allocator, u"__stats"),
+            JSValue::FromObject(runtime::semantic::NewNativeFunc(allocator, lib_Stats)));
     }
 
-    static bool lib_Execute(gc::ThreadAllocator &allocator, JSValue thisArg, JSArray *arguments, JSValue &retVal, JSValue &error)
+    static bool lib_Execute(gc::ThreadAllocator &allocator, JSValue thisArg, const ArgumentVector &arguments, JSValue &retVal, JSValue &error)
     {
         JSValue normalized;
         if (!lib_NormalizePath(allocator, thisArg, arguments, normalized, error))
@@ -51,19 +68,61 @@ struct VMInitializeHelper : public Singleton<VMInitializeHelper>
         return func->Call(allocator, thisArg, args, retVal, error);
     }
 
-    static bool lib_NormalizePath(gc::ThreadAllocator &allocator, JSValue thisArg, JSArray *arguments, JSValue &retVal, JSValue &error)
+    // __heap_snapshot(path) writes a census of the heap, true if it was written
+    static bool lib_HeapSnapshot(gc::ThreadAllocator &allocator, JSValue thisArg, const ArgumentVector &arguments, JSValue &retVal, JSValue &error)
     {
-        std::vector<std::string> paths;
-        for (size_t i = 0; i < arguments->GetLength(); ++i)
+        JSValue str;
+        if (!runtime::semantic::ToString(allocator, arguments.Get(0), str, error))
         {
-            JSValue arg;
-            if (!runtime::semantic::ObjectGetSafeArray(allocator, arguments, i, arg, error))
-            {
-                return false;
-            }
+            return false;
+        }
+
+        auto written = HeapSnapshot::Take(allocator).Write(str.String()->ToString());
+        js_return(JSValue::FromBoolean(written));
+    }
+
+    // __stats() returns every metric by name, histograms as name.count,
+    // name.sum, name.p50 and name.p99
+    static bool lib_Stats(gc::ThreadAllocator &allocator, JSValue thisArg, const ArgumentVector &arguments, JSValue &retVal, JSValue &error)
+    {
+        auto report = Metrics::GetInstance()->Collect();
+        auto stats = runtime::semantic::NewEmptyObjectSafe(allocator);
+
+        auto set = [&](const std::string &name, u64 value)
+        {
+            stats->Set(allocator,
+                String::New(allocator, name.begin(), name.end()),
+                JSValue::FromNumber(static_cast<double>(value)));
+        };
+
+        for (auto &pair : report.Counters)
+        {
+            set(pair.first, pair.second);
+        }
 
+        for (auto &pair : report.Gauges)
+        {
+            set(pair.first, pair.second);
+        }
+
+        for (auto &pair : report.Histograms)
+        {
+            set(pair.first + ".count", pair.second.Count);
+            set(pair.first + ".sum", pair.second.Sum);
+            set(pair.first + ".p50", pair.second.Percentile(0.5));
+            set(pair.first + ".p99", pair.second.Percentile(0.99));
+        }
+
+        js_return(JSValue::FromObject(stats));
+    }
+
+    static bool lib_NormalizePath(gc::ThreadAllocator &allocator, JSValue thisArg, const ArgumentVector &arguments, JSValue &retVal, JSValue &error)
+    {
+        std::vector<std::string> paths;
+        for (size_t i = 0; i < arguments.Length; ++i)
+        {
             JSValue str;
-            if (!runtime::semantic::ToString(allocator, arg, str, error))
+            if (!runtime::semantic::ToString(allocator, arguments.Values[i], str, error))
             {
                 return false;
             }
@@ -119,35 +178,107 @@ int VM::Execute(gc::ThreadAllocator &allocator)
     return 0;
 }
 
+static bool IsSmallLeaf(IRFunc *func)
+{
+    size_t count = 0;
+    for (auto &block : func->Blocks)
+    {
+        for (auto &inst : block->Insts)
+        {
+            if (inst->Is<ir::Call>() || inst->Is<ir::New>() ||
+                ++count > EAGER_COMPILE_INSTRUCTION_LIMIT)
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static bool HasLoop(IRFunc *func)
+{
+    std::set<IRBlock *> visited;
+    std::set<IRBlock *> inStack;
+
+    std::function<bool(IRBlock *)> dfs = [&](IRBlock *block) -> bool
+    {
+        if (inStack.count(block))
+        {
+            return true;
+        }
+
+        if (!visited.insert(block).second)
+        {
+            return false;
+        }
+
+        inStack.insert(block);
+        bool ret = (block->Consequent && dfs(block->Consequent.Get())) ||
+            (block->Alternate && dfs(block->Alternate.Get()));
+        inStack.erase(block);
+
+        return ret;
+    };
+
+    return !func->Blocks.empty() && dfs(func->Blocks.front().get());
+}
+
 runtime::JSFunction *VM::Compile(gc::ThreadAllocator &allocator, const std::string &path)
 {
-    ByteCode byteCode(path);
-    auto pair = Modules.emplace(byteCode.Load(allocator));
+    Tracer::Span span("vm", "LoadModule", path);
+
+    auto cacheKey = CodeCache::Key(path);
+    auto module = CodeCache::Load(allocator, path, cacheKey);
+    if (!module)
+    {
+        module = ByteCode::LoadLazily(allocator, std::unique_ptr<ByteCode>(new ByteCode(path)));
+    }
+
+    CacheEntries[module.get()] = CacheEntry{ path, cacheKey, CodeCache::OptimizedCount(module.get()) };
+
+    auto pair = Modules.emplace(std::move(module));
     hydra_assert(pair.second, "module is unique");
 
+    // decided before anything is enqueued, compilers inline callees and rewrite their IR
+    std::vector<std::pair<IRFunc *, CompilePriority>> toCompile;
     for (auto &funcIter : pair.first->get()->Functions)
     {
         auto func = funcIter.get();
-        func->BaselineFuture = std::move(std::async(
-            std::launch::deferred,
-            [func]() -> CompiledFunction *
-            {
-                Optimizer::InitialOptimize(func);
-
-                std::unique_ptr<CompileTask> task(new BaselineCompileTask(func));
 
-                size_t registerCount;
-                func->BaselineFunction = std::make_unique<CompiledFunction>(
-                    std::move(task),
-                    func->Length,
-                    func->GetVarCount());
+        if (func == pair.first->get()->Functions.front().get())
+        {
+            if (HasLoop(func))
+            {
+                // runs exactly once, only compiled code can leave a hot loop through OSR
+                func->Interpretable = false;
+                toCompile.emplace_back(func, CompilePriority::High);
+            }
+            else
+            {
+                // runs exactly once, never worth compiling
+                CompiledFunction::Interpret(func);
+            }
+        }
+        else if (func->Materialized.load() && IsSmallLeaf(func))
+        {
+            toCompile.emplace_back(func, CompilePriority::Normal);
+        }
+        // others start in the interpreter and get compiled once hot
+    }
 
-                CompiledFunction *current = nullptr;
-                func->Compiled.compare_exchange_strong(current, func->BaselineFunction.get());
+    // functions still in the bytecode are decided on when they are first created
+    pair.first->get()->OnMaterialize = [](IRFunc *func)
+    {
+        if (IsSmallLeaf(func))
+        {
+            CompileQueue::GetInstance()->EnqueueBaseline(func, CompilePriority::Normal);
+        }
+    };
 
-                return func->BaselineFunction.get();
-            }
-        ));
+    auto compileQueue = CompileQueue::GetInstance();
+    for (auto &entry : toCompile)
+    {
+        compileQueue->EnqueueBaseline(entry.first, entry.second);
     }
 
     auto moduleName = platform::NormalizePath({ path });
@@ -174,6 +305,24 @@ void VM::AddTask(runtime::JSFunction *func)
 
 void VM::Stop()
 {
+    // compilers rewrite the IR that is stored below, and must be done before the heap goes
+    CompileQueue::GetInstance()->Drain();
+
+    // only worth rewriting if more functions got optimized since the load
+    for (auto &module : Modules)
+    {
+        auto &entry = CacheEntries[module.get()];
+        if (CodeCache::IsEnabled() && CodeCache::OptimizedCount(module.get()) > entry.Optimized)
+        {
+            // the cache holds every function, also those that never ran
+            gc::ThreadAllocator allocator(gc::Heap::GetInstance());
+            module->OnMaterialize = nullptr;
+            module->MaterializeAll(allocator);
+
+            CodeCache::Store(module.get(), entry.Path, entry.Key);
+        }
+    }
+
     Logger::GetInstance()->Shutdown();
     gc::Heap::GetInstance()->Shutdown();
 }
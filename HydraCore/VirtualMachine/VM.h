@@ -8,6 +8,7 @@
 #include "IR.h"
 #include "VMDefs.h"
 
+#include <map>
 #include <queue>
 #include <set>
 #include <string>
@@ -33,9 +34,19 @@ public:
     void LoadJsLib(gc::ThreadAllocator &allocator);
 
 private:
+    struct CacheEntry
+    {
+        std::string Path;
+        u64 Key;
+
+        // functions that were optimized when the module was loaded
+        size_t Optimized;
+    };
+
     std::queue<runtime::JSFunction *> Queue;
     std::multiset<runtime::JSFunction *> References;
     std::set<std::unique_ptr<IRModule>> Modules;
+    std::map<IRModule *, CacheEntry> CacheEntries;
 };
 
 } // namespace vm
@@ -2,6 +2,10 @@
 #define _VM_DEFS_H_
 
 #include "Common/HydraCore.h"
+#include "Common/Metrics.h"
+
+#include <atomic>
+#include <string>
 
 namespace hydra
 {
@@ -20,12 +24,94 @@ namespace vm
 {
 
 class Scope;
+class CompiledFunction;
+struct IRInst;
+struct IRFunc;
+struct IRModule;
+
+// cold functions are interpreted until invocations plus back edges reach this
+constexpr static size_t JIT_HOTNESS_THRESHOLD = 100;
+constexpr static size_t OPTIMIZE_HOTNESS_THRESHOLD = 1000;
+
+// after this many deoptimizations a function stays in baseline code
+constexpr static size_t MAXIMAL_DEOPT_COUNT = 4;
+
+// functions up to this size without calls are compiled eagerly in background
+constexpr static size_t EAGER_COMPILE_INSTRUCTION_LIMIT = 64;
+constexpr static size_t DEFAULT_MAX_COMPILER_THREADS = 2;
+
+// calls to known functions up to this size are inlined, until the caller grew by the budget
+constexpr static size_t INLINE_INSTRUCTION_LIMIT = 48;
+constexpr static size_t INLINE_GROWTH_BUDGET = 256;
+
+// generated code lives in arenas of this size, on large pages if the os grants them
+constexpr static size_t CODE_HEAP_ARENA_SIZE = 16 * 1024 * 1024;
+constexpr static bool CODE_HEAP_LARGE_PAGES = false;
+
+// sampling profiler, samples deeper than this are cut at the root
+constexpr static size_t PROFILER_MAX_DEPTH = 64;
+constexpr static size_t PROFILER_BUFFER_SIZE = 4096;
+constexpr static size_t PROFILER_DEFAULT_FREQUENCY = 99;
+
+// allocation profiler, mean bytes allocated between two samples
+constexpr static size_t ALLOCATION_PROFILER_DEFAULT_INTERVAL = 512 * 1024;
+
+// heap snapshots list this many objects with the largest retained size
+constexpr static size_t HEAP_SNAPSHOT_TOP_DOMINATORS = 32;
+
+// bump whenever the IR or what the optimizer leaves in it changes meaning
+constexpr static u32 CODE_CACHE_VERSION = 2;
 
 using GeneratedCode = bool(*)(gc::ThreadAllocator &allocator,
     Scope *scope,
     runtime::JSValue &retVal,
     runtime::JSValue &error);
 
+// per kind of inline cache site; a repatch is a miss that overwrites a filled cache
+struct InlineCacheCounters
+{
+    Metrics::Id Hit;
+    Metrics::Id Miss;
+    Metrics::Id Repatch;
+
+    explicit InlineCacheCounters(const std::string &kind)
+        : Hit(Metrics::GetInstance()->RegisterCounter("ic." + kind + ".hit")),
+        Miss(Metrics::GetInstance()->RegisterCounter("ic." + kind + ".miss")),
+        Repatch(Metrics::GetInstance()->RegisterCounter("ic." + kind + ".repatch"))
+    { }
+};
+
+extern const InlineCacheCounters GetItemCacheCounters;
+extern const InlineCacheCounters SetItemCacheCounters;
+extern const InlineCacheCounters CallCacheCounters;
+
+// monomorphic cache of a CALL site, filled by semantic::CallWithCache.
+// Compiled code checks a hit itself when the arguments are passed as an
+// ArgumentVector, and calls the DirectEntry of Target, which builds its
+// frame without EnterCompiled. Other hits only skip the callee lookup
+struct CallSiteCache
+{
+    std::atomic<CompiledFunction *> Target{ nullptr };
+};
+
+// monomorphic cache of a GET_ITEM or SET_ITEM site with a string key, filled
+// by semantic::ObjectGetAndFixCache and ObjectSetAndFixCache. The klass is in
+// the low 48 bits and the slot index above it, so a hit reads both from one
+// fill. 0 until filled, no klass lives there. A repatch marks Inst as not
+// monomorphic, the optimized tier inlines the klass of the others
+struct PropertyCacheSite
+{
+    constexpr static size_t INDEX_SHIFT = 48;
+    constexpr static size_t INDEX_LIMIT = static_cast<size_t>(1) << (64 - INDEX_SHIFT);
+
+    explicit PropertyCacheSite(IRInst *inst)
+        : Inst(inst)
+    { }
+
+    std::atomic<u64> Entry{ 0 };
+    IRInst *Inst;
+};
+
 } // namespace vm
 } // namespace hydra
 
@@ -1,5 +1,6 @@
 #include "HydraCore/Core.hpp"
 
+#include <cstdlib>
 #include <iostream>
 
 using namespace hydra;
@@ -9,9 +10,12 @@ int main(int argc, const char **argv)
     // ensure initialization order
     {
         Logger::GetInstance();
+        Metrics::GetInstance();
+        Tracer::GetInstance();
         gc::Heap::GetInstance();
         vm::IRModuleGCHelper::GetInstance();
         runtime::semantic::Initialize();
+        vm::CodeHeap::GetInstance();
         vm::VM::GetInstance();
     }
 
@@ -23,16 +27,60 @@ int main(int argc, const char **argv)
         return 1;
     }
 
+    Tracer::SetThreadName("Main");
+
+    // HYDRA_TRACE=<file> records gc, jit and module load spans as chrome trace json
+    auto tracePath = std::getenv("HYDRA_TRACE");
+    if (tracePath)
+    {
+        Tracer::GetInstance()->Start(tracePath);
+    }
+
     auto VM = vm::VM::GetInstance();
     gc::ThreadAllocator allocator(gc::Heap::GetInstance());
 
+    // HYDRA_PROFILE=<file> samples the run into collapsed stacks, at
+    // HYDRA_PROFILE_FREQUENCY samples per second of cpu time
+    auto profilePath = std::getenv("HYDRA_PROFILE");
+    if (profilePath)
+    {
+        auto frequency = std::getenv("HYDRA_PROFILE_FREQUENCY");
+        if (!vm::Profiler::GetInstance()->Start(profilePath,
+            frequency ? std::strtoul(frequency, nullptr, 10) : vm::PROFILER_DEFAULT_FREQUENCY))
+        {
+            std::cerr << "Profiler not available" << std::endl;
+        }
+    }
+
+    // HYDRA_ALLOC_PROFILE=<file> ranks allocation sites by bytes allocated and
+    // promoted, sampling once every HYDRA_ALLOC_PROFILE_INTERVAL bytes on average
+    auto allocProfilePath = std::getenv("HYDRA_ALLOC_PROFILE");
+    if (allocProfilePath)
+    {
+        auto interval = std::getenv("HYDRA_ALLOC_PROFILE_INTERVAL");
+        vm::AllocationProfiler::GetInstance()->Start(allocProfilePath,
+            interval ? std::strtoul(interval, nullptr, 10) : vm::ALLOCATION_PROFILER_DEFAULT_INTERVAL);
+    }
+
     VM->LoadJsLib(allocator);
 
     VM->CompileToTask(allocator, argv[1]);
     VM->Execute(allocator);
 
+    vm::Profiler::GetInstance()->Stop();
+    vm::AllocationProfiler::GetInstance()->Stop();
+
     allocator.SetInactive([](){});
     VM->Stop();
 
+    Tracer::GetInstance()->Stop();
+
+    // HYDRA_STATS=<file> dumps every counter, gauge and histogram as json
+    auto statsPath = std::getenv("HYDRA_STATS");
+    if (statsPath)
+    {
+        Metrics::GetInstance()->WriteJson(statsPath);
+    }
+
     return 0;
 }
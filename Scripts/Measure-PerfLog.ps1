@@ -11,7 +11,7 @@ function ParseTimestamp([string]$literal)
 
 function ParseLogLine([string]$line)
 {
-    $PATTERN = [regex]'^(?<timestamp>\d+:\d\d:\d\d\.\d\d\d\.\d\d\d)\t(?<threadId>\d+)\tPerf \d\.\d\d\d\(\+\d\.\d\d\d\) (?<session>[^:]+)::(?<phase>.+)$'
+    $PATTERN = [regex]'^(?<timestamp>\d+:\d\d:\d\d\.\d\d\d\.\d\d\d)\t(?<threadId>\d+)\t[DIW]\tPerf \d\.\d\d\d\(\+\d\.\d\d\d\) (?<session>[^:]+)::(?<phase>.+)$'
 
     $match = $PATTERN.Match($line)
     if (-not $match.Success)
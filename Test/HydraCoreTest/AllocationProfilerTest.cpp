@@ -0,0 +1,64 @@
+#define CATCH_CONFIG_MAIN
+#include "Catch/include/catch.hpp"
+
+#include "VirtualMachine/AllocationProfiler.h"
+
+#include "TestJSObjects.h"
+
+#include <cmath>
+#include <sstream>
+
+namespace hydra
+{
+
+using runtime::JSObject;
+
+TEST_CASE("AllocationProfilerTest", "[vm]")
+{
+    gc::Heap *heap = gc::Heap::GetInstance();
+    gc::ThreadAllocator allocator(heap);
+
+    constexpr size_t NUMBER = 1000;
+
+    TestJSObjects objects(allocator, u"sampledKey");
+
+    auto profiler = vm::AllocationProfiler::GetInstance();
+
+    // a mean gap of one byte samples nearly every allocation
+    REQUIRE(profiler->Start("AllocationProfilerTest.txt", 1));
+    REQUIRE(!profiler->Start("AllocationProfilerTest.txt", 1));
+
+    objects.Allocate(NUMBER);
+
+    auto report = profiler->Collect();
+    profiler->Stop();
+
+    auto &site = report.Sites[std::make_pair(std::string("JSObject"), std::string("[native]"))];
+
+    SECTION("Sites")
+    {
+        REQUIRE(report.Samples >= NUMBER - 1);
+        REQUIRE(site.Count >= NUMBER - 1);
+        // a sum of estimates, rounding error may push it past NUMBER
+        REQUIRE(std::round(site.Count) <= NUMBER);
+        REQUIRE(site.Bytes >= site.Count * sizeof(JSObject));
+        REQUIRE(site.PendingBytes + site.PromotedBytes <= site.Bytes + 1);
+    }
+
+    SECTION("Write")
+    {
+        std::ostringstream out;
+        report.Write(out);
+
+        REQUIRE(out.str().find("[allocated]") != std::string::npos);
+        REQUIRE(out.str().find("JSObject\t[native]") != std::string::npos);
+    }
+
+    SECTION("Stopped")
+    {
+        objects.New();
+        REQUIRE(profiler->Collect().Sites.empty());
+    }
+}
+
+}
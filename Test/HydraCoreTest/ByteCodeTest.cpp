@@ -18,4 +18,27 @@ TEST_CASE("ByteCodeTest", "[vm]")
     REQUIRE(irModule->Functions.size() == 2);
 }
 
+TEST_CASE("Lazy loading builds only the entry function", "[vm]")
+{
+    std::string filename = "C:/Users/t-jingcz/Documents/HydraEngine/HydraCompiler/test/clouse.ir";
+    gc::ThreadAllocator allocator(gc::Heap::GetInstance());
+
+    auto irModule = vm::ByteCode::LoadLazily(allocator,
+        std::unique_ptr<vm::ByteCode>(new vm::ByteCode(filename)));
+
+    REQUIRE(irModule->Functions.size() == 2);
+
+    auto entry = irModule->Functions[0].get();
+    auto inner = irModule->Functions[1].get();
+    CHECK(entry->Materialized.load());
+    CHECK(!entry->Blocks.empty());
+    CHECK(!inner->Materialized.load());
+    CHECK(inner->Blocks.empty());
+
+    irModule->Materialize(allocator, inner);
+    CHECK(inner->Materialized.load());
+    CHECK(!inner->Blocks.empty());
+    CHECK(inner->Name != nullptr);
+}
+
 }
\ No newline at end of file
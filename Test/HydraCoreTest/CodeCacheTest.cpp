@@ -0,0 +1,142 @@
+#define CATCH_CONFIG_MAIN
+#include "Catch/include/catch.hpp"
+
+#include "Common/Platform.h"
+#include "VirtualMachine/ByteCode.h"
+#include "VirtualMachine/CodeCache.h"
+#include "VirtualMachine/Optimizer.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <vector>
+
+namespace hydra
+{
+
+static std::string Dump(vm::IRModule *module)
+{
+    std::stringstream ss;
+    for (auto &func : module->Functions)
+    {
+        func->Dump(ss);
+    }
+    return ss.str();
+}
+
+static std::vector<u32> ReadWords(const std::string &path)
+{
+    std::ifstream file(path, std::ios::binary);
+    std::vector<char> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    std::vector<u32> words(bytes.size() / sizeof(u32));
+    std::memcpy(words.data(), bytes.data(), words.size() * sizeof(u32));
+    return words;
+}
+
+static void WriteWords(const std::string &path, const std::vector<u32> &words, size_t bytes)
+{
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char *>(words.data()), bytes);
+}
+
+static bool Exists(const std::string &path)
+{
+    return static_cast<bool>(std::ifstream(path));
+}
+
+TEST_CASE("Code cache round trips optimized IR", "[vm]")
+{
+    gc::ThreadAllocator allocator(gc::Heap::GetInstance());
+
+    // a copy, the cache is written next to it and not into the sources
+    auto filename = std::string("CodeCacheTest.ir");
+    {
+        std::ifstream from(platform::NormalizePath({
+            platform::GetDirectoryOfPath(__FILE__),
+            "Fixtures",
+            "optimizer.ir"
+        }), std::ios::binary);
+        REQUIRE(from);
+
+        std::ofstream to(filename, std::ios::binary | std::ios::trunc);
+        to << from.rdbuf();
+    }
+
+    auto cachePath = vm::CodeCache::CachePath(filename);
+    std::remove(cachePath.c_str());
+
+    auto key = vm::CodeCache::Key(filename);
+    REQUIRE(vm::CodeCache::Load(allocator, filename, key) == nullptr);
+
+    vm::ByteCode byteCode(filename);
+    auto module = byteCode.Load(allocator);
+
+    // leave the last function as loaded
+    for (size_t i = 0; i + 1 < module->Functions.size(); ++i)
+    {
+        vm::Optimizer::InitialOptimize(module->Functions[i].get());
+        module->Functions[i]->InitialOptimized = true;
+    }
+
+    REQUIRE(vm::CodeCache::Store(module.get(), filename, key));
+
+    SECTION("a matching key loads the same IR")
+    {
+        auto cached = vm::CodeCache::Load(allocator, filename, key);
+        REQUIRE(cached != nullptr);
+        REQUIRE(cached->Functions.size() == module->Functions.size());
+
+        for (size_t i = 0; i < module->Functions.size(); ++i)
+        {
+            CHECK(cached->Functions[i]->InitialOptimized == module->Functions[i]->InitialOptimized);
+            CHECK(cached->Functions[i]->ScopeEscaped == module->Functions[i]->ScopeEscaped);
+        }
+
+        CHECK(vm::CodeCache::OptimizedCount(cached.get()) == vm::CodeCache::OptimizedCount(module.get()));
+        CHECK(Dump(cached.get()) == Dump(module.get()));
+    }
+
+    SECTION("another key misses")
+    {
+        CHECK(vm::CodeCache::Load(allocator, filename, key + 1) == nullptr);
+        CHECK(Exists(cachePath));
+    }
+
+    SECTION("a truncated cache is rejected and deleted")
+    {
+        auto words = ReadWords(cachePath);
+        WriteWords(cachePath, words, words.size() * sizeof(u32) / 2 + 1);
+
+        CHECK(vm::CodeCache::Load(allocator, filename, key) == nullptr);
+        CHECK(!Exists(cachePath));
+    }
+
+    SECTION("a corrupted cache fails its checksum")
+    {
+        auto words = ReadWords(cachePath);
+        words[words.size() / 3] ^= 0x10;
+        WriteWords(cachePath, words, words.size() * sizeof(u32));
+
+        CHECK(vm::CodeCache::Load(allocator, filename, key) == nullptr);
+        CHECK(!Exists(cachePath));
+    }
+
+    SECTION("counts out of bounds are rejected")
+    {
+        // a section count past the end of the header
+        auto words = ReadWords(cachePath);
+        words[2] = 0xffffffff;
+        WriteWords(cachePath, words, words.size() * sizeof(u32));
+
+        CHECK(vm::CodeCache::Load(allocator, filename, key) == nullptr);
+        CHECK(!Exists(cachePath));
+    }
+
+    std::remove(cachePath.c_str());
+    std::remove(filename.c_str());
+}
+
+}
@@ -0,0 +1,54 @@
+#define CATCH_CONFIG_MAIN
+#include "Catch/include/catch.hpp"
+
+#include "VirtualMachine/CodeHeap.h"
+
+#include <cstring>
+#include <vector>
+
+namespace hydra
+{
+
+TEST_CASE("Code heap reuses freed code of the same size class", "[vm]")
+{
+    auto heap = vm::CodeHeap::GetInstance();
+
+    // mov eax, 42; ret
+    const u8 code[] = { 0xB8, 0x2A, 0x00, 0x00, 0x00, 0xC3 };
+
+    auto first = heap->Install(code, sizeof(code));
+    REQUIRE(first != nullptr);
+    CHECK(std::memcmp(first, code, sizeof(code)) == 0);
+
+    auto second = heap->Install(code, sizeof(code));
+    CHECK(second != first);
+
+    auto used = heap->GetUsed();
+    heap->Free(first, sizeof(code));
+    CHECK(heap->GetUsed() < used);
+
+    auto third = heap->Install(code, sizeof(code));
+    CHECK(third == first);
+
+    auto func = reinterpret_cast<int(*)()>(third);
+    CHECK(func() == 42);
+
+    heap->Free(second, sizeof(code));
+    heap->Free(third, sizeof(code));
+}
+
+TEST_CASE("Code heap places large code in one piece", "[vm]")
+{
+    auto heap = vm::CodeHeap::GetInstance();
+
+    std::vector<u8> code(100000, 0x90);
+    code.back() = 0xC3;
+
+    auto installed = heap->Install(code.data(), code.size());
+    CHECK(std::memcmp(installed, code.data(), code.size()) == 0);
+
+    heap->Free(installed, code.size());
+    CHECK(heap->Install(code.data(), code.size()) == installed);
+}
+
+}
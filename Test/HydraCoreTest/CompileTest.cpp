@@ -0,0 +1,341 @@
+#define CATCH_CONFIG_MAIN
+#include "Catch/include/catch.hpp"
+
+#include "Common/Metrics.h"
+#include "Common/Platform.h"
+#include "Runtime/JSArray.h"
+#include "Runtime/JSFunction.h"
+#include "Runtime/Semantic.h"
+#include "VirtualMachine/ByteCode.h"
+#include "VirtualMachine/CodeHeap.h"
+#include "VirtualMachine/CompiledFunction.h"
+#include "VirtualMachine/IR.h"
+
+#include <algorithm>
+#include <mutex>
+
+namespace hydra
+{
+
+using runtime::ArgumentVector;
+using runtime::JSValue;
+
+static void InitializeRuntime()
+{
+    static std::once_flag once;
+    std::call_once(once, []()
+    {
+        gc::Heap::GetInstance();
+        vm::IRModuleGCHelper::GetInstance();
+        runtime::semantic::Initialize();
+        vm::CodeHeap::GetInstance();
+    });
+}
+
+// the functions of Fixtures/compile.js, each with baseline code
+static std::unique_ptr<vm::IRModule> LoadFixture(gc::ThreadAllocator &allocator)
+{
+    vm::ByteCode byteCode(platform::NormalizePath({
+        platform::GetDirectoryOfPath(__FILE__),
+        "Fixtures",
+        "compile.ir"
+    }));
+    auto module = byteCode.Load(allocator);
+    module->MaterializeAll(allocator);
+
+    for (auto &func : module->Functions)
+    {
+        func->BaselineClaimed = true;
+        vm::CompiledFunction::Baseline(func.get());
+    }
+    return module;
+}
+
+static vm::IRFunc *FindFunc(vm::IRModule *module, const char *name)
+{
+    for (auto &func : module->Functions)
+    {
+        if (func->Name && func->Name->ToString() == name)
+        {
+            return func.get();
+        }
+    }
+    hydra_trap("function not in fixture");
+}
+
+// calls a function of the fixture on its own, with no enclosing scope
+static bool Call(
+    gc::ThreadAllocator &allocator,
+    vm::IRFunc *func,
+    std::initializer_list<JSValue> arguments,
+    JSValue &retVal,
+    JSValue &error)
+{
+    std::vector<JSValue> values(arguments);
+    auto callee = runtime::semantic::NewRootFunc(allocator, func, JSValue());
+    return callee->CallWithArgv(allocator, JSValue(), ArgumentVector{ values.data(), values.size() }, retVal, error);
+}
+
+static u64 Counter(const std::string &name)
+{
+    return Metrics::GetInstance()->Collect().Counters[name];
+}
+
+TEST_CASE("Compile", "[vm]")
+{
+    InitializeRuntime();
+
+    gc::ThreadAllocator allocator(gc::Heap::GetInstance());
+    auto module = LoadFixture(allocator);
+
+    JSValue retVal;
+    JSValue error;
+
+    for (auto &func : module->Functions)
+    {
+        REQUIRE_FALSE(func->Compiled.load()->IsInterpreted());
+    }
+
+    // two objects of one shape and one of another
+    JSValue first, second, other;
+    REQUIRE(Call(allocator, FindFunc(module.get(), "point"),
+        { JSValue::FromSmallInt(1), JSValue::FromSmallInt(2) }, first, error));
+    REQUIRE(Call(allocator, FindFunc(module.get(), "point"),
+        { JSValue::FromSmallInt(3), JSValue::FromSmallInt(4) }, second, error));
+    REQUIRE(Call(allocator, FindFunc(module.get(), "swapped"),
+        { JSValue::FromSmallInt(5), JSValue::FromSmallInt(6) }, other, error));
+    REQUIRE(first.Object()->GetKlass() == second.Object()->GetKlass());
+    REQUIRE(first.Object()->GetKlass() != other.Object()->GetKlass());
+
+    SECTION("Property get cache misses, hits and repatches")
+    {
+        auto getX = FindFunc(module.get(), "getX");
+        auto hit = Counter("ic.get_item.hit");
+        auto miss = Counter("ic.get_item.miss");
+        auto repatch = Counter("ic.get_item.repatch");
+
+        // the empty cache misses and is filled
+        REQUIRE(Call(allocator, getX, { first }, retVal, error));
+        REQUIRE(retVal.SmallInt() == 1);
+        REQUIRE(Counter("ic.get_item.miss") == miss + 1);
+        REQUIRE(Counter("ic.get_item.hit") == hit);
+
+        // same shape, the generated code reads the slot itself
+        REQUIRE(Call(allocator, getX, { second }, retVal, error));
+        REQUIRE(retVal.SmallInt() == 3);
+        REQUIRE(Counter("ic.get_item.miss") == miss + 1);
+        REQUIRE(Counter("ic.get_item.hit") == hit + 1);
+
+        // x is in another slot, the cache is overwritten
+        REQUIRE(Call(allocator, getX, { other }, retVal, error));
+        REQUIRE(retVal.SmallInt() == 5);
+        REQUIRE(Counter("ic.get_item.miss") == miss + 2);
+        REQUIRE(Counter("ic.get_item.repatch") == repatch + 1);
+
+        REQUIRE(Call(allocator, getX, { other }, retVal, error));
+        REQUIRE(retVal.SmallInt() == 5);
+        REQUIRE(Counter("ic.get_item.hit") == hit + 2);
+    }
+
+    SECTION("Property set cache misses and hits")
+    {
+        auto setX = FindFunc(module.get(), "setX");
+        auto hit = Counter("ic.set_item.hit");
+        auto miss = Counter("ic.set_item.miss");
+
+        REQUIRE(Call(allocator, setX, { first, JSValue::FromSmallInt(7) }, retVal, error));
+        REQUIRE(retVal.SmallInt() == 7);
+        REQUIRE(Counter("ic.set_item.miss") == miss + 1);
+        REQUIRE(Counter("ic.set_item.hit") == hit);
+
+        // a string written through the cache, the write barrier is taken
+        auto value = runtime::String::New(allocator, u"seven");
+        REQUIRE(Call(allocator, setX, { second, JSValue::FromString(value) }, retVal, error));
+        REQUIRE(retVal.String() == value);
+        REQUIRE(Counter("ic.set_item.miss") == miss + 1);
+        REQUIRE(Counter("ic.set_item.hit") == hit + 1);
+
+        REQUIRE(Call(allocator, FindFunc(module.get(), "getX"), { second }, retVal, error));
+        REQUIRE(retVal.String() == value);
+    }
+
+    SECTION("Optimized code computes numbers as doubles")
+    {
+        auto mix = FindFunc(module.get(), "mix");
+        auto less = FindFunc(module.get(), "less");
+
+        // baseline code records that the operands were doubles
+        REQUIRE(Call(allocator, mix, { JSValue::FromNumber(1.5), JSValue::FromNumber(0.5) }, retVal, error));
+        REQUIRE(retVal.Number() == 3.25);
+        REQUIRE(Call(allocator, less, { JSValue::FromNumber(0.5), JSValue::FromNumber(1.5) }, retVal, error));
+        REQUIRE(retVal.Boolean());
+
+        vm::CompiledFunction::Optimize(mix);
+        vm::CompiledFunction::Optimize(less);
+
+        REQUIRE(Call(allocator, mix, { JSValue::FromNumber(1.5), JSValue::FromNumber(0.5) }, retVal, error));
+        REQUIRE(retVal.Number() == 3.25);
+
+        // small ints are converted, a product of two stays a small int
+        REQUIRE(Call(allocator, mix, { JSValue::FromSmallInt(3), JSValue::FromSmallInt(2) }, retVal, error));
+        REQUIRE(retVal.Number() == 5.5);
+
+        REQUIRE(Call(allocator, mix, { JSValue::FromNumber(NAN), JSValue::FromSmallInt(1) }, retVal, error));
+        REQUIRE(retVal.Payload == JSValue::NAN_PAYLOAD);
+
+        REQUIRE(Call(allocator, less, { JSValue::FromSmallInt(2), JSValue::FromNumber(1.5) }, retVal, error));
+        REQUIRE_FALSE(retVal.Boolean());
+        REQUIRE(Call(allocator, less, { JSValue::FromNumber(NAN), JSValue::FromNumber(1.5) }, retVal, error));
+        REQUIRE_FALSE(retVal.Boolean());
+        REQUIRE(Call(allocator, less, { JSValue::FromNumber(1.5), JSValue::FromNumber(NAN) }, retVal, error));
+        REQUIRE_FALSE(retVal.Boolean());
+
+        REQUIRE(mix->DeoptCount.load() == 0);
+        REQUIRE(less->DeoptCount.load() == 0);
+
+        // not a number, the frame continues in baseline code
+        REQUIRE(Call(allocator, mix, { JSValue(), JSValue::FromSmallInt(1) }, retVal, error));
+        REQUIRE(retVal.Payload == JSValue::NAN_PAYLOAD);
+        REQUIRE(mix->DeoptCount.load() == 1);
+        REQUIRE(mix->Compiled.load() == mix->BaselineFunction.get());
+    }
+
+    SECTION("Optimized property access inlines the klass")
+    {
+        auto getX = FindFunc(module.get(), "getX");
+        auto setX = FindFunc(module.get(), "setX");
+
+        REQUIRE(Call(allocator, getX, { first }, retVal, error));
+        REQUIRE(Call(allocator, setX, { first, JSValue::FromSmallInt(1) }, retVal, error));
+        vm::CompiledFunction::Optimize(getX);
+        vm::CompiledFunction::Optimize(setX);
+
+        // no cache is consulted, the slot of the klass is read and written
+        auto hit = Counter("ic.get_item.hit");
+        REQUIRE(Call(allocator, getX, { second }, retVal, error));
+        REQUIRE(retVal.SmallInt() == 3);
+        REQUIRE(Counter("ic.get_item.hit") == hit);
+
+        auto value = runtime::String::New(allocator, u"eight");
+        REQUIRE(Call(allocator, setX, { second, JSValue::FromString(value) }, retVal, error));
+        REQUIRE(retVal.String() == value);
+        REQUIRE(getX->DeoptCount.load() == 0);
+        REQUIRE(setX->DeoptCount.load() == 0);
+
+        // another klass deoptimizes
+        REQUIRE(Call(allocator, getX, { other }, retVal, error));
+        REQUIRE(retVal.SmallInt() == 5);
+        REQUIRE(getX->DeoptCount.load() == 1);
+
+        // a repatched cache is not speculated on, the next round keeps it
+        vm::CompiledFunction::Optimize(getX);
+        REQUIRE(Call(allocator, getX, { first }, retVal, error));
+        REQUIRE(retVal.SmallInt() == 1);
+        REQUIRE(Call(allocator, getX, { other }, retVal, error));
+        REQUIRE(retVal.SmallInt() == 5);
+        REQUIRE(getX->DeoptCount.load() == 1);
+    }
+
+    SECTION("Optimized loops check arrays once on entry")
+    {
+        auto sumTo = FindFunc(module.get(), "sumTo");
+        auto array = runtime::semantic::NewArrayInternal(allocator);
+        for (size_t i = 0; i < 3; ++i)
+        {
+            array->Set(allocator, i, JSValue::FromSmallInt(i + 1));
+        }
+
+        REQUIRE(Call(allocator, sumTo, { JSValue::FromObject(array), JSValue::FromSmallInt(3) }, retVal, error));
+        REQUIRE(retVal.SmallInt() == 6);
+        vm::CompiledFunction::Optimize(sumTo);
+
+        REQUIRE(Call(allocator, sumTo, { JSValue::FromObject(array), JSValue::FromSmallInt(3) }, retVal, error));
+        REQUIRE(retVal.SmallInt() == 6);
+        REQUIRE(sumTo->DeoptCount.load() == 0);
+
+        // keys past the split point, the loop is not entered in optimized code
+        REQUIRE(Call(allocator, sumTo, { JSValue::FromObject(array), JSValue::FromSmallInt(9) }, retVal, error));
+        REQUIRE(retVal.Payload == JSValue::NAN_PAYLOAD);
+        REQUIRE(sumTo->DeoptCount.load() == 1);
+
+        auto header = std::find_if(sumTo->Blocks.begin(), sumTo->Blocks.end(), [](const std::unique_ptr<vm::IRBlock> &block)
+        {
+            return block->LoopHeader.Get() == block.get();
+        });
+        REQUIRE(header != sumTo->Blocks.end());
+        REQUIRE(((*header)->Insts.front()->Feedback.load() & vm::IRInst::FEEDBACK_NOT_IN_BOUNDS) != 0);
+
+        // the next round checks every access again
+        vm::CompiledFunction::Optimize(sumTo);
+        REQUIRE(Call(allocator, sumTo, { JSValue::FromObject(array), JSValue::FromSmallInt(9) }, retVal, error));
+        REQUIRE(retVal.Payload == JSValue::NAN_PAYLOAD);
+        REQUIRE(Call(allocator, sumTo, { JSValue::FromObject(array), JSValue::FromSmallInt(3) }, retVal, error));
+        REQUIRE(retVal.SmallInt() == 6);
+        REQUIRE(sumTo->DeoptCount.load() == 1);
+    }
+
+    SECTION("Call cache hits enter the callee directly")
+    {
+        auto add = FindFunc(module.get(), "add");
+        auto count = FindFunc(module.get(), "count");
+        REQUIRE(add->Compiled.load()->GetDirectEntry());
+        REQUIRE(count->Compiled.load()->GetDirectEntry());
+
+        auto addCallee = JSValue::FromObject(runtime::semantic::NewRootFunc(allocator, add, JSValue()));
+        auto countCallee = JSValue::FromObject(runtime::semantic::NewRootFunc(allocator, count, JSValue()));
+        auto hit = Counter("ic.call.hit");
+        auto miss = Counter("ic.call.miss");
+
+        // both sites miss once, then the frames are built by add itself
+        REQUIRE(Call(allocator, FindFunc(module.get(), "twice"), { addCallee, JSValue::FromSmallInt(3) }, retVal, error));
+        REQUIRE(retVal.SmallInt() == 6);
+        REQUIRE(Counter("ic.call.miss") == miss + 2);
+        REQUIRE(Call(allocator, FindFunc(module.get(), "twice"), { addCallee, JSValue::FromSmallInt(4) }, retVal, error));
+        REQUIRE(retVal.SmallInt() == 7);
+        REQUIRE(Counter("ic.call.miss") == miss + 2);
+        REQUIRE(Counter("ic.call.hit") == hit + 2);
+
+        // nested direct frames on one stack
+        REQUIRE(Call(allocator, count, { countCallee, JSValue::FromSmallInt(5) }, retVal, error));
+        REQUIRE(retVal.SmallInt() == 15);
+        REQUIRE(Counter("ic.call.miss") == miss + 3);
+        REQUIRE(Counter("ic.call.hit") == hit + 6);
+
+        // more arguments than the direct frame holds go through the helper
+        REQUIRE(Call(allocator, FindFunc(module.get(), "many"), { addCallee }, retVal, error));
+        REQUIRE(retVal.SmallInt() == 3);
+        REQUIRE(Call(allocator, FindFunc(module.get(), "many"), { addCallee }, retVal, error));
+        REQUIRE(retVal.SmallInt() == 3);
+    }
+
+    SECTION("Closures outlive a frame on the stack")
+    {
+        auto counter = FindFunc(module.get(), "counter");
+        auto offsets = FindFunc(module.get(), "offsets");
+        REQUIRE_FALSE(counter->Compiled.load()->IsScopeEscaped());
+        REQUIRE_FALSE(offsets->Compiled.load()->IsScopeEscaped());
+
+        REQUIRE(Call(allocator, counter, { JSValue::FromSmallInt(5) }, retVal, error));
+        auto increment = dynamic_cast<runtime::JSFunction *>(retVal.Object());
+        REQUIRE(increment);
+        REQUIRE(increment->CallWithArgv(allocator, JSValue(), ArgumentVector{ nullptr, 0 }, retVal, error));
+        REQUIRE(retVal.SmallInt() == 6);
+        REQUIRE(increment->CallWithArgv(allocator, JSValue(), ArgumentVector{ nullptr, 0 }, retVal, error));
+        REQUIRE(retVal.SmallInt() == 7);
+
+        // each closure keeps the loop scope it was created in
+        JSValue closures;
+        REQUIRE(Call(allocator, offsets, { JSValue::FromSmallInt(3) }, closures, error));
+        for (size_t i = 0; i < 3; ++i)
+        {
+            JSValue closure;
+            runtime::JSObjectPropertyAttribute attribute;
+            REQUIRE(dynamic_cast<runtime::JSArray *>(closures.Object())->Get(i, closure, attribute));
+            REQUIRE(dynamic_cast<runtime::JSFunction *>(closure.Object())->CallWithArgv(
+                allocator, JSValue(), ArgumentVector{ nullptr, 0 }, retVal, error));
+            REQUIRE(retVal.SmallInt() == static_cast<i64>(i + 3));
+        }
+    }
+}
+
+}
@@ -3,6 +3,8 @@
 
 #include "Common/ConcurrentLevelHashSet.h"
 
+#include <set>
+
 namespace hydra
 {
 
@@ -78,6 +80,25 @@ TEST_CASE("ConcurrentLevelHashSet", "Common")
         }
     }
 
+    SECTION("Foreach visits every element once")
+    {
+        uintptr_t NUMBER = 10000;
+
+        for (uintptr_t i = sizeof(int); i < NUMBER; i += sizeof(int))
+        {
+            uut.Add(reinterpret_cast<int*>(i));
+        }
+
+        std::set<int *> visited;
+        uut.Foreach([&](int *ptr)
+        {
+            bool inserted = visited.insert(ptr).second;
+            REQUIRE(inserted);
+        });
+
+        REQUIRE(visited.size() == NUMBER / sizeof(int) - 1);
+    }
+
     SECTION("Mult-thread 1-1")
     {
         std::atomic<bool> shouldExit{ false };
@@ -0,0 +1,84 @@
+// Input of CompileTest, every function is compiled to baseline code and
+// called on its own with the arguments the test passes. Compile it with
+// `node HydraCompiler/index.js compile.js` after changing it.
+
+function point(x, y)
+{
+    return { x : x, y : y };
+}
+
+function swapped(x, y)
+{
+    return { y : y, x : x };
+}
+
+function getX(o)
+{
+    return o.x;
+}
+
+function setX(o, value)
+{
+    o.x = value;
+    return o.x;
+}
+
+function mix(a, b)
+{
+    return a * b + a / b - b;
+}
+
+function less(a, b)
+{
+    return a < b;
+}
+
+function add(a, b)
+{
+    return a + b;
+}
+
+function twice(f, x)
+{
+    return f(f(x, 1), 2);
+}
+
+function count(f, n)
+{
+    if (n < 1)
+    {
+        return 0;
+    }
+    return n + f(f, n - 1);
+}
+
+function many(f)
+{
+    return f(1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20);
+}
+
+function sumTo(array, n)
+{
+    let sum = 0;
+    for (let i = 0; i < n; ++i)
+    {
+        sum += array[i];
+    }
+    return sum;
+}
+
+function counter(start)
+{
+    return () => ++start;
+}
+
+function offsets(n)
+{
+    let result = [];
+    for (let i = 0; i < n; ++i)
+    {
+        let offset = i + n;
+        result[i] = () => offset;
+    }
+    return result;
+}
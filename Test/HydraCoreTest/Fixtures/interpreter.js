@@ -0,0 +1,71 @@
+// Input of InterpreterTest, each function is called on its own with the
+// arguments the test passes. Compile it with
+// `node HydraCompiler/index.js interpreter.js` after changing it.
+
+function arithmetic(a, b)
+{
+    return (a + b) * 2 - a / b;
+}
+
+function concatenate(a, b)
+{
+    return a + "-" + b;
+}
+
+function sign(n)
+{
+    if (n < 0)
+    {
+        return -1;
+    }
+    else if (n == 0)
+    {
+        return 0;
+    }
+    return 1;
+}
+
+function sumBelow(n)
+{
+    let sum = 0;
+    for (let i = 0; i < n; ++i)
+    {
+        sum += i;
+    }
+    return sum;
+}
+
+function calls(x)
+{
+    function square(y)
+    {
+        return y * y;
+    }
+
+    let offset = 1;
+    let addOffset = (y) => y + offset;
+    return addOffset(square(x));
+}
+
+function properties()
+{
+    let point = { x : 1, y : 2 };
+    point.z = point.x + point["y"];
+
+    let array = [1, 2, 3];
+    array[1] = 5;
+
+    return point.z * 100 + array[1] * 10 + array.length;
+}
+
+function propagatesError(callback)
+{
+    function inner()
+    {
+        callback();
+        return 1;
+    }
+
+    inner();
+    return 2;
+}
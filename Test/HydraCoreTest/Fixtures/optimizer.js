@@ -0,0 +1,163 @@
+// Input of OptimizerTest, each function is what one case looks at. Compile
+// it with `node HydraCompiler/index.js optimizer.js` after changing it.
+
+function constantBranch()
+{
+    let limit = 2;
+    if (limit < 3)
+    {
+        return 10;
+    }
+    return 20;
+}
+
+function redundantExpression(a, b)
+{
+    let first = a * b;
+    let second = a * b;
+    return first - second;
+}
+
+function sideEffects(object, callback)
+{
+    let unused = object.value * 2;
+    callback(object);
+    object.value = 2;
+    return 0;
+}
+
+function loopIndex(array)
+{
+    let sum = 0;
+    for (let i = 0; i < array.length; ++i)
+    {
+        sum += array[i];
+    }
+    return sum;
+}
+
+function loopBound(array, n)
+{
+    let sum = 0;
+    for (let i = 0; i < n; ++i)
+    {
+        sum += array[i];
+    }
+    return sum;
+}
+
+function negativeIndex(array)
+{
+    for (let i = -1; i < array.length; ++i)
+    {
+        array[i] = 0;
+    }
+}
+
+function fractionIndex(array)
+{
+    for (let i = 0; i < array.length; i += 0.5)
+    {
+        array[i] = 0;
+    }
+}
+
+function literalInRegisters(a)
+{
+    let point = { x : a, y : 2 };
+    point.x = point.x + point["y"];
+    return point.x;
+}
+
+function literalPassedToCall(callback)
+{
+    let point = { x : 1 };
+    callback(point);
+    return point.x;
+}
+
+function literalReturned()
+{
+    let point = { x : 1 };
+    return point;
+}
+
+function literalComputedKey(key)
+{
+    let point = { x : 1 };
+    return point[key];
+}
+
+function literalStored(target)
+{
+    let point = { x : 1 };
+    target.point = point;
+    return point.x;
+}
+
+function literalMerged(condition)
+{
+    let point = { x : 1 };
+    if (condition)
+    {
+        point = { x : 2 };
+    }
+    return point.x;
+}
+
+function literalCaptured()
+{
+    let point = { x : 1 };
+    return function () { return point.x; };
+}
+
+function callsLeaf(x)
+{
+    function subtract(a, b)
+    {
+        return a - b;
+    }
+
+    return subtract(x, 1);
+}
+
+function callsReadThis()
+{
+    function readThis()
+    {
+        return this;
+    }
+
+    return readThis();
+}
+
+function callsRecursive(n)
+{
+    function countDown(k)
+    {
+        return k == 0 ? 0 : countDown(k - 1);
+    }
+
+    return countDown(n);
+}
+
+function keepsScope(a)
+{
+    let b = a + 1;
+    return b * 2;
+}
+
+function makesClosure(a)
+{
+    return () => a;
+}
+
+function capturesLoopVariable(array)
+{
+    let closures = [];
+    for (let i = 0; i < array.length; ++i)
+    {
+        closures.push(() => i);
+    }
+    return closures;
+}
@@ -89,14 +89,14 @@ int main()
 
         if (round % 100 == 0)
         {
-            Logger::GetInstance()->Log() << "Round " << (ROUND - round);
+            hydra_log_info("Round {}", ROUND - round);
         }
     }
 
     allocator.SetInactive([]() {});
 
     auto ended = std::chrono::system_clock::now();
-    Logger::GetInstance()->Log() << "Test Finished: " << std::chrono::duration_cast<std::chrono::milliseconds>(ended - started).count() << "ms";
+    hydra_log_info("Test Finished: {}ms", std::chrono::duration_cast<std::chrono::milliseconds>(ended - started).count());
 
     heap->Shutdown();
     Logger::GetInstance()->Shutdown();
@@ -180,7 +180,7 @@ TEST_CASE("ForeachWordOnStack", "[GC]")
 {
     platform::ForeachWordOnStack([](void *ptr)
     {
-        Logger::GetInstance()->Log() << ptr << "\t" << std::hex << *reinterpret_cast<uintptr_t*>(ptr);
+        hydra_log_debug("{}\t{}", ptr, *reinterpret_cast<void **>(ptr));
     });
 }
 
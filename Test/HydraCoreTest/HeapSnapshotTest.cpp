@@ -0,0 +1,96 @@
+#define CATCH_CONFIG_MAIN
+#include "Catch/include/catch.hpp"
+
+#include "VirtualMachine/HeapSnapshot.h"
+
+#include "TestJSObjects.h"
+
+#include <atomic>
+#include <sstream>
+#include <thread>
+
+namespace hydra
+{
+
+using runtime::JSObject;
+
+TEST_CASE("HeapSnapshotTest", "[vm]")
+{
+    gc::Heap *heap = gc::Heap::GetInstance();
+    gc::ThreadAllocator allocator(heap);
+
+    constexpr size_t NUMBER = 100;
+
+    TestJSObjects objects(allocator, u"snapshotKey");
+    TestJSObjects parkedObjects(allocator, u"parkedKey");
+
+    // another thread allocates strings meanwhile, one object held only on its stack
+    std::atomic<bool> ready { false };
+    std::atomic<bool> done { false };
+    std::thread worker([&]()
+    {
+        gc::ThreadAllocator workerAllocator(heap);
+        JSObject *volatile parked = parkedObjects.Shape->NewObject<JSObject>(workerAllocator);
+        ready = true;
+
+        while (!done)
+        {
+            runtime::String::New(workerAllocator, u"garbage");
+        }
+
+        (void)parked;
+    });
+
+    while (!ready)
+    {
+        std::this_thread::yield();
+    }
+
+    auto before = vm::HeapSnapshot::Take(allocator);
+    objects.Allocate(NUMBER);
+    auto after = vm::HeapSnapshot::Take(allocator);
+
+    done = true;
+    worker.join();
+
+    SECTION("Census")
+    {
+        REQUIRE(after.ByType["JSObject"].Count == before.ByType["JSObject"].Count + NUMBER);
+        REQUIRE(after.ByShape["{snapshotKey}"].Count == before.ByShape["{snapshotKey}"].Count + NUMBER);
+        REQUIRE(after.Total.Count >= before.Total.Count + NUMBER);
+        REQUIRE(after.Total.ShallowBytes >= after.Reachable.ShallowBytes);
+        REQUIRE(after.Reachable.RetainedBytes == after.Reachable.ShallowBytes);
+    }
+
+    SECTION("Stacks of other threads are roots")
+    {
+        REQUIRE(after.ByShape["{parkedKey}"].Count == before.ByShape["{parkedKey}"].Count);
+        REQUIRE(after.ByShape["{parkedKey}"].RetainedBytes >= sizeof(JSObject));
+    }
+
+    SECTION("Retained")
+    {
+        for (auto &pair : after.ByType)
+        {
+            CAPTURE(pair.first);
+            REQUIRE(pair.second.RetainedBytes <= after.Reachable.RetainedBytes);
+        }
+
+        for (size_t i = 1; i < after.Dominators.size(); ++i)
+        {
+            REQUIRE(after.Dominators[i - 1].RetainedBytes >= after.Dominators[i].RetainedBytes);
+            REQUIRE(after.Dominators[i].RetainedBytes >= after.Dominators[i].ShallowBytes);
+        }
+    }
+
+    SECTION("Write")
+    {
+        std::ostringstream out;
+        after.Write(out);
+
+        REQUIRE(out.str().find("[type]") != std::string::npos);
+        REQUIRE(out.str().find("{snapshotKey}") != std::string::npos);
+    }
+}
+
+}
@@ -0,0 +1,173 @@
+#define CATCH_CONFIG_MAIN
+#include "Catch/include/catch.hpp"
+
+#include "Common/Platform.h"
+#include "Runtime/JSFunction.h"
+#include "Runtime/Semantic.h"
+#include "VirtualMachine/ByteCode.h"
+#include "VirtualMachine/CodeHeap.h"
+#include "VirtualMachine/CompileQueue.h"
+#include "VirtualMachine/IR.h"
+
+#include <mutex>
+
+namespace hydra
+{
+
+using runtime::ArgumentVector;
+using runtime::JSValue;
+
+static void InitializeRuntime()
+{
+    static std::once_flag once;
+    std::call_once(once, []()
+    {
+        gc::Heap::GetInstance();
+        vm::IRModuleGCHelper::GetInstance();
+        runtime::semantic::Initialize();
+        vm::CodeHeap::GetInstance();
+    });
+}
+
+// the functions of Fixtures/interpreter.js, bodies loaded
+static std::unique_ptr<vm::IRModule> LoadFixture(gc::ThreadAllocator &allocator)
+{
+    vm::ByteCode byteCode(platform::NormalizePath({
+        platform::GetDirectoryOfPath(__FILE__),
+        "Fixtures",
+        "interpreter.ir"
+    }));
+    auto module = byteCode.Load(allocator);
+    module->MaterializeAll(allocator);
+    return module;
+}
+
+static vm::IRFunc *FindFunc(vm::IRModule *module, const char *name)
+{
+    for (auto &func : module->Functions)
+    {
+        if (func->Name && func->Name->ToString() == name)
+        {
+            return func.get();
+        }
+    }
+    hydra_trap("function not in fixture");
+}
+
+// calls a function of the fixture on its own, with no enclosing scope
+static bool Call(
+    gc::ThreadAllocator &allocator,
+    vm::IRFunc *func,
+    std::initializer_list<JSValue> arguments,
+    JSValue &retVal,
+    JSValue &error)
+{
+    std::vector<JSValue> values(arguments);
+    auto callee = runtime::semantic::NewRootFunc(allocator, func, JSValue());
+    return callee->CallWithArgv(allocator, JSValue(), ArgumentVector{ values.data(), values.size() }, retVal, error);
+}
+
+static double ToDouble(JSValue value)
+{
+    return value.Type() == runtime::Type::T_SMALL_INT ?
+        static_cast<double>(value.SmallInt()) :
+        value.Number();
+}
+
+TEST_CASE("Interpreter", "[vm]")
+{
+    InitializeRuntime();
+
+    gc::ThreadAllocator allocator(gc::Heap::GetInstance());
+    auto module = LoadFixture(allocator);
+
+    JSValue retVal;
+    JSValue error;
+
+    SECTION("Arithmetic")
+    {
+        REQUIRE(Call(allocator, FindFunc(module.get(), "arithmetic"),
+            { JSValue::FromSmallInt(3), JSValue::FromSmallInt(4) }, retVal, error));
+        REQUIRE(ToDouble(retVal) == 13.25);
+
+        auto a = runtime::String::New(allocator, u"a");
+        auto b = runtime::String::New(allocator, u"b");
+        REQUIRE(Call(allocator, FindFunc(module.get(), "concatenate"),
+            { JSValue::FromString(a), JSValue::FromString(b) }, retVal, error));
+        REQUIRE(retVal.Type() == runtime::Type::T_STRING);
+        REQUIRE(retVal.String()->ToString() == "a-b");
+    }
+
+    SECTION("Branches")
+    {
+        auto sign = FindFunc(module.get(), "sign");
+
+        REQUIRE(Call(allocator, sign, { JSValue::FromSmallInt(-5) }, retVal, error));
+        REQUIRE(ToDouble(retVal) == -1);
+
+        REQUIRE(Call(allocator, sign, { JSValue::FromSmallInt(0) }, retVal, error));
+        REQUIRE(ToDouble(retVal) == 0);
+
+        REQUIRE(Call(allocator, sign, { JSValue::FromNumber(0.5) }, retVal, error));
+        REQUIRE(ToDouble(retVal) == 1);
+    }
+
+    SECTION("Calls")
+    {
+        // a local function and an arrow capturing a variable
+        REQUIRE(Call(allocator, FindFunc(module.get(), "calls"),
+            { JSValue::FromSmallInt(5) }, retVal, error));
+        REQUIRE(ToDouble(retVal) == 26);
+    }
+
+    SECTION("Property access")
+    {
+        REQUIRE(Call(allocator, FindFunc(module.get(), "properties"), { }, retVal, error));
+        REQUIRE(ToDouble(retVal) == 353);
+    }
+
+    SECTION("Errors propagate through interpreted frames")
+    {
+        auto thrower = runtime::semantic::NewNativeFunc(allocator,
+            [](gc::ThreadAllocator &allocator, JSValue thisArg, const ArgumentVector &arguments, JSValue &retVal, JSValue &error)
+        {
+            error = JSValue::FromSmallInt(42);
+            return false;
+        });
+
+        REQUIRE_FALSE(Call(allocator, FindFunc(module.get(), "propagatesError"),
+            { JSValue::FromObject(thrower) }, retVal, error));
+        REQUIRE(error.Type() == runtime::Type::T_SMALL_INT);
+        REQUIRE(error.SmallInt() == 42);
+    }
+
+    SECTION("Hot loop requests baseline code")
+    {
+        auto sumBelow = FindFunc(module.get(), "sumBelow");
+
+        // one call, its back edges alone pass the threshold
+        REQUIRE(Call(allocator, sumBelow,
+            { JSValue::FromSmallInt(vm::JIT_HOTNESS_THRESHOLD * 2) }, retVal, error));
+        REQUIRE(ToDouble(retVal) == vm::JIT_HOTNESS_THRESHOLD * (vm::JIT_HOTNESS_THRESHOLD * 2 - 1));
+        REQUIRE(sumBelow->BaselineRequested.load());
+
+        // the IR is not freed while a compiler still works on it
+        vm::CompileQueue::GetInstance()->WaitBaseline(sumBelow);
+    }
+
+    SECTION("Destroying a module cancels its compilations")
+    {
+        auto other = LoadFixture(allocator);
+        auto compileQueue = vm::CompileQueue::GetInstance();
+        for (auto &func : other->Functions)
+        {
+            compileQueue->EnqueueBaseline(func.get(), vm::CompilePriority::Low);
+        }
+
+        // nothing queued or compiling may touch the functions afterwards
+        other.reset();
+        REQUIRE(compileQueue->GetPendingCount() == 0);
+    }
+}
+
+}
@@ -0,0 +1,108 @@
+#define CATCH_CONFIG_MAIN
+#include "Catch/include/catch.hpp"
+
+#include "Common/Logger.h"
+
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+namespace hydra
+{
+
+TEST_CASE("LoggerTest", "Common")
+{
+    Logger::Record record {};
+
+    SECTION("Arguments")
+    {
+        double number = 1.5;
+
+        record.Format = "{} {} {} {} {}";
+        record.Count = 5;
+        record.Types[0] = Logger::ArgType::SIGNED;
+        record.Args[0] = static_cast<u64>(-3);
+        record.Types[1] = Logger::ArgType::UNSIGNED;
+        record.Args[1] = 7;
+        record.Types[2] = Logger::ArgType::DOUBLE;
+        std::memcpy(&record.Args[2], &number, sizeof(number));
+        record.Types[3] = Logger::ArgType::STRING;
+        record.Args[3] = reinterpret_cast<u64>("name");
+        record.Types[4] = Logger::ArgType::STRING;
+        record.Args[4] = 0;
+
+        REQUIRE(Logger::Format(record) == "-3 7 1.500 name (null)");
+    }
+
+    SECTION("Missing arguments")
+    {
+        record.Format = "{} and {}";
+        record.Count = 1;
+        record.Types[0] = Logger::ArgType::UNSIGNED;
+        record.Args[0] = 42;
+
+        REQUIRE(Logger::Format(record) == "42 and {}");
+    }
+
+    SECTION("Events from many threads")
+    {
+        constexpr size_t THREADS = 4;
+        constexpr size_t EVENTS = 1000;
+
+        std::stringstream out;
+        {
+            Logger logger(out);
+
+            std::vector<std::thread> threads;
+            for (size_t i = 0; i < THREADS; ++i)
+            {
+                threads.emplace_back([&logger, i]()
+                {
+                    for (size_t j = 0; j < EVENTS; ++j)
+                    {
+                        logger.Event(Logger::Level::DEBUG, "thread {} event {}", i, j);
+                    }
+                });
+            }
+
+            for (auto &thread : threads)
+            {
+                thread.join();
+            }
+
+            // drains the rings of the exited threads once more
+            logger.Shutdown();
+        }
+
+        std::vector<size_t> counts(THREADS, 0);
+        std::vector<std::string> lastTimes(THREADS);
+
+        std::string line;
+        while (std::getline(out, line))
+        {
+            size_t thread, event;
+            if (std::sscanf(line.c_str(), "%*s\t%*s\tD\tthread %zu event %zu", &thread, &event) != 2)
+            {
+                continue;
+            }
+
+            // a fixed width timestamp, each thread's events come in the order logged
+            auto time = line.substr(0, line.find('\t'));
+            REQUIRE(thread < THREADS);
+            REQUIRE(event == counts[thread]);
+            REQUIRE(time >= lastTimes[thread]);
+
+            ++counts[thread];
+            lastTimes[thread] = time;
+        }
+
+        for (auto count : counts)
+        {
+            REQUIRE(count == EVENTS);
+        }
+    }
+}
+
+}
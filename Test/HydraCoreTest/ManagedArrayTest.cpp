@@ -3,10 +3,13 @@
 
 #include "Runtime/ManagedArray.h"
 
+#include <vector>
+
 namespace hydra
 {
 
 using runtime::Array;
+using runtime::RangeArray;
 using runtime::JSValue;
 
 TEST_CASE("Array", "[Runtime]")
@@ -23,4 +26,26 @@ TEST_CASE("Array", "[Runtime]")
     }
 }
 
+TEST_CASE("Array in place", "[Runtime]")
+{
+    size_t level = Array::LevelFromCapacity(16);
+    std::vector<u8> buffer(gc::Region::CellSizeFromLevel(level));
+
+    Array *uut = Array::NewInPlace(buffer.data(), level);
+    REQUIRE(uut->Capacity() >= 16);
+    REQUIRE(uut->IsInUse());
+
+    for (auto value : *uut)
+    {
+        REQUIRE(value == JSValue());
+    }
+
+    size_t rangeLevel = RangeArray::LevelFromCapacity(5);
+    std::vector<u8> rangeBuffer(gc::Region::CellSizeFromLevel(rangeLevel));
+
+    RangeArray *range = RangeArray::NewInPlace(rangeBuffer.data(), rangeLevel, 5);
+    REQUIRE(range->GetLength() == 5);
+    REQUIRE(std::distance(range->begin(), range->end()) == 5);
+}
+
 }
\ No newline at end of file
@@ -0,0 +1,91 @@
+#define CATCH_CONFIG_MAIN
+#include "Catch/include/catch.hpp"
+
+#include "Common/Metrics.h"
+
+#include <memory>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+namespace hydra
+{
+
+TEST_CASE("MetricsTest", "Common")
+{
+    auto metrics = Metrics::GetInstance();
+
+    SECTION("Counters are summed over threads")
+    {
+        constexpr size_t THREADS = 4;
+        constexpr size_t NUMBER = 100000;
+
+        auto counter = metrics->RegisterCounter("test.counter");
+        auto levels = metrics->RegisterCounters("test.level", 3);
+
+        std::vector<std::thread> threads;
+        for (size_t i = 0; i < THREADS; ++i)
+        {
+            threads.emplace_back([=]()
+            {
+                for (size_t j = 0; j < NUMBER; ++j)
+                {
+                    Metrics::Add(counter);
+                }
+                Metrics::Add(levels + 2, 5);
+            });
+        }
+
+        for (auto &thread : threads)
+        {
+            thread.join();
+        }
+
+        auto report = metrics->Collect();
+        REQUIRE(report.Counters["test.counter"] == THREADS * NUMBER);
+        REQUIRE(report.Counters["test.level.00"] == 0);
+        REQUIRE(report.Counters["test.level.02"] == THREADS * 5);
+    }
+
+    SECTION("Histogram")
+    {
+        auto histogram = metrics->RegisterHistogram("test.histogram");
+
+        for (u64 i = 1; i <= 100; ++i)
+        {
+            Metrics::Record(histogram, i);
+        }
+        Metrics::Record(histogram, 0);
+
+        auto report = metrics->Collect();
+        auto &result = report.Histograms["test.histogram"];
+
+        REQUIRE(result.Count == 101);
+        REQUIRE(result.Sum == 5050);
+        REQUIRE(result.Buckets[0] == 1);
+        REQUIRE(result.Buckets[1] == 1);    // 1
+        REQUIRE(result.Buckets[2] == 2);    // 2, 3
+        REQUIRE(result.Buckets[7] == 37);   // 64 .. 100
+        REQUIRE(result.Percentile(0.5) == 63);
+        REQUIRE(result.Percentile(0.99) == 127);
+    }
+
+    SECTION("Gauges and json")
+    {
+        // the gauge stays registered after this section returns
+        auto value = std::make_shared<u64>(42);
+        metrics->RegisterGauge("test.gauge", [value]() { return *value; });
+
+        auto report = metrics->Collect();
+        REQUIRE(report.Gauges["test.gauge"] == 42);
+
+        *value = 7;
+        std::ostringstream out;
+        metrics->Collect().WriteJson(out);
+
+        REQUIRE(out.str().find("\"test.gauge\": 7") != std::string::npos);
+        REQUIRE(out.str().find("\"histograms\"") != std::string::npos);
+    }
+}
+
+}
@@ -0,0 +1,363 @@
+#define CATCH_CONFIG_MAIN
+#include "Catch/include/catch.hpp"
+
+#include "Common/Platform.h"
+#include "VirtualMachine/ByteCode.h"
+#include "VirtualMachine/Optimizer.h"
+
+namespace hydra
+{
+
+// the functions of Fixtures/optimizer.js, bodies loaded
+static std::unique_ptr<vm::IRModule> LoadFixture(gc::ThreadAllocator &allocator)
+{
+    vm::ByteCode byteCode(platform::NormalizePath({
+        platform::GetDirectoryOfPath(__FILE__),
+        "Fixtures",
+        "optimizer.ir"
+    }));
+    auto module = byteCode.Load(allocator);
+    module->MaterializeAll(allocator);
+    return module;
+}
+
+static vm::IRFunc *FindFunc(vm::IRModule *module, const char *name)
+{
+    for (auto &func : module->Functions)
+    {
+        if (func->Name && func->Name->ToString() == name)
+        {
+            return func.get();
+        }
+    }
+    hydra_trap("function not in fixture");
+}
+
+static vm::IRFunc *Optimized(vm::IRModule *module, const char *name)
+{
+    auto func = FindFunc(module, name);
+    vm::Optimizer::InitialOptimize(func);
+    return func;
+}
+
+template <typename T>
+static T *FindInst(vm::IRFunc *func)
+{
+    for (auto &block : func->Blocks)
+    {
+        for (auto &inst : block->Insts)
+        {
+            if (inst->Is<T>())
+            {
+                return inst->As<T>();
+            }
+        }
+    }
+    return nullptr;
+}
+
+template <typename T>
+static size_t CountInsts(vm::IRFunc *func)
+{
+    size_t count = 0;
+    for (auto &block : func->Blocks)
+    {
+        for (auto &inst : block->Insts)
+        {
+            count += inst->Is<T>();
+        }
+    }
+    return count;
+}
+
+static size_t CountInsts(vm::IRFunc *func)
+{
+    size_t count = 0;
+    for (auto &block : func->Blocks)
+    {
+        count += block->Insts.size();
+    }
+    return count;
+}
+
+static size_t CountBranches(vm::IRFunc *func)
+{
+    size_t count = 0;
+    for (auto &block : func->Blocks)
+    {
+        count += block->Condition ? 1 : 0;
+    }
+    return count;
+}
+
+static void OptimizeToSSA(vm::IRFunc *func)
+{
+    vm::Optimizer::RemoveAfterReturn(func);
+    vm::Optimizer::ControlFlowAnalyze(func);
+    vm::Optimizer::InlineScope(func);
+    vm::Optimizer::ArgToLocalAllocaAndMoveCapture(func);
+    vm::Optimizer::MemToReg(func);
+    vm::Optimizer::CleanupBlocks(func);
+    vm::Optimizer::RemoveMove(func);
+}
+
+TEST_CASE("Scalar optimizations never add instructions", "[vm]")
+{
+    gc::ThreadAllocator allocator(gc::Heap::GetInstance());
+    auto before = LoadFixture(allocator);
+    auto after = LoadFixture(allocator);
+
+    REQUIRE(before->Functions.size() == after->Functions.size());
+
+    for (size_t i = 0; i < before->Functions.size(); ++i)
+    {
+        auto beforeFunc = before->Functions[i].get();
+        auto afterFunc = after->Functions[i].get();
+
+        OptimizeToSSA(beforeFunc);
+
+        OptimizeToSSA(afterFunc);
+        vm::Optimizer::ConstantPropagate(afterFunc);
+        vm::Optimizer::GlobalValueNumbering(afterFunc);
+        vm::Optimizer::RemoveDeadCode(afterFunc);
+
+        INFO("function " << i);
+        CHECK(CountInsts(afterFunc) <= CountInsts(beforeFunc));
+    }
+}
+
+TEST_CASE("Scalar optimizations", "[vm]")
+{
+    gc::ThreadAllocator allocator(gc::Heap::GetInstance());
+    auto module = LoadFixture(allocator);
+
+    SECTION("Constant propagation folds a constant branch")
+    {
+        auto func = FindFunc(module.get(), "constantBranch");
+        OptimizeToSSA(func);
+        REQUIRE(CountBranches(func) == 1);
+
+        vm::Optimizer::ConstantPropagate(func);
+        REQUIRE(CountBranches(func) == 0);
+
+        vm::Optimizer::CleanupBlocks(func);
+        vm::Optimizer::RemoveDeadCode(func);
+
+        // only the taken side is left
+        REQUIRE(CountInsts<vm::ir::Return>(func) == 1);
+        auto value = FindInst<vm::ir::Return>(func)->_Value.Get();
+        REQUIRE(value->Is<vm::ir::Number>());
+        REQUIRE(value->As<vm::ir::Number>()->Value == 10);
+    }
+
+    SECTION("Value numbering merges a redundant expression")
+    {
+        auto func = FindFunc(module.get(), "redundantExpression");
+        OptimizeToSSA(func);
+        REQUIRE(CountInsts<vm::ir::Mul>(func) == 2);
+
+        vm::Optimizer::GlobalValueNumbering(func);
+        REQUIRE(CountInsts<vm::ir::Mul>(func) == 1);
+
+        auto sub = FindInst<vm::ir::Sub>(func);
+        REQUIRE(sub);
+        REQUIRE(sub->_A.Get() == sub->_B.Get());
+    }
+
+    SECTION("Dead code removal keeps side effects")
+    {
+        auto func = FindFunc(module.get(), "sideEffects");
+        OptimizeToSSA(func);
+        REQUIRE(CountInsts<vm::ir::Mul>(func) == 1);
+
+        vm::Optimizer::RemoveDeadCode(func);
+
+        // the unused product goes, the read it multiplies may run a getter
+        REQUIRE(CountInsts<vm::ir::Mul>(func) == 0);
+        REQUIRE(CountInsts<vm::ir::GetItem>(func) == 1);
+        REQUIRE(CountInsts<vm::ir::Call>(func) == 1);
+        REQUIRE(CountInsts<vm::ir::SetItem>(func) == 1);
+    }
+}
+
+TEST_CASE("Range analysis only proves non-negative integer keys", "[vm]")
+{
+    gc::ThreadAllocator allocator(gc::Heap::GetInstance());
+    auto module = LoadFixture(allocator);
+
+    SECTION("Loop index bounded by the length")
+    {
+        auto func = Optimized(module.get(), "loopIndex");
+
+        // array.length is a get_item too, by a string key
+        size_t elements = 0;
+        for (auto &block : func->Blocks)
+        {
+            for (auto &inst : block->Insts)
+            {
+                if (inst->Is<vm::ir::GetItem>() && !inst->As<vm::ir::GetItem>()->_Key->Is<vm::ir::String>())
+                {
+                    ++elements;
+                    REQUIRE(inst->As<vm::ir::GetItem>()->IndexKey);
+
+                    // the length is read again on every iteration
+                    REQUIRE_FALSE(inst->As<vm::ir::GetItem>()->Bound);
+                }
+            }
+        }
+        REQUIRE(elements == 1);
+    }
+
+    SECTION("Loop index bounded by a value the loop never changes")
+    {
+        auto getItem = FindInst<vm::ir::GetItem>(Optimized(module.get(), "loopBound"));
+        REQUIRE(getItem);
+        REQUIRE(getItem->IndexKey);
+        REQUIRE(getItem->Bound);
+        REQUIRE(getItem->Bound->Is<vm::ir::Load>());
+        REQUIRE(getItem->Bound->As<vm::ir::Load>()->_Addr->Is<vm::ir::Arg>());
+        REQUIRE(getItem->Bound->As<vm::ir::Load>()->_Addr->As<vm::ir::Arg>()->Index == 1);
+    }
+
+    SECTION("Negative index")
+    {
+        auto setItem = FindInst<vm::ir::SetItem>(Optimized(module.get(), "negativeIndex"));
+        REQUIRE(setItem);
+        REQUIRE_FALSE(setItem->IndexKey);
+    }
+
+    SECTION("Non-integer index")
+    {
+        auto setItem = FindInst<vm::ir::SetItem>(Optimized(module.get(), "fractionIndex"));
+        REQUIRE(setItem);
+        REQUIRE_FALSE(setItem->IndexKey);
+    }
+}
+
+TEST_CASE("Scope escape analysis", "[vm]")
+{
+    gc::ThreadAllocator allocator(gc::Heap::GetInstance());
+    auto module = LoadFixture(allocator);
+
+    SECTION("Scope without closures stays on the stack")
+    {
+        REQUIRE(!Optimized(module.get(), "keepsScope")->ScopeEscaped);
+        REQUIRE(!Optimized(module.get(), "literalInRegisters")->ScopeEscaped);
+    }
+
+    SECTION("Closures keep the frame on the stack")
+    {
+        REQUIRE(!Optimized(module.get(), "makesClosure")->ScopeEscaped);
+    }
+
+    SECTION("Loop scope captured by a closure keeps the frame on the stack")
+    {
+        auto func = Optimized(module.get(), "capturesLoopVariable");
+        REQUIRE(!func->ScopeEscaped);
+        REQUIRE(CountInsts<vm::ir::PushScope>(func) == 1);
+    }
+
+    SECTION("Closure capturing a parameter in place escapes")
+    {
+        auto func = Optimized(module.get(), "makesClosure");
+        auto &entry = func->Blocks.front()->Insts;
+        auto arg = new vm::ir::Arg();
+        arg->Index = 0;
+        entry.emplace(entry.begin(), arg);
+        FindInst<vm::ir::Arrow>(func)->Captured.push_back(arg);
+
+        vm::Optimizer::ScopeEscapeAnalyze(func);
+        REQUIRE(func->ScopeEscaped);
+    }
+}
+
+TEST_CASE("Scalar replacement of literals", "[vm]")
+{
+    gc::ThreadAllocator allocator(gc::Heap::GetInstance());
+    auto module = LoadFixture(allocator);
+
+    SECTION("Literal read by constant keys only lives in registers")
+    {
+        auto func = Optimized(module.get(), "literalInRegisters");
+        REQUIRE(CountInsts<vm::ir::Object>(func) == 0);
+        REQUIRE(CountInsts<vm::ir::GetItem>(func) == 0);
+        REQUIRE(CountInsts<vm::ir::SetItem>(func) == 0);
+    }
+
+    SECTION("Literal passed to a call is kept")
+    {
+        REQUIRE(CountInsts<vm::ir::Object>(Optimized(module.get(), "literalPassedToCall")) == 1);
+    }
+
+    SECTION("Returned literal is kept")
+    {
+        REQUIRE(CountInsts<vm::ir::Object>(Optimized(module.get(), "literalReturned")) == 1);
+    }
+
+    SECTION("Literal read by a computed key is kept")
+    {
+        auto func = Optimized(module.get(), "literalComputedKey");
+        REQUIRE(CountInsts<vm::ir::Object>(func) == 1);
+        REQUIRE(CountInsts<vm::ir::GetItem>(func) == 1);
+    }
+
+    SECTION("Literal stored into another object is kept")
+    {
+        REQUIRE(CountInsts<vm::ir::Object>(Optimized(module.get(), "literalStored")) == 1);
+    }
+
+    SECTION("Literals merged by a phi are kept")
+    {
+        REQUIRE(CountInsts<vm::ir::Object>(Optimized(module.get(), "literalMerged")) == 2);
+    }
+
+    SECTION("Literal captured by a closure is kept")
+    {
+        REQUIRE(CountInsts<vm::ir::Object>(Optimized(module.get(), "literalCaptured")) == 1);
+    }
+}
+
+TEST_CASE("Inline calls", "[vm]")
+{
+    gc::ThreadAllocator allocator(gc::Heap::GetInstance());
+    auto module = LoadFixture(allocator);
+
+    SECTION("Leaf is inlined with its arguments in order")
+    {
+        auto func = Optimized(module.get(), "callsLeaf");
+        REQUIRE(CountInsts<vm::ir::Call>(func) == 0);
+
+        // subtract(x, 1) is x - 1, not 1 - x
+        auto sub = FindInst<vm::ir::Sub>(func);
+        REQUIRE(sub);
+
+        auto a = sub->_A.Get();
+        REQUIRE(a->Is<vm::ir::Load>());
+        auto addr = a->As<vm::ir::Load>()->_Addr.Get();
+        REQUIRE(addr->Is<vm::ir::Arg>());
+        REQUIRE(addr->As<vm::ir::Arg>()->Index == 0);
+
+        auto b = sub->_B.Get();
+        REQUIRE(b->Is<vm::ir::Number>());
+        REQUIRE(b->As<vm::ir::Number>()->Value == 1);
+    }
+
+    SECTION("This of the callee is the receiver of the call")
+    {
+        auto func = Optimized(module.get(), "callsReadThis");
+        REQUIRE(CountInsts<vm::ir::Call>(func) == 0);
+        REQUIRE(CountInsts<vm::ir::This>(func) == 0);
+
+        auto ret = FindInst<vm::ir::Return>(func);
+        REQUIRE(ret);
+        REQUIRE(ret->_Value.Get()->Is<vm::ir::GetGlobal>());
+    }
+
+    SECTION("Recursive callee is not inlined")
+    {
+        auto func = Optimized(module.get(), "callsRecursive");
+        REQUIRE(CountInsts<vm::ir::Call>(func) == 1);
+    }
+}
+
+}
\ No newline at end of file
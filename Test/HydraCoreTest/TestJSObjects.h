@@ -0,0 +1,39 @@
+#ifndef _TEST_JS_OBJECTS_H_
+#define _TEST_JS_OBJECTS_H_
+
+#include "Common/HydraCore.h"
+#include "GarbageCollection/GC.h"
+#include "Runtime/JSObject.h"
+#include "Runtime/Klass.h"
+
+#include <vector>
+
+// JSObjects of a shape with a single key, kept alive by the test
+struct TestJSObjects
+{
+    TestJSObjects(hydra::gc::ThreadAllocator &allocator, const char16_t *key)
+        : Allocator(allocator),
+        Shape(hydra::runtime::Klass::EmptyKlass(allocator)->AddTransaction(
+            allocator, hydra::runtime::String::New(allocator, key)))
+    {
+    }
+
+    hydra::runtime::JSObject *New()
+    {
+        return Shape->NewObject<hydra::runtime::JSObject>(Allocator);
+    }
+
+    void Allocate(size_t number)
+    {
+        for (size_t i = 0; i < number; ++i)
+        {
+            Objects.push_back(New());
+        }
+    }
+
+    hydra::gc::ThreadAllocator &Allocator;
+    hydra::runtime::Klass *Shape;
+    std::vector<hydra::runtime::JSObject *> Objects;
+};
+
+#endif // _TEST_JS_OBJECTS_H_
@@ -0,0 +1,105 @@
+#define CATCH_CONFIG_MAIN
+#include "Catch/include/catch.hpp"
+
+#include "Common/Tracer.h"
+
+#include <atomic>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+namespace hydra
+{
+
+TEST_CASE("TracerTest", "Common")
+{
+    std::string path = "TracerTest.json";
+    auto tracer = Tracer::GetInstance();
+
+    {
+        Tracer::Span ignored("test", "BeforeStart");
+    }
+
+    REQUIRE(tracer->Start(path));
+    REQUIRE(!tracer->Start(path));
+
+    constexpr size_t NUMBER = 3000;
+
+    std::thread worker([]()
+    {
+        Tracer::SetThreadName("Worker");
+        for (size_t i = 0; i < NUMBER; ++i)
+        {
+            Tracer::Span span("test", "WorkerSpan");
+        }
+    });
+
+    // past its cap a thread's events are dropped
+    std::thread flood([]()
+    {
+        auto now = Tracer::Clock::now();
+        for (size_t i = 0; i < Tracer::MAX_THREAD_EVENTS + 10; ++i)
+        {
+            Tracer::GetInstance()->Complete("test", "Flood", now, now);
+        }
+    });
+
+    // still recording while the trace is written
+    std::atomic<bool> stopped { false };
+    std::thread racer([&]()
+    {
+        while (!stopped)
+        {
+            Tracer::Span span("test", "Racer");
+        }
+    });
+
+    {
+        Tracer::Span span("test", "MainSpan", "path\\with \"quotes\"");
+        auto start = Tracer::Clock::now();
+        tracer->Complete("test", "MainSlice", start, Tracer::Clock::now());
+    }
+
+    worker.join();
+    flood.join();
+    tracer->Stop();
+    stopped = true;
+    racer.join();
+
+    {
+        Tracer::Span ignored("test", "AfterStop");
+    }
+
+    std::ifstream in(path);
+    std::stringstream content;
+    content << in.rdbuf();
+    std::string json = content.str();
+
+    auto count = [&](const std::string &pattern)
+    {
+        size_t found = 0;
+        for (size_t pos = json.find(pattern); pos != std::string::npos; pos = json.find(pattern, pos + 1))
+        {
+            ++found;
+        }
+        return found;
+    };
+
+    REQUIRE(json.find("\"traceEvents\"") != std::string::npos);
+    REQUIRE(count("\"name\":\"WorkerSpan\"") == NUMBER * 2);
+    REQUIRE(count("\"name\":\"MainSpan\"") == 2);
+    REQUIRE(count("\"name\":\"MainSlice\",\"cat\":\"test\",\"ph\":\"X\"") == 1);
+    REQUIRE(json.find("\"detail\":\"path\\\\with \\\"quotes\\\"\"") != std::string::npos);
+    REQUIRE(json.find("\"args\":{\"name\":\"Worker\"}") != std::string::npos);
+    REQUIRE(count("\"name\":\"Flood\"") == Tracer::MAX_THREAD_EVENTS);
+    REQUIRE(count("\"name\":\"Racer\"") > 0);
+
+    // the racer may have reached its cap too
+    auto dropped = json.find("\"droppedEvents\":");
+    REQUIRE(dropped != std::string::npos);
+    REQUIRE(std::stoul(json.substr(dropped + 16)) >= 10);
+    REQUIRE(json.find("BeforeStart") == std::string::npos);
+    REQUIRE(json.find("AfterStop") == std::string::npos);
+}
+
+}